@@ -0,0 +1,373 @@
+#define _GNU_SOURCE
+#include "anytime.h"
+#include "maxflow.h"
+#include "pushrelabel.h"
+#include "loaddimacs.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <assert.h>
+
+// When a part of a solve must be done, and the arcs it went over since it
+// last looked at the clock
+struct deadline {
+    struct timespec* start;
+    double seconds;         // From the start, 0 for no limit
+    long scanned;
+    int passed;             // 1 once it was found to have passed
+};
+
+static void deadline_init(struct deadline* d, struct timespec* start,
+                          double seconds) {
+    d->start = start;
+    d->seconds = seconds;
+    d->scanned = 0;
+    d->passed = 0;
+}
+
+// Whether the deadline has passed, looking at the clock every
+// ANYTIME_CHECK_ARCS arcs
+static int deadline_passed(struct deadline* d, long arcs) {
+    if (!d || !d->seconds || d->passed) {
+        return d && d->passed;
+    }
+    d->scanned += arcs;
+    if (d->scanned < ANYTIME_CHECK_ARCS) {
+        return 0;
+    }
+    d->scanned = 0;
+    d->passed = d->seconds <= seconds_since(d->start);
+    return d->passed;
+}
+
+// The stop function of the searches of maxflow.h
+static int search_deadline(void* arg) {
+    struct deadline* d = arg;
+    d->passed = d->seconds <= seconds_since(d->start);
+    return d->passed;
+}
+
+// The seconds the solving itself may take, the rest of a time limit is for
+// the upper bound
+static double solve_seconds(struct flow_budget* budget) {
+    return budget ? budget->seconds * (1 - ANYTIME_BOUND_SHARE) : 0;
+}
+
+// Whether a solve that has done 'work' must stop
+static int used_up(struct flow_budget* budget, long work,
+                   struct deadline* d) {
+    if (!budget) {
+        return 0;
+    }
+    if (budget->work && budget->work <= work) {
+        return 1;
+    }
+    return d->seconds && d->seconds <= seconds_since(d->start);
+}
+
+// An arc from level 'from' to level 'to' is cut by the cuts to < k <= from.
+// cut[k] - cut[k - 1] is the change in capacity from cut k - 1 to cut k.
+static void add_arc(long* cut, int from, int to, long capacity) {
+    if (to < from) {
+        cut[to + 1] += capacity;
+        cut[from + 1] -= capacity;
+    }
+}
+
+// labeled_cut_capacity until a deadline
+// Return: The capacity, -1 if the deadline passed first
+static long cut_by_levels(struct graph* g, int* level, int top,
+                          struct deadline* d) {
+    if (top < 1) {
+        return 0;
+    }
+    long* cut = calloc(top + 2, sizeof(long));
+    assert(cut);
+
+    for (int u = 0; u < g->size; u++) {
+        if (deadline_passed(d, g->adj_array[u]->size)) {
+            free(cut);
+            return -1;
+        }
+        assert(0 <= level[u] && level[u] <= top);
+        // The virtual arcs from the super source and to the super sink
+        if (g->supply[u] == TERMINAL_UNBOUNDED) {
+            assert(level[u] == top);
+        }
+        else if (g->supply[u]) {
+            add_arc(cut, top, level[u], g->supply[u]);
+        }
+        if (g->demand[u] == TERMINAL_UNBOUNDED) {
+            assert(level[u] == 0);
+        }
+        else if (g->demand[u]) {
+            add_arc(cut, level[u], 0, g->demand[u]);
+        }
+
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            if (e->original) {
+                add_arc(cut, level[u], level[e->to], e->capacity);
+            }
+        }
+    }
+
+    long capacity = 0, least = LONG_MAX;
+    for (int k = 1; k <= top; k++) {
+        capacity += cut[k];
+        least = capacity < least ? capacity : least;
+    }
+    free(cut);
+    return least;
+}
+
+long labeled_cut_capacity(struct graph* g, int* level, int top) {
+    return cut_by_levels(g, level, top, NULL);
+}
+
+// reachability_cut_capacity until a deadline
+// Return: The capacity, -1 if the deadline passed first
+static long reachable_cut(struct graph* g, struct deadline* d) {
+    int* level = malloc(g->size * sizeof(int));
+    int* queue = malloc(g->size * sizeof(int));
+    assert(level && queue);
+    int head = 0, tail = 0;
+
+    // The level is the distance from the super source for now. The unbounded
+    // sources are a part of it, and the sources with supply left next to it.
+    for (int v = 0; v < g->size; v++) {
+        level[v] = -1;
+        if (g->supply[v] == TERMINAL_UNBOUNDED) {
+            level[v] = 0;
+            queue[tail++] = v;
+        }
+    }
+    for (int v = 0; v < g->size; v++) {
+        if (level[v] == -1 && graph_supply_left(g, v) > 0) {
+            level[v] = 1;
+            queue[tail++] = v;
+        }
+    }
+
+    // The unbounded sinks are a part of the super sink and never reached
+    while (head < tail &&
+           !deadline_passed(d, g->adj_array[queue[head]]->size)) {
+        int u = queue[head++];
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            if (level[e->to] == -1 && get_cfe(e) > 0 &&
+                g->demand[e->to] != TERMINAL_UNBOUNDED) {
+                level[e->to] = level[u] + 1;
+                queue[tail++] = e->to;
+            }
+        }
+    }
+
+    // Closer to the super source is higher
+    long capacity = -1;
+    if (head == tail) {
+        for (int v = 0; v < g->size; v++) {
+            level[v] = level[v] == -1 ? 0 : g->size - level[v];
+        }
+        capacity = cut_by_levels(g, level, g->size, d);
+    }
+    free(level);
+    free(queue);
+    return capacity;
+}
+
+long reachability_cut_capacity(struct graph* g) {
+    return reachable_cut(g, NULL);
+}
+
+// The cut around the super source or around the super sink, whichever is
+// less. It only takes the arcs of the unbounded terminals.
+static long terminal_cut(struct graph* g) {
+    long out = 0, in = 0;
+    for (int u = 0; u < g->size; u++) {
+        if (g->supply[u] && g->supply[u] != TERMINAL_UNBOUNDED) {
+            out += g->supply[u];
+        }
+        if (g->demand[u] && g->demand[u] != TERMINAL_UNBOUNDED) {
+            in += g->demand[u];
+        }
+        if (!is_unbounded_terminal(g, u)) {
+            continue;
+        }
+        // The arcs into an unbounded sink are the reverse edges in its list
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            if (e->original && g->supply[u] == TERMINAL_UNBOUNDED &&
+                g->supply[e->to] != TERMINAL_UNBOUNDED) {
+                out += e->capacity;
+            }
+            if (!e->original && g->demand[u] == TERMINAL_UNBOUNDED &&
+                g->demand[e->to] != TERMINAL_UNBOUNDED) {
+                in += e->reverse_edge->capacity;
+            }
+        }
+    }
+    return out < in ? out : in;
+}
+
+// The least of the cuts that can be had before the end of the time limit:
+// the cut around the terminals, then the one given by the heights if there
+// are any, then the one by reachability
+static long upper_bound(struct graph* g, int* height, int top,
+                        struct deadline* d) {
+    long upper = terminal_cut(g);
+    long cut = height ? cut_by_levels(g, height, top, d) : -1;
+    upper = cut != -1 && cut < upper ? cut : upper;
+    cut = reachable_cut(g, d);
+    return cut != -1 && cut < upper ? cut : upper;
+}
+
+// The flow into the sinks
+static int sink_flow(struct graph* g) {
+    int flow = 0;
+    for (int v = 0; v < g->size; v++) {
+        flow += g->absorbed[v];
+    }
+    return flow;
+}
+
+int anytime_augmenting_paths(struct graph* g,
+                             struct list*(search_algorithm)(struct graph*),
+                             struct flow_budget* budget,
+                             struct flow_bounds* bounds) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct deadline solving, bounding;
+    deadline_init(&solving, &start, solve_seconds(budget));
+    long work = 0;
+    int added = 1;
+
+    // The budget is looked at after every path, and the clock also while a
+    // search goes on
+    if (solving.seconds) {
+        search_set_stop(&search_deadline, &solving);
+    }
+    while (!used_up(budget, work, &solving) &&
+           (added = augment_paths(g, search_algorithm, 1))) {
+        ++work;
+    }
+    search_set_stop(NULL, NULL);
+    // A search that was stopped found no path, but there may be one
+    added |= solving.passed;
+
+    deadline_init(&bounding, &start, budget ? budget->seconds : 0);
+    bounds->lower = sink_flow(g);
+    bounds->finished = !added;
+    bounds->upper = added ? upper_bound(g, NULL, 0, &bounding)
+                          : bounds->lower;
+    bounds->finished |= bounds->upper == bounds->lower;
+    bounds->work = work;
+    bounds->seconds = seconds_since(&start);
+    return bounds->lower;
+}
+
+int anytime_push_relabel(struct graph* g, struct flow_budget* budget,
+                         struct flow_bounds* bounds) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct deadline solving, bounding;
+    deadline_init(&solving, &start, solve_seconds(budget));
+    struct push_relabel pr;
+    push_relabel_init(&pr, g);
+
+    // Without a time limit the run is only stopped by its work budget. With
+    // one the slices start short and double while a slice takes less than
+    // an ANYTIME_SLICE_SHARE of the time left.
+    long slice = LONG_MAX, work = 0;
+    if (solving.seconds) {
+        slice = ANYTIME_FIRST_SLICE;
+    }
+    int finished;
+    do {
+        long allowed = slice;
+        if (budget && budget->work && budget->work - work < allowed) {
+            allowed = budget->work - work;
+        }
+        double before = seconds_since(&start);
+        pr.budget = allowed;
+        push_relabel_run_fifo(&pr);
+        work += allowed - pr.budget;
+        finished = pr.budget > 0;
+        double now = seconds_since(&start);
+        if (slice < LONG_MAX / 2 &&
+            (now - before) * ANYTIME_SLICE_SHARE < solving.seconds - now) {
+            slice *= 2;
+        }
+    } while (!finished && !used_up(budget, work, &solving));
+
+    // The budget can run out just as the last vertex is discharged
+    finished = 1;
+    for (int v = 0; v < g->size; v++) {
+        if (pr.excess[v] > 0 && !is_unbounded_terminal(g, v)) {
+            finished = 0;
+        }
+    }
+
+    bounds->lower = push_relabel_flow(&pr);
+    bounds->upper = bounds->lower;
+    if (!finished) {
+        // The heights above |V| are all on the source side of every cut
+        for (int v = 0; v < g->size; v++) {
+            pr.height[v] = pr.height[v] < g->size ? pr.height[v] : g->size;
+        }
+        deadline_init(&bounding, &start, budget ? budget->seconds : 0);
+        bounds->upper = upper_bound(g, pr.height, g->size, &bounding);
+    }
+    // The flow into the sinks can be maximum while excess is still on its way
+    // back to the sources
+    bounds->finished = bounds->upper == bounds->lower;
+    bounds->work = work;
+    bounds->seconds = seconds_since(&start);
+    push_relabel_free(&pr);
+    return bounds->lower;
+}
+
+void anytime_print(struct flow_bounds* bounds, char* algorithm, FILE* fp) {
+    if (bounds->finished) {
+        fprintf(fp, "anytime: %s maximum flow %d, work %ld, %.3f ms\n",
+                algorithm, bounds->lower, bounds->work,
+                bounds->seconds * 1000);
+        return;
+    }
+    fprintf(fp, "anytime: %s stopped with the maximum flow between %d and "
+            "%ld, %.2f%% apart, work %ld, %.3f ms\n", algorithm,
+            bounds->lower, bounds->upper,
+            100.0 * (bounds->upper - bounds->lower) / bounds->upper,
+            bounds->work, bounds->seconds * 1000);
+}
+
+int anytime_run(char* path, char* algorithm, struct flow_budget* budget,
+                FILE* fp) {
+    struct list* (*search)(struct graph*) = NULL;
+    if (strcmp(algorithm, "bfs") == 0) {
+        search = &bfs;
+    }
+    else if (strcmp(algorithm, "dfs") == 0) {
+        search = &dfs;
+    }
+    else if (strcmp(algorithm, "pr-fifo") != 0) {
+        fprintf(stderr, "No anytime algorithm: %s\n", algorithm);
+        return 1;
+    }
+
+    struct graph* g = read_dimacs_file(path);
+    struct flow_bounds bounds;
+    if (search) {
+        anytime_augmenting_paths(g, search, budget, &bounds);
+    }
+    else {
+        anytime_push_relabel(g, budget, &bounds);
+    }
+    anytime_print(&bounds, algorithm, fp);
+    graph_free(g);
+    return 0;
+}
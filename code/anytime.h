@@ -0,0 +1,109 @@
+#ifndef ANYTIME_H
+#define ANYTIME_H
+
+#include "graph.h"
+#include "list.h"
+
+#include <stdio.h>
+
+/* Solves that can be stopped by a time limit or a limit on their work, and
+ * then report bounds on the maximum flow. The flow into the sinks so far is
+ * a lower bound. An upper bound is the capacity of a cut: the cuts tried are
+ * the levels of a breadth first search from the sources in the residual
+ * graph, and for push-relabel also the levels of the heights, where an empty
+ * height is a gap that no flow can cross.
+ *
+ * A time limit is looked at inside the searches for augmenting paths, every
+ * SEARCH_STOP_VERTICES vertices, and between slices of discharged vertices.
+ * The solve stops after 1 - ANYTIME_BOUND_SHARE of it, and the rest is for
+ * the upper bound. The cut around the terminals is always taken, it only
+ * needs their arcs, and the cuts that need a pass over the graph only if
+ * they are done in time. Without limits the solvers run as fast as they do
+ * otherwise. */
+
+/* When a solve stops. 0 means no limit. */
+struct flow_budget {
+    double seconds;     // From the start of the solve
+    long work;          // Augmenting paths, or vertices discharged
+};
+
+/* Part of a time limit kept for the upper bound */
+#define ANYTIME_BOUND_SHARE 0.25
+
+/* Arcs the cuts go over between looks at the clock */
+#define ANYTIME_CHECK_ARCS 4096
+
+/* Vertices push-relabel discharges in its first slice. The slices double
+ * while one takes less than 1 / ANYTIME_SLICE_SHARE of the time left. */
+#define ANYTIME_FIRST_SLICE 16
+#define ANYTIME_SLICE_SHARE 16
+
+/* What a budgeted solve found. No flow is greater than 'upper', and one of
+ * value 'lower' exists. */
+struct flow_bounds {
+    int lower;
+    long upper;
+    int finished;       // 1 if the flow is maximum, then lower == upper
+    long work;          // Augmenting paths, or vertices discharged
+    double seconds;
+};
+
+/* The least capacity of the cuts given by levels of the vertices. Cut k
+ * for 1 <= k <= top has the vertices at level k and above on the source side,
+ * with the super source at level top and the super sink at level 0. The
+ * capacities of the terminals' virtual arcs are included.
+ * Args:    - Pointer to the graph
+ *          - The level of each vertex, from 0 to top. The unbounded sources
+ *            must be at top and the unbounded sinks at 0.
+ *          - The top level
+ * Return:  The least capacity of the cuts, an upper bound on the flow */
+long labeled_cut_capacity(struct graph* g, int* level, int top);
+
+/* The least capacity of the cuts between levels of a breadth first search
+ * from the sources in the residual graph. With a flow it is the flow plus
+ * the least residual capacity from one level to the next.
+ * Args:    - Pointer to the graph with a flow or a preflow
+ * Return:  An upper bound on the maximum flow */
+long reachability_cut_capacity(struct graph* g);
+
+/* Augments paths found by search_algorithm until there are none or the
+ * budget is used up. The graph is left with a feasible flow.
+ * Args:    - Pointer to the graph
+ *          - Function pointer to a graph search algorithm, bfs or dfs
+ *          - The budget, NULL for none
+ *          - The bounds to fill in
+ * Return:  The flow found, the lower bound */
+int anytime_augmenting_paths(struct graph* g,
+                             struct list*(search_algo)(struct graph*),
+                             struct flow_budget* budget,
+                             struct flow_bounds* bounds);
+
+/* FIFO push-relabel with the gap heuristic until no vertex has excess or the
+ * budget is used up. When it is stopped, the graph is left with a preflow
+ * and the flow into the sinks is the lower bound: the excess of the other
+ * vertices can go back to the sources without changing it. The upper bound
+ * is the least of the cuts given by the heights and by reachability.
+ * Args:    - Pointer to the graph
+ *          - The budget, NULL for none
+ *          - The bounds to fill in
+ * Return:  The flow into the sinks, the lower bound */
+int anytime_push_relabel(struct graph* g, struct flow_budget* budget,
+                         struct flow_bounds* bounds);
+
+/* Prints the bounds on one line
+ * Args:    - Pointer to the bounds
+ *          - The name of the algorithm
+ *          - The file to print to
+ * Return:  Nothing */
+void anytime_print(struct flow_bounds* bounds, char* algorithm, FILE* fp);
+
+/* Loads a graph, solves it with a budget and prints the bounds
+ * Args:    - Path to the graph
+ *          - The algorithm: bfs, dfs or pr-fifo
+ *          - The budget
+ *          - The file to print to
+ * Return:  0 on success, 1 if there is no such algorithm */
+int anytime_run(char* path, char* algorithm, struct flow_budget* budget,
+                FILE* fp);
+
+#endif
@@ -0,0 +1,280 @@
+#define _GNU_SOURCE
+#include "autoselect.h"
+#include "loaddimacs.h"
+#include "solver.h"
+#include "stats.h"
+#include "graph.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+// The profile of a calibrated graph as coordinates of the same scale: log |V|,
+// log |E|, log density, the degree coefficient of variation, the log of the
+// capacity range and the log of the s-t distance
+#define CALIBRATION_FEATURES 6
+
+struct calibration_row {
+    char algorithm[32];
+    int n;
+    long m;
+    int unit;
+    double seconds;
+    double features[CALIBRATION_FEATURES];
+    int profiled;   // 0 for old rows that only have |V| and |E|
+};
+
+static struct calibration_row* rows = NULL;
+static int n_rows = 0;
+static pthread_once_t rows_loaded = PTHREAD_ONCE_INIT;
+
+// The coordinates of a graph's profile for the distance between graphs
+static void features(struct graph_stats* st, double* f) {
+    double mean_degree = 0 < st->n ? (double)st->m / st->n : 0;
+    f[0] = log(st->n + 1.0);
+    f[1] = log(st->m + 1.0);
+    f[2] = log(st->density + 1e-9);
+    f[3] = 0 < mean_degree ? st->degree_stddev / mean_degree : 0;
+    f[4] = log((st->max_capacity + 1.0) / (st->min_capacity + 1.0));
+    f[5] = log(st->st_distance + 2.0);
+}
+
+// Reads the calibration table once. A missing table gives no rows.
+static void load_calibration(void) {
+    char* path = getenv("MAXFLOW_CALIBRATION");
+    FILE* fp = fopen(path ? path : CALIBRATION_FILE, "r");
+    if (!fp) {
+        return;
+    }
+
+    char* line = NULL;
+    size_t len = 0;
+    int max_rows = 0;
+    struct calibration_row row;
+    struct graph_stats st;
+
+    while (getline(&line, &len, fp) != EOF) {
+        if (line[0] == '#') {
+            continue;
+        }
+        // An old row has the seconds where a new one has the density
+        int fields = sscanf(line, "%31s %d %ld %d %lf %lf %d %d %d %lf",
+                            row.algorithm, &st.n, &st.m, &row.unit,
+                            &st.density, &st.degree_stddev, &st.min_capacity,
+                            &st.max_capacity, &st.st_distance, &row.seconds);
+        if (fields == 5) {
+            row.seconds = st.density;
+            st.density = 1 < st.n ? st.m / ((double)st.n * (st.n - 1)) : 0;
+            st.degree_stddev = st.min_capacity = st.max_capacity = 0;
+            st.st_distance = -1;
+        } else if (fields != 10) {
+            continue;
+        }
+        row.n = st.n;
+        row.m = st.m;
+        row.profiled = fields == 10;
+        features(&st, row.features);
+
+        if (n_rows == max_rows) {
+            max_rows = max_rows ? 2 * max_rows : 64;
+            rows = realloc(rows, max_rows * sizeof(struct calibration_row));
+            assert(rows != NULL);
+        }
+        rows[n_rows++] = row;
+    }
+    free(line);
+    fclose(fp);
+}
+
+// Predicts the time of an algorithm from its calibrated graphs with the
+// closest profile. Graphs of the same unit kind are used if there are any.
+// Old rows are compared by log |V| and log |E| only.
+// Return: The predicted time in seconds, -1 if the algorithm is not calibrated
+static double predict(char* algorithm, struct graph_stats* st) {
+    double f[CALIBRATION_FEATURES];
+    int nearest[CALIBRATION_NEIGHBORS];
+    double distance[CALIBRATION_NEIGHBORS];
+    int found = 0, same_unit = 0;
+
+    features(st, f);
+    for (int i = 0; i < n_rows; i++) {
+        if (strcmp(rows[i].algorithm, algorithm) == 0 &&
+            rows[i].unit == (int)st->unit) {
+            same_unit = 1;
+        }
+    }
+
+    for (int i = 0; i < n_rows; i++) {
+        if (strcmp(rows[i].algorithm, algorithm) != 0 ||
+            (same_unit && rows[i].unit != (int)st->unit)) {
+            continue;
+        }
+        int used = rows[i].profiled ? CALIBRATION_FEATURES : 2;
+        double d = 0;
+        for (int k = 0; k < used; k++) {
+            double dk = f[k] - rows[i].features[k];
+            d += dk * dk;
+        }
+
+        // Insert into the sorted list of the nearest rows
+        int at;
+        if (found < CALIBRATION_NEIGHBORS) {
+            at = found++;
+        } else if (d < distance[found - 1]) {
+            at = found - 1;
+        } else {
+            continue;
+        }
+        while (0 < at && d < distance[at - 1]) {
+            nearest[at]  = nearest[at - 1];
+            distance[at] = distance[at - 1];
+            --at;
+        }
+        nearest[at]  = i;
+        distance[at] = d;
+    }
+
+    if (!found) {
+        return -1;
+    }
+    // Geometric mean weighted by closeness, so one noisy timing does not
+    // dominate the prediction
+    double sum = 0, weights = 0;
+    for (int k = 0; k < found; k++) {
+        struct calibration_row* row = &rows[nearest[k]];
+        double scaled = row->seconds * (st->m + 1.0) / (row->m + 1.0);
+        double w = 1 / (sqrt(distance[k]) + 0.1);
+        sum += w * log(scaled + 1e-9);
+        weights += w;
+    }
+    return exp(sum / weights);
+}
+
+// The solvers that may be chosen: the ones that run in this process, but
+// not auto itself
+static int candidate(struct solver* solver) {
+    return solver->in_process && strcmp(solver->name, "auto") != 0;
+}
+
+char* auto_choose(struct graph_stats* st, double* predicted) {
+    pthread_once(&rows_loaded, &load_calibration);
+
+    char* best = NULL;
+    *predicted = -1;
+
+    for (int i = 0; solver_at(i); i++) {
+        struct solver* solver = solver_at(i);
+        if (!candidate(solver)) {
+            continue;
+        }
+        double t = predict(solver->name, st);
+        if (t >= 0 && (!best || t < *predicted)) {
+            best = solver->name;
+            *predicted = t;
+        }
+    }
+    if (best) {
+        return best;
+    }
+
+    // Not calibrated. Highest label pseudoflow is the fastest or close to it
+    // on the random and structured families, sparse or dense. When no sink
+    // can be reached one search is all that is needed, and a hub with most
+    // of the arcs (the funnel) suits FIFO push-relabel.
+    if (st->unit != UNIT_NONE) {
+        return "unit";
+    }
+    if (st->st_distance == -1) {
+        return "bfs";
+    }
+    if (st->degree_stddev > AUTO_HUB_SPREAD * st->mean_degree) {
+        return "pr-fifo";
+    }
+    return "hpf";
+}
+
+int auto_solve(struct graph* g) {
+    struct graph_stats st;
+    double predicted;
+
+    graph_stats_compute(g, &st);
+    char* name = auto_choose(&st, &predicted);
+    struct solver* solver = solver_find(name);
+    assert(solver != NULL);
+
+    graph_stats_print(&st, stderr);
+    if (predicted < 0) {
+        fprintf(stderr, "auto: chose %s by rules, no calibration\n", name);
+    } else {
+        fprintf(stderr, "auto: chose %s, predicted %.3f ms\n", name,
+                predicted * 1000);
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int maxflow = solver->solve(g);
+    double actual = seconds_since(&start);
+
+    if (predicted < 0) {
+        fprintf(stderr, "auto: %s took %.3f ms\n", name, actual * 1000);
+    } else {
+        fprintf(stderr, "auto: %s took %.3f ms, predicted %.3f ms (%.2fx)\n",
+                name, actual * 1000, predicted * 1000,
+                0 < predicted ? actual / predicted : 0);
+    }
+    return maxflow;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+int calibrate(char* table, char** files, int n_files) {
+    FILE* fp = fopen(table, "a");
+    if (!fp) {
+        return 1;
+    }
+    fprintf(fp, "# algorithm |V| |E| unit density degree-stddev "
+            "min-capacity max-capacity s-t-distance seconds\n");
+
+    for (int f = 0; f < n_files; f++) {
+        struct graph_stats st;
+        struct graph* g = read_dimacs_file(files[f]);
+        graph_stats_compute(g, &st);
+        graph_free(g);
+
+        for (int i = 0; solver_at(i); i++) {
+            struct solver* solver = solver_at(i);
+            double times[3];
+            int runs = 0;
+
+            if (!candidate(solver)) {
+                continue;
+            }
+            while (runs < 3 && (runs == 0 || times[0] <= CALIBRATION_SLOW)) {
+                struct timespec start;
+                g = read_dimacs_file(files[f]);
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                solver->solve(g);
+                times[runs++] = seconds_since(&start);
+                graph_free(g);
+            }
+            qsort(times, runs, sizeof(double), compare_doubles);
+
+            fprintf(fp, "%s %d %ld %d %.6f %.3f %d %d %d %.9f\n",
+                    solver->name, st.n, st.m, (int)st.unit, st.density,
+                    st.degree_stddev, st.min_capacity, st.max_capacity,
+                    st.st_distance, times[runs / 2]);
+            fprintf(stderr, "%s %s %.3f ms\n", files[f], solver->name,
+                    times[runs / 2] * 1000);
+        }
+    }
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef AUTOSELECT_H
+#define AUTOSELECT_H
+
+#include "graph.h"
+#include "stats.h"
+
+/* The calibration table is read from this file. The environment variable
+ * MAXFLOW_CALIBRATION can name another file.
+ * Each line is: <algorithm> <|V|> <|E|> <unit kind> <density>
+ * <degree stddev> <min capacity> <max capacity> <s-t distance> <seconds>
+ * Old lines with only <algorithm> <|V|> <|E|> <unit kind> <seconds> are read
+ * too. Lines starting with '#' are comments. */
+#define CALIBRATION_FILE "calibration.txt"
+
+/* How many calibrated graphs with the closest profile are used for a
+ * prediction */
+#define CALIBRATION_NEIGHBORS 3
+
+/* Without calibration, a degree standard deviation above this many times the
+ * mean degree chooses FIFO push-relabel */
+#define AUTO_HUB_SPREAD 4
+
+/* Chooses the algorithm expected to be fastest for a graph. The time of each
+ * algorithm is predicted from the calibrated graphs with the same unit kind
+ * closest in size, density, degree spread, capacity range and s-t distance,
+ * scaled by |E|. pr-region and pr-checkpoint are never chosen. Without a
+ * calibration table simple rules are used instead.
+ * Args:    - Pointer to the graph's statistics
+ *          - Set to the predicted time in seconds, -1 if unknown
+ * Return:  The name of the chosen solver */
+char* auto_choose(struct graph_stats* st, double* predicted);
+
+/* Computes the graph's statistics, chooses an algorithm with auto_choose and
+ * solves the graph with it. The choice and the predicted and actual time are
+ * written to stderr.
+ * Args:    - Pointer to the graph
+ * Return:  The maximum flow */
+int auto_solve(struct graph* g);
+
+/* Times every solver that auto_choose may choose on the graphs and appends the results to a calibration
+ * table. Each time is the median of 3 runs, or of 1 run if it takes more than
+ * CALIBRATION_SLOW seconds.
+ * Args:    - Path to the calibration table
+ *          - Paths to the graphs
+ *          - Number of graphs
+ * Return:  0 on success, 1 if the table cannot be written */
+int calibrate(char* table, char** files, int n_files);
+
+#define CALIBRATION_SLOW 5.0
+
+#endif
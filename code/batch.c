@@ -0,0 +1,551 @@
+#define _GNU_SOURCE
+#include "batch.h"
+#include "graph.h"
+#include "dobfs.h"
+#include "trace.h"
+#include "loaddimacs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+
+// A graph being solved by a worker, with the worker's scratch arrays. The
+// arena's arrays are offset to the graph's first vertex and arc.
+struct batch_run {
+    struct batch_instance* instance;
+    int n;
+    int* first;
+    int* supply;
+    int* demand;
+    int* head;
+    int* rev;
+    int* residual;
+
+    int* height;
+    int* excess;
+    int* current;
+    int* supplied;
+    int* absorbed;
+    int* count;         // Vertices at each height below n, for the gap
+    int* ring;          // The vertices with excess, first in first out
+    int ring_first;
+    int ring_size;
+    int next;           // The vertex to discharge next, -1 when done
+};
+
+// What the workers share
+struct batch_pool {
+    struct batch* b;
+    int interleave;
+    int next;           // The next graph to take
+};
+
+struct batch* batch_init(void) {
+    struct batch* b = calloc(1, sizeof(struct batch));
+    assert(b != NULL);
+    return b;
+}
+
+// Makes room for 'n' more vertices and 'm' more arcs in the arena
+static void batch_reserve(struct batch* b, long n, long m) {
+    if (b->n_size < b->n + n) {
+        b->n_size = 2 * (b->n + n);
+        b->first  = realloc(b->first, b->n_size * sizeof(int));
+        b->supply = realloc(b->supply, b->n_size * sizeof(int));
+        b->demand = realloc(b->demand, b->n_size * sizeof(int));
+        assert(b->first && b->supply && b->demand);
+    }
+    if (b->m_size < b->m + m) {
+        b->m_size   = 2 * (b->m + m);
+        b->head     = realloc(b->head, b->m_size * sizeof(int));
+        b->rev      = realloc(b->rev, b->m_size * sizeof(int));
+        b->capacity = realloc(b->capacity, b->m_size * sizeof(int));
+        b->residual = realloc(b->residual, b->m_size * sizeof(int));
+        assert(b->head && b->rev && b->capacity && b->residual);
+    }
+}
+
+// Reads a whole file into memory, ending with a '\0'
+static char* read_whole_file(char* path) {
+    FILE* fp = fopen(path, "r");
+    assert(fp != NULL);
+    int sought = fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    assert(sought == 0 && 0 <= size);
+    rewind(fp);
+
+    char* text = malloc(size + 1);
+    assert(text);
+    size_t read = fread(text, 1, size, fp);
+    assert(read == (size_t)size);
+    text[size] = '\0';
+    int closed = fclose(fp);
+    assert(closed == 0);
+    return text;
+}
+
+// Like read_and_set_terminal in loaddimacs.c
+static void set_terminal(int* supply, int* demand, int n, char* line) {
+    char* s = line + 1;
+    int id, amount = TERMINAL_UNBOUNDED;
+    int read = read_int(&s, &id);
+    assert(read && 1 <= id && id <= n);
+    while (*s == ' ' || *s == '\t') {
+        ++s;
+    }
+    char kind = *s++;
+    read_int(&s, &amount);
+    // No supply or demand
+    if (amount == 0) {
+        return;
+    }
+    assert(0 < amount);
+
+    if (kind == 's') {
+        assert(demand[id - 1] == 0);
+        supply[id - 1] = amount;
+    } else {
+        assert(supply[id - 1] == 0);
+        demand[id - 1] = amount;
+    }
+}
+
+int batch_add(struct batch* b, char* path) {
+    TRACE_BEGIN("load");
+    char* text = read_whole_file(path);
+
+    if (b->count == b->size) {
+        b->size = b->size ? 2 * b->size : 64;
+        b->instances = realloc(b->instances,
+                               b->size * sizeof(struct batch_instance));
+        assert(b->instances);
+    }
+    struct batch_instance* inst = &b->instances[b->count];
+    inst->path = path;
+    inst->vertex = b->n;
+    inst->arc = b->m;
+    inst->flow = 0;
+
+    // The arcs are kept as they are read, and put in place at the end
+    int n = 0, arcs = 0, arcs_size = 0, terminals_read = 0;
+    int* ends = NULL;
+    int* first = NULL, *supply = NULL, *demand = NULL;
+
+    for (char* line = text, *end = text; end; line = end + 1) {
+        end = strchr(line, '\n');
+        char* s = line + 1;
+        switch (line[0]) {
+            case 'a': // Arc
+                if (arcs == arcs_size) {
+                    arcs_size = arcs_size ? 2 * arcs_size : 1024;
+                    ends = realloc(ends, 3 * arcs_size * sizeof(int));
+                    assert(ends);
+                }
+                int* arc = ends + 3 * arcs;
+                int read = read_int(&s, &arc[0]) && read_int(&s, &arc[1]) &&
+                           read_int(&s, &arc[2]);
+                assert(read);
+                assert(1 <= arc[0] && arc[0] <= n && 1 <= arc[1] &&
+                       arc[1] <= n && arc[0] != arc[1] && 0 <= arc[2]);
+                ++arcs;
+                break;
+            case 'n': // Source or sink
+                // The terminals in the file replace the default s and t
+                if (!terminals_read++) {
+                    memset(supply, 0, n * sizeof(int));
+                    memset(demand, 0, n * sizeof(int));
+                }
+                set_terminal(supply, demand, n, line);
+                break;
+            case 'p': // |V| and |E|
+                while (*s && (*s < '0' || '9' < *s)) {
+                    ++s;
+                }
+                read_int(&s, &n);
+                assert(0 < n);
+                batch_reserve(b, n + 1, 0);
+                first  = b->first + b->n;
+                supply = b->supply + b->n;
+                demand = b->demand + b->n;
+                memset(first, 0, (n + 1) * sizeof(int));
+                memset(supply, 0, (n + 1) * sizeof(int));
+                memset(demand, 0, (n + 1) * sizeof(int));
+                // Default terminals: s = 0 and t = n - 1
+                if (1 < n) {
+                    supply[0] = TERMINAL_UNBOUNDED;
+                    demand[n - 1] = TERMINAL_UNBOUNDED;
+                }
+                break;
+        }
+    }
+    free(text);
+    assert(first != NULL);
+
+    // Count the arcs of each vertex, both ways, and put them in place
+    batch_reserve(b, 0, 2L * arcs);
+    int* head = b->head + b->m, *rev = b->rev + b->m;
+    int* capacity = b->capacity + b->m;
+    for (int i = 0; i < arcs; i++) {
+        ++first[ends[3 * i]];
+        ++first[ends[3 * i + 1]];
+    }
+    for (int u = 0; u < n; u++) {
+        first[u + 1] += first[u];
+    }
+    // first[u] is used as the place of u's next arc, and moved back after
+    for (int i = 0; i < arcs; i++) {
+        int u = ends[3 * i] - 1, v = ends[3 * i + 1] - 1;
+        int a = first[u]++, r = first[v]++;
+        head[a] = v;
+        head[r] = u;
+        rev[a] = r;
+        rev[r] = a;
+        capacity[a] = ends[3 * i + 2];
+        capacity[r] = 0;
+    }
+    for (int u = n; 0 < u; u--) {
+        first[u] = first[u - 1];
+    }
+    first[0] = 0;
+    free(ends);
+
+    inst->n = n;
+    inst->m = 2 * arcs;
+    b->n += n + 1;
+    b->m += 2L * arcs;
+    if (b->max_n < n) {
+        b->max_n = n;
+    }
+    TRACE_END("load");
+    return b->count++;
+}
+
+void batch_free(struct batch* b) {
+    free(b->instances);
+    free(b->first);
+    free(b->supply);
+    free(b->demand);
+    free(b->head);
+    free(b->rev);
+    free(b->capacity);
+    free(b->residual);
+    free(b);
+}
+
+static int is_unbounded(struct batch_run* r, int v) {
+    return r->supply[v] == TERMINAL_UNBOUNDED ||
+           r->demand[v] == TERMINAL_UNBOUNDED;
+}
+
+static int demand_left(struct batch_run* r, int v) {
+    if (r->demand[v] == TERMINAL_UNBOUNDED) {
+        return TERMINAL_UNBOUNDED;
+    }
+    return r->demand[v] - r->absorbed[v];
+}
+
+static void queue_vertex(struct batch_run* r, int v) {
+    r->ring[(r->ring_first + r->ring_size++) % r->n] = v;
+}
+
+// Takes the next vertex with excess and prefetches its arcs, which are
+// loaded while the worker discharges a vertex of another graph
+static void take_next(struct batch_run* r) {
+    if (!r->ring_size) {
+        r->next = -1;
+        return;
+    }
+    int u = r->ring[r->ring_first];
+    r->ring_first = (r->ring_first + 1) % r->n;
+    --r->ring_size;
+    r->next = u;
+    __builtin_prefetch(r->head + r->current[u]);
+    __builtin_prefetch(r->residual + r->current[u]);
+}
+
+// Like initialize_preflow in pushrelabel.c
+static void run_start(struct batch_run* r, struct batch* b,
+                      struct batch_instance* inst) {
+    int n = inst->n;
+    r->instance = inst;
+    r->n = n;
+    r->first    = b->first + inst->vertex;
+    r->supply   = b->supply + inst->vertex;
+    r->demand   = b->demand + inst->vertex;
+    r->head     = b->head + inst->arc;
+    r->rev      = b->rev + inst->arc;
+    r->residual = b->residual + inst->arc;
+    memcpy(r->residual, b->capacity + inst->arc, inst->m * sizeof(int));
+
+    for (int v = 0; v < n; v++) {
+        r->height[v] = 0;
+        r->excess[v] = 0;
+        r->supplied[v] = 0;
+        r->absorbed[v] = 0;
+        r->current[v] = r->first[v];
+        r->count[v] = 0;
+    }
+    for (int s = 0; s < n; s++) {
+        if (r->supply[s] != TERMINAL_UNBOUNDED) {
+            r->excess[s] += r->supply[s];
+            r->supplied[s] = r->supply[s];
+            continue;
+        }
+        // An unbounded source is a part of the super source
+        r->height[s] = n;
+        for (int a = r->first[s]; a < r->first[s + 1]; a++) {
+            int v = r->head[a];
+            if (r->supply[v] != TERMINAL_UNBOUNDED) {
+                r->excess[v] += r->residual[a];
+                r->excess[s] -= r->residual[a];
+                r->residual[r->rev[a]] += r->residual[a];
+                r->residual[a] = 0;
+            }
+        }
+    }
+
+    r->ring_first = 0;
+    r->ring_size = 0;
+    for (int v = 0; v < n; v++) {
+        if (is_unbounded(r, v)) {
+            continue;
+        }
+        if (r->height[v] < n) {
+            ++r->count[r->height[v]];
+        }
+        if (r->excess[v] > 0) {
+            queue_vertex(r, v);
+        }
+    }
+    take_next(r);
+}
+
+// Like push_terminal in pushrelabel.c
+static int run_push_terminal(struct batch_run* r, int u) {
+    int amount;
+    if (r->height[u] == 1 && 0 < demand_left(r, u)) {
+        amount = demand_left(r, u);
+        amount = r->excess[u] < amount ? r->excess[u] : amount;
+        r->absorbed[u] += amount;
+    }
+    else if (r->height[u] == r->n + 1 && 0 < r->supplied[u]) {
+        amount = r->excess[u] < r->supplied[u] ? r->excess[u]
+                                                : r->supplied[u];
+        r->supplied[u] -= amount;
+    }
+    else {
+        return 0;
+    }
+    r->excess[u] -= amount;
+    return 1;
+}
+
+// Like relabel in pushrelabel.c, with the gap heuristic of
+// push_relabel_run_fifo
+static void run_relabel(struct batch_run* r, int u) {
+    int n = r->n, before = r->height[u], min = 2 * n;
+
+    for (int a = r->first[u]; a < r->first[u + 1]; a++) {
+        if (0 < r->residual[a] && r->height[r->head[a]] < min) {
+            min = r->height[r->head[a]];
+        }
+    }
+    if (0 < demand_left(r, u)) {
+        min = 0;
+    }
+    if (0 < r->supplied[u] && min > n) {
+        min = n;
+    }
+    r->height[u] = 1 + min;
+    r->current[u] = r->first[u];
+    if (before >= n) {
+        return;
+    }
+
+    --r->count[before];
+    if (r->height[u] < n) {
+        ++r->count[r->height[u]];
+    }
+    if (r->count[before] || before == 0) {
+        return;
+    }
+    for (int v = 0; v < n; v++) {
+        int h = r->height[v];
+        if (before < h && h < n && !is_unbounded(r, v)) {
+            --r->count[h];
+            r->height[v] = n;
+            r->current[v] = r->first[v];
+        }
+    }
+}
+
+// Discharges the next vertex until it has no excess and takes the one after
+// Return: 1 if the graph has more vertices to discharge, 0 if it is solved
+static int run_step(struct batch_run* r) {
+    int u = r->next;
+    int* height = r->height, *excess = r->excess;
+
+    while (excess[u] > 0) {
+        int a = r->current[u];
+        if (a == r->first[u + 1]) {
+            if (!run_push_terminal(r, u)) {
+                run_relabel(r, u);
+            }
+            continue;
+        }
+        int v = r->head[a];
+        if (r->residual[a] <= 0 || height[u] != height[v] + 1) {
+            r->current[u] = a + 1;
+            continue;
+        }
+        int amount = excess[u] < r->residual[a] ? excess[u] : r->residual[a];
+        r->residual[a] -= amount;
+        r->residual[r->rev[a]] += amount;
+        excess[u] -= amount;
+        if (excess[v] == 0 && !is_unbounded(r, v)) {
+            queue_vertex(r, v);
+        }
+        excess[v] += amount;
+    }
+
+    take_next(r);
+    if (r->next != -1) {
+        return 1;
+    }
+
+    // The flow into the sinks, with that into the unbounded ones as excess
+    int flow = 0;
+    for (int v = 0; v < r->n; v++) {
+        flow += r->demand[v] == TERMINAL_UNBOUNDED ? excess[v]
+                                                   : r->absorbed[v];
+    }
+    r->instance->flow = flow;
+    return 0;
+}
+
+// Takes the next graph that is not taken
+// Return: Pointer to it, NULL if all are taken
+static struct batch_instance* take_instance(struct batch_pool* pool) {
+    int i = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+    return i < pool->b->count ? &pool->b->instances[i] : NULL;
+}
+
+// Solves graphs until all are taken, 'interleave' of them in lockstep
+static void* batch_worker(void* arg) {
+    struct batch_pool* pool = arg;
+    int k = pool->interleave, n = pool->b->max_n + 1;
+    struct batch_run* runs = malloc(k * sizeof(struct batch_run));
+    int* scratch = malloc(7L * k * n * sizeof(int));
+    assert(runs && scratch);
+    TRACE_BEGIN("batch_worker");
+
+    int active = 0;
+    for (int i = 0; i < k; i++) {
+        int* s = scratch + 7L * i * n;
+        runs[i].height   = s;
+        runs[i].excess   = s + n;
+        runs[i].current  = s + 2 * n;
+        runs[i].supplied = s + 3 * n;
+        runs[i].absorbed = s + 4 * n;
+        runs[i].count    = s + 5 * n;
+        runs[i].ring     = s + 6 * n;
+        runs[i].next     = -1;
+    }
+
+    // A slot whose graph is solved takes the next one
+    do {
+        active = 0;
+        for (int i = 0; i < k; i++) {
+            if (runs[i].next != -1 && run_step(&runs[i])) {
+                ++active;
+                continue;
+            }
+            struct batch_instance* inst = take_instance(pool);
+            while (inst) {
+                run_start(&runs[i], pool->b, inst);
+                if (runs[i].next != -1) {
+                    ++active;
+                    break;
+                }
+                // Nothing to discharge, no flow
+                run_step(&runs[i]);
+                inst = take_instance(pool);
+            }
+        }
+    } while (active);
+    TRACE_END("batch_worker");
+
+    free(runs);
+    free(scratch);
+    return NULL;
+}
+
+void batch_solve(struct batch* b, int threads, int interleave) {
+    assert(0 < threads && 0 < interleave);
+    struct batch_pool pool = {b, interleave, 0};
+
+    if (threads == 1) {
+        batch_worker(&pool);
+        return;
+    }
+    pthread_t* workers = malloc(threads * sizeof(pthread_t));
+    assert(workers);
+    for (int i = 0; i < threads; i++) {
+        int created = pthread_create(&workers[i], NULL, &batch_worker, &pool);
+        assert(created == 0);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+}
+
+int batch_run(char** paths, int n_paths, int threads, int interleave,
+              FILE* fp) {
+    if (threads == 0) {
+        threads = bfs_default_threads();
+    }
+    struct batch* b = batch_init();
+    char* line = NULL;
+    size_t len = 0;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int i = 0; i < n_paths; i++) {
+        batch_add(b, paths[i]);
+    }
+    // The paths from stdin are kept until the results are printed
+    while (!n_paths && getline(&line, &len, stdin) != EOF) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (*line) {
+            batch_add(b, strdup(line));
+        }
+    }
+    double load = seconds_since(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    batch_solve(b, threads, interleave);
+    double solve = seconds_since(&start);
+
+    for (int i = 0; i < b->count; i++) {
+        fprintf(fp, "batch: %s maximum flow %d\n", b->instances[i].path,
+                b->instances[i].flow);
+    }
+    fprintf(fp, "batch: %d graphs, %ld arcs, read in %.3f ms, solved in "
+            "%.3f ms by %d threads with %d in lockstep, %.0f graphs/s "
+            "solving, %.0f graphs/s in all\n", b->count, b->m, load * 1000,
+            solve * 1000, threads, interleave, b->count / solve,
+            b->count / (load + solve));
+
+    if (!n_paths) {
+        for (int i = 0; i < b->count; i++) {
+            free(b->instances[i].path);
+        }
+    }
+    free(line);
+    batch_free(b);
+    return 0;
+}
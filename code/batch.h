@@ -0,0 +1,92 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+
+/* Solves many small graphs at once. The graphs are read straight into one
+ * compressed sparse row arena, without adjacency lists, so a graph costs a
+ * few appends to arrays that are shared by all of them. Worker threads take
+ * one graph at a time and solve it by FIFO push-relabel with the gap
+ * heuristic, on the arena's arrays and scratch arrays of their own.
+ *
+ * A worker can solve several graphs in lockstep: it discharges one vertex of
+ * each in turn, and prefetches the arcs of the next vertex of a graph before
+ * it moves on to the others, so the loads of one overlap the work on the
+ * others. */
+
+/* A graph in the arena. Its vertices are numbered from 0 within it, and its
+ * arcs too. */
+struct batch_instance {
+    char* path;
+    int n;
+    int m;                  // Number of arcs, the reverse arcs included
+    long vertex;            // Its first vertex in the arena. A graph has
+                            // n + 1 entries in the vertex arrays.
+    long arc;               // Its first arc in the arena
+    int flow;               // The maximum flow, when solved
+};
+
+/* The arena. The arcs out of vertex u of a graph are first[u] ..
+ * first[u + 1] - 1, from the graph's first arc and vertex on. Arc a goes to
+ * head[a], rev[a] is its reverse arc, capacity[a] its capacity, 0 for a
+ * reverse arc, and residual[a] its residual capacity. The terminals are
+ * given by supply and demand like in graph.h. */
+struct batch {
+    int count;
+    int size;               // Graphs there is room for
+    struct batch_instance* instances;
+    long n;                 // Entries used in the vertex arrays
+    long m;                 // Arcs used
+    long n_size;
+    long m_size;
+    int max_n;              // The most vertices of a graph
+    int* first;
+    int* supply;
+    int* demand;
+    int* head;
+    int* rev;
+    int* capacity;
+    int* residual;
+};
+
+/* Graphs solved in lockstep by a worker when nothing else is given */
+#define BATCH_INTERLEAVE 1
+
+/* Creates an empty batch
+ * Args:    None
+ * Return:  Pointer to the batch */
+struct batch* batch_init(void);
+
+/* Reads a DIMACS file into the arena. The terminals are read like
+ * read_dimacs_file does.
+ * Args:    - Pointer to the batch
+ *          - The path to the file, which is kept for the results
+ * Return:  The index of the graph in the batch */
+int batch_add(struct batch* b, char* path);
+
+/* Solves all the graphs of the batch and sets their 'flow'. The graphs can
+ * be solved again, the residual capacities are set from the capacities.
+ * Args:    - Pointer to the batch
+ *          - Number of threads, 1 to solve in the calling thread only
+ *          - Number of graphs a thread solves in lockstep
+ * Return:  Nothing */
+void batch_solve(struct batch* b, int threads, int interleave);
+
+/* Frees the batch, but not the paths
+ * Args:    - Pointer to the batch
+ * Return:  Nothing */
+void batch_free(struct batch* b);
+
+/* Reads the graphs into a batch, solves them and prints the maximum flow of
+ * each and then the time it took and how many graphs were solved per second
+ * Args:    - The paths to the graphs. If there are none, they are read from
+ *            stdin, one per line.
+ *          - Number of paths
+ *          - Number of threads, 0 for bfs_default_threads
+ *          - Number of graphs a thread solves in lockstep
+ *          - The file to print to
+ * Return:  0 on success */
+int batch_run(char** paths, int n_paths, int threads, int interleave,
+              FILE* fp);
+
+#endif
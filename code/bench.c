@@ -0,0 +1,427 @@
+#define _GNU_SOURCE
+#include "bench.h"
+#include "solver.h"
+#include "loaddimacs.h"
+#include "graph.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+// The 97.5% quantile of Student's t distribution, by degrees of freedom from
+// 1 to 30. Above that up to BENCH_MAX_RUNS - 1 it is close to 2.01.
+static const double t_quantiles[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Sets the mean, the confidence interval and the median from the samples
+static void summarize(struct bench_result* r) {
+    double sum = 0, squares = 0;
+    for (int i = 0; i < r->runs; i++) {
+        sum += r->samples[i];
+    }
+    r->mean = sum / r->runs;
+    for (int i = 0; i < r->runs; i++) {
+        squares += (r->samples[i] - r->mean) * (r->samples[i] - r->mean);
+    }
+    int df = r->runs - 1;
+    double t = df < 1 ? 0 : df <= 30 ? t_quantiles[df - 1] : 2.01;
+    r->ci = df < 1 ? 0 : t * sqrt(squares / df / r->runs);
+
+    double sorted[BENCH_MAX_RUNS];
+    memcpy(sorted, r->samples, r->runs * sizeof(double));
+    qsort(sorted, r->runs, sizeof(double), compare_doubles);
+    r->median = r->runs % 2 ? sorted[r->runs / 2]
+                            : (sorted[r->runs / 2 - 1] + sorted[r->runs / 2]) / 2;
+}
+
+// The family of a graph is its name between the first '-' and the first '_',
+// e.g. "layered" of V1000-layered_E2999_1
+static void graph_family(char* name, char* family, int size) {
+    char* dash = strchr(name, '-');
+    char* underscore = strchr(name, '_');
+    if (!dash || (underscore && underscore < dash)) {
+        snprintf(family, size, "other");
+        return;
+    }
+    int length = underscore ? underscore - dash - 1 : (int)strlen(dash + 1);
+    snprintf(family, size, "%.*s", length, dash + 1);
+}
+
+// Runs in the worker process and writes the result to the pipe
+static void bench_worker(char* path, struct solver* solver, int out) {
+    struct bench_result r;
+    memset(&r, 0, sizeof(r));
+    // What the solvers print, like the choice of auto, is not wanted
+    FILE* out_null = freopen("/dev/null", "w", stdout);
+    FILE* err_null = freopen("/dev/null", "w", stderr);
+    assert(out_null && err_null);
+
+    for (int i = 0; i < BENCH_WARMUP; i++) {
+        struct graph* g = read_dimacs_file(path);
+        solver->solve(g);
+        graph_free(g);
+    }
+    struct timespec begun;
+    clock_gettime(CLOCK_MONOTONIC, &begun);
+    while (r.runs < BENCH_MAX_RUNS) {
+        struct graph* g = read_dimacs_file(path);
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        r.flow = solver->solve(g);
+        r.samples[r.runs++] = seconds_since(&start);
+        graph_free(g);
+        if (BENCH_MIN_RUNS <= r.runs) {
+            summarize(&r);
+            if (r.ci <= BENCH_PRECISION * r.mean ||
+                BENCH_BUDGET <= seconds_since(&begun)) {
+                break;
+            }
+        }
+    }
+    summarize(&r);
+
+    // The counters of the last run, on one line
+    if (solver->print_stats) {
+        char* text = NULL;
+        size_t length = 0;
+        FILE* stream = open_memstream(&text, &length);
+        assert(stream != NULL);
+        solver->print_stats(stream);
+        fclose(stream);
+        while (length && text[length - 1] == '\n') {
+            text[--length] = '\0';
+        }
+        for (char* c = text; *c; c++) {
+            *c = *c == '\n' || *c == '\t' ? ';' : *c;
+        }
+        snprintf(r.counters, sizeof(r.counters), "%s", text);
+        free(text);
+    }
+
+    char* p = (char*)&r;
+    for (size_t written = 0; written < sizeof(r);) {
+        ssize_t w = write(out, p + written, sizeof(r) - written);
+        assert(w > 0);
+        written += w;
+    }
+}
+
+// Runs a worker for a solver and graph and waits for it
+// Return: 0 on success, 1 if the worker failed
+static int bench_one(char* path, struct solver* solver, struct bench_result* r) {
+    int fds[2];
+    int piped = pipe(fds);
+    assert(piped == 0);
+    fflush(NULL);
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        close(fds[0]);
+        bench_worker(path, solver, fds[1]);
+        _exit(0);
+    }
+    close(fds[1]);
+    size_t got = 0;
+    ssize_t n;
+    while (got < sizeof(*r) &&
+           (n = read(fds[0], (char*)r + got, sizeof(*r) - got)) > 0) {
+        got += n;
+    }
+    close(fds[0]);
+
+    int status;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    if (got < sizeof(*r) || !WIFEXITED(status) || WEXITSTATUS(status)) {
+        return 1;
+    }
+    r->peak_kb = usage.ru_maxrss;
+    return 0;
+}
+
+static void write_result(struct bench_result* r, FILE* out) {
+    fprintf(out, "%s\t%s\t%s\t%d\t%d\t%.9g\t%.9g\t%.9g\t%ld\t", r->graph,
+            r->family, r->solver, r->flow, r->runs, r->mean, r->ci, r->median,
+            r->peak_kb);
+    for (int i = 0; i < r->runs; i++) {
+        fprintf(out, "%s%.9g", i ? "," : "", r->samples[i]);
+    }
+    fprintf(out, "\t%s\n", r->counters[0] ? r->counters : "-");
+}
+
+// Reads a line of a results file
+// Return: 1 if it is a result, 0 otherwise
+static int read_result(char* line, struct bench_result* r) {
+    char* fields[11];
+    int n = 0;
+    line[strcspn(line, "\n")] = '\0';
+    for (char* save = NULL, *f = strtok_r(line, "\t", &save); f && n < 11;
+         f = strtok_r(NULL, "\t", &save)) {
+        fields[n++] = f;
+    }
+    if (n < 11 || line[0] == '#') {
+        return 0;
+    }
+    memset(r, 0, sizeof(*r));
+    snprintf(r->graph, sizeof(r->graph), "%s", fields[0]);
+    snprintf(r->family, sizeof(r->family), "%s", fields[1]);
+    snprintf(r->solver, sizeof(r->solver), "%s", fields[2]);
+    r->flow = atoi(fields[3]);
+    r->mean = atof(fields[5]);
+    r->ci = atof(fields[6]);
+    r->median = atof(fields[7]);
+    r->peak_kb = atol(fields[8]);
+    for (char* s = fields[9]; *s && r->runs < BENCH_MAX_RUNS;) {
+        r->samples[r->runs++] = strtod(s, &s);
+        s += *s == ',';
+    }
+    snprintf(r->counters, sizeof(r->counters), "%s",
+             strcmp(fields[10], "-") ? fields[10] : "");
+    return r->runs > 0;
+}
+
+// Reads all the results of a file
+// Return: The number of results, -1 if the file could not be opened
+static int read_results(char* path, struct bench_result** results) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+    int n = 0, size = 16;
+    *results = malloc(size * sizeof(struct bench_result));
+    assert(*results != NULL);
+    char line[4096];
+    while (fgets(line, sizeof(line), fp)) {
+        if (n == size) {
+            size *= 2;
+            *results = realloc(*results, size * sizeof(struct bench_result));
+            assert(*results != NULL);
+        }
+        n += read_result(line, &(*results)[n]);
+    }
+    fclose(fp);
+    return n;
+}
+
+int bench_run(char** paths, int n_paths, char* results, FILE* fp) {
+    // The solvers, from MAXFLOW_BENCH_SOLVERS or all of them
+    struct solver* solvers[64];
+    int n_solvers = 0;
+    char* names = getenv("MAXFLOW_BENCH_SOLVERS");
+    if (names) {
+        char* copy = strdup(names);
+        for (char* save = NULL, *name = strtok_r(copy, ",", &save);
+             name && n_solvers < 64; name = strtok_r(NULL, ",", &save)) {
+            solvers[n_solvers] = solver_find(name);
+            if (!solvers[n_solvers++]) {
+                fprintf(stderr, "bench: no such solver %s\n", name);
+                free(copy);
+                return 1;
+            }
+        }
+        free(copy);
+    }
+    else {
+        for (struct solver* s; (s = solver_at(n_solvers)) && n_solvers < 64;) {
+            solvers[n_solvers++] = s;
+        }
+    }
+
+    FILE* out = fopen(results, "w");
+    if (!out) {
+        fprintf(stderr, "bench: cannot write %s\n", results);
+        return 1;
+    }
+    fprintf(out, "# graph\tfamily\tsolver\tflow\truns\tmean\tci\tmedian\t"
+            "peak_kb\tsamples\tcounters\n");
+    int failed = 0;
+    for (int i = 0; i < n_paths; i++) {
+        char* name = strrchr(paths[i], '/') ? strrchr(paths[i], '/') + 1
+                                            : paths[i];
+        int expected = -1;
+        for (int j = 0; j < n_solvers; j++) {
+            struct bench_result r;
+            if (bench_one(paths[i], solvers[j], &r)) {
+                fprintf(stderr, "bench: %s failed on %s, run it alone to see "
+                        "why\n", solvers[j]->name, paths[i]);
+                failed = 1;
+                continue;
+            }
+            snprintf(r.graph, sizeof(r.graph), "%s", name);
+            graph_family(name, r.family, sizeof(r.family));
+            snprintf(r.solver, sizeof(r.solver), "%s", solvers[j]->name);
+            write_result(&r, out);
+            fflush(out);
+
+            fprintf(fp, "bench: %-32s %-11s median %9.3f ms, +-%.1f%% in %d "
+                    "runs, %.1f MB%s\n", name, r.solver, r.median * 1000,
+                    100 * r.ci / r.mean, r.runs, r.peak_kb / 1024.0,
+                    expected != -1 && r.flow != expected ? ", WRONG FLOW"
+                                                         : "");
+            failed |= expected != -1 && r.flow != expected;
+            expected = expected == -1 ? r.flow : expected;
+        }
+    }
+    fclose(out);
+    return failed;
+}
+
+struct ranked {
+    double value;
+    int first;              // 1 if from the first sample
+};
+
+static int compare_ranked(const void* a, const void* b) {
+    return compare_doubles(&((const struct ranked*)a)->value,
+                           &((const struct ranked*)b)->value);
+}
+
+// The two-sided p-value of the Mann-Whitney U test, from the normal
+// approximation of U with the corrections for ties and continuity
+static double mann_whitney(double* a, int n, double* b, int m) {
+    struct ranked all[2 * BENCH_MAX_RUNS];
+    for (int i = 0; i < n; i++) {
+        all[i] = (struct ranked){a[i], 1};
+    }
+    for (int i = 0; i < m; i++) {
+        all[n + i] = (struct ranked){b[i], 0};
+    }
+    int total = n + m;
+    qsort(all, total, sizeof(struct ranked), compare_ranked);
+
+    double rank_sum = 0, ties = 0;
+    for (int i = 0; i < total;) {
+        int j = i;
+        while (j < total && all[j].value == all[i].value) {
+            j++;
+        }
+        // Tied values get the mean of their ranks, which start at 1
+        double rank = (i + 1 + j) / 2.0;
+        for (int k = i; k < j; k++) {
+            rank_sum += all[k].first ? rank : 0;
+        }
+        ties += (double)(j - i) * (j - i) * (j - i) - (j - i);
+        i = j;
+    }
+    double u = rank_sum - n * (n + 1) / 2.0;
+    double variance = n * m / 12.0 * (total + 1 - ties / (total * (total - 1.0)));
+    if (variance <= 0) {
+        return 1;
+    }
+    double z = (fabs(u - n * m / 2.0) - 0.5) / sqrt(variance);
+    return z <= 0 ? 1 : erfc(z / sqrt(2));
+}
+
+int bench_compare(char* baseline, char* results, FILE* fp) {
+    struct bench_result* base;
+    struct bench_result* now;
+    int n_base = read_results(baseline, &base);
+    if (n_base < 0) {
+        fprintf(stderr, "bench: cannot read %s\n", baseline);
+        return 1;
+    }
+    int n_now = read_results(results, &now);
+    if (n_now < 0) {
+        fprintf(stderr, "bench: cannot read %s\n", results);
+        free(base);
+        return 1;
+    }
+
+    // The matching baseline of each result and whether it got slower
+    int* match = malloc(n_now * sizeof(int));
+    int* slower = calloc(n_now, sizeof(int));
+    double* ratio = malloc(n_now * sizeof(double));
+    assert(match && slower && ratio);
+    int slowed = 0, faster = 0, compared = 0, changed = 0, regressions = 0;
+    for (int i = 0; i < n_now; i++) {
+        struct bench_result* r = &now[i];
+        match[i] = -1;
+        for (int j = 0; j < n_base && match[i] == -1; j++) {
+            if (strcmp(base[j].graph, r->graph) == 0 &&
+                strcmp(base[j].solver, r->solver) == 0) {
+                match[i] = j;
+            }
+        }
+        if (match[i] == -1) {
+            fprintf(fp, "compare: %-32s %-11s new, median %.3f ms\n", r->graph,
+                    r->solver, r->median * 1000);
+            continue;
+        }
+        struct bench_result* b = &base[match[i]];
+        ratio[i] = r->median / b->median;
+        double p = mann_whitney(b->samples, b->runs, r->samples, r->runs);
+        // Times near the resolution of the clock are mostly noise
+        int significant = p < BENCH_SIGNIFICANCE &&
+                          BENCH_RESOLUTION <= b->median;
+        slower[i] = significant && 1 + BENCH_TOLERANCE < ratio[i];
+        int sped_up = significant && ratio[i] < 1 - BENCH_TOLERANCE;
+        slowed += slower[i];
+        faster += sped_up;
+        changed += r->flow != b->flow;
+        compared++;
+
+        fprintf(fp, "compare: %-32s %-11s %9.3f -> %9.3f ms, %.2f times, "
+                "p %.4f, %ld -> %ld kB%s%s%s%s\n", r->graph, r->solver,
+                b->median * 1000, r->median * 1000, ratio[i], p, b->peak_kb,
+                r->peak_kb, slower[i] ? ", slower" : sped_up ? ", faster" : "",
+                r->flow != b->flow ? ", FLOW CHANGED" : "",
+                b->peak_kb * (1 + BENCH_MEMORY_TOLERANCE) < r->peak_kb
+                    ? ", more memory" : "",
+                strcmp(r->counters, b->counters) ? ", counters changed" : "");
+        if (strcmp(r->counters, b->counters)) {
+            fprintf(fp, "         was %s\n         now %s\n", b->counters,
+                    r->counters);
+        }
+    }
+
+    // Each family and solver, in the order they first come
+    for (int i = 0; i < n_now; i++) {
+        int first = match[i] != -1;
+        for (int j = 0; j < i && first; j++) {
+            first = match[j] == -1 || strcmp(now[j].family, now[i].family) ||
+                    strcmp(now[j].solver, now[i].solver);
+        }
+        if (!first) {
+            continue;
+        }
+        double logs = 0;
+        int graphs = 0, family_slower = 0;
+        for (int j = i; j < n_now; j++) {
+            if (match[j] != -1 && strcmp(now[j].family, now[i].family) == 0 &&
+                strcmp(now[j].solver, now[i].solver) == 0) {
+                logs += log(ratio[j]);
+                graphs++;
+                family_slower += slower[j];
+            }
+        }
+        double mean = exp(logs / graphs);
+        int regressed = family_slower && 1 + BENCH_TOLERANCE < mean;
+        regressions += regressed;
+        fprintf(fp, "family: %-12s %-11s %d graphs, %.2f times, %d slower%s\n",
+                now[i].family, now[i].solver, graphs, mean, family_slower,
+                regressed ? ", REGRESSION" : "");
+    }
+    fprintf(fp, "compare: %d of %d slower, %d faster, %d flows changed, %d "
+            "regressions\n", slowed, compared, faster, changed, regressions);
+    free(match);
+    free(slower);
+    free(ratio);
+    free(base);
+    free(now);
+    return regressions || changed;
+}
@@ -0,0 +1,76 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+
+/* A benchmark suite that finds out if a change made the solvers slower.
+ *
+ * bench_run times every solver on each graph of a corpus in a worker process
+ * of its own, so the peak memory of the process is that of reading the graph
+ * and solving it with that solver. The worker first solves the graph
+ * BENCH_WARMUP times untimed, then times at least BENCH_MIN_RUNS runs and
+ * goes on until the 95% confidence interval of the mean is within
+ * BENCH_PRECISION of it, BENCH_MAX_RUNS runs are done or BENCH_BUDGET seconds
+ * are used. The graph is read again for each run. Each solver and graph
+ * becomes a line of a results file, which is kept as the baseline.
+ *
+ * bench_compare compares a new results file with a baseline. The times of
+ * each solver and graph are compared with the Mann-Whitney U test, which
+ * does not assume the times are normally distributed. They are slower if
+ * they are higher with p below BENCH_SIGNIFICANCE and the median is more
+ * than BENCH_TOLERANCE higher. For each family of graphs, e.g. "layered" or
+ * "max-c2" of V200-max-c2_E400_..., and solver it is a regression if a graph
+ * is slower and the geometric mean of the ratios of the medians is more than
+ * BENCH_TOLERANCE above 1. A changed flow is always an error.
+ *
+ * The solvers are all of solver.h, or those named in the environment variable
+ * MAXFLOW_BENCH_SOLVERS separated by commas. */
+
+#define BENCH_WARMUP 1
+#define BENCH_MIN_RUNS 7
+#define BENCH_MAX_RUNS 50
+#define BENCH_PRECISION 0.02
+#define BENCH_BUDGET 5.0
+#define BENCH_SIGNIFICANCE 0.01
+#define BENCH_TOLERANCE 0.10
+
+/* Medians of the baseline below this many seconds are not compared */
+#define BENCH_RESOLUTION 50e-6
+
+/* More peak memory than this much over the baseline is reported */
+#define BENCH_MEMORY_TOLERANCE 0.10
+
+/* The measurements of one solver on one graph, a line of the results file */
+struct bench_result {
+    char graph[256];        // The file name, without the directories
+    char family[64];
+    char solver[32];
+    int flow;
+    int runs;
+    double mean;            // Seconds
+    double ci;              // Half the width of the 95% confidence interval
+    double median;
+    long peak_kb;           // The most memory the worker had resident
+    double samples[BENCH_MAX_RUNS];
+    char counters[512];     // What the solver's print_stats printed
+};
+
+/* Times the solvers on each graph and writes the results
+ * Args:    - Paths to the graphs
+ *          - Number of graphs
+ *          - Path of the results file to write
+ *          - The file to print a summary of each result to
+ * Return:  0 on success, 1 if a solver is unknown, a worker failed or the
+ *          solvers found different flows */
+int bench_run(char** paths, int n_paths, char* results, FILE* fp);
+
+/* Compares results with a baseline and prints each solver and graph and
+ * each family and solver, with what got slower marked
+ * Args:    - Path of the baseline results
+ *          - Path of the new results
+ *          - The file to print to
+ * Return:  0 if there is no regression, 1 if there is one, a flow changed or
+ *          a file could not be read */
+int bench_compare(char* baseline, char* results, FILE* fp);
+
+#endif
@@ -0,0 +1,50 @@
+#!/usr/bin/python3
+# Times every solver on a fixed corpus of graphs with './max.out --bench' and
+# compares the times with those of bench_baseline.txt. It exits with 1 if a
+# solver got slower or found another flow. With --baseline the results become
+# the new baseline instead.
+#
+# python3 bench.py [--baseline]
+#
+# The corpus is the first graph of a few of the random families in
+# generator/graphs/ and graphs made by generator/structured.py with fixed
+# seeds, so it is the same on every machine. The baseline should be made on
+# the machine it is compared on.
+import sys, os
+import subprocess
+
+PATH_graphs = os.path.join("generator", "graphs")
+BASELINE = "bench_baseline.txt"
+RESULTS = "bench_results.txt"
+
+RANDOM_FAMILIES = ["V200-max-c2", "V200-min-c0.4", "V800-max-c2",
+                   "V400-min-c0.4"]
+# kind, n, max capacity, seed
+STRUCTURED = [("layered", 500, 1000000, 1), ("chain", 500, 1000000, 1),
+              ("funnel", 500, 1000000, 1)]
+
+corpus = []
+graph_files = sorted(f for f in os.listdir(PATH_graphs) if f.startswith('V'))
+for family in RANDOM_FAMILIES:
+    files = [f for f in graph_files if f.split('_')[0] == family]
+    if not files:
+        sys.exit("no graph of the family %s in %s" % (family, PATH_graphs))
+    corpus.append(os.path.join(PATH_graphs, files[0]))
+
+for kind, n, capacity, seed in STRUCTURED:
+    made = subprocess.check_output(
+        ["python3", "structured.py", kind, str(n), str(capacity), str(seed)],
+        cwd="generator", universal_newlines=True)
+    corpus.append(os.path.join("generator", made.strip()))
+
+subprocess.check_call(["./max.out", "--bench", RESULTS] + corpus)
+
+if len(sys.argv) > 1 and sys.argv[1] == "--baseline":
+    os.replace(RESULTS, BASELINE)
+    print("bench: the baseline is now %s" % BASELINE)
+elif not os.path.exists(BASELINE):
+    print("bench: no %s to compare with, make it with 'make bench-baseline'"
+          % BASELINE)
+else:
+    sys.exit(subprocess.call(["./max.out", "--bench-compare", BASELINE,
+                              RESULTS]))
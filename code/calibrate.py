@@ -0,0 +1,31 @@
+#!/usr/bin/python3
+# Builds the calibration table used by './max.out <path> auto'. Every algorithm
+# that auto may choose is timed on a few graphs of each family and size in
+# generator/graphs/ and the times are written to calibration.txt.
+#
+# python3 calibrate.py [<graphs per family and size>] [<largest |V|>]
+import sys, os
+import subprocess
+import collections
+
+PATH_graphs = os.path.join("generator", "graphs")
+TABLE = "calibration.txt"
+
+per_family = int(sys.argv[1]) if len(sys.argv) > 1 else 1
+max_size = int(sys.argv[2]) if len(sys.argv) > 2 else 500
+
+graph_files = sorted(f for f in os.listdir(PATH_graphs) if f.startswith('V'))
+
+# The family is the part of the name before the number of edges, e.g.
+# V100-max-c2
+families = collections.defaultdict(list)
+for f in graph_files:
+    family = f.split('_')[0]
+    if int(family.split('-')[0][1:]) <= max_size:
+        families[family].append(os.path.join(PATH_graphs, f))
+
+chosen = [f for family in sorted(families) for f in families[family][:per_family]]
+
+if os.path.exists(TABLE):
+    os.remove(TABLE)
+subprocess.check_call(["./max.out", "--calibrate", TABLE] + chosen)
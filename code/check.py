@@ -0,0 +1,40 @@
+#!/usr/bin/python3
+# Solves graphs with several sources and sinks with every solver and checks
+# each flow with './max.out --verify all'. It exits with 1 if a solver left a
+# flow that is not a maximum flow.
+#
+# python3 check.py
+#
+# The graphs are made by generator/structured.py with the kind 'terminals'
+# and fixed seeds, half of the terminals with no limit and half with a supply
+# or demand, together with the first graph of a few of the random families in
+# generator/graphs/ that have one source and one sink.
+import sys, os
+import subprocess
+
+PATH_graphs = os.path.join("generator", "graphs")
+
+RANDOM_FAMILIES = ["V100-max-c2", "V200-min-c0.4"]
+# n, max capacity, seeds
+TERMINALS = [(50, 100, range(1, 21)), (500, 1000, range(1, 6))]
+
+graphs = []
+graph_files = sorted(f for f in os.listdir(PATH_graphs) if f.startswith('V'))
+for family in RANDOM_FAMILIES:
+    files = [f for f in graph_files if f.split('_')[0] == family]
+    if not files:
+        sys.exit("no graph of the family %s in %s" % (family, PATH_graphs))
+    graphs.append(os.path.join(PATH_graphs, files[0]))
+
+made = []
+for n, capacity, seeds in TERMINALS:
+    for seed in seeds:
+        path = subprocess.check_output(
+            ["python3", "structured.py", "terminals", str(n), str(capacity),
+             str(seed)], cwd="generator", universal_newlines=True)
+        made.append(os.path.join("generator", path.strip()))
+
+status = subprocess.call(["./max.out", "--verify", "all", "0"] + graphs + made)
+for path in made:
+    os.remove(path)
+sys.exit(status)
@@ -0,0 +1,608 @@
+#define _GNU_SOURCE
+#include "checkpoint.h"
+#include "list.h"
+#include "loaddimacs.h"
+#include "placement.h"
+#include "preflow.h"
+#include "verify.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+// Set by the handlers of checkpoint_catch_signals
+static volatile sig_atomic_t stop_requested = 0;
+
+// FNV-1a, an int at a time
+static unsigned long mix(unsigned long x, const int* a, long count) {
+    for (long i = 0; i < count; i++) {
+        x = (x ^ (unsigned)a[i]) * 0x100000001b3UL;
+    }
+    return x;
+}
+
+static unsigned long fingerprint(const struct topology* t) {
+    unsigned long x = 0xcbf29ce484222325UL;
+    x = mix(x, &t->n, 1);
+    x = mix(x, &t->m, 1);
+    x = mix(x, t->first, t->n + 1);
+    x = mix(x, t->head, t->m);
+    x = mix(x, t->capacity, t->m);
+    x = mix(x, t->supply, t->n);
+    return mix(x, t->demand, t->n);
+}
+
+// No flow and no preflow
+static void clear(struct checkpoint_run* r) {
+    memcpy(r->state.residual, r->t->capacity, r->t->m * sizeof(int));
+    memset(r->state.supplied, 0, r->t->n * sizeof(int));
+    memset(r->state.absorbed, 0, r->t->n * sizeof(int));
+    r->started = 0;
+}
+
+static int write_all(int fd, void* data, size_t size) {
+    char* p = data;
+    while (0 < size) {
+        ssize_t w = write(fd, p, size);
+        if (w < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 1;
+        }
+        p += w;
+        size -= w;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void* data, size_t size) {
+    char* p = data;
+    while (0 < size) {
+        ssize_t got = read(fd, p, size);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return 1;
+        }
+        p += got;
+        size -= got;
+    }
+    return 0;
+}
+
+// Writes the staged snapshot to the temporary file and renames it over the
+// snapshot file
+// Return: The bytes written, -1 if it failed
+static long write_snapshot(struct checkpoint_run* r) {
+    const struct topology* t = r->t;
+    int n = t->n, arcs = 0, queued = r->staged.queued;
+    for (int a = 0; a < t->m; a++) {
+        if (t->forward[a]) {
+            r->flow[arcs++] = t->capacity[a] - r->staged_residual[a];
+        }
+    }
+
+    int fd = open(r->temporary, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    int failed = write_all(fd, &r->staged, sizeof(r->staged));
+    failed |= write_all(fd, r->flow, arcs * sizeof(int));
+    failed |= write_all(fd, r->staged_height, n * sizeof(int));
+    failed |= write_all(fd, r->staged_excess, n * sizeof(long));
+    failed |= write_all(fd, r->staged_current, n * sizeof(int));
+    failed |= write_all(fd, r->staged_supplied, n * sizeof(int));
+    failed |= write_all(fd, r->staged_absorbed, n * sizeof(int));
+    failed |= write_all(fd, r->staged_queue, queued * sizeof(int));
+    failed |= fdatasync(fd) != 0;
+    failed |= close(fd) != 0;
+    if (failed || rename(r->temporary, r->file) != 0) {
+        unlink(r->temporary);
+        return -1;
+    }
+    return sizeof(r->staged) + (arcs + 4L * n + queued) * sizeof(int) +
+           n * sizeof(long);
+}
+
+// The writer thread. Writes each snapshot it is handed until the run quits.
+static void* write_snapshots(void* arg) {
+    struct checkpoint_run* r = arg;
+    pthread_mutex_lock(&r->lock);
+    for (;;) {
+        while (!r->busy && !r->quit) {
+            pthread_cond_wait(&r->changed, &r->lock);
+        }
+        if (!r->busy) {
+            break;
+        }
+        pthread_mutex_unlock(&r->lock);
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        long bytes = write_snapshot(r);
+        double seconds = seconds_since(&start);
+
+        pthread_mutex_lock(&r->lock);
+        r->write_seconds += seconds;
+        if (bytes < 0) {
+            ++r->failed;
+        }
+        else {
+            ++r->snapshots;
+            r->bytes = bytes;
+        }
+        r->busy = 0;
+        pthread_cond_broadcast(&r->changed);
+    }
+    pthread_mutex_unlock(&r->lock);
+    return NULL;
+}
+
+struct checkpoint_run* checkpoint_create(const struct topology* t, char* file,
+                                         double period) {
+    struct checkpoint_run* r = calloc(1, sizeof(struct checkpoint_run));
+    assert(r != NULL);
+    int n = t->n, m = t->m;
+    r->t = t;
+    r->fingerprint = fingerprint(t);
+    struct preflow* p = &r->state;
+    p->n        = n;
+    p->begin    = t->first;
+    p->end      = t->first + 1;
+    p->head     = t->head;
+    p->rev      = t->rev;
+    p->capacity = t->capacity;
+    p->supply   = t->supply;
+    p->demand   = t->demand;
+    p->residual = array_alloc((m + 1) * sizeof(int));
+    p->height   = array_alloc(n * sizeof(int));
+    p->excess   = array_alloc(n * sizeof(long));
+    p->current  = array_alloc(n * sizeof(int));
+    p->queue    = array_alloc((n + 1) * sizeof(int));
+    p->search   = array_alloc(n * sizeof(int));
+    p->supplied = malloc(n * sizeof(int));
+    p->absorbed = malloc(n * sizeof(int));
+    assert(p->supplied && p->absorbed);
+    r->stop_after = LONG_MAX;
+    clear(r);
+    if (!file) {
+        return r;
+    }
+
+    r->file = file;
+    r->temporary = malloc(strlen(file) + 5);
+    assert(r->temporary != NULL);
+    strcpy(r->temporary, file);
+    strcat(r->temporary, ".tmp");
+    r->period = period;
+    r->staged_residual = malloc((m + 1) * sizeof(int));
+    r->staged_height   = malloc(n * sizeof(int));
+    r->staged_excess   = malloc(n * sizeof(long));
+    r->staged_current  = malloc(n * sizeof(int));
+    r->staged_queue    = malloc((n + 1) * sizeof(int));
+    r->staged_supplied = malloc(n * sizeof(int));
+    r->staged_absorbed = malloc(n * sizeof(int));
+    r->flow            = malloc((m / 2 + 1) * sizeof(int));
+    assert(r->staged_residual && r->staged_height && r->staged_excess &&
+           r->staged_current && r->staged_queue && r->staged_supplied &&
+           r->staged_absorbed && r->flow);
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->changed, NULL);
+    int created = pthread_create(&r->writer, NULL, &write_snapshots, r);
+    assert(created == 0);
+    return r;
+}
+
+void checkpoint_free(struct checkpoint_run* r) {
+    if (r->file) {
+        pthread_mutex_lock(&r->lock);
+        r->quit = 1;
+        pthread_cond_broadcast(&r->changed);
+        pthread_mutex_unlock(&r->lock);
+        pthread_join(r->writer, NULL);
+        pthread_mutex_destroy(&r->lock);
+        pthread_cond_destroy(&r->changed);
+        free(r->temporary);
+        free(r->staged_residual);
+        free(r->staged_height);
+        free(r->staged_excess);
+        free(r->staged_current);
+        free(r->staged_queue);
+        free(r->staged_supplied);
+        free(r->staged_absorbed);
+        free(r->flow);
+    }
+    struct preflow* p = &r->state;
+    array_free(p->residual);
+    array_free(p->height);
+    array_free(p->excess);
+    array_free(p->current);
+    array_free(p->queue);
+    array_free(p->search);
+    free(p->supplied);
+    free(p->absorbed);
+    free(r);
+}
+
+// Copies the state into the staging area. Only done while the writer is
+// idle, so the area is the solve's.
+static void stage(struct checkpoint_run* r) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    const struct preflow* p = &r->state;
+    int n = r->t->n, queued = 0;
+    memcpy(r->staged_residual, p->residual, r->t->m * sizeof(int));
+    memcpy(r->staged_height, p->height, n * sizeof(int));
+    memcpy(r->staged_excess, p->excess, n * sizeof(long));
+    memcpy(r->staged_current, p->current, n * sizeof(int));
+    memcpy(r->staged_supplied, p->supplied, n * sizeof(int));
+    memcpy(r->staged_absorbed, p->absorbed, n * sizeof(int));
+    for (int i = p->front; i != p->back; i = i == n ? 0 : i + 1) {
+        r->staged_queue[queued++] = p->queue[i];
+    }
+
+    struct checkpoint_header* h = &r->staged;
+    memcpy(h->magic, CHECKPOINT_MAGIC, sizeof(h->magic));
+    h->version = CHECKPOINT_VERSION;
+    h->n = n;
+    h->m = r->t->m;
+    h->queued = queued;
+    ++h->snapshot;
+    h->fingerprint = r->fingerprint;
+    h->since_global = p->since_global;
+    h->discharges = p->discharges;
+    h->pushes = p->pushes;
+    h->relabels = p->relabels;
+    h->global_relabels = p->global_relabels;
+    r->copy_seconds += seconds_since(&start);
+}
+
+// Hands the state to the writer, waiting for it to be idle first or skipping
+// the snapshot if it is busy
+static void take_snapshot(struct checkpoint_run* r, int wait) {
+    pthread_mutex_lock(&r->lock);
+    while (wait && r->busy) {
+        pthread_cond_wait(&r->changed, &r->lock);
+    }
+    if (r->busy) {
+        ++r->skipped;
+        pthread_mutex_unlock(&r->lock);
+        return;
+    }
+    pthread_mutex_unlock(&r->lock);
+    stage(r);
+    pthread_mutex_lock(&r->lock);
+    r->busy = 1;
+    pthread_cond_broadcast(&r->changed);
+    pthread_mutex_unlock(&r->lock);
+}
+
+static void wait_for_writer(struct checkpoint_run* r) {
+    pthread_mutex_lock(&r->lock);
+    while (r->busy) {
+        pthread_cond_wait(&r->changed, &r->lock);
+    }
+    pthread_mutex_unlock(&r->lock);
+}
+
+int checkpoint_resume(struct checkpoint_run* r) {
+    const struct topology* t = r->t;
+    struct preflow* p = &r->state;
+    int n = t->n;
+    assert(!r->started);
+    int fd = r->file ? open(r->file, O_RDONLY) : -1;
+    if (fd < 0) {
+        return 1;
+    }
+
+    struct checkpoint_header h;
+    int bad = read_all(fd, &h, sizeof(h)) ||
+              memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic)) != 0 ||
+              h.version != CHECKPOINT_VERSION || h.n != n || h.m != t->m ||
+              h.fingerprint != r->fingerprint || h.queued < 0 || n < h.queued;
+    int arcs = 0;
+    for (int a = 0; a < t->m; a++) {
+        arcs += t->forward[a];
+    }
+    int* flow = malloc((arcs + 1) * sizeof(int));
+    assert(flow != NULL);
+    if (!bad) {
+        char extra;
+        bad = read_all(fd, flow, arcs * sizeof(int)) ||
+              read_all(fd, p->height, n * sizeof(int)) ||
+              read_all(fd, p->excess, n * sizeof(long)) ||
+              read_all(fd, p->current, n * sizeof(int)) ||
+              read_all(fd, p->supplied, n * sizeof(int)) ||
+              read_all(fd, p->absorbed, n * sizeof(int)) ||
+              read_all(fd, p->queue, h.queued * sizeof(int)) ||
+              read(fd, &extra, 1) != 0;
+    }
+    close(fd);
+
+    // Only a state the solve could have been in is taken up
+    for (int a = 0, k = 0; !bad && a < t->m; a++) {
+        if (t->forward[a]) {
+            int f = flow[k++];
+            bad = f < 0 || t->capacity[a] < f;
+            p->residual[a] = t->capacity[a] - f;
+            p->residual[t->rev[a]] = t->capacity[t->rev[a]] + f;
+        }
+    }
+    for (int v = 0; !bad && v < n; v++) {
+        bad = p->height[v] < 0 || 2 * (n + 2) < p->height[v] ||
+              p->excess[v] < 0 || p->current[v] < t->first[v] ||
+              t->first[v + 1] < p->current[v];
+    }
+    for (int i = 0; !bad && i < h.queued; i++) {
+        bad = p->queue[i] < 0 || n <= p->queue[i];
+    }
+    free(flow);
+    if (bad) {
+        clear(r);
+        return 1;
+    }
+
+    p->front = 0;
+    p->back = h.queued;
+    p->since_global = h.since_global;
+    p->discharges = h.discharges;
+    p->pushes = h.pushes;
+    p->relabels = h.relabels;
+    p->global_relabels = h.global_relabels;
+    r->staged.snapshot = h.snapshot;
+    r->started = 1;
+    r->resumed = 1;
+    return 0;
+}
+
+long checkpoint_solve(struct checkpoint_run* r) {
+    struct preflow* p = &r->state;
+    if (!r->started) {
+        preflow_start(p);
+        r->started = 1;
+    }
+    struct timespec last;
+    clock_gettime(CLOCK_MONOTONIC, &last);
+    int stopped = 0;
+
+    // Snapshots are only taken between discharges, where the state is the
+    // queue and the arrays
+    while (!preflow_run(p, CHECKPOINT_SLICE)) {
+        if (stop_requested || r->stop_after <= p->discharges) {
+            if (r->file) {
+                take_snapshot(r, 1);
+            }
+            stopped = 1;
+            break;
+        }
+        if (r->file && r->period <= seconds_since(&last)) {
+            take_snapshot(r, 0);
+            clock_gettime(CLOCK_MONOTONIC, &last);
+        }
+    }
+    if (r->file) {
+        wait_for_writer(r);
+    }
+    return stopped ? -1 : preflow_value(p);
+}
+
+static void request_stop(int signal) {
+    (void)signal;
+    stop_requested = 1;
+}
+
+void checkpoint_catch_signals(void) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = &request_stop;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGINT, &action, NULL);
+}
+
+void checkpoint_store_flow(struct checkpoint_run* r, struct graph* g) {
+    const struct topology* t = r->t;
+    int a = 0;
+    for (int u = 0; u < g->size; u++) {
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            if (e->original) {
+                e->flow = t->capacity[a] - r->state.residual[a];
+            }
+            ++a;
+        }
+    }
+    assert(a == t->m);
+    memcpy(g->supplied, r->state.supplied, g->size * sizeof(int));
+    memcpy(g->absorbed, r->state.absorbed, g->size * sizeof(int));
+}
+
+static _Thread_local struct {
+    long discharges;
+    long pushes;
+    long relabels;
+    long global_relabels;
+    long snapshots;
+    long skipped;
+    long bytes;
+    double copy_seconds;
+    double write_seconds;
+    int resumed;
+} last_stats;
+
+static void keep_stats(struct checkpoint_run* r) {
+    last_stats.discharges = r->state.discharges;
+    last_stats.pushes = r->state.pushes;
+    last_stats.relabels = r->state.relabels;
+    last_stats.global_relabels = r->state.global_relabels;
+    last_stats.snapshots = r->snapshots;
+    last_stats.skipped = r->skipped;
+    last_stats.bytes = r->bytes;
+    last_stats.copy_seconds = r->copy_seconds;
+    last_stats.write_seconds = r->write_seconds;
+    last_stats.resumed = r->resumed;
+}
+
+int checkpoint_solve_graph(struct graph* g) {
+    char* file = getenv("MAXFLOW_CHECKPOINT");
+    char* seconds = getenv("MAXFLOW_CHECKPOINT_SECONDS");
+    struct topology* t = topology_build(g);
+    struct checkpoint_run* r =
+        checkpoint_create(t, file, seconds ? atof(seconds) : CHECKPOINT_SECONDS);
+    checkpoint_resume(r);
+    long value = checkpoint_solve(r);
+    assert(0 <= value);
+    checkpoint_store_flow(r, g);
+    keep_stats(r);
+    checkpoint_free(r);
+    topology_free(t);
+    // A finished solve is not taken up again
+    if (file) {
+        unlink(file);
+    }
+    return value;
+}
+
+void checkpoint_print_stats(FILE* fp) {
+    fprintf(fp, "checkpoint: discharges %ld, pushes %ld, relabels %ld, global "
+            "relabels %ld%s\n", last_stats.discharges, last_stats.pushes,
+            last_stats.relabels, last_stats.global_relabels,
+            last_stats.resumed ? ", from a snapshot" : "");
+    fprintf(fp, "checkpoint: snapshots %ld of %.1f MB, skipped %ld, solve "
+            "waited %.3f ms for the copies, writer %.3f ms\n",
+            last_stats.snapshots, last_stats.bytes / 1e6, last_stats.skipped,
+            1e3 * last_stats.copy_seconds, 1e3 * last_stats.write_seconds);
+}
+
+int checkpoint_run_file(char* path, char* file, double period, FILE* fp) {
+    struct graph* g = read_dimacs_file(path);
+    struct topology* t = topology_build(g);
+    struct checkpoint_run* r = checkpoint_create(t, file, period);
+    if (checkpoint_resume(r) == 0) {
+        fprintf(fp, "checkpoint: going on from snapshot %d in %s, %ld "
+                "discharges done\n", r->staged.snapshot, file,
+                r->state.discharges);
+    }
+    checkpoint_catch_signals();
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    long value = checkpoint_solve(r);
+    double seconds = seconds_since(&start);
+
+    int failed = value < 0;
+    if (failed) {
+        fprintf(fp, "checkpoint: stopped after %ld discharges, %s in %s\n",
+                r->state.discharges,
+                r->failed ? "the snapshot could not be written" : "snapshot",
+                file);
+    }
+    else {
+        checkpoint_store_flow(r, g);
+        fprintf(fp, "checkpoint: maximum flow %ld in %.3f ms\n", value,
+                1e3 * seconds);
+        unlink(file);
+    }
+    keep_stats(r);
+    checkpoint_print_stats(fp);
+    checkpoint_free(r);
+    topology_free(t);
+    graph_free(g);
+    return failed;
+}
+
+// Solves from no flow the fastest of CHECKPOINT_BENCH_RUNS times
+// Return: The maximum flow
+static long time_solves(struct topology* t, char* file, double period,
+                        double* best) {
+    long value = 0;
+    *best = 0;
+    for (int i = 0; i < CHECKPOINT_BENCH_RUNS; i++) {
+        struct checkpoint_run* r = checkpoint_create(t, file, period);
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        value = checkpoint_solve(r);
+        double seconds = seconds_since(&start);
+        if (i == 0 || seconds < *best) {
+            *best = seconds;
+            keep_stats(r);
+        }
+        checkpoint_free(r);
+    }
+    return value;
+}
+
+int checkpoint_benchmark(char* path, double period, FILE* fp) {
+    struct graph* g = read_dimacs_file(path);
+    struct topology* t = topology_build(g);
+    char* file = malloc(strlen(path) + strlen(".checkpoint") + 1);
+    assert(file != NULL);
+    strcpy(file, path);
+    strcat(file, ".checkpoint");
+
+    double plain, with;
+    long value = time_solves(t, NULL, period, &plain);
+    long discharges = last_stats.discharges;
+    fprintf(fp, "checkpoint: no snapshots          %9.3f ms, maximum flow "
+            "%ld, %ld discharges\n", 1e3 * plain, value, discharges);
+    long checked = time_solves(t, file, period, &with);
+    fprintf(fp, "checkpoint: a snapshot every %gs %9.3f ms, %+.1f%%, %ld "
+            "snapshots of %.1f MB, %ld skipped\n", period, 1e3 * with,
+            100 * (with - plain) / plain, last_stats.snapshots,
+            last_stats.bytes / 1e6, last_stats.skipped);
+    fprintf(fp, "checkpoint: the solve waited %.3f ms for the copies, %.1f%% "
+            "of it, the writer took %.3f ms beside it\n",
+            1e3 * last_stats.copy_seconds,
+            100 * last_stats.copy_seconds / with,
+            1e3 * last_stats.write_seconds);
+    int failed = checked != value;
+
+    // Stop a solve halfway and take it up in a new run
+    struct checkpoint_run* r = checkpoint_create(t, file, period);
+    r->stop_after = discharges / 2;
+    long stopped = checkpoint_solve(r);
+    long at = r->state.discharges;
+    failed |= r->failed != 0;
+    checkpoint_free(r);
+    if (0 <= stopped) {
+        fprintf(fp, "checkpoint: solved within a slice of %d discharges, "
+                "nothing to take up\n", CHECKPOINT_SLICE);
+    }
+    else {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        r = checkpoint_create(t, file, period);
+        int missing = checkpoint_resume(r);
+        double load = seconds_since(&start);
+        long resumed = missing ? -1 : checkpoint_solve(r);
+        double rest = seconds_since(&start) - load;
+        struct flow_verdict verdict;
+        memset(&verdict, 0, sizeof(verdict));
+        if (!missing) {
+            checkpoint_store_flow(r, g);
+            verify_flow(g, 1, &verdict);
+        }
+        int right = !missing && resumed == value && verdict.maximum;
+        fprintf(fp, "checkpoint: stopped at %ld discharges, taken up in %.3f "
+                "ms, finished in %.3f ms, maximum flow %ld%s\n", at,
+                1e3 * load, 1e3 * rest, resumed,
+                right ? "" : ", WRONG FLOW");
+        failed |= !right;
+        checkpoint_free(r);
+    }
+
+    unlink(file);
+    free(file);
+    topology_free(t);
+    graph_free(g);
+    return failed;
+}
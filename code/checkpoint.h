@@ -0,0 +1,174 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "graph.h"
+#include "context.h"
+#include "preflow.h"
+
+#include <stdio.h>
+#include <pthread.h>
+
+/* Push-relabel that takes snapshots of its state on disk while it runs, so a
+ * solve that is stopped can be taken up again from the last one instead of
+ * from the start.
+ *
+ * The solve is the FIFO push-relabel of preflow.h that contexts solve with,
+ * on a topology of context.h, run CHECKPOINT_SLICE discharges at a time.
+ * Between two runs it looks at the clock. When a snapshot is due and the
+ * writer is idle, it copies the residual capacities, heights, excess, current
+ * arcs, queue of active vertices and flow of the terminals into a staging
+ * area and goes on, and that copy is all the solve waits for. A snapshot due while the writer is
+ * still busy is skipped.
+ *
+ * The writer is a thread of the run. It turns the residual capacities into
+ * the flow of the graph's arcs, half as many numbers, writes the snapshot to
+ * FILE.tmp, syncs it and renames it over FILE, so FILE always holds a whole
+ * snapshot.
+ *
+ * A snapshot is a struct checkpoint_header and then flow[m / 2] of the arcs
+ * with forward[a], height[n], excess[n] as longs, current[n], supplied[n],
+ * absorbed[n] and the queue, queue[queued], all in the byte order of the
+ * machine. The header has a fingerprint of the topology, and a run only takes
+ * up a snapshot of the same graph. */
+
+#define CHECKPOINT_MAGIC "MFCP"
+#define CHECKPOINT_VERSION 1
+
+/* Vertices discharged between looks at the clock */
+#define CHECKPOINT_SLICE 4096
+
+/* Seconds between snapshots if MAXFLOW_CHECKPOINT_SECONDS is not set */
+#define CHECKPOINT_SECONDS 60.0
+
+/* Seconds between snapshots in checkpoint_benchmark by default */
+#define CHECKPOINT_BENCH_SECONDS 0.05
+
+/* Times each solve of checkpoint_benchmark is run, the fastest counts */
+#define CHECKPOINT_BENCH_RUNS 3
+
+struct checkpoint_header {
+    char magic[4];
+    int version;
+    int n;
+    int m;                  // Arcs, the reverse arcs included
+    int queued;             // Active vertices in the queue
+    int snapshot;           // Snapshots the run had taken, this one included
+    unsigned long fingerprint;
+    long since_global;      // Relabels since the last global relabel
+    long discharges;
+    long pushes;
+    long relabels;
+    long global_relabels;
+};
+
+/* The state of a solve, the staging area and the writer. The fields are
+ * read only for the caller. */
+struct checkpoint_run {
+    const struct topology* t;
+    unsigned long fingerprint;
+    int started;            // 1 once there is a preflow, fresh or taken up
+    struct preflow state;   // The solve, on the arcs of the topology
+    long stop_after;        // Discharges after which the solve stops, at
+                            // the end of a slice. LONG_MAX for no limit.
+
+    // Snapshots, none if file is NULL
+    char* file;
+    char* temporary;        // FILE.tmp
+    double period;          // Seconds between snapshots
+    struct checkpoint_header staged;
+    int* staged_residual;
+    int* staged_height;
+    long* staged_excess;
+    int* staged_current;
+    int* staged_queue;
+    int* staged_supplied;
+    int* staged_absorbed;
+    int* flow;              // The writer's, flow of the forward arcs
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int busy;               // 1 while the writer has a snapshot to write
+    int quit;
+
+    long snapshots;         // Written, the last of a stopped solve included
+    long skipped;           // Due while the writer was busy
+    long failed;            // Snapshots that could not be written
+    long bytes;             // Size of a snapshot
+    double copy_seconds;    // The solve waiting for the copies
+    double write_seconds;   // The writer writing, beside the solve
+    int resumed;            // 1 if the run took up a snapshot
+};
+
+/* Makes a run with no flow on a topology
+ * Args:    - Pointer to the topology
+ *          - Path of the snapshot file, NULL for no snapshots
+ *          - Seconds between snapshots
+ * Return:  Pointer to the run */
+struct checkpoint_run* checkpoint_create(const struct topology* t, char* file,
+                                         double period);
+
+/* Frees a run after its writer is done. The snapshot file is left.
+ * Args:    - Pointer to the run
+ * Return:  Nothing */
+void checkpoint_free(struct checkpoint_run* r);
+
+/* Takes up the snapshot in the run's file
+ * Args:    - Pointer to a run that has not solved yet
+ * Return:  0 if the run goes on from the snapshot, 1 if there is no file or
+ *          it is not a whole snapshot of this graph */
+int checkpoint_resume(struct checkpoint_run* r);
+
+/* Solves from where the run is, taking snapshots. When the run reaches
+ * stop_after discharges, or checkpoint_catch_signals caught a signal, a last
+ * snapshot is written before it returns.
+ * Args:    - Pointer to the run
+ * Return:  The maximum flow, -1 if the solve was stopped */
+long checkpoint_solve(struct checkpoint_run* r);
+
+/* Makes SIGTERM and SIGINT stop the solves at the end of a slice with a last
+ * snapshot, instead of ending the process
+ * Args:    None
+ * Return:  Nothing */
+void checkpoint_catch_signals(void);
+
+/* Stores the run's flow in the edges of the graph the topology was built
+ * from, or of a copy of it
+ * Args:    - Pointer to the run
+ *          - Pointer to the graph
+ * Return:  Nothing */
+void checkpoint_store_flow(struct checkpoint_run* r, struct graph* g);
+
+/* Solves a graph with snapshots for solver.h. The file is the environment
+ * variable MAXFLOW_CHECKPOINT, no snapshots if it is not set, and the
+ * seconds between them MAXFLOW_CHECKPOINT_SECONDS.
+ * Args:    - Pointer to graph
+ * Return:  The maximum flow */
+int checkpoint_solve_graph(struct graph* g);
+
+/* Prints the counters of the last checkpointed solve in this thread
+ * Args:    - The file to print to
+ * Return:  Nothing */
+void checkpoint_print_stats(FILE* fp);
+
+/* Solves a graph taking snapshots in a file, going on from the snapshot in
+ * it if it has one of this graph. The file is removed once the solve is
+ * done.
+ * Args:    - Path to the graph
+ *          - Path of the snapshot file
+ *          - Seconds between snapshots
+ *          - The file to print to
+ * Return:  0 if solved, 1 if stopped by a signal */
+int checkpoint_run_file(char* path, char* file, double period, FILE* fp);
+
+/* Times solving a graph without snapshots and with a snapshot every
+ * 'period' seconds, then stops a solve halfway, takes it up from its
+ * snapshot in a new run and checks that the flow is a maximum flow. The
+ * snapshot file is written next to the graph and removed after.
+ * Args:    - Path to the graph
+ *          - Seconds between snapshots
+ *          - The file to print to
+ * Return:  0 on success, 1 if a snapshot could not be written or taken up
+ *          or the flows differ */
+int checkpoint_benchmark(char* path, double period, FILE* fp);
+
+#endif
@@ -0,0 +1,33 @@
+#!/usr/bin/python3
+# Small client for './max.out --serve'. Starts the server, sends a batch of
+# solve requests for the graphs given as arguments (or the first graphs in
+# generator/graphs/) and prints the answers and the server's stats.
+#
+# python3 client.py [<path to graph>...]
+import sys, os
+import subprocess
+
+PATH_graphs = os.path.join("generator", "graphs")
+ALGORITHMS = ["dfs", "bfs", "rtf"]
+ROUNDS = 3   # Each graph is solved this many times to show cache hits
+
+graph_files = sys.argv[1:]
+if not graph_files:
+    graph_files = sorted(f for f in os.listdir(PATH_graphs) if f.startswith('V'))
+    graph_files = [os.path.join(PATH_graphs, f) for f in graph_files[:4]]
+
+server = subprocess.Popen(["./max.out", "--serve"], stdin=subprocess.PIPE,
+                          stdout=subprocess.PIPE, universal_newlines=True)
+
+request_id = 0
+for r in range(ROUNDS):
+    for f in graph_files:
+        for algo in ALGORITHMS:
+            request_id += 1
+            server.stdin.write("solve %d %s %s\n" % (request_id, f, algo))
+server.stdin.write("sync\nstats\nquit\n")
+server.stdin.flush()
+
+for line in server.stdout:
+    print(line, end='')
+server.wait()
@@ -0,0 +1,728 @@
+#define _GNU_SOURCE
+#include "compact.h"
+#include "list.h"
+#include "maxflow.h"
+#include "pushrelabel.h"
+#include "loaddimacs.h"
+#include "trace.h"
+#include "placement.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+#include <time.h>
+
+static int write_varint(unsigned char* p, unsigned int value) {
+    int size = 0;
+    while (value >= 0x80) {
+        p[size++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    p[size++] = value;
+    return size;
+}
+
+static int varint_size(unsigned int value) {
+    int size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+static unsigned int read_varint(const unsigned char** p) {
+    unsigned int value = 0;
+    int shift = 0;
+    while (**p & 0x80) {
+        value |= (unsigned int)(*(*p)++ & 0x7f) << shift;
+        shift += 7;
+    }
+    return value | (unsigned int)*(*p)++ << shift;
+}
+
+static int compare_slots(const void* a, const void* b) {
+    long x = *(const long*)a, y = *(const long*)b;
+    return (x > y) - (x < y);
+}
+
+// Builds the arcs of the graph's edges. Edge i goes from tail[i] to
+// head[i]. Each vertex' arcs are sorted by their head, and then by edge,
+// through a slot holding the head above a key. The key of edge i's arc is
+// 2i, and of its reverse arc 2i + 1.
+static void build_arcs(struct compact* c, int n_edges, int* tail, int* head,
+                       int* capacity, struct edge** edges, int compressed) {
+    int n = c->g->size;
+    assert(n_edges <= INT_MAX / 2);
+    int m = 2 * n_edges;
+    c->n = n;
+    c->m = m;
+    c->compressed = compressed;
+    c->head = NULL;
+    c->rev = NULL;
+    c->offset = NULL;
+    c->bytes = NULL;
+    c->edges = NULL;
+    c->first    = array_calloc(n + 1, sizeof(int));
+    c->residual = array_alloc((m + 1) * sizeof(int));
+    long* slot  = malloc((m + 1) * sizeof(long));
+    int* fill   = malloc((n + 1) * sizeof(int));
+    int* at     = malloc((m + 1) * sizeof(int));
+    assert(c->first && c->residual && slot && fill && at);
+
+    for (int i = 0; i < n_edges; i++) {
+        ++c->first[tail[i]];
+        ++c->first[head[i]];
+    }
+    int a = 0;
+    for (int u = 0; u <= n; u++) {
+        int count = c->first[u];
+        c->first[u] = a;
+        fill[u] = a;
+        a += count;
+    }
+    for (int i = 0; i < n_edges; i++) {
+        slot[fill[tail[i]]++] = (long)head[i] << 32 | 2 * i;
+        slot[fill[head[i]]++] = (long)tail[i] << 32 | (2 * i + 1);
+    }
+    free(fill);
+    for (int u = 0; u < n; u++) {
+        qsort(slot + c->first[u], c->first[u + 1] - c->first[u], sizeof(long),
+              &compare_slots);
+    }
+    for (a = 0; a < m; a++) {
+        at[slot[a] & 0xffffffff] = a;
+    }
+
+    for (a = 0; a < m; a++) {
+        int key = slot[a] & 0xffffffff;
+        c->residual[a] = key % 2 ? 0 : capacity[key / 2];
+    }
+    if (edges) {
+        c->edges = malloc((m + 1) * sizeof(struct edge*));
+        assert(c->edges != NULL);
+        for (a = 0; a < m; a++) {
+            int key = slot[a] & 0xffffffff;
+            c->edges[a] = key % 2 ? edges[key / 2]->reverse_edge
+                                  : edges[key / 2];
+        }
+    }
+
+    c->topology_bytes = (n + 1) * sizeof(int);
+    if (!compressed) {
+        c->head = array_alloc((m + 1) * sizeof(int));
+        c->rev  = array_alloc((m + 1) * sizeof(int));
+        assert(c->head && c->rev);
+        for (a = 0; a < m; a++) {
+            c->head[a] = slot[a] >> 32;
+            c->rev[a]  = at[(slot[a] & 0xffffffff) ^ 1];
+        }
+        c->topology_bytes += 2L * m * sizeof(int);
+    }
+    else {
+        // The size of the bytes first, then the bytes
+        c->offset = array_alloc((n + 1) * sizeof(long));
+        assert(c->offset != NULL);
+        long size = 0;
+        for (int u = 0; u < n; u++) {
+            int last = 0;
+            c->offset[u] = size;
+            for (a = c->first[u]; a < c->first[u + 1]; a++) {
+                int v = slot[a] >> 32;
+                size += varint_size(v - last);
+                size += varint_size(at[(slot[a] & 0xffffffff) ^ 1] -
+                                    c->first[v]);
+                last = v;
+            }
+        }
+        c->offset[n] = size;
+        c->bytes = array_alloc(size + 1);
+        assert(c->bytes != NULL);
+        for (int u = 0; u < n; u++) {
+            int last = 0;
+            unsigned char* p = c->bytes + c->offset[u];
+            for (a = c->first[u]; a < c->first[u + 1]; a++) {
+                int v = slot[a] >> 32;
+                p += write_varint(p, v - last);
+                p += write_varint(p, at[(slot[a] & 0xffffffff) ^ 1] -
+                                     c->first[v]);
+                last = v;
+            }
+        }
+        c->topology_bytes += (n + 1) * sizeof(long) + size;
+    }
+    free(slot);
+    free(at);
+}
+
+struct compact* compact_build(struct graph* g, int compressed) {
+    struct compact* c = malloc(sizeof(struct compact));
+    assert(c != NULL);
+    c->g = g;
+    int n_edges = 0;
+
+    for (int u = 0; u < g->size; u++) {
+        n_edges += g->adj_array[u]->size;
+    }
+    // Half of the edges are reverse edges
+    n_edges /= 2;
+    int* tail = malloc((n_edges + 1) * sizeof(int));
+    int* head = malloc((n_edges + 1) * sizeof(int));
+    int* capacity = malloc((n_edges + 1) * sizeof(int));
+    struct edge** edges = malloc((n_edges + 1) * sizeof(struct edge*));
+    assert(tail && head && capacity && edges);
+
+    int i = 0;
+    for (int u = 0; u < g->size; u++) {
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            if (e->original) {
+                tail[i] = e->from;
+                head[i] = e->to;
+                capacity[i] = e->capacity;
+                edges[i++] = e;
+            }
+        }
+    }
+    assert(i == n_edges);
+    build_arcs(c, n_edges, tail, head, capacity, edges, compressed);
+
+    free(tail);
+    free(head);
+    free(capacity);
+    free(edges);
+    return c;
+}
+
+struct compact* compact_read(char* file, int compressed) {
+    TRACE_BEGIN("load");
+    FILE* fp = fopen(file, "r");
+    assert(fp != NULL);
+    struct compact* c = malloc(sizeof(struct compact));
+    assert(c != NULL);
+
+    struct graph* g = NULL;
+    int terminals_read = 0, n_edges = 0, size = 0;
+    int *tail = NULL, *head = NULL, *capacity = NULL;
+    char* line = NULL;
+    size_t len = 0;
+
+    while (getline(&line, &len, fp) != EOF) {
+        switch (line[0]) {
+            case 'a': {
+                if (n_edges == size) {
+                    size = size ? 2 * size : 4096;
+                    tail = realloc(tail, size * sizeof(int));
+                    head = realloc(head, size * sizeof(int));
+                    capacity = realloc(capacity, size * sizeof(int));
+                    assert(tail && head && capacity);
+                }
+                char* s = line + 1;
+                int from, to, cap;
+                int read = read_int(&s, &from) && read_int(&s, &to) &&
+                           read_int(&s, &cap);
+                // The checks of graph_add_edges
+                assert(read && g != NULL);
+                assert(from != to && 0 <= cap);
+                assert(1 <= from && from <= g->size);
+                assert(1 <= to && to <= g->size);
+                tail[n_edges] = from - 1;
+                head[n_edges] = to - 1;
+                capacity[n_edges++] = cap;
+                break;
+            }
+            case 'n':
+                // The terminals in the file replace the default s and t
+                if (!terminals_read++) {
+                    graph_clear_terminals(g);
+                }
+                read_and_set_terminal(g, line);
+                break;
+            case 'p':
+                g = read_and_build_graph(line);
+                break;
+        }
+    }
+    assert(g != NULL);
+    free(line);
+    int closed = fclose(fp);
+    assert(closed == 0);
+
+    c->g = g;
+    build_arcs(c, n_edges, tail, head, capacity, NULL, compressed);
+    free(tail);
+    free(head);
+    free(capacity);
+    TRACE_END("load");
+    return c;
+}
+
+void compact_free(struct compact* c) {
+    if (!c->edges) {
+        graph_free(c->g);
+    }
+    array_free(c->first);
+    array_free(c->head);
+    array_free(c->rev);
+    array_free(c->offset);
+    array_free(c->bytes);
+    array_free(c->residual);
+    free(c->edges);
+    free(c);
+}
+
+void compact_begin(struct compact* c, struct compact_cursor* cur, int u) {
+    cur->arc = c->first[u];
+    cur->end = c->first[u + 1];
+    cur->pos = c->compressed ? c->offset[u] : 0;
+    cur->last_head = 0;
+}
+
+int compact_next_block(struct compact* c, struct compact_cursor* cur,
+                       struct compact_block* b) {
+    int size = cur->end - cur->arc;
+    size = size < COMPACT_BLOCK ? size : COMPACT_BLOCK;
+    b->arc = cur->arc;
+    b->size = size;
+
+    if (!c->compressed) {
+        b->head = c->head + cur->arc;
+        b->rev = c->rev + cur->arc;
+    }
+    else {
+        const unsigned char* p = c->bytes + cur->pos;
+        int v = cur->last_head;
+        for (int i = 0; i < size; i++) {
+            v += read_varint(&p);
+            b->heads[i] = v;
+            b->revs[i] = c->first[v] + read_varint(&p);
+        }
+        b->head = b->heads;
+        b->rev = b->revs;
+        cur->pos = p - c->bytes;
+        cur->last_head = v;
+    }
+    cur->arc += size;
+    return size;
+}
+
+void compact_store_flow(struct compact* c) {
+    if (!c->edges) {
+        return;
+    }
+    for (int a = 0; a < c->m; a++) {
+        struct edge* e = c->edges[a];
+        if (e->original) {
+            e->flow = e->capacity - c->residual[a];
+        }
+    }
+}
+
+// Parent of a source in the search. Unvisited vertices have parent -1.
+#define PARENT_SOURCE -2
+
+int compact_edmonds_karp(struct compact* c) {
+    struct graph* g = c->g;
+    int n = c->n, maxflow = 0;
+    int* parent     = array_alloc(n * sizeof(int));
+    int* parent_arc = array_alloc(n * sizeof(int));
+    int* parent_rev = array_alloc(n * sizeof(int));
+    int* queue      = array_alloc(n * sizeof(int));
+    assert(parent && parent_arc && parent_rev && queue);
+    struct compact_block b;
+    struct compact_cursor cur;
+
+    while (1) {
+        TRACE_BEGIN("search");
+        int first = 0, last = 0, sink = -1;
+        for (int i = 0; i < n; i++) {
+            parent[i] = -1;
+            if (graph_supply_left(g, i) > 0) {
+                parent[i] = PARENT_SOURCE;
+                queue[last++] = i;
+            }
+        }
+
+        while (sink == -1 && first < last) {
+            int u = queue[first++];
+            compact_begin(c, &cur, u);
+            while (sink == -1 && compact_next_block(c, &cur, &b)) {
+                for (int i = 0; i < b.size; i++) {
+                    int v = b.head[i];
+                    if (c->residual[b.arc + i] <= 0 || parent[v] != -1) {
+                        continue;
+                    }
+                    parent[v] = u;
+                    parent_arc[v] = b.arc + i;
+                    parent_rev[v] = b.rev[i];
+                    queue[last++] = v;
+                    if (graph_demand_left(g, v) > 0) {
+                        sink = v;
+                        break;
+                    }
+                }
+            }
+        }
+        TRACE_END("search");
+        if (sink == -1) {
+            break;
+        }
+
+        // The path of parents from the sink back to a source
+        int cfp = graph_demand_left(g, sink), s = sink;
+        while (0 <= parent[s]) {
+            int a = parent_arc[s];
+            cfp = c->residual[a] < cfp ? c->residual[a] : cfp;
+            s = parent[s];
+        }
+        cfp = graph_supply_left(g, s) < cfp ? graph_supply_left(g, s) : cfp;
+        for (int v = sink; v != s; v = parent[v]) {
+            c->residual[parent_arc[v]] -= cfp;
+            c->residual[parent_rev[v]] += cfp;
+        }
+        g->supplied[s] += cfp;
+        g->absorbed[sink] += cfp;
+        maxflow += cfp;
+    }
+
+    array_free(parent);
+    array_free(parent_arc);
+    array_free(parent_rev);
+    array_free(queue);
+    return maxflow;
+}
+
+// The state of a push-relabel run. u.current is the arc 'skip' arcs into the
+// block that starts at current[u].
+struct compact_pr {
+    struct compact* c;
+    int* height;
+    int* excess;
+    int* count;             // Vertices at each height below |V|
+    int* ring;              // The active vertices, first in first out
+    int ring_first;
+    int ring_size;
+    struct compact_cursor* current;
+    int* skip;
+};
+
+static void pr_activate(struct compact_pr* pr, int v) {
+    pr->ring[(pr->ring_first + pr->ring_size++) % pr->c->n] = v;
+}
+
+static void pr_reset_current(struct compact_pr* pr, int u) {
+    compact_begin(pr->c, &pr->current[u], u);
+    pr->skip[u] = 0;
+}
+
+// Like relabel in pushrelabel.c
+static void pr_relabel(struct compact_pr* pr, int u) {
+    TRACE_BEGIN("relabel");
+    struct compact* c = pr->c;
+    struct compact_block b;
+    struct compact_cursor cur;
+    int min = INT_MAX;
+
+    compact_begin(c, &cur, u);
+    while (compact_next_block(c, &cur, &b)) {
+        for (int i = 0; i < b.size; i++) {
+            int h = pr->height[b.head[i]];
+            if (0 < c->residual[b.arc + i] && h < min) {
+                min = h;
+            }
+        }
+    }
+    if (0 < graph_demand_left(c->g, u)) {
+        min = 0;
+    }
+    if (0 < c->g->supplied[u] && min > c->n) {
+        min = c->n;
+    }
+    pr->height[u] = 1 + min;
+    TRACE_END("relabel");
+}
+
+// Pushes u's excess on the admissible arcs from u.current on, and to the
+// terminals, until it has none or is relabeled
+// Return: 1 if u was relabeled, 0 if not
+static int pr_discharge(struct compact_pr* pr, int u) {
+    struct compact* c = pr->c;
+    struct graph* g = c->g;
+    int* excess = pr->excess;
+    int* height = pr->height;
+    struct compact_block b;
+
+    while (excess[u] > 0) {
+        struct compact_cursor next = pr->current[u];
+        if (!compact_next_block(c, &next, &b)) {
+            if (!push_terminal(g, u, excess, height)) {
+                pr_relabel(pr, u);
+                pr_reset_current(pr, u);
+                return 1;
+            }
+            continue;
+        }
+
+        int i = pr->skip[u];
+        for (; i < b.size; i++) {
+            int a = b.arc + i, v = b.head[i];
+            if (c->residual[a] <= 0 || height[u] != height[v] + 1) {
+                continue;
+            }
+            TRACE_BEGIN("push");
+            int amount = excess[u] < c->residual[a] ? excess[u]
+                                                    : c->residual[a];
+            int before = excess[v];
+            c->residual[a] -= amount;
+            c->residual[b.rev[i]] += amount;
+            excess[u] -= amount;
+            excess[v] += amount;
+            if (before == 0 && !is_unbounded_terminal(g, v)) {
+                pr_activate(pr, v);
+            }
+            TRACE_END("push");
+            if (excess[u] == 0) {
+                break;
+            }
+        }
+        if (i < b.size) {
+            pr->skip[u] = i;
+        }
+        else {
+            pr->current[u] = next;
+            pr->skip[u] = 0;
+        }
+    }
+    return 0;
+}
+
+// The gap heuristic of push_relabel_run_fifo
+static void pr_lift_gap(struct compact_pr* pr, int height) {
+    struct graph* g = pr->c->g;
+    for (int v = 0; v < g->size; v++) {
+        int h = pr->height[v];
+        if (height < h && h < g->size && !is_unbounded_terminal(g, v)) {
+            --pr->count[h];
+            pr->height[v] = g->size;
+            pr_reset_current(pr, v);
+        }
+    }
+}
+
+// Like initialize_preflow in pushrelabel.c. There is no flow yet, so the
+// arcs out of a source with residual capacity are its edges.
+static void pr_initialize_preflow(struct compact_pr* pr) {
+    struct compact* c = pr->c;
+    struct graph* g = c->g;
+    struct compact_block b;
+    struct compact_cursor cur;
+
+    for (int i = 0; i < c->n; i++) {
+        pr->excess[i] = 0;
+        pr->height[i] = 0;
+        g->supplied[i] = 0;
+        g->absorbed[i] = 0;
+    }
+    for (int s = 0; s < c->n; s++) {
+        if (g->supply[s] != TERMINAL_UNBOUNDED) {
+            pr->excess[s] += g->supply[s];
+            g->supplied[s] = g->supply[s];
+            continue;
+        }
+        pr->height[s] = c->n;
+        compact_begin(c, &cur, s);
+        while (compact_next_block(c, &cur, &b)) {
+            for (int i = 0; i < b.size; i++) {
+                int a = b.arc + i, v = b.head[i];
+                if (g->supply[v] != TERMINAL_UNBOUNDED && 0 < c->residual[a]) {
+                    int amount = c->residual[a];
+                    c->residual[a] = 0;
+                    c->residual[b.rev[i]] += amount;
+                    pr->excess[v] += amount;
+                    pr->excess[s] -= amount;
+                }
+            }
+        }
+    }
+}
+
+int compact_push_relabel(struct compact* c) {
+    struct graph* g = c->g;
+    int n = c->n;
+    struct compact_pr pr;
+    pr.c = c;
+    pr.height  = array_alloc(n * sizeof(int));
+    pr.excess  = array_alloc(n * sizeof(int));
+    pr.count   = calloc(n, sizeof(int));
+    pr.ring    = malloc(n * sizeof(int));
+    pr.current = malloc(n * sizeof(struct compact_cursor));
+    pr.skip    = malloc(n * sizeof(int));
+    assert(pr.height && pr.excess && pr.count && pr.ring && pr.current &&
+           pr.skip);
+    pr.ring_first = 0;
+    pr.ring_size = 0;
+
+    pr_initialize_preflow(&pr);
+    for (int i = 0; i < n; i++) {
+        pr_reset_current(&pr, i);
+        if (is_unbounded_terminal(g, i)) {
+            continue;
+        }
+        if (pr.height[i] < n) {
+            ++pr.count[pr.height[i]];
+        }
+        if (pr.excess[i] > 0) {
+            pr_activate(&pr, i);
+        }
+    }
+
+    while (pr.ring_size) {
+        int u = pr.ring[pr.ring_first];
+        pr.ring_first = (pr.ring_first + 1) % n;
+        --pr.ring_size;
+        while (pr.excess[u] > 0) {
+            int before = pr.height[u];
+            if (!pr_discharge(&pr, u) || before >= n) {
+                continue;
+            }
+            --pr.count[before];
+            if (pr.height[u] < n) {
+                ++pr.count[pr.height[u]];
+            }
+            // Height 0 is never a gap, the super sink is there
+            if (pr.count[before] == 0 && 0 < before) {
+                pr_lift_gap(&pr, before);
+            }
+        }
+    }
+
+    int maximum_flow = 0;
+    for (int i = 0; i < n; i++) {
+        if (g->supply[i] == TERMINAL_UNBOUNDED) {
+            g->supplied[i] = -pr.excess[i];
+        }
+        if (g->demand[i] == TERMINAL_UNBOUNDED) {
+            g->absorbed[i] = pr.excess[i];
+        }
+        maximum_flow += g->absorbed[i];
+    }
+
+    array_free(pr.height);
+    array_free(pr.excess);
+    free(pr.count);
+    free(pr.ring);
+    free(pr.current);
+    free(pr.skip);
+    return maximum_flow;
+}
+
+int compact_bfs_solve(struct graph* g) {
+    struct compact* c = compact_build(g, 1);
+    int maxflow = compact_edmonds_karp(c);
+    compact_store_flow(c);
+    compact_free(c);
+    return maxflow;
+}
+
+int compact_pr_solve(struct graph* g) {
+    struct compact* c = compact_build(g, 1);
+    int maxflow = compact_push_relabel(c);
+    compact_store_flow(c);
+    graph_cancel_surplus(g);
+    compact_free(c);
+    return maxflow;
+}
+
+// Goes through all the arcs with residual capacity, as a search does
+// Return: A checksum, the same for both forms
+static long scan_all(struct compact* c) {
+    struct compact_block b;
+    struct compact_cursor cur;
+    long sum = 0;
+    for (int u = 0; u < c->n; u++) {
+        compact_begin(c, &cur, u);
+        while (compact_next_block(c, &cur, &b)) {
+            for (int i = 0; i < b.size; i++) {
+                if (0 < c->residual[b.arc + i]) {
+                    sum += b.head[i] ^ b.rev[i];
+                }
+            }
+        }
+    }
+    return sum;
+}
+
+static char* form_names[] = {"arrays", "bytes"};
+
+int compact_benchmark(char* path, FILE* fp) {
+    struct compact* forms[2];
+    double scan[2], solve[2][2];
+    int flow[2][2];
+    long checksum[2];
+
+    for (int f = 0; f < 2; f++) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        struct compact* c = compact_read(path, f);
+        double load = seconds_since(&start);
+        forms[f] = c;
+        fprintf(fp, "compact: %-6s %.2f bytes/arc of topology, %.2f with "
+                "the residual capacities, loaded in %.3f ms\n", form_names[f],
+                (double)c->topology_bytes / c->m,
+                (double)(c->topology_bytes + c->m * sizeof(int)) / c->m,
+                load * 1000);
+    }
+    fprintf(fp, "compact: the adjacency lists take %zu bytes/arc and more "
+            "for malloc, %d vertices, %d arcs\n",
+            sizeof(struct edge) + sizeof(struct element), forms[0]->n,
+            forms[0]->m);
+
+    for (int f = 0; f < 2; f++) {
+        struct compact* c = forms[f];
+        int* residual = malloc((c->m + 1) * sizeof(int));
+        assert(residual != NULL);
+        memcpy(residual, c->residual, c->m * sizeof(int));
+
+        // Repeat the scan until it has run for at least 0.1 seconds
+        struct timespec start;
+        long reps = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        do {
+            checksum[f] = scan_all(c);
+            ++reps;
+        } while (seconds_since(&start) < 0.1);
+        scan[f] = seconds_since(&start) / reps;
+
+        for (int s = 0; s < 2; s++) {
+            memcpy(c->residual, residual, c->m * sizeof(int));
+            memset(c->g->supplied, 0, c->n * sizeof(int));
+            memset(c->g->absorbed, 0, c->n * sizeof(int));
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            flow[f][s] = s ? compact_push_relabel(c) : compact_edmonds_karp(c);
+            solve[f][s] = seconds_since(&start);
+        }
+        free(residual);
+    }
+
+    fprintf(fp, "compact: scan   arrays %.3f arcs/ns, bytes %.3f arcs/ns, "
+            "%.2f times slower\n", forms[0]->m / (scan[0] * 1e9),
+            forms[1]->m / (scan[1] * 1e9), scan[1] / scan[0]);
+    char* solvers[] = {"bfs", "pr"};
+    for (int s = 0; s < 2; s++) {
+        fprintf(fp, "compact: %-6s maximum flow %d, arrays %.3f ms, bytes "
+                "%.3f ms, %.2f times slower\n", solvers[s], flow[1][s],
+                solve[0][s] * 1000, solve[1][s] * 1000,
+                solve[1][s] / solve[0][s]);
+    }
+
+    int same = checksum[0] == checksum[1] && flow[0][0] == flow[1][0] &&
+               flow[0][1] == flow[1][1] && flow[0][0] == flow[0][1];
+    if (!same) {
+        fprintf(fp, "compact: THE FORMS DIFFER\n");
+    }
+    compact_free(forms[0]);
+    compact_free(forms[1]);
+    return !same;
+}
@@ -0,0 +1,131 @@
+#ifndef COMPACT_H
+#define COMPACT_H
+
+#include "graph.h"
+#include "edge.h"
+
+#include <stdio.h>
+
+/* A graph kept small enough for graphs that do not fit in memory as lists.
+ * The arcs out of u, the reverse arcs included, are numbered first[u] ..
+ * first[u + 1] - 1 and sorted by the vertex they go to. The residual
+ * capacities are a dense array indexed by arc, the only part that changes.
+ *
+ * The topology is either arrays like in csr.h, 'head' and 'rev', or bytes.
+ * In the bytes the arcs of u start at offset[u], and each arc is two
+ * varints of 7 bits a byte: how much its head is above the head of the arc
+ * before it, or above 0 for u's first arc, and the place of its reverse arc
+ * among the arcs of its head. Most arcs take 2 to 4 bytes instead of 8.
+ *
+ * The solvers go through the arcs of a vertex a block at a time, with
+ * compact_next_block, which decodes the bytes into the block or points it
+ * into the arrays, so the same code runs on both. */
+
+/* Arcs decoded at a time */
+#define COMPACT_BLOCK 64
+
+struct compact {
+    int n;
+    int m;                  // Number of arcs, the reverse arcs included
+    int compressed;         // 1 for the bytes, 0 for the arrays
+    int* first;             // n + 1 entries
+    int* head;              // The arrays, NULL if compressed
+    int* rev;
+    long* offset;           // The bytes, NULL if not compressed. n + 1
+    unsigned char* bytes;   // entries in offset.
+    int* residual;
+    struct edge** edges;    // The graph's edge of each arc, NULL if the
+                            // graph was read from a file
+    struct graph* g;        // The terminals, and the edges if not read
+    long topology_bytes;    // Size of first and of the arrays or the bytes
+};
+
+/* Where the next block of a vertex' arcs starts */
+struct compact_cursor {
+    long pos;               // The next byte, if compressed
+    int arc;
+    int end;                // The first arc of the next vertex
+    int last_head;          // The head of the arc before 'arc'
+};
+
+/* Arcs arc .. arc + size - 1 of a vertex. head[i] and rev[i] are arc + i's
+ * head and reverse arc, and point into the arrays or at the decoded ones. */
+struct compact_block {
+    int arc;
+    int size;
+    int* head;
+    int* rev;
+    int heads[COMPACT_BLOCK];
+    int revs[COMPACT_BLOCK];
+};
+
+/* Builds the compact form of a graph. The residual capacities are those of
+ * the graph without flow.
+ * Args:    - Pointer to the graph
+ *          - 1 to compress the topology, 0 to keep arrays
+ * Return:  A pointer to the compact graph */
+struct compact* compact_build(struct graph* g, int compressed);
+
+/* Builds the compact form of a graph from a DIMACS file without building
+ * its adjacency lists. The graph in it only has the terminals.
+ * Args:    - The path to the file to load
+ *          - 1 to compress the topology, 0 to keep arrays
+ * Return:  A pointer to the compact graph */
+struct compact* compact_read(char* file, int compressed);
+
+/* Frees the compact graph. The graph it holds is freed too if it was read
+ * from a file.
+ * Args:    - Pointer to the compact graph
+ * Return:  Nothing */
+void compact_free(struct compact* c);
+
+/* Starts a cursor at the first arc of a vertex
+ * Args:    - Pointer to the compact graph
+ *          - The cursor to set
+ *          - The vertex
+ * Return:  Nothing */
+void compact_begin(struct compact* c, struct compact_cursor* cur, int u);
+
+/* Gets the next block of arcs and moves the cursor past it
+ * Args:    - Pointer to the compact graph
+ *          - Pointer to the cursor
+ *          - The block to fill in
+ * Return:  The number of arcs in the block, 0 after the vertex' last arc */
+int compact_next_block(struct compact* c, struct compact_cursor* cur,
+                       struct compact_block* b);
+
+/* Stores the flow given by the residual capacities in the graph's edges, if
+ * it was built from a graph
+ * Args:    - Pointer to the compact graph
+ * Return:  Nothing */
+void compact_store_flow(struct compact* c);
+
+/* Edmonds-Karp on the compact graph
+ * Args:    - Pointer to the compact graph, without flow
+ * Return:  The maximum flow */
+int compact_edmonds_karp(struct compact* c);
+
+/* Push-relabel discharging the active vertices first in, first out, with
+ * the gap heuristic like push_relabel_fifo
+ * Args:    - Pointer to the compact graph, without flow
+ * Return:  The maximum flow */
+int compact_push_relabel(struct compact* c);
+
+/* Edmonds-Karp on the compressed form of the graph, for solver.h
+ * Args:    - Pointer to graph
+ * Return:  The maximum flow */
+int compact_bfs_solve(struct graph* g);
+
+/* FIFO push-relabel on the compressed form of the graph, for solver.h
+ * Args:    - Pointer to graph
+ * Return:  The maximum flow */
+int compact_pr_solve(struct graph* g);
+
+/* Reads a graph with arrays and with bytes, and prints the bytes per arc of
+ * each and the time both solvers take on each
+ * Args:    - Path to the graph
+ *          - The file to print to
+ * Return:  0 on success, 1 if the flows differ */
+int compact_benchmark(char* path, FILE* fp);
+
+#endif
@@ -0,0 +1,390 @@
+#define _GNU_SOURCE
+#include "context.h"
+#include "csr.h"
+#include "loaddimacs.h"
+#include "placement.h"
+#include "preflow.h"
+#include "pushrelabel.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+
+struct topology* topology_build(struct graph* g) {
+    struct topology* t = malloc(sizeof(struct topology));
+    assert(t != NULL);
+    // The arrays of the compressed graph are kept, the residual capacities
+    // becoming the capacities
+    struct csr* c = csr_build(g);
+    int n = c->n, m = c->m;
+    t->n        = n;
+    t->m        = m;
+    t->first    = c->first;
+    t->head     = c->head;
+    t->rev      = c->rev;
+    t->capacity = c->residual;
+    t->forward  = array_alloc(m + 1);
+    t->supply   = malloc(n * sizeof(int));
+    t->demand   = malloc(n * sizeof(int));
+    assert(t->forward && t->supply && t->demand);
+    for (int a = 0; a < m; a++) {
+        struct edge* e = c->edges[a];
+        t->forward[a] = e->original;
+        t->capacity[a] = e->original ? e->capacity : 0;
+    }
+    memcpy(t->supply, g->supply, n * sizeof(int));
+    memcpy(t->demand, g->demand, n * sizeof(int));
+    t->bytes = (n + 1) * sizeof(int) + 2L * n * sizeof(int) +
+               (long)m * (3 * sizeof(int) + 1);
+
+    array_free(c->edges);
+    free(c);
+    return t;
+}
+
+struct topology* topology_read(char* path) {
+    struct graph* g = read_dimacs_file(path);
+    struct topology* t = topology_build(g);
+    graph_free(g);
+    return t;
+}
+
+void topology_free(struct topology* t) {
+    array_free(t->first);
+    array_free(t->head);
+    array_free(t->rev);
+    array_free(t->capacity);
+    array_free(t->forward);
+    free(t->supply);
+    free(t->demand);
+    free(t);
+}
+
+struct flow_context* context_create(const struct topology* t) {
+    struct flow_context* c = calloc(1, sizeof(struct flow_context));
+    assert(c != NULL);
+    int n = t->n, m = t->m;
+    c->t = t;
+    c->residual = array_alloc((m + 1) * sizeof(int));
+    c->stamp    = array_calloc(m + 1, sizeof(unsigned));
+    c->supply   = malloc(n * sizeof(int));
+    c->demand   = malloc(n * sizeof(int));
+    c->supplied = calloc(n, sizeof(int));
+    c->absorbed = calloc(n, sizeof(int));
+    c->height   = array_alloc(n * sizeof(int));
+    c->excess   = array_alloc(n * sizeof(long));
+    c->current  = array_alloc(n * sizeof(int));
+    c->queue    = array_alloc((n + 1) * sizeof(int));
+    c->parent   = array_alloc(n * sizeof(int));
+    assert(c->supply && c->demand && c->supplied && c->absorbed);
+    memcpy(c->supply, t->supply, n * sizeof(int));
+    memcpy(c->demand, t->demand, n * sizeof(int));
+    // The stamps start at 0, so no arc is of the first epoch
+    c->epoch = 1;
+    c->bytes = (long)m * (sizeof(int) + sizeof(unsigned)) +
+               (long)n * (8 * sizeof(int) + sizeof(long));
+    return c;
+}
+
+void context_free(struct flow_context* c) {
+    array_free(c->residual);
+    array_free(c->stamp);
+    free(c->supply);
+    free(c->demand);
+    free(c->supplied);
+    free(c->absorbed);
+    array_free(c->height);
+    array_free(c->excess);
+    array_free(c->current);
+    array_free(c->queue);
+    array_free(c->parent);
+    free(c);
+}
+
+static void clear_terminal_flow(struct flow_context* c) {
+    memset(c->supplied, 0, c->t->n * sizeof(int));
+    memset(c->absorbed, 0, c->t->n * sizeof(int));
+    c->value = 0;
+    c->dirty = 0;
+}
+
+void context_reset(struct flow_context* c) {
+    memcpy(c->residual, c->t->capacity, c->t->m * sizeof(int));
+    for (int a = 0; a < c->t->m; a++) {
+        c->stamp[a] = c->epoch;
+    }
+    clear_terminal_flow(c);
+}
+
+void context_reset_lazy(struct flow_context* c) {
+    // After 2^32 epochs the old stamps could match again
+    if (++c->epoch == 0) {
+        c->epoch = 1;
+        context_reset(c);
+        return;
+    }
+    clear_terminal_flow(c);
+}
+
+void context_clear_terminals(struct flow_context* c) {
+    if (c->dirty) {
+        context_reset_lazy(c);
+    }
+    memset(c->supply, 0, c->t->n * sizeof(int));
+    memset(c->demand, 0, c->t->n * sizeof(int));
+}
+
+void context_add_source(struct flow_context* c, int v, int supply) {
+    assert(0 <= v && v < c->t->n);
+    if (c->dirty) {
+        context_reset_lazy(c);
+    }
+    c->supply[v] = supply;
+}
+
+void context_add_sink(struct flow_context* c, int v, int demand) {
+    assert(0 <= v && v < c->t->n);
+    if (c->dirty) {
+        context_reset_lazy(c);
+    }
+    c->demand[v] = demand;
+}
+
+static inline int residual(struct flow_context* c, int a) {
+    return c->stamp[a] == c->epoch ? c->residual[a] : c->t->capacity[a];
+}
+
+// Moves 'amount' of flow over arc a
+static inline void push_arc(struct flow_context* c, int a, int amount) {
+    int b = c->t->rev[a];
+    if (c->stamp[a] != c->epoch) {
+        c->residual[a] = c->t->capacity[a];
+        c->stamp[a] = c->epoch;
+    }
+    if (c->stamp[b] != c->epoch) {
+        c->residual[b] = c->t->capacity[b];
+        c->stamp[b] = c->epoch;
+    }
+    c->residual[a] -= amount;
+    c->residual[b] += amount;
+}
+
+// An unbounded source can send at most what its arcs can carry
+static int supply_of(struct flow_context* c, int v) {
+    if (c->supply[v] != TERMINAL_UNBOUNDED) {
+        return c->supply[v];
+    }
+    long sum = 0;
+    for (int a = c->t->first[v]; a < c->t->first[v + 1]; a++) {
+        sum += c->t->capacity[a];
+    }
+    return sum < INT_MAX ? sum : INT_MAX;
+}
+
+static inline long demand_left(struct flow_context* c, int v) {
+    return c->demand[v] == TERMINAL_UNBOUNDED ? LONG_MAX
+                                              : c->demand[v] - c->absorbed[v];
+}
+
+static long run_push_relabel(struct flow_context* c) {
+    const struct topology* t = c->t;
+    struct preflow p = {
+        .n = t->n, .begin = t->first, .end = t->first + 1, .head = t->head,
+        .rev = t->rev, .capacity = t->capacity, .residual = c->residual,
+        .stamp = c->stamp, .epoch = c->epoch, .supply = c->supply,
+        .demand = c->demand, .supplied = c->supplied, .absorbed = c->absorbed,
+        .height = c->height, .excess = c->excess, .current = c->current,
+        .queue = c->queue, .search = c->parent
+    };
+    preflow_start(&p);
+    preflow_run(&p, LONG_MAX);
+    c->pushes = p.pushes;
+    c->relabels = p.relabels;
+    c->global_relabels = p.global_relabels;
+    return preflow_value(&p);
+}
+
+// Breadth first search from the sources with supply left over arcs with
+// residual capacity
+// Return: A sink with demand left it reached, -1 if none
+static int find_path(struct flow_context* c) {
+    const struct topology* t = c->t;
+    int n = t->n, head = 0, tail = 0;
+    for (int v = 0; v < n; v++) {
+        c->parent[v] = -2;
+        if (c->supplied[v] < supply_of(c, v)) {
+            c->parent[v] = -1;
+            c->queue[tail++] = v;
+        }
+    }
+    while (head < tail) {
+        int u = c->queue[head++];
+        if (0 < demand_left(c, u)) {
+            return u;
+        }
+        for (int a = t->first[u]; a < t->first[u + 1]; a++) {
+            int w = t->head[a];
+            if (c->parent[w] == -2 && 0 < residual(c, a)) {
+                c->parent[w] = a;
+                c->queue[tail++] = w;
+            }
+        }
+    }
+    return -1;
+}
+
+static long run_edmonds_karp(struct flow_context* c) {
+    const struct topology* t = c->t;
+    for (int sink = find_path(c); sink != -1; sink = find_path(c)) {
+        long amount = demand_left(c, sink);
+        int v = sink;
+        while (c->parent[v] != -1) {
+            int a = c->parent[v];
+            amount = residual(c, a) < amount ? residual(c, a) : amount;
+            v = t->head[t->rev[a]];
+        }
+        int left = supply_of(c, v) - c->supplied[v];
+        amount = left < amount ? left : amount;
+
+        c->supplied[v] += amount;
+        c->absorbed[sink] += amount;
+        for (v = sink; c->parent[v] != -1; v = t->head[t->rev[c->parent[v]]]) {
+            push_arc(c, c->parent[v], amount);
+        }
+        ++c->augmentations;
+    }
+    long value = 0;
+    for (int v = 0; v < t->n; v++) {
+        value += c->absorbed[v];
+    }
+    return value;
+}
+
+long context_solve(struct flow_context* c, enum context_algorithm algorithm) {
+    c->pushes = c->relabels = c->global_relabels = c->augmentations = 0;
+    c->dirty = 1;
+    c->value = algorithm == CONTEXT_PUSH_RELABEL ? run_push_relabel(c)
+                                                 : run_edmonds_karp(c);
+    return c->value;
+}
+
+int context_arc_flow(struct flow_context* c, int a) {
+    return c->t->forward[a] ? c->t->capacity[a] - residual(c, a) : 0;
+}
+
+void context_store_flow(struct flow_context* c, struct graph* g) {
+    int a = 0;
+    for (int u = 0; u < g->size; u++) {
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            if (e->original) {
+                e->flow = context_arc_flow(c, a);
+            }
+            ++a;
+        }
+    }
+    assert(a == c->t->m);
+    memcpy(g->supplied, c->supplied, g->size * sizeof(int));
+    memcpy(g->absorbed, c->absorbed, g->size * sizeof(int));
+}
+
+static _Thread_local struct {
+    long pushes;
+    long relabels;
+    long global_relabels;
+} last_stats;
+
+int context_solve_graph(struct graph* g) {
+    struct topology* t = topology_build(g);
+    struct flow_context* c = context_create(t);
+    int mf = context_solve(c, CONTEXT_PUSH_RELABEL);
+    context_store_flow(c, g);
+    last_stats.pushes = c->pushes;
+    last_stats.relabels = c->relabels;
+    last_stats.global_relabels = c->global_relabels;
+    context_free(c);
+    topology_free(t);
+    return mf;
+}
+
+void context_print_stats(FILE* fp) {
+    fprintf(fp, "context: pushes %ld, relabels %ld, global relabels %ld\n",
+            last_stats.pushes, last_stats.relabels,
+            last_stats.global_relabels);
+}
+
+// A thread of the benchmark, with a context of its own
+struct querier {
+    struct topology* t;
+    int queries;
+    long flow;              // The flow of every query, -1 if they differed
+    long bytes;
+    pthread_t thread;
+};
+
+static void* run_queries(void* arg) {
+    struct querier* q = arg;
+    struct flow_context* c = context_create(q->t);
+    q->bytes = c->bytes;
+    for (int i = 0; i < q->queries; i++) {
+        context_reset_lazy(c);
+        long flow = context_solve(c, CONTEXT_PUSH_RELABEL);
+        q->flow = i == 0 || q->flow == flow ? flow : -1;
+    }
+    context_free(c);
+    return NULL;
+}
+
+int context_benchmark(char* path, int* threads, int n, int queries, FILE* fp) {
+    struct graph* g = read_dimacs_file(path);
+    struct topology* t = topology_build(g);
+
+    // A copy of the graph for each query, as in the server
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int expected = 0;
+    for (int i = 0; i < queries; i++) {
+        struct graph* copy = graph_copy(g);
+        expected = push_relabel_fifo(copy);
+        graph_free(copy);
+    }
+    double copies = seconds_since(&start);
+    fprintf(fp, "contexts: pr-fifo on copies  1 thread  %8.1f queries/s, "
+            "maximum flow %d\n", queries / copies, expected);
+    graph_free(g);
+
+    int failed = 0;
+    for (int i = 0; i < n; i++) {
+        struct querier* q = calloc(threads[i], sizeof(struct querier));
+        assert(q != NULL);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int j = 0; j < threads[i]; j++) {
+            q[j].t = t;
+            q[j].queries = queries;
+            int created = pthread_create(&q[j].thread, NULL, &run_queries,
+                                         &q[j]);
+            assert(created == 0);
+        }
+        int same = 1;
+        for (int j = 0; j < threads[i]; j++) {
+            pthread_join(q[j].thread, NULL);
+            same &= q[j].flow == expected;
+        }
+        double seconds = seconds_since(&start);
+        fprintf(fp, "contexts: contexts          %2d threads %8.1f queries/s, "
+                "%.2f times "
+                "the copies, topology %.1f MB shared, %.1f MB per context%s\n",
+                threads[i], (double)queries * threads[i] / seconds,
+                queries * threads[i] / seconds / (queries / copies),
+                t->bytes / 1e6, q[0].bytes / 1e6, same ? "" : ", WRONG FLOW");
+        failed |= !same;
+        free(q);
+    }
+    topology_free(t);
+    return failed;
+}
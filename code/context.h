@@ -0,0 +1,172 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include "graph.h"
+
+#include <stdio.h>
+
+/* Solving many times on one graph from many threads at once, for programs
+ * that link the solvers in as a library (make lib).
+ *
+ * A topology is the graph in compressed sparse row form like csr.h, with
+ * the capacities and terminals, and is never changed once built. Any number
+ * of threads can share it. A context belongs to one thread at a time and
+ * holds everything a solve changes: the residual capacities, the flow of the
+ * terminals and the heights, excess, queue and other workspaces. Each
+ * context has its own sources and sinks, copied from the topology's when it
+ * is made, so queries between other terminals need no copy of the graph.
+ *
+ * A solve starts from the flow the context holds. context_reset sets the
+ * flow to 0 by copying the capacities in O(|E|). context_reset_lazy does it
+ * in O(|V|): each arc has the epoch it was last written in, and an arc from
+ * an older epoch has its capacity as residual capacity. The epoch is moved
+ * on, and the arcs are copied when they are first written again. */
+enum context_algorithm {CONTEXT_PUSH_RELABEL, CONTEXT_EDMONDS_KARP};
+
+/* The graph shared by the contexts. Arc a goes to head[a], rev[a] is its
+ * reverse arc and capacity[a] its residual capacity without flow, 0 for the
+ * reverse arcs. The arcs of u are first[u] .. first[u + 1] - 1 in the order
+ * of the graph's adjacency list. */
+struct topology {
+    int n;
+    int m;                  // Number of arcs, the reverse arcs included
+    int* first;
+    int* head;
+    int* rev;
+    int* capacity;
+    char* forward;          // 1 for the arcs of the graph's edges
+    int* supply;            // The terminals, like in graph.h
+    int* demand;
+    long bytes;
+};
+
+/* What a thread solves with. The fields are read only for the caller. */
+struct flow_context {
+    const struct topology* t;
+    int* residual;          // Valid for the arcs with stamp[a] == epoch
+    unsigned* stamp;
+    unsigned epoch;
+    int* supply;
+    int* demand;
+    int* supplied;          // Flow from the super source to each vertex
+    int* absorbed;          // Flow from each vertex to the super sink
+    int dirty;              // 1 if a solve ran since the last reset
+
+    // Workspaces
+    int* height;
+    long* excess;
+    int* current;
+    int* queue;
+    int* parent;
+
+    // What the last solve did
+    long value;
+    long pushes;
+    long relabels;
+    long global_relabels;
+    long augmentations;
+    long bytes;
+};
+
+/* Builds the topology of a graph. The graph's flow is left out and the
+ * graph can be freed after.
+ * Args:    - Pointer to the graph
+ * Return:  Pointer to the topology */
+struct topology* topology_build(struct graph* g);
+
+/* Reads a graph in DIMACS format and builds its topology
+ * Args:    - Path to the file
+ * Return:  Pointer to the topology */
+struct topology* topology_read(char* path);
+
+/* Frees a topology. No context of it may be used after.
+ * Args:    - Pointer to the topology
+ * Return:  Nothing */
+void topology_free(struct topology* t);
+
+/* Makes a context with no flow and the topology's terminals
+ * Args:    - Pointer to the topology
+ * Return:  Pointer to the context */
+struct flow_context* context_create(const struct topology* t);
+
+/* Frees a context
+ * Args:    - Pointer to the context
+ * Return:  Nothing */
+void context_free(struct flow_context* c);
+
+/* Sets the flow to 0 by copying all the capacities, O(|E|)
+ * Args:    - Pointer to the context
+ * Return:  Nothing */
+void context_reset(struct flow_context* c);
+
+/* Sets the flow to 0 by moving on to the next epoch, O(|V|)
+ * Args:    - Pointer to the context
+ * Return:  Nothing */
+void context_reset_lazy(struct flow_context* c);
+
+/* Removes all sources and sinks of the context. The terminals can only
+ * change without flow, so this resets the flow lazily first.
+ * Args:    - Pointer to the context
+ * Return:  Nothing */
+void context_clear_terminals(struct flow_context* c);
+
+/* Makes a vertex a source of the context, resetting the flow lazily first
+ * Args:    - Pointer to the context
+ *          - The vertex
+ *          - How much flow it can send. TERMINAL_UNBOUNDED for no limit
+ * Return:  Nothing */
+void context_add_source(struct flow_context* c, int v, int supply);
+
+/* Makes a vertex a sink of the context, resetting the flow lazily first
+ * Args:    - Pointer to the context
+ *          - The vertex
+ *          - How much flow it can receive. TERMINAL_UNBOUNDED for no limit
+ * Return:  Nothing */
+void context_add_sink(struct flow_context* c, int v, int demand);
+
+/* Finds a maximum flow from the sources to the sinks, starting from the
+ * flow in the context
+ * Args:    - Pointer to the context
+ *          - The algorithm
+ * Return:  The value of the flow */
+long context_solve(struct flow_context* c, enum context_algorithm algorithm);
+
+/* The flow on an arc of the topology
+ * Args:    - Pointer to the context
+ *          - The arc
+ * Return:  The flow, 0 for reverse arcs */
+int context_arc_flow(struct flow_context* c, int a);
+
+/* Stores the context's flow in the edges of the graph the topology was built
+ * from, or of a copy of it
+ * Args:    - Pointer to the context
+ *          - Pointer to the graph
+ * Return:  Nothing */
+void context_store_flow(struct flow_context* c, struct graph* g);
+
+/* Solves a graph with a topology and a context, for solver.h
+ * Args:    - Pointer to graph
+ * Return:  The maximum flow */
+int context_solve_graph(struct graph* g);
+
+/* Prints what the last context_solve_graph in the calling thread did
+ * Args:    - The file to print to
+ * Return:  Nothing */
+void context_print_stats(FILE* fp);
+
+/* Queries each thread of --contexts solves */
+#define CONTEXT_BENCH_QUERIES 20
+
+/* Solves a graph 'queries' times from each number of threads, each with a
+ * context of its own on one shared topology, and from one thread with
+ * pr-fifo on a copy of the graph for each query, as the server does. Prints
+ * the queries per second and the memory of the topology and the contexts.
+ * Args:    - Path to the graph
+ *          - The numbers of threads
+ *          - Number of them
+ *          - Number of queries for each thread
+ *          - The file to print to
+ * Return:  0 on success, 1 if a flow differed */
+int context_benchmark(char* path, int* threads, int n, int queries, FILE* fp);
+
+#endif
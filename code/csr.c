@@ -0,0 +1,72 @@
+#include "csr.h"
+#include "list.h"
+#include "maxflow.h"
+#include "placement.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+struct csr* csr_build(struct graph* g) {
+    struct csr* c = malloc(sizeof(struct csr));
+    assert(c != NULL);
+    int n = g->size, m = 0;
+
+    for (int u = 0; u < n; u++) {
+        m += g->adj_array[u]->size;
+    }
+    c->n = n;
+    c->m = m;
+    c->g = g;
+    c->first    = array_alloc((n + 1) * sizeof(int));
+    c->head     = array_alloc((m + 1) * sizeof(int));
+    c->rev      = array_alloc((m + 1) * sizeof(int));
+    c->residual = array_alloc((m + 1) * sizeof(int));
+    c->edges    = array_alloc((m + 1) * sizeof(struct edge*));
+    assert(c->first && c->head && c->rev && c->residual && c->edges);
+
+    int a = 0;
+    for (int u = 0; u < n; u++) {
+        c->first[u] = a;
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            c->head[a]     = e->to;
+            c->residual[a] = get_cfe(e);
+            c->edges[a]    = e;
+            ++a;
+        }
+    }
+    c->first[n] = a;
+
+    // The reverse edge of every edge is in the graph too. Each edge's 'from'
+    // is set to its arc for a moment to find the arcs of the reverse edges.
+    for (a = 0; a < m; a++) {
+        c->edges[a]->from = a;
+    }
+    for (a = 0; a < m; a++) {
+        c->rev[a] = c->edges[a]->reverse_edge->from;
+    }
+    for (int u = 0; u < n; u++) {
+        for (a = c->first[u]; a < c->first[u + 1]; a++) {
+            c->edges[a]->from = u;
+        }
+    }
+    return c;
+}
+
+void csr_store_flow(struct csr* c) {
+    for (int a = 0; a < c->m; a++) {
+        struct edge* e = c->edges[a];
+        if (e->original) {
+            e->flow = e->capacity - c->residual[a];
+        }
+    }
+}
+
+void csr_free(struct csr* c) {
+    array_free(c->first);
+    array_free(c->head);
+    array_free(c->rev);
+    array_free(c->residual);
+    array_free(c->edges);
+    free(c);
+}
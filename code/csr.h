@@ -0,0 +1,40 @@
+#ifndef CSR_H
+#define CSR_H
+
+#include "graph.h"
+#include "edge.h"
+
+/* A graph in compressed sparse row form, for the solvers that scan the arcs of
+ * a vertex in bulk. The arcs out of u, the reverse arcs included, are
+ * first[u] .. first[u + 1] - 1 in the same order as u's adjacency list.
+ * Arc a goes to head[a], rev[a] is its reverse arc and residual[a] its
+ * residual capacity. 'edges' links the arcs back to the graph's edges, so the
+ * flow can be stored in the graph when a solver is done. */
+struct csr {
+    int n;
+    int m;              // Number of arcs, the reverse arcs included
+    int* first;         // n + 1 entries
+    int* head;
+    int* rev;
+    int* residual;
+    struct edge** edges;
+    struct graph* g;
+};
+
+/* Builds the compressed sparse row form of a graph. The residual capacities
+ * are those of the graph's current flow.
+ * Args:    - Pointer to the graph
+ * Return:  A pointer to the compressed graph */
+struct csr* csr_build(struct graph* g);
+
+/* Stores the flow given by the residual capacities in the graph's edges
+ * Args:    - Pointer to the compressed graph
+ * Return:  Nothing */
+void csr_store_flow(struct csr* c);
+
+/* Frees the compressed graph, but not the graph it was built from
+ * Args:    - Pointer to the compressed graph
+ * Return:  Nothing */
+void csr_free(struct csr* c);
+
+#endif
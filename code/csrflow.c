@@ -0,0 +1,498 @@
+#define _GNU_SOURCE
+#include "csrflow.h"
+#include "csr.h"
+#include "simd.h"
+#include "dobfs.h"
+#include "pushrelabel.h"
+#include "loaddimacs.h"
+#include "graph.h"
+#include "placement.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+
+// Push as much of u's excess as arc a can take
+static void csr_push(struct csr* c, int a, int u, int* excess) {
+    int amount = excess[u] < c->residual[a] ? excess[u] : c->residual[a];
+    c->residual[a] -= amount;
+    c->residual[c->rev[a]] += amount;
+    excess[u] -= amount;
+    excess[c->head[a]] += amount;
+}
+
+// Like relabel in pushrelabel.c, with the minimum over the arcs found by the
+// kernel
+static void csr_relabel(struct csr* c, struct simd_kernels* k, int u,
+                        int* height) {
+    int first = c->first[u];
+    int min = k->min_height(c->residual + first, c->head + first, height,
+                            c->first[u + 1] - first);
+
+    if (0 < graph_demand_left(c->g, u)) {
+        min = 0;
+    }
+    if (0 < c->g->supplied[u] && min > c->n) {
+        min = c->n;
+    }
+    height[u] = 1 + min;
+}
+
+void csr_initialize_preflow(struct csr* c, int* excess, int* height) {
+    struct graph* g = c->g;
+
+    for (int i = 0; i < c->n; i++) {
+        excess[i] = 0;
+        height[i] = 0;
+        g->supplied[i] = 0;
+        g->absorbed[i] = 0;
+    }
+    for (int s = 0; s < c->n; s++) {
+        if (g->supply[s] != TERMINAL_UNBOUNDED) {
+            excess[s] += g->supply[s];
+            g->supplied[s] = g->supply[s];
+            continue;
+        }
+        height[s] = c->n;
+        for (int a = c->first[s]; a < c->first[s + 1]; a++) {
+            if (c->edges[a]->original &&
+                g->supply[c->head[a]] != TERMINAL_UNBOUNDED) {
+                int amount = c->residual[a];
+                c->residual[a] = 0;
+                c->residual[c->rev[a]] += amount;
+                excess[c->head[a]] += amount;
+                excess[s] -= amount;
+            }
+        }
+    }
+}
+
+// Pushes u's excess on the admissible arcs from u.current onwards, and to the
+// virtual terminal arcs at the end, relabeling u when none is left
+// Return: The number of relabels
+static int discharge(struct csr* c, struct simd_kernels* k, int u,
+                     int* excess, int* height, int* current) {
+    int end = c->first[u + 1], relabels = 0;
+
+    while (excess[u] > 0) {
+        int a = current[u];
+        int found = k->find_admissible(c->residual + a, c->head + a, height,
+                                       end - a, height[u] - 1);
+        if (found < 0) {
+            current[u] = end;
+            if (!push_terminal(c->g, u, excess, height)) {
+                csr_relabel(c, k, u, height);
+                current[u] = c->first[u];
+                ++relabels;
+            }
+            continue;
+        }
+        current[u] = a + found;
+        csr_push(c, a + found, u, excess);
+    }
+    return relabels;
+}
+
+void csr_global_relabel(struct csr* c, struct bfs_engine* e, int* height) {
+    struct graph* g = c->g;
+    int n = c->n;
+
+    // The unbounded sinks are the super sink at height 0, the sinks with
+    // demand left have an arc to it
+    bfs_reset(e);
+    for (int v = 0; v < n; v++) {
+        if (g->supply[v] == TERMINAL_UNBOUNDED) {
+            bfs_block(e, v);
+        }
+        if (g->demand[v] == TERMINAL_UNBOUNDED) {
+            bfs_seed(e, v, 0);
+        }
+    }
+    for (int v = 0; v < n; v++) {
+        if (g->demand[v] != TERMINAL_UNBOUNDED && 0 < graph_demand_left(g, v)) {
+            bfs_seed(e, v, 1);
+        }
+    }
+    bfs_run(e, BFS_REVERSE, NULL);
+    for (int v = 0; v < n; v++) {
+        height[v] = e->level[v];
+    }
+
+    // The unbounded sources are the super source at height |V|, the sources
+    // that have supplied flow have an arc back to it
+    bfs_reset(e);
+    for (int v = 0; v < n; v++) {
+        if (0 <= height[v]) {
+            bfs_block(e, v);
+        }
+        if (g->supply[v] == TERMINAL_UNBOUNDED) {
+            bfs_seed(e, v, 0);
+        }
+    }
+    for (int v = 0; v < n; v++) {
+        if (g->supply[v] != TERMINAL_UNBOUNDED && 0 < g->supplied[v]) {
+            bfs_seed(e, v, 1);
+        }
+    }
+    bfs_run(e, BFS_REVERSE, NULL);
+    for (int v = 0; v < n; v++) {
+        if (height[v] < 0) {
+            height[v] = 0 <= e->level[v] ? n + e->level[v] : 2 * n;
+        }
+    }
+}
+
+// Builds L in 'next' with the vertices in order of decreasing height, which is
+// a topological order of the admissible arcs
+// Return: The first vertex of L
+static int order_by_height(struct graph* g, int* height, int* next,
+                           int* count) {
+    int n = g->size, L = -1;
+
+    for (int h = 0; h <= 2 * n; h++) {
+        count[h] = -1;
+    }
+    // A list of vertices for every height, in 'next'
+    for (int v = n - 1; 0 <= v; v--) {
+        if (!is_unbounded_terminal(g, v)) {
+            int h = height[v] < 2 * n ? height[v] : 2 * n;
+            next[v] = count[h];
+            count[h] = v;
+        }
+    }
+    // Join them, the lowest heights last
+    int last = -1;
+    for (int h = 2 * n; 0 <= h; h--) {
+        for (int v = count[h]; v != -1; v = next[v]) {
+            if (last == -1) {
+                L = v;
+            }
+            else {
+                next[last] = v;
+            }
+            last = v;
+        }
+    }
+    if (last != -1) {
+        next[last] = -1;
+    }
+    return L;
+}
+
+int csr_relabel_to_front(struct graph* g) {
+    struct csr* c = csr_build(g);
+    struct simd_kernels* k = simd_kernels();
+    int n = g->size;
+    int* height  = array_alloc(n * sizeof(int));
+    int* excess  = array_alloc(n * sizeof(int));
+    int* current = array_alloc(n * sizeof(int));
+    int* next    = array_alloc(n * sizeof(int));
+    int* count   = array_alloc((2 * n + 1) * sizeof(int));
+    assert(height && excess && current && next && count);
+    struct bfs_engine* e = bfs_engine_init(c, bfs_default_threads());
+
+    csr_initialize_preflow(c, excess, height);
+
+    // L is a singly linked list in 'next'. Moving the vertex just discharged
+    // to the front only needs the one before it. After every |V| relabels
+    // the heights are set to the exact distances and L is ordered again, from
+    // its front.
+    int L = -1, prev = -1, u = -1, relabels = n;
+    while (1) {
+        if (relabels >= n) {
+            csr_global_relabel(c, e, height);
+            L = order_by_height(g, height, next, count);
+            for (int i = 0; i < n; i++) {
+                current[i] = c->first[i];
+            }
+            relabels = 0;
+            prev = -1;
+            u = L;
+        }
+        if (u == -1) {
+            break;
+        }
+
+        int old_height = height[u];
+        relabels += discharge(c, k, u, excess, height, current);
+
+        if (height[u] > old_height && prev != -1) {
+            next[prev] = next[u];
+            next[u] = L;
+            L = u;
+        }
+        prev = u;
+        u = next[u];
+    }
+    if (getenv("MAXFLOW_BFS_STATS")) {
+        bfs_print_stats(e, stderr);
+    }
+
+    int maximum_flow = 0;
+    for (int i = 0; i < n; i++) {
+        if (g->supply[i] == TERMINAL_UNBOUNDED) {
+            g->supplied[i] = -excess[i];
+        }
+        if (g->demand[i] == TERMINAL_UNBOUNDED) {
+            g->absorbed[i] = excess[i];
+        }
+        maximum_flow += g->absorbed[i];
+    }
+    csr_store_flow(c);
+    graph_cancel_surplus(g);
+
+    array_free(height);
+    array_free(excess);
+    array_free(current);
+    array_free(next);
+    array_free(count);
+    bfs_engine_free(e);
+    csr_free(c);
+    return maximum_flow;
+}
+
+// Parent of a source in the search. Unvisited vertices have parent -1.
+#define PARENT_SOURCE -2
+
+// Augments along the path of parent arcs that ends in the sink. The path
+// starts in the vertex with a negative parent, a source.
+// Return: The flow augmented, bounded by the virtual arcs at the path's ends
+static int augment_path(struct csr* c, int* parent, int sink) {
+    struct graph* g = c->g;
+    int cfp = graph_demand_left(g, sink), s = sink;
+
+    while (0 <= parent[s]) {
+        int a = parent[s];
+        cfp = c->residual[a] < cfp ? c->residual[a] : cfp;
+        s = c->head[c->rev[a]];
+    }
+    cfp = graph_supply_left(g, s) < cfp ? graph_supply_left(g, s) : cfp;
+
+    for (int v = sink; v != s; v = c->head[c->rev[parent[v]]]) {
+        c->residual[parent[v]] -= cfp;
+        c->residual[c->rev[parent[v]]] += cfp;
+    }
+    g->supplied[s] += cfp;
+    g->absorbed[sink] += cfp;
+    return cfp;
+}
+
+int csr_edmonds_karp(struct graph* g) {
+    struct csr* c = csr_build(g);
+    struct simd_kernels* k = simd_kernels();
+    int n = g->size, max_degree = 0, maxflow = 0;
+
+    for (int u = 0; u < n; u++) {
+        int degree = c->first[u + 1] - c->first[u];
+        max_degree = degree > max_degree ? degree : max_degree;
+    }
+    int* parent = array_alloc(n * sizeof(int));
+    int* queue  = array_alloc(n * sizeof(int));
+    int* found  = malloc((max_degree + 1) * sizeof(int));
+    assert(parent && queue && found);
+
+    while (1) {
+        int first = 0, last = 0, sink = -1;
+
+        for (int i = 0; i < n; i++) {
+            parent[i] = -1;
+            if (graph_supply_left(g, i) > 0) {
+                parent[i] = PARENT_SOURCE;
+                queue[last++] = i;
+            }
+        }
+
+        while (sink == -1 && first < last) {
+            int u = queue[first++];
+            int begin = c->first[u];
+            int count = k->scan_unvisited(c->residual + begin, c->head + begin,
+                                          parent, c->first[u + 1] - begin,
+                                          found);
+
+            // Sources are negative too, and parallel arcs can reach the same
+            // vertex, so the arcs found are checked again
+            for (int i = 0; i < count; i++) {
+                int a = begin + found[i];
+                int v = c->head[a];
+                if (parent[v] != -1) {
+                    continue;
+                }
+                parent[v] = a;
+                queue[last++] = v;
+                if (graph_demand_left(g, v) > 0) {
+                    sink = v;
+                    break;
+                }
+            }
+        }
+        if (sink == -1) {
+            break;
+        }
+
+        maxflow += augment_path(c, parent, sink);
+    }
+    csr_store_flow(c);
+
+    array_free(parent);
+    array_free(queue);
+    free(found);
+    csr_free(c);
+    return maxflow;
+}
+
+int csr_edmonds_karp_do(struct graph* g) {
+    struct csr* c = csr_build(g);
+    struct bfs_engine* e = bfs_engine_init(c, bfs_default_threads());
+    char* target = malloc(g->size + 1);
+    assert(target != NULL);
+    int maxflow = 0, sink;
+
+    for (int v = 0; v < g->size; v++) {
+        target[v] = 0 < graph_demand_left(g, v);
+    }
+    do {
+        bfs_reset(e);
+        for (int v = 0; v < g->size; v++) {
+            if (0 < graph_supply_left(g, v)) {
+                bfs_seed(e, v, 0);
+            }
+        }
+        sink = bfs_run(e, BFS_FORWARD, target);
+        if (sink != -1) {
+            maxflow += augment_path(c, e->parent, sink);
+            target[sink] = 0 < graph_demand_left(g, sink);
+        }
+    } while (sink != -1);
+    csr_store_flow(c);
+
+    if (getenv("MAXFLOW_BFS_STATS")) {
+        bfs_print_stats(e, stderr);
+    }
+    free(target);
+    bfs_engine_free(e);
+    csr_free(c);
+    return maxflow;
+}
+
+enum bench_kernel {BENCH_MIN_HEIGHT, BENCH_FIND_ADMISSIBLE,
+                   BENCH_SCAN_UNVISITED, BENCH_KERNELS};
+
+static char* bench_kernel_names[] = {"min height", "find admissible",
+                                     "scan unvisited"};
+
+// Runs one kernel over the arcs of all the chosen vertices
+// Return: A checksum of the results, the same for all levels
+static long run_kernel(struct csr* c, struct simd_kernels* k, int kernel,
+                       int* vertices, int n_vertices, int* values, int* out) {
+    long sum = 0;
+    for (int i = 0; i < n_vertices; i++) {
+        int first = c->first[vertices[i]];
+        int degree = c->first[vertices[i] + 1] - first;
+        int* residual = c->residual + first;
+        int* head = c->head + first;
+
+        switch (kernel) {
+            case BENCH_MIN_HEIGHT:
+                sum += k->min_height(residual, head, values, degree);
+                break;
+            case BENCH_FIND_ADMISSIBLE:
+                sum += k->find_admissible(residual, head, values, degree, -1);
+                break;
+            default:
+                sum += k->scan_unvisited(residual, head, values, degree, out);
+                break;
+        }
+    }
+    return sum;
+}
+
+int csr_simd_benchmark(char* path, int min_degree, FILE* fp) {
+    struct graph* g = read_dimacs_file(path);
+    struct csr* c = csr_build(g);
+    int* vertices = malloc(c->n * sizeof(int));
+    int* heights  = malloc(c->n * sizeof(int));
+    int* marks    = malloc(c->n * sizeof(int));
+    int* out      = malloc((c->m + 1) * sizeof(int));
+    assert(vertices && heights && marks && out);
+    int n_vertices = 0;
+    long arcs = 0, residual_arcs = 0;
+    unsigned seed = 1;
+
+    for (int u = 0; u < c->n; u++) {
+        if (min_degree <= c->first[u + 1] - c->first[u]) {
+            vertices[n_vertices++] = u;
+            arcs += c->first[u + 1] - c->first[u];
+            for (int a = c->first[u]; a < c->first[u + 1]; a++) {
+                residual_arcs += 0 < c->residual[a];
+            }
+        }
+        // Random heights below 2|V| and one vertex in eight unvisited
+        seed = seed * 1103515245 + 12345;
+        heights[u] = (seed >> 8) % (2 * c->n);
+        marks[u] = (seed >> 4) % 8 == 0 ? -1 : 0;
+    }
+
+    if (!n_vertices) {
+        free(vertices);
+        free(heights);
+        free(marks);
+        free(out);
+        csr_free(c);
+        graph_free(g);
+        return 1;
+    }
+
+    fprintf(fp, "simd: %d vertices with at least %d arcs, %ld arcs, %.1f arcs "
+            "per vertex, %.0f%% with residual capacity\n", n_vertices,
+            min_degree, arcs, (double)arcs / n_vertices,
+            100.0 * residual_arcs / arcs);
+
+    long expected[BENCH_KERNELS];
+    for (int level = 0; level < SIMD_LEVELS; level++) {
+        struct simd_kernels* k = simd_kernels_at(level);
+        if (!k) {
+            fprintf(fp, "simd: %s is not supported by the CPU\n",
+                    simd_level_name(level));
+            continue;
+        }
+
+        for (int kernel = 0; kernel < BENCH_KERNELS; kernel++) {
+            int* values = kernel == BENCH_SCAN_UNVISITED ? marks : heights;
+            long sum = run_kernel(c, k, kernel, vertices, n_vertices, values,
+                                  out);
+            if (level == SIMD_SCALAR) {
+                expected[kernel] = sum;
+            }
+            assert(sum == expected[kernel]);
+
+            // Repeat until it has run for at least 0.1 seconds
+            struct timespec start, end;
+            double seconds = 0;
+            long reps = 0;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            while (seconds < 0.1) {
+                for (int r = 0; r < 16; r++) {
+                    sum += run_kernel(c, k, kernel, vertices, n_vertices,
+                                      values, out);
+                }
+                reps += 16;
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                seconds = (end.tv_sec - start.tv_sec) +
+                          (end.tv_nsec - start.tv_nsec) / 1e9;
+            }
+            fprintf(fp, "simd: %-7s %-16s %6.3f arcs/ns %8.2f ns/vertex\n",
+                    k->name, bench_kernel_names[kernel],
+                    reps * arcs / (seconds * 1e9),
+                    seconds * 1e9 / (reps * n_vertices));
+        }
+    }
+
+    free(vertices);
+    free(heights);
+    free(marks);
+    free(out);
+    csr_free(c);
+    graph_free(g);
+    return 0;
+}
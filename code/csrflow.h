@@ -0,0 +1,64 @@
+#ifndef CSRFLOW_H
+#define CSRFLOW_H
+
+#include "graph.h"
+#include "csr.h"
+#include "dobfs.h"
+
+#include <stdio.h>
+
+/* Relabel-to-Front on the compressed form of the graph. Finding the next
+ * admissible arc and the least height to relabel to are done by the SIMD
+ * kernels in simd.h. At the start and after every |V| relabels the heights
+ * are set to the exact distances to the sinks by a reverse search with
+ * dobfs.h, a global relabel. The flow is stored in the graph's edges at the
+ * end.
+ * Args:    - Pointer to graph
+ * Return:  The maximum flow */
+int csr_relabel_to_front(struct graph* g);
+
+/* Edmonds-Karp on the compressed form of the graph. The arcs of a vertex are
+ * checked for residual capacity into unvisited vertices by a SIMD kernel.
+ * The augmenting paths are the same as those of 'bfs'.
+ * Args:    - Pointer to graph
+ * Return:  The maximum flow */
+int csr_edmonds_karp(struct graph* g);
+
+/* Edmonds-Karp on the compressed form of the graph, with the augmenting
+ * paths found by the direction-optimizing parallel search in dobfs.h. Set
+ * MAXFLOW_BFS_STATS to print the search's totals for each level to stderr.
+ * Args:    - Pointer to graph
+ * Return:  The maximum flow */
+int csr_edmonds_karp_do(struct graph* g);
+
+/* Like initialize_preflow in pushrelabel.c, on the compressed form of a
+ * graph without flow
+ * Args:    - Pointer to the compressed graph
+ *          - Array to set to the vertices' excess
+ *          - Array to set to the vertices' heights
+ * Return:  Nothing */
+void csr_initialize_preflow(struct csr* c, int* excess, int* height);
+
+/* Sets the heights to the distances to the super sink in the residual graph,
+ * or |V| plus the distance to the super source for the vertices that cannot
+ * reach a sink. The vertices that can reach neither have no excess and get
+ * height 2|V|. This is a global relabel.
+ * Args:    - Pointer to the compressed graph
+ *          - A search engine for it
+ *          - Array with the vertices' heights
+ * Return:  Nothing */
+void csr_global_relabel(struct csr* c, struct bfs_engine* e, int* height);
+
+/* Vertices with fewer arcs are left out of the benchmark by default */
+#define SIMD_BENCH_MIN_DEGREE 64
+
+/* Measures the arcs scanned per nanosecond by each kernel at each level the
+ * CPU supports, on the vertices with at least 'min_degree' arcs. The heights
+ * are random and no arc is admissible, so every scan reads all the arcs.
+ * Args:    - Path to the graph
+ *          - Least number of arcs, reverse arcs included, of the vertices
+ *          - The file to print to
+ * Return:  0 on success, 1 if no vertex has that many arcs */
+int csr_simd_benchmark(char* path, int min_degree, FILE* fp);
+
+#endif
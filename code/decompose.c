@@ -0,0 +1,288 @@
+#include "decompose.h"
+#include "list.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+
+// The arcs of a graph and the state of the walks over them
+struct walker {
+    int n;
+    int* first;             // Those of struct flow_arcs
+    int* head;
+    int* left;              // Flow not in a path or cycle yet
+    int* current;
+    int* supply;            // What the terminals have left
+    int* demand;
+    int* path;              // The vertices of the walk
+    int* stack;             // stack[i] is the arc from path[i]
+    int* pos;               // The place of a vertex in the walk, -1 if none
+    struct flow_decomposition* d;
+};
+
+// Adds path[from] .. path[to] to the decomposition
+static void emit(struct walker* w, int from, int to, int amount, int cycle) {
+    struct flow_decomposition* d = w->d;
+    if (d->count == d->room) {
+        d->room *= 2;
+        d->first  = realloc(d->first, (d->room + 1) * sizeof(long));
+        d->amount = realloc(d->amount, d->room * sizeof(int));
+        d->cycle  = realloc(d->cycle, d->room);
+        assert(d->first && d->amount && d->cycle);
+    }
+    long needed = d->length + to - from + 1;
+    if (d->vertex_room < needed) {
+        d->vertex_room = 2 * d->vertex_room < needed ? needed
+                                                     : 2 * d->vertex_room;
+        d->vertices = realloc(d->vertices, d->vertex_room * sizeof(int));
+        assert(d->vertices != NULL);
+    }
+    memcpy(d->vertices + d->length, w->path + from,
+           (to - from + 1) * sizeof(int));
+    d->length = needed;
+    d->amount[d->count] = amount;
+    d->cycle[d->count] = cycle;
+    d->first[++d->count] = d->length;
+}
+
+// The least flow left on stack[from] .. stack[to - 1]
+static int least(struct walker* w, int from, int to) {
+    int x = INT_MAX;
+    for (int i = from; i < to; i++) {
+        x = w->left[w->stack[i]] < x ? w->left[w->stack[i]] : x;
+    }
+    return x;
+}
+
+// Takes 'amount' off stack[from] .. stack[to - 1]
+// Return: The first of them that is empty after, 'to' if none
+static int take(struct walker* w, int from, int to, int amount) {
+    int emptied = to;
+    for (int i = to - 1; from <= i; i--) {
+        w->left[w->stack[i]] -= amount;
+        emptied = w->left[w->stack[i]] == 0 ? i : emptied;
+    }
+    return emptied;
+}
+
+// Cuts the walk back to path[k]
+static int cut(struct walker* w, int k, int len) {
+    for (int i = k + 1; i <= len; i++) {
+        w->pos[w->path[i]] = -1;
+    }
+    return k;
+}
+
+// Records flow left out at a vertex where it is not conserved
+static void unbalanced(struct flow_decomposition* d, int v, long amount) {
+    if (d->unbalanced == -1 || v < d->unbalanced) {
+        d->unbalanced = v;
+    }
+    d->residue += amount;
+}
+
+// Walks from r taking paths to the sinks off the flow until r has supplied
+// all it did, or for 'cycles' taking cycles off until r has no flow out left
+static void walk(struct walker* w, int r, int cycles) {
+    struct flow_decomposition* d = w->d;
+    int len = 0;
+    w->path[0] = r;
+    w->pos[r] = 0;
+    for (;;) {
+        int u = w->path[len];
+        if (!cycles && 0 < w->demand[u]) {
+            int x = least(w, 0, len);
+            x = w->supply[r] < x ? w->supply[r] : x;
+            x = w->demand[u] < x ? w->demand[u] : x;
+            emit(w, 0, len, x, 0);
+            w->supply[r] -= x;
+            w->demand[u] -= x;
+            d->value += x;
+            int k = take(w, 0, len, x);
+            if (w->supply[r] == 0) {
+                break;
+            }
+            len = cut(w, k < len ? k : len, len);
+            continue;
+        }
+
+        int last = w->first[u + 1];
+        while (w->current[u] < last && w->left[w->current[u]] == 0) {
+            ++w->current[u];
+        }
+        if (w->current[u] == last) {
+            if (cycles && len == 0) {
+                break;
+            }
+            // More flow goes into u than out of it. What the walk carries to
+            // u is left out of the decomposition.
+            int x = len ? least(w, 0, len) : INT_MAX;
+            x = !cycles && w->supply[r] < x ? w->supply[r] : x;
+            unbalanced(d, u, x);
+            if (!cycles) {
+                w->supply[r] -= x;
+            }
+            if (len == 0 || (!cycles && w->supply[r] == 0)) {
+                take(w, 0, len, x);
+                break;
+            }
+            int k = take(w, 0, len, x);
+            len = cut(w, k < len ? k : len, len);
+            continue;
+        }
+        int a = w->current[u], v = w->head[a];
+        w->stack[len] = a;
+        ++d->steps;
+        if (w->pos[v] == -1) {
+            w->path[++len] = v;
+            w->pos[v] = len;
+            continue;
+        }
+        // The walk ran into itself
+        int i = w->pos[v];
+        int x = least(w, i, len + 1);
+        emit(w, i, len, x, 1);
+        int k = take(w, i, len + 1, x);
+        len = cut(w, k < len ? k : len, len);
+    }
+    cut(w, -1, len);
+}
+
+struct flow_arcs* flow_arcs_gather(struct graph* g) {
+    int n = g->size;
+    struct flow_arcs* a = malloc(sizeof(struct flow_arcs));
+    assert(a != NULL);
+    a->n = n;
+    a->first    = malloc((n + 1) * sizeof(int));
+    a->supplied = malloc(n * sizeof(int));
+    a->absorbed = malloc(n * sizeof(int));
+    assert(a->first && a->supplied && a->absorbed);
+    memcpy(a->supplied, g->supplied, n * sizeof(int));
+    memcpy(a->absorbed, g->absorbed, n * sizeof(int));
+
+    // Every element of the lists gets a place, the reverse arcs a 'to' of -1,
+    // and they are packed after
+    long entries = 0;
+    for (int u = 0; u < n; u++) {
+        entries += g->adj_array[u]->size;
+    }
+    a->to   = malloc((entries < 1 ? 1 : entries) * sizeof(int));
+    a->flow = malloc((entries < 1 ? 1 : entries) * sizeof(int));
+    assert(a->to && a->flow);
+    long start = 0;
+    for (int u0 = 0; u0 < n; u0 += FLOW_GATHER_LISTS) {
+        struct element* cur[FLOW_GATHER_LISTS];
+        long pos[FLOW_GATHER_LISTS];
+        int lists = n - u0 < FLOW_GATHER_LISTS ? n - u0 : FLOW_GATHER_LISTS;
+        for (int i = 0; i < lists; i++) {
+            cur[i] = g->adj_array[u0 + i]->head;
+            pos[i] = start;
+            start += g->adj_array[u0 + i]->size;
+        }
+        for (int active = lists; 0 < active; ) {
+            active = 0;
+            for (int i = 0; i < lists; i++) {
+                if (!cur[i]) {
+                    continue;
+                }
+                struct edge* e = cur[i]->this;
+                a->to[pos[i]] = e->original ? e->to : -1;
+                a->flow[pos[i]] = e->flow;
+                ++pos[i];
+                cur[i] = cur[i]->next;
+                ++active;
+            }
+        }
+    }
+
+    int m = 0;
+    start = 0;
+    for (int u = 0; u < n; u++) {
+        long end = start + g->adj_array[u]->size;
+        a->first[u] = m;
+        for (long k = start; k < end; k++) {
+            if (a->to[k] != -1) {
+                a->to[m] = a->to[k];
+                a->flow[m] = a->flow[k];
+                ++m;
+            }
+        }
+        start = end;
+    }
+    a->first[n] = a->m = m;
+    return a;
+}
+
+void flow_arcs_free(struct flow_arcs* a) {
+    free(a->first);
+    free(a->to);
+    free(a->flow);
+    free(a->supplied);
+    free(a->absorbed);
+    free(a);
+}
+
+struct flow_decomposition* flow_decompose(struct flow_arcs* a) {
+    int n = a->n;
+    struct walker w;
+    w.n = n;
+    w.first   = a->first;
+    w.head    = a->to;
+    w.left    = malloc((a->m < 1 ? 1 : a->m) * sizeof(int));
+    w.current = malloc((n + 1) * sizeof(int));
+    w.supply  = malloc(n * sizeof(int));
+    w.demand  = malloc(n * sizeof(int));
+    w.path    = malloc((n + 1) * sizeof(int));
+    w.stack   = malloc((n + 1) * sizeof(int));
+    w.pos     = malloc(n * sizeof(int));
+    assert(w.left && w.current && w.supply && w.demand && w.path &&
+           w.stack && w.pos);
+    memcpy(w.left, a->flow, a->m * sizeof(int));
+    memcpy(w.current, a->first, (n + 1) * sizeof(int));
+    memcpy(w.supply, a->supplied, n * sizeof(int));
+    memcpy(w.demand, a->absorbed, n * sizeof(int));
+    for (int v = 0; v < n; v++) {
+        w.pos[v] = -1;
+    }
+
+    struct flow_decomposition* d = calloc(1, sizeof(struct flow_decomposition));
+    assert(d != NULL);
+    d->room = 64;
+    d->first  = malloc((d->room + 1) * sizeof(long));
+    d->amount = malloc(d->room * sizeof(int));
+    d->cycle  = malloc(d->room);
+    assert(d->first && d->amount && d->cycle);
+    d->first[0] = 0;
+    d->unbalanced = -1;
+    w.d = d;
+
+    for (int s = 0; s < n; s++) {
+        if (0 < w.supply[s]) {
+            walk(&w, s, 0);
+        }
+    }
+    for (int v = 0; v < n; v++) {
+        if (w.demand[v]) {
+            unbalanced(d, v, w.demand[v]);
+        }
+        walk(&w, v, 1);
+    }
+
+    free(w.left);
+    free(w.current);
+    free(w.supply);
+    free(w.demand);
+    free(w.path);
+    free(w.stack);
+    free(w.pos);
+    return d;
+}
+
+void decomposition_free(struct flow_decomposition* d) {
+    free(d->first);
+    free(d->amount);
+    free(d->cycle);
+    free(d->vertices);
+    free(d);
+}
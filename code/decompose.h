@@ -0,0 +1,80 @@
+#ifndef DECOMPOSE_H
+#define DECOMPOSE_H
+
+#include "graph.h"
+
+/* The arcs of a graph and their flow in arrays, for the decomposition and
+ * the writers of flowout.h. The arcs of u, without the reverse arcs, are
+ * first[u] .. first[u + 1] - 1 in the order of u's adjacency list.
+ *
+ * Going down an adjacency list is a chain of loads that each wait for the
+ * one before, so flow_arcs_gather goes down FLOW_GATHER_LISTS lists at a
+ * time, a step of each in turn, and their loads wait for memory together. */
+#define FLOW_GATHER_LISTS 16
+
+struct flow_arcs {
+    int n;
+    int m;
+    int* first;             // n + 1 entries
+    int* to;
+    int* flow;
+    int* supplied;          // Copies of the graph's
+    int* absorbed;
+};
+
+/* A flow split into paths from the sources to the sinks and into cycles,
+ * each with an amount of flow. The amounts of the paths and cycles through
+ * an arc add up to the arc's flow, and those of the paths starting at a
+ * source or ending at a sink to what it supplied or absorbed.
+ *
+ * flow_decompose walks from each source along arcs with flow left, taking
+ * the amount off the walk when it reaches a sink or runs into itself, which
+ * is a cycle. Each vertex has a current arc like in push-relabel, and the
+ * walk is only cut back to the first arc that was emptied, so it takes
+ * O(|V| + |E|) plus the length of the paths and cycles it finds. What flow
+ * is left after the sources are done is cycles, found the same way.
+ *
+ * A flow that is not conserved is split as far as it goes. The flow a walk
+ * carries to a vertex with more flow in than out, and the flow sinks absorbed
+ * that no path brought them, is left out and counted in 'residue'. */
+struct flow_decomposition {
+    int count;              // Paths and cycles
+    int room;
+    long* first;            // Path i is vertices[first[i]] ..
+                            // vertices[first[i + 1] - 1]
+    int* amount;
+    char* cycle;            // 1 if path i is a cycle, its last vertex has
+                            // an arc to its first
+    int* vertices;
+    long length;            // Entries in vertices
+    long vertex_room;
+    long value;             // Flow of the paths, the flow's value
+    long steps;             // Arcs the walks went over
+    int unbalanced;         // The least vertex where the flow is not
+                            // conserved, -1 if none
+    long residue;           // Flow left out of the paths and cycles at such
+                            // vertices, 0 for a valid flow
+};
+
+/* Copies the arcs of a graph and their flow into arrays
+ * Args:    - Pointer to the graph holding the flow
+ * Return:  Pointer to the arcs */
+struct flow_arcs* flow_arcs_gather(struct graph* g);
+
+/* Frees the arrays of arcs
+ * Args:    - Pointer to the arcs
+ * Return:  Nothing */
+void flow_arcs_free(struct flow_arcs* a);
+
+/* Splits a flow into paths and cycles
+ * Args:    - Pointer to the arcs of the graph holding the flow, which are
+ *            not changed
+ * Return:  Pointer to the decomposition */
+struct flow_decomposition* flow_decompose(struct flow_arcs* a);
+
+/* Frees a decomposition
+ * Args:    - Pointer to the decomposition
+ * Return:  Nothing */
+void decomposition_free(struct flow_decomposition* d);
+
+#endif
@@ -0,0 +1,466 @@
+#define _GNU_SOURCE
+#include "dobfs.h"
+#include "placement.h"
+#include "csr.h"
+#include "simd.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+
+// Vertices of the frontier, or words of the bitmap bottom-up, taken at a time
+#define BFS_CHUNK 64
+
+#define BIT_GET(bits, i) (((bits)[(i) >> 6] >> ((i) & 63)) & 1)
+#define BIT_SET(bits, i) ((bits)[(i) >> 6] |= (uint64_t)1 << ((i) & 63))
+
+/* What each thread found while expanding a level */
+struct bfs_thread {
+    struct bfs_engine* e;
+    int id;
+    int* next;              // Vertices visited
+    int n_next;
+    int* scratch;           // Arcs found by the SIMD kernel
+    long arcs;              // Arcs scanned
+    long next_arcs;         // Arcs of the vertices visited
+};
+
+struct bfs_pool {
+    pthread_t* workers;
+    pthread_barrier_t start;
+    pthread_barrier_t done;
+    struct bfs_thread* threads;
+    int quit;
+
+    // The level being expanded
+    enum bfs_direction direction;
+    int bottom_up;
+    int depth;              // Level of the frontier
+    int frontier_begin;     // The frontier is queue[frontier_begin ..
+    int frontier_end;       // frontier_end - 1]
+    int cursor;             // Next chunk to take
+    int found;              // A target reached, or -1
+    const char* target;
+    int* targets;           // The vertices in 'target'
+    int n_targets;
+};
+
+static int degree(struct csr* c, int v) {
+    return c->first[v + 1] - c->first[v];
+}
+
+// Visits v from arc a, or the reverse arc of a, unless another thread did
+static void visit_top_down(struct bfs_thread* t, int v, int a) {
+    struct bfs_engine* e = t->e;
+    struct bfs_pool* p = e->pool;
+    int unvisited = -1;
+
+    if (!__atomic_compare_exchange_n(&e->level[v], &unvisited, p->depth + 1, 0,
+                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        return;
+    }
+    e->parent[v] = p->direction == BFS_FORWARD ? a : e->c->rev[a];
+    t->next[t->n_next++] = v;
+    t->next_arcs += degree(e->c, v);
+
+    if (p->target && p->target[v]) {
+        int none = -1;
+        __atomic_compare_exchange_n(&p->found, &none, v, 0, __ATOMIC_RELAXED,
+                                    __ATOMIC_RELAXED);
+    }
+}
+
+static void expand_top_down(struct bfs_thread* t) {
+    struct bfs_engine* e = t->e;
+    struct bfs_pool* p = e->pool;
+    struct csr* c = e->c;
+    struct simd_kernels* k = simd_kernels();
+
+    while (__atomic_load_n(&p->found, __ATOMIC_RELAXED) == -1) {
+        int begin = p->frontier_begin +
+                    __atomic_fetch_add(&p->cursor, BFS_CHUNK, __ATOMIC_RELAXED);
+        if (begin >= p->frontier_end) {
+            break;
+        }
+        int end = begin + BFS_CHUNK < p->frontier_end ? begin + BFS_CHUNK
+                                                      : p->frontier_end;
+        for (int i = begin; i < end; i++) {
+            int u = e->queue[i];
+            int first = c->first[u];
+            t->arcs += degree(c, u);
+
+            // Forward the arcs out of u are contiguous and can be scanned by
+            // the kernel. The levels it reads may be changed by other threads
+            // meanwhile, but only the compare and swap visits a vertex.
+            if (p->direction == BFS_FORWARD) {
+                int count = k->scan_unvisited(c->residual + first,
+                                              c->head + first, e->level,
+                                              degree(c, u), t->scratch);
+                for (int j = 0; j < count; j++) {
+                    int a = first + t->scratch[j];
+                    visit_top_down(t, c->head[a], a);
+                }
+                continue;
+            }
+            for (int a = first; a < c->first[u + 1]; a++) {
+                if (0 < c->residual[c->rev[a]] &&
+                    __atomic_load_n(&e->level[c->head[a]],
+                                    __ATOMIC_RELAXED) == -1) {
+                    visit_top_down(t, c->head[a], a);
+                }
+            }
+        }
+    }
+}
+
+// Each chunk is a word of the bitmap, so no other thread visits its vertices
+static void expand_bottom_up(struct bfs_thread* t) {
+    struct bfs_engine* e = t->e;
+    struct bfs_pool* p = e->pool;
+    struct csr* c = e->c;
+    int words = (c->n + 63) / 64;
+
+    while (__atomic_load_n(&p->found, __ATOMIC_RELAXED) == -1) {
+        int w = __atomic_fetch_add(&p->cursor, 1, __ATOMIC_RELAXED);
+        if (w >= words) {
+            break;
+        }
+        int end = 64 * w + 64 < c->n ? 64 * w + 64 : c->n;
+        for (int v = 64 * w; v < end; v++) {
+            if (e->level[v] != -1) {
+                continue;
+            }
+            for (int b = c->first[v]; b < c->first[v + 1]; b++) {
+                ++t->arcs;
+                if (!BIT_GET(e->frontier, c->head[b])) {
+                    continue;
+                }
+                int r = p->direction == BFS_FORWARD ? c->residual[c->rev[b]]
+                                                    : c->residual[b];
+                if (r <= 0) {
+                    continue;
+                }
+                e->level[v] = p->depth + 1;
+                e->parent[v] = p->direction == BFS_FORWARD ? c->rev[b] : b;
+                t->next[t->n_next++] = v;
+                t->next_arcs += degree(c, v);
+                if (p->target && p->target[v]) {
+                    int none = -1;
+                    __atomic_compare_exchange_n(&p->found, &none, v, 0,
+                                                __ATOMIC_RELAXED,
+                                                __ATOMIC_RELAXED);
+                }
+                break;
+            }
+        }
+    }
+}
+
+// Looks for an arc from the frontier into one of the targets before the level
+// is expanded. There are usually few targets, so this is much cheaper than
+// expanding a level that reaches one.
+static void probe_targets(struct bfs_engine* e) {
+    struct bfs_pool* p = e->pool;
+    struct csr* c = e->c;
+
+    for (int i = 0; i < p->n_targets; i++) {
+        int v = p->targets[i];
+        if (e->level[v] != -1) {
+            continue;
+        }
+        for (int b = c->first[v]; b < c->first[v + 1]; b++) {
+            int r = p->direction == BFS_FORWARD ? c->residual[c->rev[b]]
+                                                : c->residual[b];
+            if (0 < r && BIT_GET(e->frontier, c->head[b])) {
+                e->level[v] = p->depth + 1;
+                e->parent[v] = p->direction == BFS_FORWARD ? c->rev[b] : b;
+                e->queue[p->frontier_end] = v;
+                p->found = v;
+                return;
+            }
+        }
+    }
+}
+
+static void expand(struct bfs_thread* t) {
+    TRACE_BEGIN("expand");
+    t->n_next = 0;
+    t->arcs = 0;
+    t->next_arcs = 0;
+    if (t->e->pool->bottom_up) {
+        expand_bottom_up(t);
+    }
+    else {
+        expand_top_down(t);
+    }
+    TRACE_END("expand");
+}
+
+static void* bfs_worker(void* arg) {
+    struct bfs_thread* t = arg;
+    struct bfs_pool* p = t->e->pool;
+
+    while (1) {
+        pthread_barrier_wait(&p->start);
+        if (p->quit) {
+            break;
+        }
+        expand(t);
+        pthread_barrier_wait(&p->done);
+    }
+    return NULL;
+}
+
+int bfs_default_threads(void) {
+    char* threads = getenv("MAXFLOW_THREADS");
+    if (threads && 0 < atoi(threads)) {
+        return atoi(threads);
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus < 1 ? 1 : cpus;
+}
+
+struct bfs_engine* bfs_engine_init(struct csr* c, int threads) {
+    struct bfs_engine* e = malloc(sizeof(struct bfs_engine));
+    struct bfs_pool* p = malloc(sizeof(struct bfs_pool));
+    assert(e != NULL && p != NULL);
+    int max_degree = 0;
+
+    for (int v = 0; v < c->n; v++) {
+        max_degree = degree(c, v) > max_degree ? degree(c, v) : max_degree;
+    }
+    e->c = c;
+    e->threads = threads < 1 ? 1 : threads;
+    e->level  = array_alloc((c->n + 1) * sizeof(int));
+    e->parent = array_alloc((c->n + 1) * sizeof(int));
+    e->frontier = array_alloc(((c->n + 63) / 64 + 1) * sizeof(uint64_t));
+    e->queue  = array_alloc((c->n + 1) * sizeof(int));
+    e->seeds  = malloc((c->n + 1) * sizeof(int));
+    e->seed_levels = malloc((c->n + 1) * sizeof(int));
+    assert(e->level && e->parent && e->frontier && e->queue && e->seeds &&
+           e->seed_levels);
+    e->pool = p;
+    e->stats = NULL;
+    e->n_stats = 0;
+
+    p->quit = 0;
+    p->threads = malloc(e->threads * sizeof(struct bfs_thread));
+    assert(p->threads != NULL);
+    for (int i = 0; i < e->threads; i++) {
+        p->threads[i].e = e;
+        p->threads[i].id = i;
+        p->threads[i].next = array_alloc((c->n + 1) * sizeof(int));
+        p->threads[i].scratch = malloc((max_degree + 1) * sizeof(int));
+        assert(p->threads[i].next && p->threads[i].scratch);
+    }
+
+    // The calling thread is thread 0
+    p->targets = malloc((c->n + 1) * sizeof(int));
+    assert(p->targets != NULL);
+    p->workers = NULL;
+    if (1 < e->threads) {
+        p->workers = malloc(e->threads * sizeof(pthread_t));
+        assert(p->workers != NULL);
+        pthread_barrier_init(&p->start, NULL, e->threads);
+        pthread_barrier_init(&p->done, NULL, e->threads);
+        for (int i = 1; i < e->threads; i++) {
+            int error = pthread_create(&p->workers[i], NULL, &bfs_worker,
+                                       &p->threads[i]);
+            assert(error == 0);
+        }
+    }
+    bfs_reset(e);
+    return e;
+}
+
+void bfs_reset(struct bfs_engine* e) {
+    for (int v = 0; v < e->c->n; v++) {
+        e->level[v] = -1;
+        e->parent[v] = -1;
+    }
+    e->n_seeds = 0;
+}
+
+void bfs_seed(struct bfs_engine* e, int v, int level) {
+    assert(e->n_seeds == 0 || e->seed_levels[e->n_seeds - 1] <= level);
+    e->seeds[e->n_seeds] = v;
+    e->seed_levels[e->n_seeds] = level;
+    ++e->n_seeds;
+}
+
+void bfs_block(struct bfs_engine* e, int v) {
+    e->level[v] = BFS_BLOCKED;
+}
+
+static struct bfs_level_stats* level_stats(struct bfs_engine* e, int depth) {
+    if (e->n_stats <= depth) {
+        e->stats = realloc(e->stats, (depth + 1) *
+                                     sizeof(struct bfs_level_stats));
+        assert(e->stats != NULL);
+        memset(e->stats + e->n_stats, 0, (depth + 1 - e->n_stats) *
+                                         sizeof(struct bfs_level_stats));
+        e->n_stats = depth + 1;
+    }
+    return &e->stats[depth];
+}
+
+int bfs_run(struct bfs_engine* e, enum bfs_direction direction,
+            const char* target) {
+    struct bfs_pool* p = e->pool;
+    struct csr* c = e->c;
+    int length = 0, seed = 0;
+    long unvisited_arcs = 0;
+
+    if (!e->n_seeds) {
+        return -1;
+    }
+    p->n_targets = 0;
+    for (int v = 0; v < c->n; v++) {
+        if (e->level[v] == -1) {
+            unvisited_arcs += degree(c, v);
+        }
+        if (target && target[v]) {
+            p->targets[p->n_targets++] = v;
+        }
+    }
+    p->direction = direction;
+    p->target = target;
+    p->found = -1;
+    p->bottom_up = 0;
+    p->depth = e->seed_levels[0];
+    p->frontier_begin = 0;
+
+    while (1) {
+        // The seeds of this level that are not visited yet join the frontier
+        while (seed < e->n_seeds && e->seed_levels[seed] == p->depth) {
+            int v = e->seeds[seed++];
+            if (e->level[v] == -1) {
+                e->level[v] = p->depth;
+                e->parent[v] = -1;
+                e->queue[length++] = v;
+                unvisited_arcs -= degree(c, v);
+                if (target && target[v] && p->found == -1) {
+                    p->found = v;
+                }
+            }
+        }
+        p->frontier_end = length;
+        if (p->found != -1) {
+            break;
+        }
+        if (p->frontier_begin == p->frontier_end) {
+            if (seed == e->n_seeds) {
+                break;
+            }
+            p->depth = e->seed_levels[seed];
+            continue;
+        }
+
+        // Bottom-up when the frontier has many arcs compared with the
+        // unvisited vertices, until the frontier is small again
+        int frontier = p->frontier_end - p->frontier_begin;
+        long frontier_arcs = 0;
+        for (int i = p->frontier_begin; i < p->frontier_end; i++) {
+            frontier_arcs += degree(c, e->queue[i]);
+        }
+        if (!p->bottom_up && unvisited_arcs / BFS_ALPHA < frontier_arcs) {
+            p->bottom_up = 1;
+        }
+        else if (p->bottom_up && frontier < c->n / BFS_BETA) {
+            p->bottom_up = 0;
+        }
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (p->bottom_up || p->n_targets) {
+            memset(e->frontier, 0, ((c->n + 63) / 64) * sizeof(uint64_t));
+            for (int i = p->frontier_begin; i < p->frontier_end; i++) {
+                BIT_SET(e->frontier, e->queue[i]);
+            }
+        }
+        struct bfs_level_stats* st = level_stats(e, p->depth);
+        ++st->searches;
+        st->frontier += frontier;
+        if (p->n_targets) {
+            probe_targets(e);
+        }
+        if (p->found != -1) {
+            st->seconds += seconds_since(&start);
+            break;
+        }
+
+        p->cursor = 0;
+        if (1 < e->threads) {
+            pthread_barrier_wait(&p->start);
+            expand(&p->threads[0]);
+            pthread_barrier_wait(&p->done);
+        }
+        else {
+            expand(&p->threads[0]);
+        }
+
+        // The next frontier is what the threads visited
+        for (int i = 0; i < e->threads; i++) {
+            struct bfs_thread* t = &p->threads[i];
+            memcpy(e->queue + length, t->next, t->n_next * sizeof(int));
+            length += t->n_next;
+            unvisited_arcs -= t->next_arcs;
+            st->arcs += t->arcs;
+        }
+        st->bottom_up += p->bottom_up;
+        st->seconds += seconds_since(&start);
+
+        p->frontier_begin = p->frontier_end;
+        ++p->depth;
+    }
+    return p->found;
+}
+
+void bfs_print_stats(struct bfs_engine* e, FILE* fp) {
+    fprintf(fp, "bfs: %d threads, level: searches, bottom-up, mean frontier, "
+            "mean arcs scanned, total ms\n", e->threads);
+    for (int d = 0; d < e->n_stats; d++) {
+        struct bfs_level_stats* st = &e->stats[d];
+        if (!st->searches) {
+            continue;
+        }
+        fprintf(fp, "bfs: %4d: %8ld %8ld %10.1f %12.1f %10.3f\n", d,
+                st->searches, st->bottom_up,
+                (double)st->frontier / st->searches,
+                (double)st->arcs / st->searches, st->seconds * 1000);
+    }
+}
+
+void bfs_engine_free(struct bfs_engine* e) {
+    struct bfs_pool* p = e->pool;
+
+    if (1 < e->threads) {
+        p->quit = 1;
+        pthread_barrier_wait(&p->start);
+        for (int i = 1; i < e->threads; i++) {
+            pthread_join(p->workers[i], NULL);
+        }
+        pthread_barrier_destroy(&p->start);
+        pthread_barrier_destroy(&p->done);
+        free(p->workers);
+    }
+    for (int i = 0; i < e->threads; i++) {
+        array_free(p->threads[i].next);
+        free(p->threads[i].scratch);
+    }
+    free(p->threads);
+    free(p->targets);
+    free(p);
+    array_free(e->level);
+    array_free(e->parent);
+    array_free(e->frontier);
+    array_free(e->queue);
+    free(e->seeds);
+    free(e->seed_levels);
+    free(e->stats);
+    free(e);
+}
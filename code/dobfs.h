@@ -0,0 +1,116 @@
+#ifndef DOBFS_H
+#define DOBFS_H
+
+#include "csr.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Breadth first search in the residual graph of a compressed graph, level by
+ * level. A level is expanded top-down, from the vertices in the frontier, or
+ * bottom-up, from the unvisited vertices looking for a parent in the
+ * frontier, whichever is expected to scan fewer arcs (Beamer et al.). The
+ * frontier is kept both as a list and as a bitmap. The vertices of a level
+ * are split between threads in chunks of 64.
+ *
+ * A forward search follows the arcs with residual capacity out of the
+ * vertices, as for augmenting paths. A reverse search follows them into the
+ * vertices, giving the distances to the seeds, as for global relabeling. */
+enum bfs_direction {BFS_FORWARD, BFS_REVERSE};
+
+/* Switch to bottom-up when the frontier's arcs are more than 1/BFS_ALPHA of
+ * the unvisited vertices' arcs, and back to top-down when the frontier has
+ * less than 1/BFS_BETA of the vertices. Beamer et al. use 14 for alpha, but in
+ * a residual graph many unvisited vertices have no arc from the frontier and
+ * bottom-up scans all their arcs, so it pays off later. 2 was fastest on the
+ * dense min graphs. */
+#define BFS_ALPHA 2
+#define BFS_BETA 24
+
+/* Vertices the search must not visit have this level */
+#define BFS_BLOCKED -2
+
+/* Totals over all searches of one level */
+struct bfs_level_stats {
+    long searches;          // Searches that expanded this level
+    long bottom_up;         // Of those, how many expanded it bottom-up
+    long frontier;          // Vertices in the frontier
+    long arcs;              // Arcs scanned
+    double seconds;
+};
+
+/* The threads and what they share while expanding a level, see dobfs.c */
+struct bfs_pool;
+
+struct bfs_engine {
+    struct csr* c;
+    int threads;
+    int* level;             // -1 if not visited
+    int* parent;            // Arc the vertex was reached by, -1 for seeds.
+                            // Forward it ends in the vertex, reverse it
+                            // starts in it.
+    uint64_t* frontier;     // Bitmap of the frontier, for bottom-up
+    int* queue;             // The visited vertices in the order visited
+    int* seeds;
+    int* seed_levels;
+    int n_seeds;
+    struct bfs_pool* pool;
+
+    struct bfs_level_stats* stats;
+    int n_stats;
+};
+
+/* The number of threads to use, from the environment variable
+ * MAXFLOW_THREADS or else the number of CPUs
+ * Args:    None
+ * Return:  The number of threads */
+int bfs_default_threads(void);
+
+/* Creates a search engine for a compressed graph, with its threads
+ * Args:    - Pointer to the compressed graph
+ *          - Number of threads, 1 to search in the calling thread only
+ * Return:  Pointer to the engine */
+struct bfs_engine* bfs_engine_init(struct csr* c, int threads);
+
+/* Marks all vertices as not visited and removes the seeds
+ * Args:    - Pointer to the engine
+ * Return:  Nothing */
+void bfs_reset(struct bfs_engine* e);
+
+/* Adds a vertex the search starts from. It is put in the frontier when the
+ * search reaches its level, if it is not visited by then. Seeds must be added
+ * in order of level.
+ * Args:    - Pointer to the engine
+ *          - The vertex
+ *          - The level of the vertex
+ * Return:  Nothing */
+void bfs_seed(struct bfs_engine* e, int v, int level);
+
+/* Keeps the search from visiting a vertex
+ * Args:    - Pointer to the engine
+ *          - The vertex
+ * Return:  Nothing */
+void bfs_block(struct bfs_engine* e, int v);
+
+/* Runs the search from the seeds. The levels and parents of the vertices
+ * reached are left in the engine.
+ * Args:    - Pointer to the engine
+ *          - Forward or reverse
+ *          - Array with 1 for the vertices to stop at, the first one reached
+ *            is returned. NULL to visit all vertices that can be reached.
+ * Return:  The target reached, -1 if none */
+int bfs_run(struct bfs_engine* e, enum bfs_direction direction,
+            const char* target);
+
+/* Prints the totals of each level on a line each
+ * Args:    - Pointer to the engine
+ *          - The file to print to
+ * Return:  Nothing */
+void bfs_print_stats(struct bfs_engine* e, FILE* fp);
+
+/* Stops the threads and frees the engine, but not the compressed graph
+ * Args:    - Pointer to the engine
+ * Return:  Nothing */
+void bfs_engine_free(struct bfs_engine* e);
+
+#endif
@@ -0,0 +1,716 @@
+#define _GNU_SOURCE
+#include "dynamic.h"
+#include "list.h"
+#include "loaddimacs.h"
+#include "preflow.h"
+#include "pushrelabel.h"
+#include "verify.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+#include <time.h>
+
+static void* grow(void* p, long count, size_t size) {
+    p = realloc(p, (count < 1 ? 1 : count) * size);
+    assert(p != NULL);
+    return p;
+}
+
+// Makes room for at least 'needed' vertices
+static void reserve_vertices(struct dynamic_graph* d, int needed) {
+    if (needed <= d->vertex_room) {
+        return;
+    }
+    int room = 2 * d->vertex_room < needed ? needed : 2 * d->vertex_room;
+    d->alive         = grow(d->alive, room, sizeof(char));
+    d->start         = grow(d->start, room, sizeof(int));
+    d->degree        = grow(d->degree, room, sizeof(int));
+    d->room          = grow(d->room, room, sizeof(int));
+    d->supply        = grow(d->supply, room, sizeof(int));
+    d->demand        = grow(d->demand, room, sizeof(int));
+    d->supplied      = grow(d->supplied, room, sizeof(int));
+    d->absorbed      = grow(d->absorbed, room, sizeof(int));
+    d->free_vertices = grow(d->free_vertices, room, sizeof(int));
+    d->height        = grow(d->height, room, sizeof(int));
+    d->excess        = grow(d->excess, room, sizeof(long));
+    d->current       = grow(d->current, room, sizeof(int));
+    d->queue         = grow(d->queue, room + 1, sizeof(int));
+    d->walk          = grow(d->walk, room, sizeof(int));
+    d->mark          = grow(d->mark, room, sizeof(int));
+    d->end           = grow(d->end, room, sizeof(int));
+    for (int v = d->vertex_room; v < room; v++) {
+        d->mark[v] = -1;
+    }
+    d->vertex_room = room;
+}
+
+static void reserve_slots(struct dynamic_graph* d, int needed) {
+    if (needed <= d->slot_room) {
+        return;
+    }
+    int room = 2 * d->slot_room < needed ? needed : 2 * d->slot_room;
+    d->head     = grow(d->head, room, sizeof(int));
+    d->residual = grow(d->residual, room, sizeof(int));
+    d->arc      = grow(d->arc, room, sizeof(int));
+    d->rev      = grow(d->rev, room, sizeof(int));
+    d->slot_capacity = grow(d->slot_capacity, room, sizeof(int));
+    d->slot_room = room;
+}
+
+static void reserve_ids(struct dynamic_graph* d, int needed) {
+    if (needed <= d->id_room) {
+        return;
+    }
+    int room = 2 * d->id_room < needed ? needed : 2 * d->id_room;
+    d->slot     = grow(d->slot, 2L * room, sizeof(int));
+    d->ends     = grow(d->ends, 2L * room, sizeof(int));
+    d->capacity = grow(d->capacity, room, sizeof(int));
+    d->free_ids = grow(d->free_ids, room, sizeof(int));
+    d->id_room = room;
+}
+
+// Points the slots of arc a and its reverse to each other
+static inline void link_slots(struct dynamic_graph* d, int a) {
+    d->rev[d->slot[a]] = d->slot[a ^ 1];
+    d->rev[d->slot[a ^ 1]] = d->slot[a];
+}
+
+// Puts arc a in the next slot of v's range, which must have room. The
+// reverse arc is put after the arc.
+static void place(struct dynamic_graph* d, int v, int a, int head,
+                  int residual) {
+    int s = d->start[v] + d->degree[v]++;
+    d->head[s] = head;
+    d->residual[s] = residual;
+    d->arc[s] = a;
+    d->slot_capacity[s] = a % 2 == 0 ? d->capacity[a / 2] : 0;
+    d->slot[a] = s;
+    if (a % 2 == 1) {
+        link_slots(d, a);
+    }
+}
+
+struct dynamic_graph* dynamic_build(struct graph* g) {
+    struct dynamic_graph* d = calloc(1, sizeof(struct dynamic_graph));
+    assert(d != NULL);
+    int n = g->size, slots = 0;
+    d->n = n;
+    reserve_vertices(d, n);
+    memcpy(d->supply, g->supply, n * sizeof(int));
+    memcpy(d->demand, g->demand, n * sizeof(int));
+    memcpy(d->supplied, g->supplied, n * sizeof(int));
+    memcpy(d->absorbed, g->absorbed, n * sizeof(int));
+    for (int v = 0; v < n; v++) {
+        d->alive[v] = 1;
+        d->start[v] = slots;
+        d->degree[v] = 0;
+        d->room[v] = g->adj_array[v]->size + DYNAMIC_SLACK;
+        slots += d->room[v];
+    }
+    reserve_slots(d, slots);
+    reserve_ids(d, (slots - n * DYNAMIC_SLACK) / 2);
+    d->slots = slots;
+
+    // The forward arcs of u get its slots in the order of its adjacency list
+    for (int u = 0; u < n; u++) {
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            if (!e->original) {
+                continue;
+            }
+            int id = d->ids++;
+            d->ends[2 * id] = u;
+            d->ends[2 * id + 1] = e->to;
+            d->capacity[id] = e->capacity;
+            place(d, u, 2 * id, e->to, e->capacity - e->flow);
+            place(d, e->to, 2 * id + 1, u, e->flow);
+        }
+    }
+    d->arcs = d->ids;
+    return d;
+}
+
+struct dynamic_graph* dynamic_read(char* path) {
+    struct graph* g = read_dimacs_file(path);
+    struct dynamic_graph* d = dynamic_build(g);
+    graph_free(g);
+    return d;
+}
+
+void dynamic_free(struct dynamic_graph* d) {
+    free(d->alive);
+    free(d->start);
+    free(d->degree);
+    free(d->room);
+    free(d->supply);
+    free(d->demand);
+    free(d->supplied);
+    free(d->absorbed);
+    free(d->free_vertices);
+    free(d->head);
+    free(d->residual);
+    free(d->arc);
+    free(d->slot);
+    free(d->ends);
+    free(d->capacity);
+    free(d->free_ids);
+    free(d->height);
+    free(d->excess);
+    free(d->current);
+    free(d->queue);
+    free(d->walk);
+    free(d->mark);
+    free(d->end);
+    free(d->rev);
+    free(d->slot_capacity);
+    free(d);
+}
+
+// Lays the ranges out again one after the other, leaving out the slots moved
+// ranges left behind
+static void compact(struct dynamic_graph* d) {
+    int* head     = malloc(d->slot_room * sizeof(int));
+    int* residual = malloc(d->slot_room * sizeof(int));
+    int* arc      = malloc(d->slot_room * sizeof(int));
+    int* capacity = malloc(d->slot_room * sizeof(int));
+    assert(head && residual && arc && capacity);
+    int slots = 0;
+    for (int v = 0; v < d->n; v++) {
+        int from = d->start[v];
+        d->start[v] = slots;
+        for (int i = 0; i < d->degree[v]; i++) {
+            head[slots + i]     = d->head[from + i];
+            residual[slots + i] = d->residual[from + i];
+            arc[slots + i]      = d->arc[from + i];
+            capacity[slots + i] = d->slot_capacity[from + i];
+            d->slot[arc[slots + i]] = slots + i;
+        }
+        slots += d->room[v];
+    }
+    free(d->head);
+    free(d->residual);
+    free(d->arc);
+    free(d->slot_capacity);
+    d->head = head;
+    d->residual = residual;
+    d->arc = arc;
+    d->slot_capacity = capacity;
+    // An arc added while its head's range is moved has no reverse slot yet
+    for (int v = 0; v < d->n; v++) {
+        for (int s = d->start[v]; s < d->start[v] + d->degree[v]; s++) {
+            d->rev[s] = d->slot[d->arc[s] ^ 1];
+        }
+    }
+    d->slots = slots;
+    d->garbage = 0;
+    ++d->compactions;
+}
+
+// Moves the range of v to the end of the slots with twice the room
+static void relocate(struct dynamic_graph* d, int v) {
+    int room = 2 * d->room[v] < 2 * DYNAMIC_SLACK ? 2 * DYNAMIC_SLACK
+                                                  : 2 * d->room[v];
+    if (d->slot_room < d->slots + room && d->slots - d->garbage < d->garbage) {
+        compact(d);
+    }
+    reserve_slots(d, d->slots + room);
+    int from = d->start[v];
+    for (int i = 0; i < d->degree[v]; i++) {
+        int s = d->slots + i;
+        d->head[s]     = d->head[from + i];
+        d->residual[s] = d->residual[from + i];
+        d->arc[s]      = d->arc[from + i];
+        d->slot_capacity[s] = d->slot_capacity[from + i];
+        d->slot[d->arc[s]] = s;
+        link_slots(d, d->arc[s]);
+    }
+    d->garbage += d->room[v];
+    d->start[v] = d->slots;
+    d->room[v] = room;
+    d->slots += room;
+    ++d->relocations;
+}
+
+// Moves the last arc of the range into the slot of arc a
+static void remove_slot(struct dynamic_graph* d, int a) {
+    int s = d->slot[a], v = d->ends[a];
+    int last = d->start[v] + --d->degree[v];
+    if (s != last) {
+        d->head[s]     = d->head[last];
+        d->residual[s] = d->residual[last];
+        d->arc[s]      = d->arc[last];
+        d->slot_capacity[s] = d->slot_capacity[last];
+        d->slot[d->arc[s]] = s;
+        link_slots(d, d->arc[s]);
+    }
+    d->slot[a] = -1;
+}
+
+// The flow going out of the slot's vertex over slot s for sign 1, or coming
+// in over it for sign -1
+static inline int slot_flow(struct dynamic_graph* d, int s, int sign) {
+    int a = d->arc[s];
+    if (sign > 0) {
+        return a % 2 == 0 ? d->capacity[a / 2] - d->residual[s] : 0;
+    }
+    return a % 2 == 1 ? d->residual[s] : 0;
+}
+
+// The least flow on walk[from] .. walk[to - 1]
+static int walk_flow(struct dynamic_graph* d, int from, int to, int sign) {
+    int least = INT_MAX;
+    for (int i = from; i < to; i++) {
+        int f = slot_flow(d, d->walk[i], sign);
+        least = f < least ? f : least;
+    }
+    return least;
+}
+
+static void take_off_walk(struct dynamic_graph* d, int from, int to,
+                          int amount, int sign) {
+    for (int i = from; i < to; i++) {
+        int s = d->walk[i];
+        d->residual[s] += sign * amount;
+        d->residual[d->slot[d->arc[s] ^ 1]] -= sign * amount;
+    }
+}
+
+// Takes 'amount' of flow off paths leaving v for sign 1, or coming into v
+// for sign -1, so v sends or receives that much less. A path ends at the
+// super sink or super source, or at 'partner', the vertex at the other end
+// of an arc flow was taken off, which then needs as much less. Cycles the
+// walk runs into are taken off on the way, as they keep the flow balanced.
+// Return: How much ended at the partner
+static int cancel_flow(struct dynamic_graph* d, int v, int amount, int sign,
+                       int partner) {
+    int at_partner = 0;
+    int* path = d->queue;   // The vertices of the walk
+    while (0 < amount) {
+        int len = 0, u = v;
+        path[0] = v;
+        d->mark[v] = 0;
+        for (;;) {
+            long end = u == partner ? amount
+                     : sign > 0     ? d->absorbed[u] : d->supplied[u];
+            if (0 < end) {
+                int x = walk_flow(d, 0, len, sign);
+                x = amount < x ? amount : x;
+                x = end < x ? end : x;
+                take_off_walk(d, 0, len, x, sign);
+                if (u == partner) {
+                    at_partner += x;
+                }
+                else if (sign > 0) {
+                    d->absorbed[u] -= x;
+                }
+                else {
+                    d->supplied[u] -= x;
+                }
+                amount -= x;
+                ++d->cancelled;
+                break;
+            }
+
+            // Since every vertex but v and the partner is balanced, u has
+            // flow going on
+            int s = d->start[u], last = d->start[u] + d->degree[u];
+            while (s < last && slot_flow(d, s, sign) == 0) {
+                ++s;
+            }
+            assert(s < last);
+            int w = d->head[s];
+            d->walk[len] = s;
+            if (d->mark[w] == -1) {
+                path[++len] = w;
+                d->mark[w] = len;
+                u = w;
+                continue;
+            }
+            // A cycle back to w
+            int x = walk_flow(d, d->mark[w], len + 1, sign);
+            take_off_walk(d, d->mark[w], len + 1, x, sign);
+            for (int i = d->mark[w] + 1; i <= len; i++) {
+                d->mark[path[i]] = -1;
+            }
+            len = d->mark[w];
+            u = w;
+            ++d->cancelled;
+        }
+        for (int i = 0; i <= len; i++) {
+            d->mark[path[i]] = -1;
+        }
+    }
+    return at_partner;
+}
+
+// Takes 'amount' off the flow on an arc. Its tail is left receiving more than
+// it sends and its head sending more than it receives, so the same amount is
+// taken off paths through them.
+static void take_off_arc(struct dynamic_graph* d, int id, int amount) {
+    int u = d->ends[2 * id], v = d->ends[2 * id + 1];
+    d->residual[d->slot[2 * id]] += amount;
+    d->residual[d->slot[2 * id + 1]] -= amount;
+    int at_head = cancel_flow(d, u, amount, -1, v);
+    cancel_flow(d, v, amount - at_head, 1, -1);
+}
+
+int dynamic_add_vertex(struct dynamic_graph* d) {
+    int v;
+    if (0 < d->n_free_vertices) {
+        v = d->free_vertices[--d->n_free_vertices];
+    }
+    else {
+        reserve_vertices(d, d->n + 1);
+        v = d->n++;
+    }
+    d->alive[v] = 1;
+    d->start[v] = d->degree[v] = d->room[v] = 0;
+    d->supply[v] = d->demand[v] = d->supplied[v] = d->absorbed[v] = 0;
+    return v;
+}
+
+void dynamic_remove_vertex(struct dynamic_graph* d, int v) {
+    assert(0 <= v && v < d->n && d->alive[v]);
+    dynamic_set_supply(d, v, 0);
+    dynamic_set_demand(d, v, 0);
+    while (0 < d->degree[v]) {
+        dynamic_remove_arc(d, d->arc[d->start[v]] / 2);
+    }
+    d->alive[v] = 0;
+    d->garbage += d->room[v];
+    d->start[v] = d->room[v] = 0;
+    d->free_vertices[d->n_free_vertices++] = v;
+}
+
+int dynamic_add_arc(struct dynamic_graph* d, int from, int to, int capacity) {
+    assert(0 <= from && from < d->n && d->alive[from]);
+    assert(0 <= to && to < d->n && d->alive[to]);
+    assert(from != to);
+    assert(0 <= capacity);
+    int id;
+    if (0 < d->n_free_ids) {
+        id = d->free_ids[--d->n_free_ids];
+    }
+    else {
+        reserve_ids(d, d->ids + 1);
+        id = d->ids++;
+    }
+    d->ends[2 * id] = from;
+    d->ends[2 * id + 1] = to;
+    d->capacity[id] = capacity;
+    if (d->degree[from] == d->room[from]) {
+        relocate(d, from);
+    }
+    place(d, from, 2 * id, to, capacity);
+    if (d->degree[to] == d->room[to]) {
+        relocate(d, to);
+    }
+    place(d, to, 2 * id + 1, from, 0);
+    ++d->arcs;
+    return id;
+}
+
+void dynamic_remove_arc(struct dynamic_graph* d, int id) {
+    assert(0 <= id && id < d->ids && 0 <= d->capacity[id]);
+    int flow = dynamic_arc_flow(d, id);
+    if (0 < flow) {
+        take_off_arc(d, id, flow);
+    }
+    remove_slot(d, 2 * id);
+    remove_slot(d, 2 * id + 1);
+    d->capacity[id] = -1;
+    d->free_ids[d->n_free_ids++] = id;
+    --d->arcs;
+}
+
+void dynamic_set_capacity(struct dynamic_graph* d, int id, int capacity) {
+    assert(0 <= id && id < d->ids && 0 <= d->capacity[id]);
+    assert(0 <= capacity);
+    int flow = dynamic_arc_flow(d, id);
+    d->capacity[id] = capacity;
+    d->slot_capacity[d->slot[2 * id]] = capacity;
+    d->residual[d->slot[2 * id]] = capacity - flow;
+    if (capacity < flow) {
+        take_off_arc(d, id, flow - capacity);
+    }
+}
+
+void dynamic_set_supply(struct dynamic_graph* d, int v, int supply) {
+    assert(0 <= v && v < d->n && d->alive[v]);
+    assert(0 <= supply);
+    // A vertex being both source and sink would make a path without arcs
+    assert(supply == 0 || d->demand[v] == 0);
+    d->supply[v] = supply;
+    if (supply < d->supplied[v]) {
+        int over = d->supplied[v] - supply;
+        d->supplied[v] = supply;
+        cancel_flow(d, v, over, 1, -1);
+    }
+}
+
+void dynamic_set_demand(struct dynamic_graph* d, int v, int demand) {
+    assert(0 <= v && v < d->n && d->alive[v]);
+    assert(0 <= demand);
+    assert(demand == 0 || d->supply[v] == 0);
+    d->demand[v] = demand;
+    if (demand < d->absorbed[v]) {
+        int over = d->absorbed[v] - demand;
+        d->absorbed[v] = demand;
+        cancel_flow(d, v, over, -1, -1);
+    }
+}
+
+int dynamic_arc_flow(struct dynamic_graph* d, int id) {
+    assert(0 <= id && id < d->ids && 0 <= d->capacity[id]);
+    return d->residual[d->slot[2 * id + 1]];
+}
+
+long dynamic_flow_value(struct dynamic_graph* d) {
+    long value = 0;
+    for (int v = 0; v < d->n; v++) {
+        value += d->absorbed[v];
+    }
+    return value;
+}
+
+long dynamic_solve(struct dynamic_graph* d) {
+    for (int v = 0; v < d->n; v++) {
+        d->end[v] = d->start[v] + d->degree[v];
+    }
+    // The flow is balanced, so only what the sources have left to send
+    // becomes excess
+    struct preflow p = {
+        .n = d->n, .begin = d->start, .end = d->end, .head = d->head,
+        .rev = d->rev, .capacity = d->slot_capacity, .residual = d->residual,
+        .supply = d->supply, .demand = d->demand, .supplied = d->supplied,
+        .absorbed = d->absorbed, .height = d->height, .excess = d->excess,
+        .current = d->current, .queue = d->queue, .search = d->walk
+    };
+    preflow_start(&p);
+    preflow_run(&p, LONG_MAX);
+    d->pushes = p.pushes;
+    d->relabels = p.relabels;
+    d->global_relabels = p.global_relabels;
+    return dynamic_flow_value(d);
+}
+
+struct graph* dynamic_export(struct dynamic_graph* d) {
+    struct graph* g = graph_init(d->n);
+    memcpy(g->supply, d->supply, d->n * sizeof(int));
+    memcpy(g->demand, d->demand, d->n * sizeof(int));
+    memcpy(g->supplied, d->supplied, d->n * sizeof(int));
+    memcpy(g->absorbed, d->absorbed, d->n * sizeof(int));
+    // Edges are put first in the lists, so going backwards leaves the forward
+    // arcs of u in the order of its slots
+    for (int u = 0; u < d->n; u++) {
+        for (int s = d->start[u] + d->degree[u] - 1; d->start[u] <= s; s--) {
+            int a = d->arc[s];
+            if (a % 2 == 1) {
+                continue;
+            }
+            graph_add_edges(g, u, d->head[s], d->capacity[a / 2]);
+            struct edge* e = g->adj_array[u]->head->this;
+            e->flow = d->capacity[a / 2] - d->residual[s];
+        }
+    }
+    return g;
+}
+
+// Calls 'visit' with each forward arc's slot and the graph's edge for it
+static void match_edges(struct dynamic_graph* d, struct graph* g,
+                        void visit(struct dynamic_graph*, int, struct edge*)) {
+    assert(g->size == d->n);
+    for (int u = 0; u < d->n; u++) {
+        struct element* cur = g->adj_array[u]->head;
+        for (int s = d->start[u]; s < d->start[u] + d->degree[u]; s++) {
+            if (d->arc[s] % 2 == 1) {
+                continue;
+            }
+            while (!((struct edge*)cur->this)->original) {
+                cur = cur->next;
+            }
+            struct edge* e = cur->this;
+            assert(e->to == d->head[s]);
+            visit(d, s, e);
+            cur = cur->next;
+        }
+    }
+}
+
+static void store_edge(struct dynamic_graph* d, int s, struct edge* e) {
+    e->flow = d->capacity[d->arc[s] / 2] - d->residual[s];
+}
+
+static void load_edge(struct dynamic_graph* d, int s, struct edge* e) {
+    d->residual[s] = d->capacity[d->arc[s] / 2] - e->flow;
+    d->residual[d->slot[d->arc[s] ^ 1]] = e->flow;
+}
+
+void dynamic_store_flow(struct dynamic_graph* d, struct graph* g) {
+    match_edges(d, g, &store_edge);
+    memcpy(g->supplied, d->supplied, d->n * sizeof(int));
+    memcpy(g->absorbed, d->absorbed, d->n * sizeof(int));
+}
+
+void dynamic_load_flow(struct dynamic_graph* d, struct graph* g) {
+    match_edges(d, g, &load_edge);
+    memcpy(d->supplied, g->supplied, d->n * sizeof(int));
+    memcpy(d->absorbed, g->absorbed, d->n * sizeof(int));
+}
+
+static _Thread_local struct {
+    long pushes;
+    long relabels;
+    long global_relabels;
+} last_stats;
+
+int dynamic_solve_graph(struct graph* g) {
+    struct dynamic_graph* d = dynamic_build(g);
+    int mf = dynamic_solve(d);
+    dynamic_store_flow(d, g);
+    last_stats.pushes = d->pushes;
+    last_stats.relabels = d->relabels;
+    last_stats.global_relabels = d->global_relabels;
+    dynamic_free(d);
+    return mf;
+}
+
+void dynamic_print_stats(FILE* fp) {
+    fprintf(fp, "dynamic: pushes %ld, relabels %ld, global relabels %ld\n",
+            last_stats.pushes, last_stats.relabels,
+            last_stats.global_relabels);
+}
+
+// xorshift64*, so the stream of updates is the same on every machine
+static unsigned long next_random(unsigned long* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717UL;
+}
+
+static int random_vertex(struct dynamic_graph* d, unsigned long* state) {
+    int v;
+    do {
+        v = next_random(state) % d->n;
+    } while (!d->alive[v]);
+    return v;
+}
+
+static int random_arc(struct dynamic_graph* d, unsigned long* state) {
+    int id;
+    do {
+        id = next_random(state) % d->ids;
+    } while (d->capacity[id] < 0);
+    return id;
+}
+
+int dynamic_benchmark(char* path, int updates, int batch, FILE* fp) {
+    struct dynamic_graph* d = dynamic_read(path);
+    unsigned long state = 1;
+    // New capacities are those of random arcs of the graph as it was read.
+    // The flows are ints, so a uniform draw up to the largest capacity could
+    // make a source send more than they hold.
+    int n_capacities = d->ids < 1 ? 1 : d->ids;
+    int* capacities = malloc(n_capacities * sizeof(int));
+    assert(capacities != NULL);
+    capacities[0] = 1;
+    memcpy(capacities, d->capacity, d->ids * sizeof(int));
+    dynamic_solve(d);
+
+    // Added and removed arcs, changed capacities, added and removed vertices
+    long made[5] = {0};
+    long queries = 0, pushes = 0;
+    double updating = 0, going_on = 0, again = 0;
+    int failed = 0;
+    struct timespec start;
+    for (int done = 0; done < updates; ) {
+        int alive = d->n - d->n_free_vertices;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < batch && done < updates; i++, done++) {
+            int kind = next_random(&state) % 100;
+            if (kind < 35 && 2 <= alive) {
+                int u = random_vertex(d, &state), v;
+                do {
+                    v = random_vertex(d, &state);
+                } while (v == u);
+                int c = capacities[next_random(&state) % n_capacities];
+                dynamic_add_arc(d, u, v, c);
+                ++made[0];
+            }
+            else if (kind < 60 && 0 < d->arcs) {
+                dynamic_remove_arc(d, random_arc(d, &state));
+                ++made[1];
+            }
+            else if (kind < 90 && 0 < d->arcs) {
+                int c = capacities[next_random(&state) % n_capacities];
+                dynamic_set_capacity(d, random_arc(d, &state), c);
+                ++made[2];
+            }
+            else if (kind < 95) {
+                dynamic_add_vertex(d);
+                ++alive;
+                ++made[3];
+            }
+            else if (2 < alive) {
+                // The terminals stay, so the flow can keep being found
+                int v = random_vertex(d, &state);
+                if (d->supply[v] == 0 && d->demand[v] == 0) {
+                    dynamic_remove_vertex(d, v);
+                    --alive;
+                    ++made[4];
+                }
+            }
+        }
+        updating += seconds_since(&start);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        long flow = dynamic_solve(d);
+        going_on += seconds_since(&start);
+        pushes += d->pushes;
+
+        // The flow must be a maximum flow of the graph as it is now, and
+        // the same as the one found from scratch
+        struct graph* g = dynamic_export(d);
+        struct flow_verdict verdict;
+        if (!verify_flow(g, 1, &verdict)) {
+            fprintf(fp, "dynamic: after %d updates ", done);
+            verify_print(&verdict, flow, fp);
+            failed = 1;
+        }
+        graph_free(g);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        g = dynamic_export(d);
+        graph_reset_flow(g);
+        long expected = push_relabel_fifo(g);
+        again += seconds_since(&start);
+        graph_free(g);
+        if (flow != expected) {
+            fprintf(fp, "dynamic: after %d updates the flow is %ld, solving "
+                    "again finds %ld\n", done, flow, expected);
+            failed = 1;
+        }
+        ++queries;
+    }
+
+    fprintf(fp, "dynamic: %d updates, %ld arcs added, %ld removed, %ld "
+            "capacities changed, %ld vertices added, %ld removed\n",
+            updates, made[0], made[1], made[2], made[3], made[4]);
+    fprintf(fp, "dynamic: %.0f updates/s, %ld ranges moved, %ld compactions, "
+            "flow taken off %ld paths and cycles\n",
+            updates / updating, d->relocations, d->compactions, d->cancelled);
+    fprintf(fp, "dynamic: %ld queries, going on from the flow %.3f ms and "
+            "%ld pushes, pr-fifo on a new graph %.3f ms, %.2f times faster\n",
+            queries, 1e3 * going_on / queries, pushes / queries,
+            1e3 * again / queries, again / going_on);
+    fprintf(fp, "dynamic: %d vertices, %d arcs, maximum flow %ld%s\n",
+            d->n - d->n_free_vertices, d->arcs, dynamic_flow_value(d),
+            failed ? ", WRONG FLOW" : "");
+    free(capacities);
+    dynamic_free(d);
+    return failed;
+}
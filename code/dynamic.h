@@ -0,0 +1,214 @@
+#ifndef DYNAMIC_H
+#define DYNAMIC_H
+
+#include "graph.h"
+
+#include <stdio.h>
+
+/* A graph that changes while it has a flow: arcs and vertices are added and
+ * removed and capacities and terminals change, and a solve goes on from the
+ * flow the graph has instead of from 0.
+ *
+ * The arcs of each vertex are a range of slots in one array of slots, like
+ * the arcs of csr.h, with room for more. An arc is added in a free slot of
+ * its vertices' ranges. A full range is moved to the end of the slots with
+ * twice the room, and the slots are compacted when more of them are left
+ * behind by moves than are in use, so adding an arc takes amortized O(1). An
+ * arc is removed by moving the last arc of the range to its slot, in O(1).
+ *
+ * The flow is always valid. When an arc with flow is removed, or a capacity,
+ * supply or demand is made less than its flow, the flow that no longer fits
+ * is taken off paths to the sources and the sinks, or off cycles, that go
+ * through it. The flow may then be less than maximum until the next
+ * dynamic_solve. */
+
+/* Free slots each vertex's range gets when the graph is built */
+#define DYNAMIC_SLACK 2
+
+/* Arc ids stay the same while the arc exists. Arc 'id' goes from ends[2 id]
+ * to ends[2 id + 1]. Its slots are slot[2 id] in the range of the tail and
+ * slot[2 id + 1], the reverse arc, in the range of the head. A slot s holds
+ * arc[s], one of these 2 id + 0 or 1, its head, its residual capacity, rev[s]
+ * the slot of the reverse arc and slot_capacity[s] the capacity, 0 for the
+ * reverse arc, so the slots are the arcs of preflow.h.
+ * The removed vertices and arcs are reused by the next ones added. */
+struct dynamic_graph {
+    int n;                  // Vertex ids handed out, the removed included
+    int vertex_room;
+    char* alive;
+    int* start;             // Range of slots of each vertex
+    int* degree;            // Slots in use
+    int* room;
+    int* supply;            // The terminals, like in graph.h
+    int* demand;
+    int* supplied;
+    int* absorbed;
+    int* free_vertices;
+    int n_free_vertices;
+
+    int slots;              // Slots handed out to ranges
+    int slot_room;
+    int* head;
+    int* residual;
+    int* arc;
+    int* rev;
+    int* slot_capacity;
+    int garbage;            // Slots of ranges that were moved away
+
+    int ids;                // Arc ids handed out, the removed included
+    int id_room;
+    int* slot;
+    int* ends;
+    int* capacity;          // -1 for a removed arc
+    int* free_ids;
+    int n_free_ids;
+    int arcs;               // Arcs there are
+
+    // Workspaces
+    int* height;
+    long* excess;
+    int* current;
+    int* queue;
+    int* walk;
+    int* mark;
+    int* end;               // End of each range, for the solve
+
+    // Counters since the graph was built
+    long relocations;       // Ranges moved
+    long compactions;
+    long cancelled;         // Paths and cycles flow was taken off
+
+    // What the last dynamic_solve did
+    long pushes;
+    long relabels;
+    long global_relabels;
+};
+
+/* Builds a dynamic graph with the arcs, terminals and flow of a graph. The
+ * graph can be freed after.
+ * Args:    - Pointer to the graph
+ * Return:  Pointer to the dynamic graph */
+struct dynamic_graph* dynamic_build(struct graph* g);
+
+/* Reads a graph in DIMACS format into a dynamic graph
+ * Args:    - Path to the file
+ * Return:  Pointer to the dynamic graph */
+struct dynamic_graph* dynamic_read(char* path);
+
+/* Frees a dynamic graph
+ * Args:    - Pointer to the dynamic graph
+ * Return:  Nothing */
+void dynamic_free(struct dynamic_graph* d);
+
+/* Adds a vertex with no arcs that is no terminal
+ * Args:    - Pointer to the dynamic graph
+ * Return:  The vertex */
+int dynamic_add_vertex(struct dynamic_graph* d);
+
+/* Removes a vertex, its arcs and the flow through it
+ * Args:    - Pointer to the dynamic graph
+ *          - The vertex
+ * Return:  Nothing */
+void dynamic_remove_vertex(struct dynamic_graph* d, int v);
+
+/* Adds an arc with no flow
+ * Args:    - Pointer to the dynamic graph
+ *          - From vertex
+ *          - To vertex
+ *          - Capacity of the arc
+ * Return:  The id of the arc */
+int dynamic_add_arc(struct dynamic_graph* d, int from, int to, int capacity);
+
+/* Removes an arc and the flow through it
+ * Args:    - Pointer to the dynamic graph
+ *          - The id of the arc
+ * Return:  Nothing */
+void dynamic_remove_arc(struct dynamic_graph* d, int id);
+
+/* Changes the capacity of an arc, taking off the flow above it
+ * Args:    - Pointer to the dynamic graph
+ *          - The id of the arc
+ *          - The new capacity
+ * Return:  Nothing */
+void dynamic_set_capacity(struct dynamic_graph* d, int id, int capacity);
+
+/* Changes how much a vertex can send as a source, 0 for no source, taking off
+ * the flow above it
+ * Args:    - Pointer to the dynamic graph
+ *          - The vertex
+ *          - The supply. TERMINAL_UNBOUNDED for no limit
+ * Return:  Nothing */
+void dynamic_set_supply(struct dynamic_graph* d, int v, int supply);
+
+/* Changes how much a vertex can receive as a sink, 0 for no sink, taking off
+ * the flow above it
+ * Args:    - Pointer to the dynamic graph
+ *          - The vertex
+ *          - The demand. TERMINAL_UNBOUNDED for no limit
+ * Return:  Nothing */
+void dynamic_set_demand(struct dynamic_graph* d, int v, int demand);
+
+/* The flow on an arc
+ * Args:    - Pointer to the dynamic graph
+ *          - The id of the arc
+ * Return:  The flow */
+int dynamic_arc_flow(struct dynamic_graph* d, int id);
+
+/* The value of the flow the graph has
+ * Args:    - Pointer to the dynamic graph
+ * Return:  The flow into the sinks */
+long dynamic_flow_value(struct dynamic_graph* d);
+
+/* Finds a maximum flow with the FIFO push-relabel of preflow.h, starting
+ * from the flow the graph has
+ * Args:    - Pointer to the dynamic graph
+ * Return:  The value of the flow */
+long dynamic_solve(struct dynamic_graph* d);
+
+/* Makes a graph of the dynamic graph with its flow, to solve it with a solver
+ * of solver.h. The augmenting path solvers of maxflow.h go on from the flow.
+ * The removed vertices are in it without arcs.
+ * Args:    - Pointer to the dynamic graph
+ * Return:  Pointer to the graph */
+struct graph* dynamic_export(struct dynamic_graph* d);
+
+/* Stores the flow of the dynamic graph in a graph it was built from or
+ * exported to, if it did not change since
+ * Args:    - Pointer to the dynamic graph
+ *          - Pointer to the graph
+ * Return:  Nothing */
+void dynamic_store_flow(struct dynamic_graph* d, struct graph* g);
+
+/* Takes the flow of a graph the dynamic graph was built from or exported to,
+ * if it did not change since, e.g. after another solver solved it
+ * Args:    - Pointer to the dynamic graph
+ *          - Pointer to the graph
+ * Return:  Nothing */
+void dynamic_load_flow(struct dynamic_graph* d, struct graph* g);
+
+/* Solves a graph as a dynamic graph, for solver.h
+ * Args:    - Pointer to graph
+ * Return:  The maximum flow */
+int dynamic_solve_graph(struct graph* g);
+
+/* Prints what the last dynamic_solve_graph in the calling thread did
+ * Args:    - The file to print to
+ * Return:  Nothing */
+void dynamic_print_stats(FILE* fp);
+
+/* Updates --dynamic makes between two queries by default */
+#define DYNAMIC_BENCH_BATCH 100
+
+/* Changes a graph with a stream of random updates, a mix of added and removed
+ * arcs and vertices and changed capacities, and finds the maximum flow after
+ * each batch of them by going on from the flow and by solving the graph
+ * again with pr-fifo. Checks each flow with verify.h and prints the updates
+ * per second and the times of both ways to query.
+ * Args:    - Path to the graph
+ *          - Number of updates
+ *          - Updates in each batch
+ *          - The file to print to
+ * Return:  0 on success, 1 if a flow was wrong */
+int dynamic_benchmark(char* path, int updates, int batch, FILE* fp);
+
+#endif
@@ -0,0 +1,339 @@
+#define _GNU_SOURCE
+#include "flowout.h"
+#include "list.h"
+#include "loaddimacs.h"
+#include "solver.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+// A file written a buffer at a time
+struct out {
+    int fd;
+    int failed;
+    size_t used;
+    char* buffer;
+};
+
+static int out_open(struct out* o, char* path) {
+    o->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    o->failed = o->fd < 0;
+    o->used = 0;
+    o->buffer = malloc(FLOWOUT_BUFFER);
+    assert(o->buffer != NULL);
+    return o->failed;
+}
+
+static void out_flush(struct out* o) {
+    size_t written = 0;
+    while (!o->failed && written < o->used) {
+        ssize_t w = write(o->fd, o->buffer + written, o->used - written);
+        if (w < 0 && errno != EINTR) {
+            o->failed = 1;
+        }
+        written += w < 0 ? 0 : w;
+    }
+    o->used = 0;
+}
+
+// Return: 0 if everything was written
+static int out_close(struct out* o) {
+    out_flush(o);
+    if (0 <= o->fd && close(o->fd) != 0) {
+        o->failed = 1;
+    }
+    free(o->buffer);
+    return o->failed;
+}
+
+// Makes sure the buffer has room for a line of at most 'size' bytes
+static inline void out_reserve(struct out* o, size_t size) {
+    if (FLOWOUT_BUFFER < o->used + size) {
+        out_flush(o);
+    }
+}
+
+static inline void put_char(struct out* o, char c) {
+    o->buffer[o->used++] = c;
+}
+
+// Two digits at a time, from the right
+static const char pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233"
+    "34353637383940414243444546474849505152535455565758596061626364656667"
+    "6869707172737475767778798081828384858687888990919293949596979899";
+
+static inline void put_number(struct out* o, long x) {
+    char digits[24];
+    int k = sizeof(digits);
+    unsigned long u = x < 0 ? -(unsigned long)x : (unsigned long)x;
+    while (100 <= u) {
+        int pair = u % 100;
+        u /= 100;
+        digits[--k] = pairs[2 * pair + 1];
+        digits[--k] = pairs[2 * pair];
+    }
+    if (10 <= u) {
+        digits[--k] = pairs[2 * u + 1];
+        digits[--k] = pairs[2 * u];
+    }
+    else {
+        digits[--k] = '0' + u;
+    }
+    if (x < 0) {
+        digits[--k] = '-';
+    }
+    memcpy(o->buffer + o->used, digits + k, sizeof(digits) - k);
+    o->used += sizeof(digits) - k;
+}
+
+// The longest a number is written
+#define NUMBER_BYTES 21
+
+int flow_write_dimacs(struct flow_arcs* a, long value, char* path) {
+    struct out o;
+    if (out_open(&o, path)) {
+        return out_close(&o);
+    }
+    out_reserve(&o, 3 + NUMBER_BYTES);
+    put_char(&o, 's');
+    put_char(&o, ' ');
+    put_number(&o, value);
+    put_char(&o, '\n');
+    for (int u = 0; u < a->n; u++) {
+        for (int k = a->first[u]; k < a->first[u + 1]; k++) {
+            out_reserve(&o, 5 + 3 * NUMBER_BYTES);
+            put_char(&o, 'f');
+            put_char(&o, ' ');
+            put_number(&o, u + 1);
+            put_char(&o, ' ');
+            put_number(&o, a->to[k] + 1);
+            put_char(&o, ' ');
+            put_number(&o, a->flow[k]);
+            put_char(&o, '\n');
+        }
+    }
+    return out_close(&o);
+}
+
+// Writes all of the vectors, going on after the writes that were cut short
+static int write_vectors(int fd, struct iovec* v, int count) {
+    while (0 < count) {
+        ssize_t w = writev(fd, v, count);
+        if (w < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 1;
+        }
+        while (0 < count && (size_t)w >= v->iov_len) {
+            w -= v->iov_len;
+            ++v;
+            --count;
+        }
+        if (0 < count) {
+            v->iov_base = (char*)v->iov_base + w;
+            v->iov_len -= w;
+        }
+    }
+    return 0;
+}
+
+int flow_write_binary(struct flow_arcs* a, long value, char* path) {
+    int n = a->n, m = a->m;
+    struct flow_dump_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FLOW_DUMP_MAGIC, sizeof(header.magic));
+    header.version = FLOW_DUMP_VERSION;
+    header.n = n;
+    header.m = m;
+    header.value = value;
+    struct iovec v[6] = {
+        {&header, sizeof(header)},
+        {a->first, (n + 1) * sizeof(int)},
+        {a->to, m * sizeof(int)},
+        {a->flow, m * sizeof(int)},
+        {a->supplied, n * sizeof(int)},
+        {a->absorbed, n * sizeof(int)},
+    };
+
+    int failed = 1;
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (0 <= fd) {
+        failed = write_vectors(fd, v, 6);
+        failed |= close(fd) != 0;
+    }
+    return failed;
+}
+
+int decomposition_write(struct flow_decomposition* d, char* path) {
+    struct out o;
+    if (out_open(&o, path)) {
+        return out_close(&o);
+    }
+    out_reserve(&o, 3 + NUMBER_BYTES);
+    put_char(&o, 's');
+    put_char(&o, ' ');
+    put_number(&o, d->value);
+    put_char(&o, '\n');
+    for (int i = 0; i < d->count; i++) {
+        out_reserve(&o, 7 + NUMBER_BYTES);
+        memcpy(o.buffer + o.used, d->cycle[i] ? "cycle " : "path ",
+               d->cycle[i] ? 6 : 5);
+        o.used += d->cycle[i] ? 6 : 5;
+        put_number(&o, d->amount[i]);
+        for (long k = d->first[i]; k < d->first[i + 1]; k++) {
+            out_reserve(&o, 2 + NUMBER_BYTES);
+            put_char(&o, ' ');
+            put_number(&o, d->vertices[k] + 1);
+        }
+        put_char(&o, '\n');
+    }
+    return out_close(&o);
+}
+
+// The flow lines with fprintf, what flow_write_dimacs is compared with
+static int write_with_stdio(struct graph* g, long value, char* path) {
+    FILE* fp = fopen(path, "w");
+    if (fp == NULL) {
+        return 1;
+    }
+    fprintf(fp, "s %ld\n", value);
+    for (int u = 0; u < g->size; u++) {
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            if (e->original) {
+                fprintf(fp, "f %d %d %d\n", u + 1, e->to + 1, e->flow);
+            }
+        }
+    }
+    return fclose(fp) != 0;
+}
+
+// Return: The size of a file, -1 if it cannot be read
+static long file_size(char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? st.st_size : -1;
+}
+
+// Return: 1 if the two files have the same bytes
+static int same_files(char* a, char* b) {
+    FILE* fa = fopen(a, "r");
+    FILE* fb = fopen(b, "r");
+    int same = fa && fb;
+    char* ba = malloc(1 << 16);
+    char* bb = malloc(1 << 16);
+    assert(ba && bb);
+    while (same) {
+        size_t ra = fread(ba, 1, 1 << 16, fa);
+        size_t rb = fread(bb, 1, 1 << 16, fb);
+        same = ra == rb && memcmp(ba, bb, ra) == 0;
+        if (ra == 0) {
+            break;
+        }
+    }
+    if (fa) {
+        fclose(fa);
+    }
+    if (fb) {
+        fclose(fb);
+    }
+    free(ba);
+    free(bb);
+    return same;
+}
+
+static void print_time(FILE* fp, char* what, double seconds, long bytes,
+                       double solve) {
+    fprintf(fp, "output: %-22s %9.3f ms %8.1f MB/s %7.1f%% of the solve\n",
+            what, 1e3 * seconds, bytes / 1e6 / seconds,
+            100 * seconds / solve);
+}
+
+int flow_output_benchmark(char* path, char* algorithm, FILE* fp) {
+    struct solver* solver = solver_find(algorithm);
+    if (!solver) {
+        fprintf(stderr, "Unknown algorithm: %s\n", algorithm);
+        return 1;
+    }
+    struct graph* g = read_dimacs_file(path);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    long value = solver->solve(g);
+    double solve = seconds_since(&start);
+    fprintf(fp, "output: %s solved in %.3f ms, maximum flow %ld\n",
+            solver->name, 1e3 * solve, value);
+
+    char* files[4];
+    char* suffixes[4] = {"_flow_stdio", "_flow", "_flow.bin", "_paths"};
+    for (int i = 0; i < 4; i++) {
+        files[i] = malloc(strlen(path) + strlen(suffixes[i]) + 1);
+        assert(files[i] != NULL);
+        strcpy(files[i], path);
+        strcat(files[i], suffixes[i]);
+    }
+
+    int failed = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    failed |= write_with_stdio(g, value, files[0]);
+    print_time(fp, "flow lines, fprintf", seconds_since(&start),
+               file_size(files[0]), solve);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct flow_arcs* a = flow_arcs_gather(g);
+    double gather = seconds_since(&start);
+    print_time(fp, "gathering the arcs", gather,
+               (3L * a->m + 3L * a->n) * sizeof(int), solve);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    failed |= flow_write_dimacs(a, value, files[1]);
+    print_time(fp, "flow lines", seconds_since(&start), file_size(files[1]),
+               solve);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    failed |= flow_write_binary(a, value, files[2]);
+    print_time(fp, "binary dump", seconds_since(&start), file_size(files[2]),
+               solve);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct flow_decomposition* d = flow_decompose(a);
+    double decompose = seconds_since(&start);
+    fprintf(fp, "output: %-22s %9.3f ms %8d paths and cycles over %ld arcs, "
+            "%.1f%% of the solve\n", "decomposition", 1e3 * decompose,
+            d->count, d->steps, 100 * decompose / solve);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    failed |= decomposition_write(d, files[3]);
+    print_time(fp, "paths and cycles", seconds_since(&start),
+               file_size(files[3]), solve);
+
+    if (!same_files(files[0], files[1])) {
+        fprintf(fp, "output: the flow lines differ from fprintf's\n");
+        failed = 1;
+    }
+    if (d->residue) {
+        fprintf(fp, "output: the flow is not conserved at vertex %d, %ld of "
+                "it is in no path\n", d->unbalanced + 1, d->residue);
+        failed = 1;
+    }
+    if (d->value != value) {
+        fprintf(fp, "output: the paths carry %ld, not %ld\n", d->value, value);
+        failed = 1;
+    }
+    decomposition_free(d);
+    flow_arcs_free(a);
+    for (int i = 0; i < 4; i++) {
+        unlink(files[i]);
+        free(files[i]);
+    }
+    graph_free(g);
+    return failed;
+}
@@ -0,0 +1,74 @@
+#ifndef FLOWOUT_H
+#define FLOWOUT_H
+
+#include "graph.h"
+#include "decompose.h"
+
+#include <stdio.h>
+
+/* Writing a flow out for the programs that use it.
+ *
+ * The writers take the arcs as flow_arcs_gather of decompose.h gives them,
+ * so the adjacency lists are gone through once for all of them.
+ *
+ * flow_write_dimacs writes the flow like the DIMACS challenge's solvers do,
+ * an "s VALUE" line and an "f u v x" line for each arc in the order of the
+ * adjacency lists, with the vertices counted from 1. The numbers are
+ * formatted by hand into a buffer of FLOWOUT_BUFFER bytes that is given to
+ * write() when full, as printf would parse its format for each of them.
+ *
+ * flow_write_binary writes a struct flow_dump_header and then the arrays of
+ * struct flow_arcs: first[n + 1], to[m], flow[m], supplied[n] and
+ * absorbed[n], all ints in the byte order of the machine. They are written
+ * with one writev() from where they are, without copying them into a
+ * buffer.
+ *
+ * decomposition_write writes an "s VALUE" line and a line for each path,
+ * "path AMOUNT v1 v2 ... vk", and each cycle, "cycle AMOUNT v1 v2 ... vk",
+ * whose last vertex has an arc back to v1. */
+
+#define FLOWOUT_BUFFER (1 << 20)
+
+#define FLOW_DUMP_MAGIC "MFLW"
+#define FLOW_DUMP_VERSION 1
+
+struct flow_dump_header {
+    char magic[4];
+    int version;
+    int n;
+    int m;                  // Arcs of the graph, without the reverse arcs
+    long value;
+};
+
+/* Writes a flow as DIMACS flow lines
+ * Args:    - Pointer to the arcs with the flow
+ *          - The value of the flow
+ *          - Path of the file to write
+ * Return:  0 on success, 1 if the file could not be written */
+int flow_write_dimacs(struct flow_arcs* a, long value, char* path);
+
+/* Writes a flow as a binary dump
+ * Args:    - Pointer to the arcs with the flow
+ *          - The value of the flow
+ *          - Path of the file to write
+ * Return:  0 on success, 1 if the file could not be written */
+int flow_write_binary(struct flow_arcs* a, long value, char* path);
+
+/* Writes the paths and cycles of a decomposition
+ * Args:    - Pointer to the decomposition
+ *          - Path of the file to write
+ * Return:  0 on success, 1 if the file could not be written */
+int decomposition_write(struct flow_decomposition* d, char* path);
+
+/* Solves a graph and times writing its flow with fprintf from the lists,
+ * gathering the arcs, each of the writers above and decomposing the flow,
+ * next to the solve. The files are written next to the graph and removed
+ * after.
+ * Args:    - Path to the graph
+ *          - The name of the algorithm, see solver.h
+ *          - The file to print to
+ * Return:  0 on success, 1 if the algorithm is unknown, a file could not be
+ *          written or the outputs do not agree */
+int flow_output_benchmark(char* path, char* algorithm, FILE* fp);
+
+#endif
@@ -0,0 +1,93 @@
+#!/usr/bin/python3
+# Generates graphs with long augmenting paths in DIMACS format, where the
+# blocking flow algorithms differ most. The graph is placed in graphs/.
+#
+# python3 structured.py <layered, chain, funnel or terminals> <n> [<max capacity>]
+#                        [<seed>]
+#
+# - layered: the vertices between the source and the sink are in layers of
+#   about sqrt(n) vertices. The source has an arc to every vertex in the first
+#   layer, every vertex in the last layer to the sink and every other vertex
+#   has arcs to 3 random vertices in the next layer.
+# - chain: the vertices between the source and the sink are on 4 chains from
+#   the source to the sink. A third of the vertices also have an arc to the
+#   next vertex of another chain.
+# - funnel: half of the vertices between the source and the sink have an arc
+#   from the source and one into a single chain through the other half to the
+#   sink. Every augmenting path goes through the whole chain. The arcs from
+#   the source have at most (2^31 - 1) / (n / 2) capacity, so that no excess
+#   overflows, and the chain arcs their total capacity.
+# - terminals: every vertex has arcs to 3 random vertices, and there are
+#   n / 10 sources and n / 10 sinks, at least 2 of each, half of them without
+#   a limit and half with a supply or demand of up to max capacity. Flow that
+#   can not reach a sink may go back to any source.
+# The capacities are random integers between 1 and max capacity, by default
+# 1000000. The chain arcs have at least half of it.
+import sys, os
+import random
+
+kind = sys.argv[1]
+n = int(sys.argv[2])
+max_capacity = int(sys.argv[3]) if len(sys.argv) > 3 else 1000000
+seed = int(sys.argv[4]) if len(sys.argv) > 4 else 1
+random.seed(seed)
+
+s, t = 1, n
+inner = list(range(2, n))
+arcs = []
+# vertex, 's' or 't', supply or demand or None for no limit
+terminals = [(s, 's', None), (t, 't', None)]
+
+def capacity(least=1):
+    return random.randint(least, max_capacity)
+
+if kind == "layered":
+    width = max(1, int(len(inner) ** 0.5))
+    layers = [inner[i:i + width] for i in range(0, len(inner), width)]
+    arcs += [(s, v, capacity()) for v in layers[0]]
+    arcs += [(v, t, capacity()) for v in layers[-1]]
+    for layer, next_layer in zip(layers, layers[1:]):
+        for u in layer:
+            for v in random.sample(next_layer, min(3, len(next_layer))):
+                arcs.append((u, v, capacity()))
+elif kind == "chain":
+    chains = [inner[i::4] for i in range(4)]
+    for chain in chains:
+        path = [s] + chain + [t]
+        arcs += [(u, v, capacity(max_capacity // 2))
+                 for u, v in zip(path, path[1:])]
+    for i, chain in enumerate(chains):
+        for j, u in enumerate(chain):
+            other = chains[random.choice([k for k in range(4) if k != i])]
+            if random.random() < 1 / 3 and j + 1 < len(other):
+                arcs.append((u, other[j + 1], capacity()))
+elif kind == "funnel":
+    fan, chain = inner[:len(inner) // 2], inner[len(inner) // 2:]
+    most = min(max_capacity, (2 ** 31 - 1) // len(fan))
+    arcs += [(s, v, random.randint(1, most)) for v in fan]
+    arcs += [(v, chain[0], capacity()) for v in fan]
+    total = sum(c for _, _, c in arcs[:len(fan)])
+    path = chain + [t]
+    arcs += [(u, v, total) for u, v in zip(path, path[1:])]
+elif kind == "terminals":
+    for u in range(1, n + 1):
+        for v in random.sample([v for v in range(1, n + 1) if v != u], 3):
+            arcs.append((u, v, capacity()))
+    k = max(2, n // 10)
+    chosen = random.sample(range(1, n + 1), 2 * k)
+    terminals = []
+    for i, v in enumerate(chosen):
+        amount = capacity() if i % 2 else None
+        terminals.append((v, 's' if i < k else 't', amount))
+else:
+    sys.exit("kind should be layered, chain, funnel or terminals")
+
+name = "V%d-%s_E%d_%d" % (n, kind, len(arcs), seed)
+with open(os.path.join("graphs", name), "w") as f:
+    f.write("p max %d %d\n" % (n, len(arcs)))
+    for v, which, amount in terminals:
+        f.write("n %d %s%s\n" % (v, which, "" if amount is None
+                                 else " %d" % amount))
+    for u, v, c in arcs:
+        f.write("a %d %d %d\n" % (u, v, c))
+print(os.path.join("graphs", name))
@@ -2,10 +2,14 @@
 #include "container.h"
 #include "list.h"
 #include "edge.h"
+#include "trace.h"
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 #include <assert.h>
+#include <limits.h>
 
 struct graph* graph_init(int size) {
     assert(0 < size);
@@ -17,9 +21,17 @@ struct graph* graph_init(int size) {
     g->vertices  = malloc(sizeof(int) * size);
     //g->parents   = malloc(sizeof(struct edge) * size - 1);
     g->adj_array = malloc(sizeof(struct list*) * size);
+    g->supply    = calloc(size, sizeof(int));
+    g->demand    = calloc(size, sizeof(int));
+    g->supplied  = calloc(size, sizeof(int));
+    g->absorbed  = calloc(size, sizeof(int));
     assert(g->vertices  != NULL);
     //assert(g->parents   != NULL);
     assert(g->adj_array != NULL);
+    assert(g->supply    != NULL);
+    assert(g->demand    != NULL);
+    assert(g->supplied  != NULL);
+    assert(g->absorbed  != NULL);
 
     for (int i = 0; i < size; i++) {
         g->vertices[i] = i;
@@ -27,11 +39,18 @@ struct graph* graph_init(int size) {
         g->adj_array[i] = list_init(); // List pointer in each entry
     }
 
+    // Default terminals: s = 0 and t = size - 1
+    if (1 < size) {
+        graph_add_source(g, 0, TERMINAL_UNBOUNDED);
+        graph_add_sink(g, size - 1, TERMINAL_UNBOUNDED);
+    }
+
     return g;
 }
 
 void graph_free(struct graph* g) {
     assert(g != NULL);
+    TRACE_BEGIN("teardown");
 
     for (int i = 0; i < g->size; i++) {
         // Both backward and forward edges are placed in the adjlists, hence it
@@ -41,9 +60,98 @@ void graph_free(struct graph* g) {
     }
 
 //    free(g->parents);
+    free(g->supply);
+    free(g->demand);
+    free(g->supplied);
+    free(g->absorbed);
     free(g->vertices);
     free(g->adj_array);
     free(g);
+    TRACE_END("teardown");
+}
+
+// Orders edges by their address, so they can be looked up with bsearch
+static int compare_edge_pointers(const void* a, const void* b) {
+    uintptr_t x = (uintptr_t)*(struct edge* const*)a;
+    uintptr_t y = (uintptr_t)*(struct edge* const*)b;
+    return (x > y) - (x < y);
+}
+
+// Find the copy of an edge. Reverse edges are found through their original.
+static struct edge* find_copy(struct edge* e, struct edge** old,
+                              struct edge** new, int m) {
+    struct edge* original = e->original ? e : e->reverse_edge;
+    struct edge** found = bsearch(&original, old, m, sizeof(struct edge*),
+                                  compare_edge_pointers);
+    assert(found != NULL);
+    struct edge* copy = new[found - old];
+    return e->original ? copy : copy->reverse_edge;
+}
+
+struct graph* graph_copy(struct graph* g) {
+    struct graph* c = graph_init(g->size);
+    int n = g->size, m = 0, max_degree = 0;
+
+    memcpy(c->supply,   g->supply,   n * sizeof(int));
+    memcpy(c->demand,   g->demand,   n * sizeof(int));
+    memcpy(c->supplied, g->supplied, n * sizeof(int));
+    memcpy(c->absorbed, g->absorbed, n * sizeof(int));
+
+    // Collect the original edges and sort them by address
+    for (int u = 0; u < n; u++) {
+        m += g->adj_array[u]->size;
+        if (max_degree < g->adj_array[u]->size) {
+            max_degree = g->adj_array[u]->size;
+        }
+    }
+    m /= 2;
+    struct edge** old = malloc((m + 1) * sizeof(struct edge*));
+    struct edge** new = malloc((m + 1) * sizeof(struct edge*));
+    struct edge** adj = malloc((max_degree + 1) * sizeof(struct edge*));
+    assert(old != NULL && new != NULL && adj != NULL);
+
+    int k = 0;
+    for (int u = 0; u < n; u++) {
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            if (((struct edge*)cur->this)->original) {
+                old[k++] = cur->this;
+            }
+        }
+    }
+    assert(k == m);
+    qsort(old, m, sizeof(struct edge*), compare_edge_pointers);
+
+    for (int i = 0; i < m; i++) {
+        new[i] = edges_init(old[i]->from, old[i]->to, old[i]->capacity);
+        new[i]->flow = old[i]->flow;
+    }
+
+    // Build each adjacency list back to front, so the order is kept
+    for (int u = 0; u < n; u++) {
+        int degree = 0;
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            adj[degree++] = find_copy(cur->this, old, new, m);
+        }
+        while (degree) {
+            int success = list_insert_first(c->adj_array[u], adj[--degree]);
+            assert(success == 0);
+        }
+    }
+
+    free(old);
+    free(new);
+    free(adj);
+    return c;
+}
+
+void graph_reset_flow(struct graph* g) {
+    for (int u = 0; u < g->size; u++) {
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            ((struct edge*)cur->this)->flow = 0;
+        }
+        g->supplied[u] = 0;
+        g->absorbed[u] = 0;
+    }
 }
 
 void graph_add_edges(struct graph* g, int from, int to, int capacity) {
@@ -67,6 +175,151 @@ void graph_add_edges(struct graph* g, int from, int to, int capacity) {
     assert(success == 0);
 }
 
+void graph_clear_terminals(struct graph* g) {
+    for (int i = 0; i < g->size; i++) {
+        g->supply[i] = 0;
+        g->demand[i] = 0;
+    }
+}
+
+void graph_add_source(struct graph* g, int v, int supply) {
+    assert(0 <= v && v < g->size);
+    assert(0 < supply);
+    // A vertex being both source and sink would make a path without edges
+    assert(g->demand[v] == 0);
+    g->supply[v] = supply;
+}
+
+void graph_add_sink(struct graph* g, int v, int demand) {
+    assert(0 <= v && v < g->size);
+    assert(0 < demand);
+    assert(g->supply[v] == 0);
+    g->demand[v] = demand;
+}
+
+// An unbounded source can get flow back from the rest of the graph, which
+// makes its net supply negative, so it is not subtracted for those
+int graph_supply_left(struct graph* g, int v) {
+    if (g->supply[v] == TERMINAL_UNBOUNDED) {
+        return TERMINAL_UNBOUNDED;
+    }
+    return g->supply[v] - g->supplied[v];
+}
+
+int graph_demand_left(struct graph* g, int v) {
+    if (g->demand[v] == TERMINAL_UNBOUNDED) {
+        return TERMINAL_UNBOUNDED;
+    }
+    return g->demand[v] - g->absorbed[v];
+}
+
+// The least flow on stack[from] .. stack[to - 1]
+static int least_flow(struct edge** stack, int from, int to) {
+    int x = INT_MAX;
+    for (int i = from; i < to; i++) {
+        x = stack[i]->flow < x ? stack[i]->flow : x;
+    }
+    return x;
+}
+
+// Takes 'amount' off stack[from] .. stack[to - 1]
+// Return: The first of them without flow after, 'to' if none
+static int take_flow(struct edge** stack, int from, int to, int amount) {
+    int emptied = to;
+    for (int i = to - 1; from <= i; i--) {
+        stack[i]->flow -= amount;
+        emptied = stack[i]->flow == 0 ? i : emptied;
+    }
+    return emptied;
+}
+
+// Walks backwards from each source s that gets more than it sends, over the
+// arcs with flow, until a vertex with net supply is reached, and takes the
+// least flow on the walk off it, like the walks of decompose.c. Flow is only
+// taken off, so each vertex keeps its current arc from one walk and one
+// source to the next and every arc is passed over once. A walk that runs into
+// itself has found a cycle of flow, which is taken off too. The vertices a
+// walk reaches get flow from outside them while s gets more than it sends, so
+// it always ends at a vertex with net supply.
+void graph_cancel_surplus(struct graph* g) {
+    int n = g->size;
+    struct element** current = NULL;
+    struct edge** stack = NULL;     // stack[i] goes from path[i + 1] to path[i]
+    int* path = NULL;
+    int* pos = NULL;                // The place of a vertex on the walk, or -1
+
+    for (int s = 0; s < n; s++) {
+        if (0 <= g->supplied[s]) {
+            continue;
+        }
+        if (!current) {
+            current = malloc(n * sizeof(struct element*));
+            stack = malloc(n * sizeof(struct edge*));
+            path = malloc(n * sizeof(int));
+            pos = malloc(n * sizeof(int));
+            assert(current && stack && path && pos);
+            for (int v = 0; v < n; v++) {
+                current[v] = g->adj_array[v]->head;
+                pos[v] = -1;
+            }
+        }
+
+        int len = 0;
+        path[0] = s;
+        pos[s] = 0;
+        while (g->supplied[s] < 0) {
+            int u = path[len];
+            if (0 < len && 0 < g->supplied[u]) {
+                int x = least_flow(stack, 0, len);
+                x = g->supplied[u] < x ? g->supplied[u] : x;
+                x = -g->supplied[s] < x ? -g->supplied[s] : x;
+                g->supplied[u] -= x;
+                g->supplied[s] += x;
+                int k = take_flow(stack, 0, len, x);
+                for (int i = k + 1; i <= len; i++) {
+                    pos[path[i]] = -1;
+                }
+                len = k < len ? k : len;
+                continue;
+            }
+
+            // The reverse edges in u's list are the arcs into u
+            struct edge* e = NULL;
+            while (current[u]) {
+                e = ((struct edge*)current[u]->this)->reverse_edge;
+                if (e->original && 0 < e->flow) {
+                    break;
+                }
+                current[u] = current[u]->next;
+            }
+            assert(current[u] != NULL);
+            stack[len] = e;
+            int v = e->from;
+            if (pos[v] == -1) {
+                path[++len] = v;
+                pos[v] = len;
+                continue;
+            }
+            // The walk ran into itself
+            int i = pos[v];
+            int k = take_flow(stack, i, len + 1,
+                              least_flow(stack, i, len + 1));
+            for (int j = k + 1; j <= len; j++) {
+                pos[path[j]] = -1;
+            }
+            len = k < len ? k : len;
+        }
+        for (int i = 0; i <= len; i++) {
+            pos[path[i]] = -1;
+        }
+    }
+
+    free(current);
+    free(stack);
+    free(path);
+    free(pos);
+}
+
 void graph_print(struct graph* g) {
     // Iterating through adjacency array
     for (int i = 0; i < g->size; i++) {
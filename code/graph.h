@@ -3,17 +3,31 @@
 
 #include "edge.h"
 
+#include <limits.h>
+
+/* Supply or demand of a terminal that has no limit on how much flow it can
+ * send or receive */
+#define TERMINAL_UNBOUNDED INT_MAX
+
 /* A graph is an array of adjacency lists */
-// The source, s = 0
-// The sink,   t = size - 1
+// By default the source is s = 0 and the sink is t = size - 1.
 // 'parents' is for running searches on the graph and finding vertices' parents
 // 'vertices' is to be able to queue pointers to integers when running maxflow
 // algorithms on the graph
+// The terminals are given by 'supply' and 'demand'. A vertex v is a source if
+// supply[v] > 0 and a sink if demand[v] > 0. They are the capacities of virtual
+// arcs from a super source to v and from v to a super sink, which are never put
+// in the adjacency lists. The flow on the virtual arcs is kept in 'supplied' and
+// 'absorbed', just like the flow on real arcs is kept in the edges.
 struct graph {
     int size;
     int* vertices;
 //    struct edge** parents;
     struct list** adj_array;
+    int* supply;
+    int* demand;
+    int* supplied;
+    int* absorbed;
 };
 
 /* Initializes a graph with n = |V| = 'size' vertices
@@ -21,6 +35,17 @@ struct graph {
  * Return:  A pointer to the graph */
 struct graph* graph_init(int size);
 
+/* Makes a copy of the graph with the same adjacency lists in the same order,
+ * the same terminals and the same flow
+ * Args:    - Pointer to the graph
+ * Return:  A pointer to the copy */
+struct graph* graph_copy(struct graph* g);
+
+/* Sets the flow on all edges, also the virtual terminal arcs, to 0
+ * Args:    - Pointer to the graph
+ * Return:  Nothing */
+void graph_reset_flow(struct graph* g);
+
 /* Add a forward- and backward edge to the graph
  * Args:    - Pointer to the graph
  *          - From vertex
@@ -29,6 +54,49 @@ struct graph* graph_init(int size);
  * Return:  Nothing */
 void graph_add_edges(struct graph* g, int from, int to, int c);
 
+/* Removes all sources and sinks from the graph, also the default ones
+ * Args:    - Pointer to the graph
+ * Return:  Nothing */
+void graph_clear_terminals(struct graph* g);
+
+/* Makes a vertex a source
+ * Args:    - Pointer to the graph
+ *          - The vertex
+ *          - How much flow it can send. TERMINAL_UNBOUNDED for no limit
+ * Return:  Nothing */
+void graph_add_source(struct graph* g, int v, int supply);
+
+/* Makes a vertex a sink
+ * Args:    - Pointer to the graph
+ *          - The vertex
+ *          - How much flow it can receive. TERMINAL_UNBOUNDED for no limit
+ * Return:  Nothing */
+void graph_add_sink(struct graph* g, int v, int demand);
+
+/* Residual capacity of the virtual arc from the super source to v
+ * Args:    - Pointer to the graph
+ *          - The vertex
+ * Return:  How much more flow v can send as a source. 0 if v is no source */
+int graph_supply_left(struct graph* g, int v);
+
+/* Residual capacity of the virtual arc from v to the super sink
+ * Args:    - Pointer to the graph
+ *          - The vertex
+ * Return:  How much more flow v can receive as a sink. 0 if v is no sink */
+int graph_demand_left(struct graph* g, int v);
+
+/* Takes back the flow that unbounded sources got beyond what they sent out,
+ * along flow paths to the sources that supplied it, so no source ends with a
+ * negative net supply. Push-relabel lets flow that can not reach a sink go
+ * back to any unbounded source, not only the one it came from. The flow into
+ * the sinks is not changed. The walks back along the flow keep their place
+ * in each vertex's list from one source to the next, so every arc is passed
+ * over once.
+ * Args:    - Pointer to the graph, with a flow that keeps conservation at
+ *            every vertex but the unbounded sources
+ * Return:  Nothing */
+void graph_cancel_surplus(struct graph* g);
+
 /* Prints all the elements in the graph one entry in the adjacency array at the
  * time - one adjacency list at the time
  * Args:    - Pointer to the graph
@@ -0,0 +1,214 @@
+#include "linkcut.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+static int is_splay_root(struct linkcut* t, int v) {
+    int p = t->parent[v];
+    return p == -1 || (t->left[p] != v && t->right[p] != v);
+}
+
+static void apply_add(struct linkcut* t, int v, long amount) {
+    if (v == -1) {
+        return;
+    }
+    // The roots' infinite costs stay infinite
+    if (t->cost[v] != LINKCUT_INFINITY) {
+        t->cost[v] += amount;
+    }
+    if (t->min[v] != LINKCUT_INFINITY) {
+        t->min[v] += amount;
+    }
+    t->add[v] += amount;
+}
+
+// Gives v's pending addition to its children
+static void push_down(struct linkcut* t, int v) {
+    if (t->add[v]) {
+        apply_add(t, t->left[v], t->add[v]);
+        apply_add(t, t->right[v], t->add[v]);
+        t->add[v] = 0;
+    }
+}
+
+static void pull_up(struct linkcut* t, int v) {
+    long min = t->cost[v];
+    if (t->left[v] != -1 && t->min[t->left[v]] < min) {
+        min = t->min[t->left[v]];
+    }
+    if (t->right[v] != -1 && t->min[t->right[v]] < min) {
+        min = t->min[t->right[v]];
+    }
+    t->min[v] = min;
+}
+
+static void rotate(struct linkcut* t, int v) {
+    int p = t->parent[v], g = t->parent[p];
+
+    if (!is_splay_root(t, p)) {
+        if (t->left[g] == p) {
+            t->left[g] = v;
+        }
+        else {
+            t->right[g] = v;
+        }
+    }
+    t->parent[v] = g;
+
+    if (t->left[p] == v) {
+        t->left[p] = t->right[v];
+        if (t->right[v] != -1) {
+            t->parent[t->right[v]] = p;
+        }
+        t->right[v] = p;
+    }
+    else {
+        t->right[p] = t->left[v];
+        if (t->left[v] != -1) {
+            t->parent[t->left[v]] = p;
+        }
+        t->left[v] = p;
+    }
+    t->parent[p] = v;
+    pull_up(t, p);
+    pull_up(t, v);
+}
+
+// Gives the pending additions down from the splay root to v
+static void push_path(struct linkcut* t, int v) {
+    int top = 0;
+    t->stack[top++] = v;
+    while (!is_splay_root(t, v)) {
+        v = t->parent[v];
+        t->stack[top++] = v;
+    }
+    while (top) {
+        push_down(t, t->stack[--top]);
+    }
+}
+
+static void splay(struct linkcut* t, int v) {
+    push_path(t, v);
+    while (!is_splay_root(t, v)) {
+        int p = t->parent[v];
+        if (!is_splay_root(t, p)) {
+            int g = t->parent[p];
+            // Zig-zig rotates the parent first, zig-zag v twice
+            if ((t->left[g] == p) == (t->left[p] == v)) {
+                rotate(t, p);
+            }
+            else {
+                rotate(t, v);
+            }
+        }
+        rotate(t, v);
+    }
+}
+
+// Makes the path from the root to v one splay tree with v at its top and
+// nothing deeper than v
+static void access(struct linkcut* t, int v) {
+    int last = -1;
+    for (int y = v; y != -1; y = t->parent[y]) {
+        splay(t, y);
+        t->right[y] = last;
+        pull_up(t, y);
+        last = y;
+    }
+    splay(t, v);
+}
+
+struct linkcut* linkcut_init(int size) {
+    struct linkcut* t = malloc(sizeof(struct linkcut));
+    assert(t != NULL);
+    t->size   = size;
+    t->parent = malloc(size * sizeof(int));
+    t->left   = malloc(size * sizeof(int));
+    t->right  = malloc(size * sizeof(int));
+    t->cost   = malloc(size * sizeof(long));
+    t->min    = malloc(size * sizeof(long));
+    t->add    = malloc(size * sizeof(long));
+    t->stack  = malloc(size * sizeof(int));
+    assert(t->parent && t->left && t->right && t->cost && t->min && t->add &&
+           t->stack);
+
+    for (int v = 0; v < size; v++) {
+        t->parent[v] = t->left[v] = t->right[v] = -1;
+        t->cost[v] = t->min[v] = LINKCUT_INFINITY;
+        t->add[v] = 0;
+    }
+    return t;
+}
+
+int linkcut_root(struct linkcut* t, int v) {
+    access(t, v);
+    int r = v;
+    while (t->left[r] != -1) {
+        push_down(t, r);
+        r = t->left[r];
+    }
+    splay(t, r);
+    return r;
+}
+
+void linkcut_link(struct linkcut* t, int v, int w, long cost) {
+    access(t, v);
+    assert(t->left[v] == -1);
+    t->cost[v] = cost;
+    pull_up(t, v);
+    t->parent[v] = w;
+}
+
+long linkcut_cut(struct linkcut* t, int v) {
+    access(t, v);
+    assert(t->left[v] != -1);
+    long cost = t->cost[v];
+    t->parent[t->left[v]] = -1;
+    t->left[v] = -1;
+    t->cost[v] = LINKCUT_INFINITY;
+    pull_up(t, v);
+    return cost;
+}
+
+long linkcut_cost(struct linkcut* t, int v) {
+    access(t, v);
+    return t->cost[v];
+}
+
+int linkcut_path_min(struct linkcut* t, int v) {
+    access(t, v);
+    long min = t->min[v];
+    int u = v;
+
+    // The root of the path is leftmost, so search left first
+    while (1) {
+        push_down(t, u);
+        if (t->left[u] != -1 && t->min[t->left[u]] == min) {
+            u = t->left[u];
+        }
+        else if (t->cost[u] == min) {
+            break;
+        }
+        else {
+            u = t->right[u];
+        }
+    }
+    splay(t, u);
+    return u;
+}
+
+void linkcut_path_add(struct linkcut* t, int v, long amount) {
+    access(t, v);
+    apply_add(t, v, amount);
+}
+
+void linkcut_free(struct linkcut* t) {
+    free(t->parent);
+    free(t->left);
+    free(t->right);
+    free(t->cost);
+    free(t->min);
+    free(t->add);
+    free(t->stack);
+    free(t);
+}
@@ -0,0 +1,71 @@
+#ifndef LINKCUT_H
+#define LINKCUT_H
+
+/* Sleator-Tarjan dynamic trees as link-cut trees of splay trees. The forest
+ * has the nodes 0 .. size - 1, each with a cost that is the cost of the arc to
+ * its parent. All operations take O(log n) amortized time.
+ * A root has cost LINKCUT_INFINITY. */
+#define LINKCUT_INFINITY (1L << 60)
+
+struct linkcut {
+    int size;
+    int* parent;            // Splay tree parent, or path parent at a root
+    int* left;
+    int* right;
+    long* cost;
+    long* min;              // Least cost in the splay subtree
+    long* add;              // Cost to add to the whole splay subtree
+    int* stack;
+};
+
+/* Creates a forest of single nodes
+ * Args:    - Number of nodes
+ * Return:  Pointer to the forest */
+struct linkcut* linkcut_init(int size);
+
+/* Find the root of the tree a node is in
+ * Args:    - Pointer to the forest
+ *          - The node
+ * Return:  The root */
+int linkcut_root(struct linkcut* t, int v);
+
+/* Makes root v a child of w through an arc with the given cost
+ * Args:    - Pointer to the forest
+ *          - The node v, a root
+ *          - The node w, in another tree
+ *          - The cost of the arc from v to w
+ * Return:  Nothing */
+void linkcut_link(struct linkcut* t, int v, int w, long cost);
+
+/* Removes the arc from v to its parent. v becomes a root.
+ * Args:    - Pointer to the forest
+ *          - The node v, not a root
+ * Return:  The cost the arc had */
+long linkcut_cut(struct linkcut* t, int v);
+
+/* The cost of the arc from v to its parent
+ * Args:    - Pointer to the forest
+ *          - The node
+ * Return:  The cost, LINKCUT_INFINITY for a root */
+long linkcut_cost(struct linkcut* t, int v);
+
+/* Finds the arc of least cost on the path from v to its root
+ * Args:    - Pointer to the forest
+ *          - The node v
+ * Return:  The node whose arc to its parent has the least cost, the one
+ *          closest to the root if there are more. The root if v is a root. */
+int linkcut_path_min(struct linkcut* t, int v);
+
+/* Adds to the costs of all arcs on the path from v to its root
+ * Args:    - Pointer to the forest
+ *          - The node v
+ *          - The amount to add, can be negative
+ * Return:  Nothing */
+void linkcut_path_add(struct linkcut* t, int v, long amount);
+
+/* Frees the forest
+ * Args:    - Pointer to the forest
+ * Return:  Nothing */
+void linkcut_free(struct linkcut* t);
+
+#endif
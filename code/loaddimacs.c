@@ -1,10 +1,38 @@
 #define _GNU_SOURCE
 #include "loaddimacs.h"
 #include "graph.h"
+#include "trace.h"
+#include "loadparallel.h"
+#include "dobfs.h"
 
 #include "stdio.h"
 #include "stdlib.h"
 #include "assert.h"
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+// The files are parsed by hand where sscanf would be most of the time it
+// takes to read them
+int read_int(char** s, int* value) {
+    char* c = *s;
+    while (*c == ' ' || *c == '\t') {
+        ++c;
+    }
+    int negative = *c == '-';
+    c += negative;
+    if (*c < '0' || '9' < *c) {
+        return 0;
+    }
+    long v = 0;
+    while ('0' <= *c && *c <= '9') {
+        v = 10 * v + (*c++ - '0');
+    }
+    *value = (int)(negative ? -v : v);
+    *s = c;
+    return 1;
+}
 
 struct graph* read_and_build_graph(char* line) {
     int V, E, offset = 5;
@@ -20,6 +48,27 @@ void read_and_add_edge(struct graph* g, char* line) {
     graph_add_edges(g, from - 1, to - 1, capacity);
 }
 
+void read_and_set_terminal(struct graph* g, char* line) {
+    int id, amount, offset = 2;
+    char c[1];
+    int read = sscanf(line + offset, "%d %c %d", &id, c, &amount);
+    assert(2 <= read);
+
+    if (read == 2) {
+        amount = TERMINAL_UNBOUNDED;
+    }
+    // No supply or demand, as a parametric terminal can have at lambda = 0
+    if (amount == 0) {
+        return;
+    }
+
+    if (*c == 's') {
+        graph_add_source(g, id - 1, amount);
+    } else {
+        graph_add_sink(g, id - 1, amount);
+    }
+}
+
 // Use this if running on other peoples DIMACS files
 // The difference is that I always give the source number 0 and the sink the
 // last number, |V| - 1.
@@ -46,43 +95,212 @@ void read_and_add_edge2(struct graph* g, char* line, int sink, int last_index) {
     }
 }
 
-struct graph* read_dimacs_file(char* file) {
+void read_and_set_parametric_terminal(struct graph* g, char* line,
+                                      int* supply_slope, int* demand_slope) {
+    int id, amount, slope, offset = 2;
+    char c[1];
+    int read = sscanf(line + offset, "%d %c %d %d", &id, c, &amount, &slope);
+    if (read < 4) {
+        read_and_set_terminal(g, line);
+        return;
+    }
+    assert(1 <= id && id <= g->size);
+    assert(0 <= amount && 0 <= slope);
+
+    // The amount can be 0 at the start and grow with lambda, so the terminal
+    // is set directly instead of by graph_add_source or graph_add_sink
+    if (*c == 's') {
+        assert(g->demand[id - 1] == 0 && demand_slope[id - 1] == 0);
+        g->supply[id - 1] = amount;
+        supply_slope[id - 1] = slope;
+    } else {
+        assert(g->supply[id - 1] == 0 && supply_slope[id - 1] == 0);
+        g->demand[id - 1] = amount;
+        demand_slope[id - 1] = slope;
+    }
+}
+
+// Reads the file for both read_dimacs_file and read_parametric_dimacs_file.
+// The slopes are read if 'supply_slope' is not NULL.
+static struct graph* read_file(char* file, int** supply_slope,
+                               int** demand_slope) {
+    TRACE_BEGIN("load");
     FILE* fp;
     fp = fopen(file, "r");
     assert(fp != NULL);
 
-    struct graph* g;
-    int source, sink, ans;
-    char c[1];
+    struct graph* g = NULL;
+    int terminals_read = 0;
     char* line = NULL;
     size_t chars_read, len = 0;
 
     // Read one line at a time
     while((chars_read = getline(&line, &len, fp) != EOF)) {
 
+        // Every arc and terminal line comes after the 'p' line
+        assert(g != NULL || (line[0] != 'a' && line[0] != 'n'));
         switch (line[0]) {
             case 'a': // Edge
                 read_and_add_edge(g, line);
                 break;
             case 'c': // Comment
                 break;
-            case 'n': // Sorce or sink info
-                sscanf(line + 2, "%d %c", &ans, c);
-                if (*c == 's') {
-                    source = ans;
+            case 'n': // Source or sink info. There can be many of both.
+                // The terminals in the file replace the default s and t
+                if (!terminals_read++) {
+                    graph_clear_terminals(g);
+                }
+                if (supply_slope) {
+                    read_and_set_parametric_terminal(g, line, *supply_slope,
+                                                     *demand_slope);
                 } else {
-                    sink = ans;
+                    read_and_set_terminal(g, line);
                 }
                 break;
             case 'p': // Graph info: |V| and |E|
                 g = read_and_build_graph(line);
+                if (supply_slope) {
+                    *supply_slope = calloc(g->size, sizeof(int));
+                    *demand_slope = calloc(g->size, sizeof(int));
+                    assert(*supply_slope && *demand_slope);
+                }
                 break;
         }
     }
 
     free(line);
     int closed = fclose(fp);
-    assert(closed == 0);
+    assert(closed == 0 && g != NULL);
+    TRACE_END("load");
+    return g;
+}
+
+struct graph* read_dimacs_file(char* file) {
+    struct stat st;
+    int threads = bfs_default_threads();
+    if (threads > 1 && stat(file, &st) == 0 &&
+        LOAD_PARALLEL_BYTES <= st.st_size) {
+        return read_dimacs_file_parallel(file, threads);
+    }
+    return read_file(file, NULL, NULL);
+}
+
+// Reads the next integer after s like read_int, but fails on one that does
+// not fit in an int
+static int read_checked_int(char** s, int* value) {
+    char* c = *s;
+    while (*c == ' ' || *c == '\t') {
+        ++c;
+    }
+    if (*c != '-' && (*c < '0' || '9' < *c)) {
+        return 0;
+    }
+    char* end;
+    errno = 0;
+    long v = strtol(c, &end, 10);
+    if (end == c || errno || v < INT_MIN || INT_MAX < v) {
+        return 0;
+    }
+    *value = (int)v;
+    *s = end;
+    return 1;
+}
+
+// Reads the lines of a file for read_dimacs_file_checked and builds the graph
+// from the same lines it checks
+// Return: Pointer to the graph, NULL if the file can not be loaded
+static struct graph* read_checked_lines(FILE* fp) {
+    char* line = NULL;
+    size_t len = 0;
+    struct graph* g = NULL;
+    int n = 0, bad = 0, terminals_read = 0;
+
+    while (!bad && getline(&line, &len, fp) != -1) {
+        char* s = line + 1;
+        int from, to, capacity, id, amount = TERMINAL_UNBOUNDED;
+        char which;
+        switch (line[0]) {
+            case 'p':
+                s = line + 5;
+                bad = g || strncmp(line, "p max", 5) != 0 ||
+                      !read_checked_int(&s, &n) ||
+                      !read_checked_int(&s, &capacity) || n < 1 ||
+                      capacity < 0;
+                if (!bad) {
+                    g = graph_init(n);
+                }
+                break;
+            case 'a':
+                bad = !g || !read_checked_int(&s, &from) ||
+                      !read_checked_int(&s, &to) ||
+                      !read_checked_int(&s, &capacity) ||
+                      from < 1 || n < from || to < 1 || n < to ||
+                      from == to || capacity < 0;
+                if (!bad) {
+                    graph_add_edges(g, from - 1, to - 1, capacity);
+                }
+                break;
+            case 'n':
+                bad = !g || !read_checked_int(&s, &id) || id < 1 || n < id;
+                if (bad) {
+                    break;
+                }
+                while (*s == ' ' || *s == '\t') {
+                    ++s;
+                }
+                which = *s++;
+                bad = which != 's' && which != 't';
+                // The amount is optional, the terminal is unbounded without
+                if (!bad && read_checked_int(&s, &amount)) {
+                    bad = amount < 0;
+                }
+                if (bad) {
+                    break;
+                }
+                // The terminals in the file replace the default s and t
+                if (!terminals_read++) {
+                    graph_clear_terminals(g);
+                }
+                bad = which == 's' ? g->demand[id - 1] != 0
+                                   : g->supply[id - 1] != 0;
+                if (!bad && amount && which == 's') {
+                    graph_add_source(g, id - 1, amount);
+                } else if (!bad && amount) {
+                    graph_add_sink(g, id - 1, amount);
+                }
+                break;
+        }
+    }
+
+    if ((bad || ferror(fp)) && g) {
+        graph_free(g);
+        g = NULL;
+    }
+    free(line);
     return g;
 }
 
+struct graph* read_dimacs_file_checked(char* file) {
+    struct stat st;
+    if (stat(file, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return NULL;
+    }
+    FILE* fp = fopen(file, "r");
+    if (fp == NULL) {
+        return NULL;
+    }
+    TRACE_BEGIN("load");
+    struct graph* g = read_checked_lines(fp);
+    TRACE_END("load");
+    fclose(fp);
+    return g;
+}
+
+struct graph* read_dimacs_file_sequential(char* file) {
+    return read_file(file, NULL, NULL);
+}
+
+struct graph* read_parametric_dimacs_file(char* file, int** supply_slope,
+                                          int** demand_slope) {
+    return read_file(file, supply_slope, demand_slope);
+}
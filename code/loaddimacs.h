@@ -1,11 +1,51 @@
 #ifndef LOADDIMACS_H
 #define LOADDIMACS_H
 
-/* Builds a graph based on a DIMACS file
+/* Builds a graph based on a DIMACS file. Files of LOAD_PARALLEL_BYTES or
+ * more are loaded by read_dimacs_file_parallel with bfs_default_threads
+ * threads, if there are more than one.
  * Args:    - The path to the file to load
  * Return:  Pointer to graph */
 struct graph* read_dimacs_file(char* file);
 
+/* Builds a graph based on a DIMACS file like read_dimacs_file, after checking
+ * that the file is one it can load: a regular file with one 'p max' line
+ * before the arcs and terminals, arcs between two different vertices in the
+ * graph with a capacity of 0 or more, and terminals in the graph that are
+ * not both a source and a sink, with no negative supply or demand. The
+ * graph is built from the lines as they are checked, in the calling thread,
+ * so a file that changes while it is read can not get past the checks. This
+ * is for files that come from others, read_dimacs_file stops the program on
+ * a bad file.
+ * Args:    - The path to the file to load
+ * Return:  Pointer to graph, NULL if the file could not be opened or is not
+ *          a graph in the DIMACS format */
+struct graph* read_dimacs_file_checked(char* file);
+
+/* Builds a graph based on a DIMACS file, reading it a line at a time in the
+ * calling thread
+ * Args:    - The path to the file to load
+ * Return:  Pointer to graph */
+struct graph* read_dimacs_file_sequential(char* file);
+
+/* Builds a graph based on a DIMACS file where the supply and demand of the
+ * terminals can depend on a parameter lambda. A terminal line can end with a
+ * slope, 'n <id> s <supply> <slope>' for a supply of supply + slope * lambda
+ * and 'n <id> t <demand> <slope>' for a demand of demand - slope * lambda.
+ * The supply or demand in the graph is the one at lambda = 0, and can be 0.
+ * Args:    - The path to the file to load
+ *          - Set to an array with the slope of each vertex' supply
+ *          - Set to an array with the slope of each vertex' demand
+ * Return:  Pointer to graph */
+struct graph* read_parametric_dimacs_file(char* file, int** supply_slope,
+                                          int** demand_slope);
+
+/* Reads the next integer after s, skipping spaces and tabs but not newlines
+ * Args:    - Pointer to where to read from, moved past the integer
+ *          - Set to the integer
+ * Return:  1 if there was one, 0 if not */
+int read_int(char** s, int* value);
+
 /* Initializes a graph based on the input line
  * Args:    - A line with info about |V| and |E|
  * Return:  Pointer to graph */
@@ -17,6 +57,24 @@ struct graph* read_and_build_graph(char* line);
  *          - Line with info about vertices to add edge between and its capacity
  * Return:  Nothing */
 void read_and_add_edge(struct graph* g, char* line);
+/* Makes a vertex a source or sink based on the input line. The line can end
+ * with the supply/demand of the terminal, 'n <id> s <supply>'. Without it the
+ * terminal is unbounded.
+ * Args:    - Pointer to graph
+ *          - Line with info about the terminal
+ * Return:  Nothing */
+void read_and_set_terminal(struct graph* g, char* line);
+
+/* Makes a vertex a source or sink based on the input line, which can end with
+ * the slope of the supply or demand, 'n <id> s <supply> <slope>'. Both must
+ * not be negative. Without a slope it is read by read_and_set_terminal.
+ * Args:    - Pointer to graph
+ *          - Line with info about the terminal
+ *          - Array with the slopes of the supplies to set
+ *          - Array with the slopes of the demands to set
+ * Return:  Nothing */
+void read_and_set_parametric_terminal(struct graph* g, char* line,
+                                      int* supply_slope, int* demand_slope);
 
 /* Adds an edge to the graph based on the input line
  * If the sinks current number emerges it is changed to the last index in the
@@ -0,0 +1,388 @@
+#define _GNU_SOURCE
+#include "loadparallel.h"
+#include "loaddimacs.h"
+#include "graph.h"
+#include "list.h"
+#include "edge.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Vertices a thread sorts and builds the lists of at a time
+#define LOAD_CHUNK 1024
+
+// Slots of a vertex sorted by insertion, more are sorted by qsort
+#define LOAD_INSERTION_SORT 64
+
+// The lines a thread parsed. An arc is three ints, from, to and capacity,
+// with the vertices numbered from 1 like in the file.
+struct load_part {
+    int* arcs;
+    long n_arcs;
+    long arcs_size;
+    char** lines;       // The 'p' and 'n' lines, in the order in the file
+    int n_lines;
+    int lines_size;
+    long first_arc;     // The number of arcs in the parts before this one
+    long sum;           // Slots of the part's vertices, for the prefix sum
+};
+
+// What the threads share
+struct load_shared {
+    char* text;
+    long size;
+    int fd;
+    int threads;
+    struct load_part* parts;
+    struct graph* g;
+    long* start;        // The first slot of each vertex, and of |V| the end
+    long* fill;         // The next free slot of each vertex
+    long* slots;        // Twice the arc's number, plus 1 at its head
+    struct edge** edges;
+    int next_chunk;
+    pthread_barrier_t barrier;
+};
+
+struct load_thread {
+    struct load_shared* sh;
+    int id;
+};
+
+static void wait_all(struct load_shared* sh) {
+    if (sh->threads > 1) {
+        pthread_barrier_wait(&sh->barrier);
+    }
+}
+
+static void add_line(struct load_part* p, char* line) {
+    if (p->n_lines == p->lines_size) {
+        p->lines_size = p->lines_size ? 2 * p->lines_size : 16;
+        p->lines = realloc(p->lines, p->lines_size * sizeof(char*));
+        assert(p->lines);
+    }
+    p->lines[p->n_lines++] = line;
+}
+
+// Parses the lines that start in the thread's part of the text. A line that
+// starts in one part and ends in the next belongs to the first.
+static void parse_part(struct load_shared* sh, int id) {
+    struct load_part* p = &sh->parts[id];
+    long from = sh->size * id / sh->threads;
+    long to = sh->size * (id + 1) / sh->threads;
+    char* text = sh->text;
+
+    // Start at the first line that starts in the part
+    if (from > 0 && text[from - 1] != '\n') {
+        char* newline = memchr(text + from, '\n', sh->size - from);
+        from = newline ? newline - text + 1 : sh->size;
+    }
+    for (long at = from; at < to; ) {
+        char* line = text + at;
+        char* end = memchr(line, '\n', sh->size - at);
+        at = end ? end - text + 1 : sh->size;
+
+        if (*line == 'a') {
+            if (p->n_arcs == p->arcs_size) {
+                p->arcs_size = p->arcs_size ? 2 * p->arcs_size : 4096;
+                p->arcs = realloc(p->arcs, 3 * p->arcs_size * sizeof(int));
+                assert(p->arcs);
+            }
+            int* arc = p->arcs + 3 * p->n_arcs++;
+            char* s = line + 1;
+            int read = read_int(&s, &arc[0]) && read_int(&s, &arc[1]) &&
+                       read_int(&s, &arc[2]);
+            assert(read);
+        }
+        else if (*line == 'p' || *line == 'n') {
+            add_line(p, line);
+        }
+    }
+}
+
+// Makes the graph from the 'p' line and sets the terminals from the 'n' lines
+// in the order they are in the file, like read_dimacs_file
+static void make_graph(struct load_shared* sh) {
+    struct graph* g = NULL;
+    int terminals_read = 0;
+    long arcs = 0;
+
+    for (int t = 0; t < sh->threads; t++) {
+        struct load_part* p = &sh->parts[t];
+        p->first_arc = arcs;
+        arcs += p->n_arcs;
+        for (int i = 0; i < p->n_lines; i++) {
+            char* line = p->lines[i];
+            if (*line == 'p') {
+                assert(g == NULL);
+                g = read_and_build_graph(line);
+                continue;
+            }
+            assert(g != NULL);
+            // The terminals in the file replace the default s and t
+            if (!terminals_read++) {
+                graph_clear_terminals(g);
+            }
+            read_and_set_terminal(g, line);
+        }
+    }
+    assert(g != NULL);
+
+    sh->g = g;
+    sh->start = calloc(g->size + 1, sizeof(long));
+    sh->fill = malloc((g->size + 1) * sizeof(long));
+    sh->slots = malloc((2 * arcs + 1) * sizeof(long));
+    sh->edges = malloc((arcs + 1) * sizeof(struct edge*));
+    assert(sh->start && sh->fill && sh->slots && sh->edges);
+}
+
+// Counts the arcs at each vertex, both ends, like graph_add_edges checks them
+static void count_arcs(struct load_shared* sh, struct load_part* p) {
+    int n = sh->g->size;
+    for (long i = 0; i < p->n_arcs; i++) {
+        int* arc = p->arcs + 3 * i;
+        assert(arc[0] != arc[1]);
+        assert(1 <= arc[0] && arc[0] <= n && 1 <= arc[1] && arc[1] <= n);
+        assert(0 <= arc[2]);
+        __atomic_fetch_add(&sh->start[arc[0] - 1], 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&sh->start[arc[1] - 1], 1, __ATOMIC_RELAXED);
+    }
+}
+
+// The prefix sum of the counts over the thread's range of vertices, after
+// the sums of the ranges before it are added up
+static void prefix_sum(struct load_shared* sh, int id) {
+    int n = sh->g->size;
+    long first = (long)n * id / sh->threads;
+    long last = (long)n * (id + 1) / sh->threads;
+    struct load_part* p = &sh->parts[id];
+
+    p->sum = 0;
+    for (long v = first; v < last; v++) {
+        p->sum += sh->start[v];
+    }
+    wait_all(sh);
+    long slot = 0;
+    for (int t = 0; t < id; t++) {
+        slot += sh->parts[t].sum;
+    }
+    for (long v = first; v < last; v++) {
+        long count = sh->start[v];
+        sh->start[v] = slot;
+        sh->fill[v] = slot;
+        slot += count;
+    }
+    if (id == sh->threads - 1) {
+        sh->start[n] = slot;
+    }
+}
+
+// Puts the thread's arcs into the slots of their ends and makes their edges
+static void scatter_arcs(struct load_shared* sh, struct load_part* p) {
+    for (long i = 0; i < p->n_arcs; i++) {
+        int* arc = p->arcs + 3 * i;
+        long number = p->first_arc + i;
+        long tail = __atomic_fetch_add(&sh->fill[arc[0] - 1], 1,
+                                       __ATOMIC_RELAXED);
+        long head = __atomic_fetch_add(&sh->fill[arc[1] - 1], 1,
+                                       __ATOMIC_RELAXED);
+        sh->slots[tail] = 2 * number;
+        sh->slots[head] = 2 * number + 1;
+        sh->edges[number] = edges_init(arc[0] - 1, arc[1] - 1, arc[2]);
+    }
+}
+
+static int compare_slots(const void* a, const void* b) {
+    long x = *(const long*)a, y = *(const long*)b;
+    return (x > y) - (x < y);
+}
+
+// The slots a thread put in are in order, so they are often sorted already
+static void sort_slots(long* slot, long count) {
+    if (LOAD_INSERTION_SORT < count) {
+        qsort(slot, count, sizeof(long), &compare_slots);
+        return;
+    }
+    for (long i = 1; i < count; i++) {
+        long s = slot[i], j = i;
+        for (; 0 < j && s < slot[j - 1]; j--) {
+            slot[j] = slot[j - 1];
+        }
+        slot[j] = s;
+    }
+}
+
+// Sorts the slots of chunks of vertices and builds their adjacency lists.
+// The arcs are inserted first in the order of the file, like
+// read_dimacs_file does.
+static void build_lists(struct load_shared* sh) {
+    struct graph* g = sh->g;
+    while (1) {
+        int from = __atomic_fetch_add(&sh->next_chunk, LOAD_CHUNK,
+                                      __ATOMIC_RELAXED);
+        if (from >= g->size) {
+            break;
+        }
+        int to = from + LOAD_CHUNK < g->size ? from + LOAD_CHUNK : g->size;
+        for (int v = from; v < to; v++) {
+            long* slot = sh->slots + sh->start[v];
+            long count = sh->start[v + 1] - sh->start[v];
+            sort_slots(slot, count);
+            for (long i = 0; i < count; i++) {
+                struct edge* e = sh->edges[slot[i] / 2];
+                int inserted = list_insert_first(g->adj_array[v],
+                                                 slot[i] % 2 ? e->reverse_edge
+                                                             : e);
+                assert(inserted == 0);
+            }
+        }
+    }
+}
+
+static void* load_worker(void* arg) {
+    struct load_thread* t = arg;
+    struct load_shared* sh = t->sh;
+    struct load_part* p = &sh->parts[t->id];
+
+    // Each thread reads its part of the file
+    long from = sh->size * t->id / sh->threads;
+    long to = sh->size * (t->id + 1) / sh->threads;
+    while (from < to) {
+        ssize_t read = pread(sh->fd, sh->text + from, to - from, from);
+        assert(0 < read);
+        from += read;
+    }
+    wait_all(sh);
+
+    parse_part(sh, t->id);
+    wait_all(sh);
+    if (t->id == 0) {
+        make_graph(sh);
+    }
+    wait_all(sh);
+    count_arcs(sh, p);
+    wait_all(sh);
+    prefix_sum(sh, t->id);
+    wait_all(sh);
+    scatter_arcs(sh, p);
+    wait_all(sh);
+    build_lists(sh);
+    return NULL;
+}
+
+struct graph* read_dimacs_file_parallel(char* file, int threads) {
+    TRACE_BEGIN("load");
+    threads = threads < 1 ? 1 : threads;
+    struct load_shared sh;
+    memset(&sh, 0, sizeof(sh));
+    sh.fd = open(file, O_RDONLY);
+    assert(sh.fd != -1);
+    struct stat st;
+    int stated = fstat(sh.fd, &st);
+    assert(stated == 0);
+
+    sh.size = st.st_size;
+    sh.threads = threads;
+    sh.text = malloc(sh.size + 1);
+    sh.parts = calloc(threads, sizeof(struct load_part));
+    struct load_thread* t = malloc(threads * sizeof(struct load_thread));
+    pthread_t* workers = malloc(threads * sizeof(pthread_t));
+    assert(sh.text && sh.parts && t && workers);
+    // sscanf in read_and_set_terminal may look past the last line
+    sh.text[sh.size] = '\0';
+    if (threads > 1) {
+        pthread_barrier_init(&sh.barrier, NULL, threads);
+    }
+
+    // The calling thread is the first one
+    for (int i = 0; i < threads; i++) {
+        t[i].sh = &sh;
+        t[i].id = i;
+    }
+    for (int i = 1; i < threads; i++) {
+        int created = pthread_create(&workers[i], NULL, &load_worker, &t[i]);
+        assert(created == 0);
+    }
+    load_worker(&t[0]);
+    for (int i = 1; i < threads; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    if (threads > 1) {
+        pthread_barrier_destroy(&sh.barrier);
+    }
+    for (int i = 0; i < threads; i++) {
+        free(sh.parts[i].arcs);
+        free(sh.parts[i].lines);
+    }
+    int closed = close(sh.fd);
+    assert(closed == 0);
+    free(sh.text);
+    free(sh.parts);
+    free(sh.start);
+    free(sh.fill);
+    free(sh.slots);
+    free(sh.edges);
+    free(t);
+    free(workers);
+    TRACE_END("load");
+    return sh.g;
+}
+
+int graph_same(struct graph* a, struct graph* b) {
+    if (a->size != b->size) {
+        return 0;
+    }
+    for (int v = 0; v < a->size; v++) {
+        if (a->supply[v] != b->supply[v] || a->demand[v] != b->demand[v] ||
+            a->adj_array[v]->size != b->adj_array[v]->size) {
+            return 0;
+        }
+        struct element* x = a->adj_array[v]->head;
+        struct element* y = b->adj_array[v]->head;
+        for (; x && y; x = x->next, y = y->next) {
+            struct edge* e = x->this;
+            struct edge* f = y->this;
+            if (e->from != f->from || e->to != f->to ||
+                e->capacity != f->capacity || e->original != f->original ||
+                e->reverse_edge->capacity != f->reverse_edge->capacity) {
+                return 0;
+            }
+        }
+        if (x || y) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int load_benchmark(char* path, int* threads, int n, FILE* fp) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct graph* g = read_dimacs_file_sequential(path);
+    double sequential = seconds_since(&start);
+    fprintf(fp, "load: sequential %.3f ms, |V| %d\n", sequential * 1000,
+            g->size);
+
+    int same = 1;
+    for (int i = 0; i < n; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        struct graph* h = read_dimacs_file_parallel(path, threads[i]);
+        double parallel = seconds_since(&start);
+        int equal = graph_same(g, h);
+        same &= equal;
+        fprintf(fp, "load: %d threads %.3f ms, speedup %.2f, %s\n",
+                threads[i], parallel * 1000, sequential / parallel,
+                equal ? "same graph" : "NOT THE SAME GRAPH");
+        graph_free(h);
+    }
+    graph_free(g);
+    return !same;
+}
@@ -0,0 +1,45 @@
+#ifndef LOADPARALLEL_H
+#define LOADPARALLEL_H
+
+#include "graph.h"
+
+#include <stdio.h>
+
+/* Loads a DIMACS file with many threads. Each thread reads a part of the
+ * file and parses the lines that start in it, keeping the arcs in a buffer
+ * of its own. The number of arcs at each vertex is then counted by all the
+ * threads, and a prefix sum over the counts gives each vertex a range of
+ * slots. The threads put the arcs into the slots and make their edges, and
+ * then each vertex' slots are sorted and its adjacency list built from them.
+ *
+ * The graph is the same as read_dimacs_file gives: the same edges in the
+ * same order in every adjacency list, which is the reverse of the order of
+ * the arcs in the file, and the same terminals. */
+
+/* read_dimacs_file uses the threads for files at least this large */
+#define LOAD_PARALLEL_BYTES (16L << 20)
+
+/* Builds a graph based on a DIMACS file, like read_dimacs_file
+ * Args:    - The path to the file to load
+ *          - Number of threads, 1 to load in the calling thread only
+ * Return:  Pointer to graph */
+struct graph* read_dimacs_file_parallel(char* file, int threads);
+
+/* Checks that two graphs have the same vertices, terminals and edges, in the
+ * same order in each adjacency list. The flow is not compared.
+ * Args:    - Pointer to one graph
+ *          - Pointer to the other graph
+ * Return:  1 if they are the same, 0 if not */
+int graph_same(struct graph* a, struct graph* b);
+
+/* Times read_dimacs_file_sequential and read_dimacs_file_parallel with
+ * each number of threads, checks that the graphs are the same and prints
+ * the times and the speedups
+ * Args:    - Path to the graph
+ *          - The numbers of threads
+ *          - Number of them
+ *          - The file to print to
+ * Return:  0 on success, 1 if a graph was not the same */
+int load_benchmark(char* path, int* threads, int n, FILE* fp);
+
+#endif
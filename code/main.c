@@ -2,6 +2,27 @@
 #include "maxflow.h"
 #include "pushrelabel.h"
 #include "loaddimacs.h"
+#include "solver.h"
+#include "server.h"
+#include "reduce.h"
+#include "autoselect.h"
+#include "csrflow.h"
+#include "parametric.h"
+#include "batch.h"
+#include "anytime.h"
+#include "trace.h"
+#include "verify.h"
+#include "loadparallel.h"
+#include "compact.h"
+#include "region.h"
+#include "placement.h"
+#include "bench.h"
+#include "context.h"
+#include "dynamic.h"
+#include "flowout.h"
+#include "checkpoint.h"
+#include "mincost.h"
+#include "dobfs.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -43,8 +64,289 @@ void write_results(char* alg, clock_t results[], FILE* fp, int len) {
     }
 }
 
+// Solve the graph after reducing it and report how much was reduced and the
+// time saved compared with solving the graph as it is
+int solve_reduced(char* path, struct solver* solver) {
+    struct graph* g = read_dimacs_file(path);
+    clock_t start = clock();
+    struct reduction* r = reduce_graph(g);
+    int mf = solver->solve(r->reduced);
+    reduction_expand_flow(r);
+    clock_t end = clock();
+    reduction_print(r, stdout);
+
+    // The expanded flow must be a maximum flow in the original graph
+    long cut = get_min_cut(g, NULL);
+    assert(cut == mf);
+    reduction_free(r);
+    graph_free(g);
+
+    g = read_dimacs_file(path);
+    clock_t start_original = clock();
+    int mf_original = solver->solve(g);
+    clock_t end_original = clock();
+    assert(mf == mf_original);
+    graph_free(g);
+
+    double reduced_ms  = 1000.0 * (end - start) / CLOCKS_PER_SEC;
+    double original_ms = 1000.0 * (end_original - start_original) /
+                         CLOCKS_PER_SEC;
+    fprintf(stdout, "solve: maximum flow %d, reduced %.3f ms (reduce and "
+            "expand included), original %.3f ms, saved %.3f ms\n",
+            mf, reduced_ms, original_ms, original_ms - reduced_ms);
+    return mf;
+}
+
 
 int main(int argc, char* argv[]) {
+    // The placement of the arrays comes before the rest of the arguments
+    if (2 < argc && strcmp(argv[1], "--memory") == 0) {
+        if (placement_parse(argv[2])) {
+            fprintf(stderr, "Usage: ./max.out --memory "
+                    "[malloc|thp|hugetlb][,default|first-touch|interleave] "
+                    "...\n");
+            return 1;
+        }
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+    // Run as a server reading requests from stdin
+    if (1 < argc && strcmp(argv[1], "--serve") == 0) {
+        int workers    = 2 < argc ? atoi(argv[2]) : SERVER_WORKERS;
+        int cache_size = 3 < argc ? atoi(argv[3]) : SERVER_CACHE_SIZE;
+        if (workers < 1 || cache_size < 1) {
+            fprintf(stderr, "Usage: ./max.out --serve [WORKERS] [CACHE SIZE]\n");
+            return 1;
+        }
+        return server_run(workers, cache_size);
+    }
+    // Time all algorithms on the graphs for the 'auto' algorithm
+    if (1 < argc && strcmp(argv[1], "--calibrate") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, "Usage: ./max.out --calibrate [TABLE] [PATH]...\n");
+            return 1;
+        }
+        return calibrate(argv[2], argv + 3, argc - 3);
+    }
+    // Time some solvers on one graph
+    if (1 < argc && strcmp(argv[1], "--compare") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, "Usage: ./max.out --compare [PATH] "
+                    "[ALGORITHM]...\n");
+            return 1;
+        }
+        return solver_compare(argv[2], argv + 3, argc - 3, stdout);
+    }
+    // Solve a graph with parametric terminals at many values of lambda
+    if (1 < argc && strcmp(argv[1], "--parametric") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, "Usage: ./max.out --parametric [PATH] "
+                    "[LAMBDA]...\n");
+            return 1;
+        }
+        return parametric_run(argv[2], argv + 3, argc - 3, stdout);
+    }
+    // Solve many small graphs together
+    if (1 < argc && strcmp(argv[1], "--batch") == 0) {
+        int threads    = 2 < argc ? atoi(argv[2]) : 0;
+        int interleave = 3 < argc ? atoi(argv[3]) : BATCH_INTERLEAVE;
+        if (threads < 0 || interleave < 1) {
+            fprintf(stderr, "Usage: ./max.out --batch [THREADS] [INTERLEAVE] "
+                    "[PATH]...\n");
+            return 1;
+        }
+        return batch_run(argv + 4, argc > 4 ? argc - 4 : 0, threads,
+                         interleave, stdout);
+    }
+    // Solve with a time or work limit and report bounds on the flow
+    if (1 < argc && strcmp(argv[1], "--anytime") == 0) {
+        struct flow_budget budget;
+        budget.seconds = 4 < argc ? atof(argv[4]) : 0;
+        budget.work    = 5 < argc ? atol(argv[5]) : 0;
+        if (argc < 4 || budget.seconds < 0 || budget.work < 0) {
+            fprintf(stderr, "Usage: ./max.out --anytime [PATH] [ALGORITHM] "
+                    "[SECONDS] [WORK]\n");
+            return 1;
+        }
+        return anytime_run(argv[2], argv[3], &budget, stdout);
+    }
+    // Solve graphs and check that the flows are maximum flows
+    if (1 < argc && strcmp(argv[1], "--verify") == 0) {
+        int threads = 3 < argc ? atoi(argv[3]) : 0;
+        if (argc < 5 || threads < 0) {
+            fprintf(stderr, "Usage: ./max.out --verify [ALGORITHM] [THREADS] "
+                    "[PATH]...\n");
+            return 1;
+        }
+        return verify_run(argv[2], argv + 4, argc - 4, threads, stdout);
+    }
+    // Time loading a graph with threads against loading it without
+    if (1 < argc && strcmp(argv[1], "--load-bench") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "Usage: ./max.out --load-bench [PATH] "
+                    "[THREADS]...\n");
+            return 1;
+        }
+        int n = argc - 3;
+        int threads[n + 1];
+        for (int i = 0; i < n; i++) {
+            threads[i] = atoi(argv[3 + i]);
+            assert(0 < threads[i]);
+        }
+        if (n == 0) {
+            threads[n++] = bfs_default_threads();
+        }
+        return load_benchmark(argv[2], threads, n, stdout);
+    }
+    // Measure the memory and speed of the compressed arcs
+    if (1 < argc && strcmp(argv[1], "--compact-bench") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "Usage: ./max.out --compact-bench [PATH]\n");
+            return 1;
+        }
+        return compact_benchmark(argv[2], stdout);
+    }
+    // Solve with the vertices split into regions in worker processes
+    if (1 < argc && strcmp(argv[1], "--region") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "Usage: ./max.out --region [PATH] "
+                    "[REGIONS]...\n");
+            return 1;
+        }
+        int n = argc - 3;
+        int regions[n + 1];
+        for (int i = 0; i < n; i++) {
+            regions[i] = atoi(argv[3 + i]);
+            assert(0 < regions[i]);
+        }
+        if (n == 0) {
+            regions[n++] = bfs_default_threads();
+        }
+        return region_benchmark(argv[2], regions, n, stdout);
+    }
+    // Time all the solvers on a corpus of graphs
+    if (1 < argc && strcmp(argv[1], "--bench") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, "Usage: ./max.out --bench [RESULTS] [PATH]...\n");
+            return 1;
+        }
+        return bench_run(argv + 3, argc - 3, argv[2], stdout);
+    }
+    // Compare the times with those of a baseline
+    if (1 < argc && strcmp(argv[1], "--bench-compare") == 0) {
+        if (argc != 4) {
+            fprintf(stderr, "Usage: ./max.out --bench-compare [BASELINE] "
+                    "[RESULTS]\n");
+            return 1;
+        }
+        return bench_compare(argv[2], argv[3], stdout);
+    }
+    // Solve from many threads on one shared topology
+    if (1 < argc && strcmp(argv[1], "--contexts") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "Usage: ./max.out --contexts [PATH] "
+                    "[THREADS]...\n");
+            return 1;
+        }
+        int n = argc < 4 ? 1 : argc - 3;
+        int* threads = malloc(n * sizeof(int));
+        assert(threads != NULL);
+        for (int i = 0; i < n; i++) {
+            threads[i] = argc < 4 ? bfs_default_threads() : atoi(argv[3 + i]);
+            if (threads[i] < 1) {
+                fprintf(stderr, "The number of threads must be at least 1\n");
+                free(threads);
+                return 1;
+            }
+        }
+        int failed = context_benchmark(argv[2], threads, n,
+                                       CONTEXT_BENCH_QUERIES, stdout);
+        free(threads);
+        return failed;
+    }
+    // Change a graph with a stream of updates and find the flow after each
+    // batch
+    if (1 < argc && strcmp(argv[1], "--dynamic") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "Usage: ./max.out --dynamic [PATH] [UPDATES] "
+                    "[BATCH]\n");
+            return 1;
+        }
+        int updates = 3 < argc ? atoi(argv[3]) : 10 * DYNAMIC_BENCH_BATCH;
+        int batch = 4 < argc ? atoi(argv[4]) : DYNAMIC_BENCH_BATCH;
+        if (updates < 1 || batch < 1) {
+            fprintf(stderr, "The updates and the batch must be at least 1\n");
+            return 1;
+        }
+        return dynamic_benchmark(argv[2], updates, batch, stdout);
+    }
+    // Time writing the flow out next to solving
+    if (1 < argc && strcmp(argv[1], "--flow-bench") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "Usage: ./max.out --flow-bench [PATH] "
+                    "[ALGORITHM]\n");
+            return 1;
+        }
+        return flow_output_benchmark(argv[2], 3 < argc ? argv[3] : "rtf-simd",
+                                     stdout);
+    }
+    // Solve taking snapshots, going on from the last one if there is one
+    if (1 < argc && strcmp(argv[1], "--checkpoint") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, "Usage: ./max.out --checkpoint [PATH] [FILE] "
+                    "[SECONDS]\n");
+            return 1;
+        }
+        return checkpoint_run_file(argv[2], argv[3], 4 < argc ?
+                                   atof(argv[4]) : CHECKPOINT_SECONDS, stdout);
+    }
+    // Time taking snapshots and going on from one
+    if (1 < argc && strcmp(argv[1], "--checkpoint-bench") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "Usage: ./max.out --checkpoint-bench [PATH] "
+                    "[SECONDS]\n");
+            return 1;
+        }
+        return checkpoint_benchmark(argv[2], 3 < argc ? atof(argv[3]) :
+                                    CHECKPOINT_BENCH_SECONDS, stdout);
+    }
+    // Find a flow of minimum cost
+    if (1 < argc && strcmp(argv[1], "--mincost") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "Usage: ./max.out --mincost [PATH] [FLOW FILE]\n");
+            return 1;
+        }
+        return mincost_run(argv[2], 3 < argc ? argv[3] : NULL, stdout);
+    }
+    // Find the cheapest maximum flow of graphs with costs added
+    if (1 < argc && strcmp(argv[1], "--mincost-bench") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "Usage: ./max.out --mincost-bench [PATH]...\n");
+            return 1;
+        }
+        return mincost_benchmark(argv + 2, argc - 2, stdout);
+    }
+    // Time a solver with each placement of the arrays
+    if (1 < argc && strcmp(argv[1], "--memory-bench") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "Usage: ./max.out --memory-bench [PATH] "
+                    "[ALGORITHM]\n");
+            return 1;
+        }
+        return placement_benchmark(argv[2], 3 < argc ? argv[3] : "rtf-simd",
+                                   stdout);
+    }
+    // Measure the SIMD arc scanning kernels on the high degree vertices
+    if (1 < argc && strcmp(argv[1], "--simd-bench") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "Usage: ./max.out --simd-bench [PATH] "
+                    "[MIN DEGREE]\n");
+            return 1;
+        }
+        int min_degree = 3 < argc ? atoi(argv[3]) : SIMD_BENCH_MIN_DEGREE;
+        return csr_simd_benchmark(argv[2], min_degree, stdout);
+    }
     // Do time measuring for all three maximum flow algorithms
     // 3 times per algorithm, because it runs with different speed for each
     // iteration. Then the median can be found later.
@@ -59,7 +361,9 @@ int main(int argc, char* argv[]) {
         for (int i = 0; i < len; i++) {
             g = read_dimacs_file(argv[1]);
             start = clock();
+            TRACE_BEGIN("solve");
             mf1 = get_maximum_flow(g, &dfs);
+            TRACE_END("solve");
             end = clock();
             time_measures[i] = end - start;
             graph_free(g);
@@ -72,7 +376,9 @@ int main(int argc, char* argv[]) {
         for (int i = 0; i < len; i++) {
             g = read_dimacs_file(argv[1]);
             start = clock();
+            TRACE_BEGIN("solve");
             mf2 = get_maximum_flow(g, &bfs);
+            TRACE_END("solve");
             end = clock();
             time_measures[i] = end - start;
             graph_free(g);
@@ -83,7 +389,9 @@ int main(int argc, char* argv[]) {
         for (int i = 0; i < len; i++) {
             g = read_dimacs_file(argv[1]);
             start = clock();
+            TRACE_BEGIN("solve");
             mf3 = relabel_to_front(g);
+            TRACE_END("solve");
             end = clock();
             time_measures[i] = end - start;
             graph_free(g);
@@ -101,30 +409,123 @@ int main(int argc, char* argv[]) {
     }
     // Run one maximum flow algorithm once on graph
     // from the path in argv[1]
-    else if (argc == 3) {
+    // Options after the algorithm change how it is run
+    else if (argc >= 3) {
+        struct solver* solver = solver_find(argv[2]);
+        if (!solver) {
+            fprintf(stderr, "argv[2] should be one of: ");
+            solver_print_names(stderr);
+            fprintf(stderr, ".\nargv[2] was: %s\n", argv[2]);
+            return 1;
+        }
+
+        int reduce = 0, verify = 0;
+        // Files to write the flow to
+        char* flow_path = NULL;
+        char* binary_path = NULL;
+        char* paths_path = NULL;
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "--reduce") == 0) {
+                reduce = 1;
+            }
+            else if (strcmp(argv[i], "--verify") == 0) {
+                verify = 1;
+            }
+            else if (i + 1 < argc && strcmp(argv[i], "--flow") == 0) {
+                flow_path = argv[++i];
+            }
+            else if (i + 1 < argc && strcmp(argv[i], "--flow-binary") == 0) {
+                binary_path = argv[++i];
+            }
+            else if (i + 1 < argc && strcmp(argv[i], "--paths") == 0) {
+                paths_path = argv[++i];
+            }
+            else {
+                fprintf(stderr, "Unknown option: %s\n", argv[i]);
+                return 1;
+            }
+        }
+
+        if (reduce) {
+            solve_reduced(argv[1], solver);
+            return 0;
+        }
+
         struct graph* g;
         g = read_dimacs_file(argv[1]);
         int mf;
 
-        if (strcmp(argv[2], "dfs") == 0) {
-            mf = get_maximum_flow(g, &dfs);
-        }
-        else if (strcmp(argv[2],  "bfs") == 0) {
-            mf = get_maximum_flow(g, &bfs);
+        TRACE_BEGIN("solve");
+        mf = solver->solve(g);
+        TRACE_END("solve");
+        if (verify) {
+            struct flow_verdict v;
+            verify_flow(g, bfs_default_threads(), &v);
+            verify_print(&v, mf, stdout);
+            if (!v.maximum || v.value != mf) {
+                graph_free(g);
+                return 1;
+            }
         }
-        else if (strcmp(argv[2], "rtf") == 0) {
-            mf = relabel_to_front(g);
+        int failed = 0;
+        if (flow_path || binary_path || paths_path) {
+            struct flow_arcs* a = flow_arcs_gather(g);
+            if (flow_path) {
+                failed |= flow_write_dimacs(a, mf, flow_path);
+            }
+            if (binary_path) {
+                failed |= flow_write_binary(a, mf, binary_path);
+            }
+            if (paths_path) {
+                struct flow_decomposition* d = flow_decompose(a);
+                if (d->residue) {
+                    fprintf(stderr, "The flow is not conserved at vertex %d, "
+                            "%ld of it is in no path\n", d->unbalanced + 1,
+                            d->residue);
+                    failed = 1;
+                }
+                else {
+                    failed |= decomposition_write(d, paths_path);
+                }
+                decomposition_free(d);
+            }
+            flow_arcs_free(a);
         }
-        else {
-            fprintf(stderr, "argv[2] should be bfs, dfs or rtf.\n"
-                    "argv[2] was: %s\n", argv[2]);
+        if (failed) {
+            fprintf(stderr, "The flow could not be written\n");
         }
         graph_free(g);
 
-        return 0;
+        return failed;
     }
     else {
         fprintf(stderr, "Usage: ./runall [PATH]\n"
+                "       ./runall [PATH] [ALGORITHM] [--reduce] [--verify]\n"
+                "                [--flow FILE] [--flow-binary FILE] "
+                "[--paths FILE]\n"
+                "       ./runall --serve [WORKERS] [CACHE SIZE]\n"
+                "       ./runall --calibrate [TABLE] [PATH]...\n"
+                "       ./runall --simd-bench [PATH] [MIN DEGREE]\n"
+                "       ./runall --compare [PATH] [ALGORITHM]...\n"
+                "       ./runall --parametric [PATH] [LAMBDA]...\n"
+                "       ./runall --batch [THREADS] [INTERLEAVE] [PATH]...\n"
+                "       ./runall --anytime [PATH] [ALGORITHM] [SECONDS] "
+                "[WORK]\n"
+                "       ./runall --verify [ALGORITHM] [THREADS] [PATH]...\n"
+                "       ./runall --load-bench [PATH] [THREADS]...\n"
+                "       ./runall --compact-bench [PATH]\n"
+                "       ./runall --region [PATH] [REGIONS]...\n"
+                "       ./runall --memory-bench [PATH] [ALGORITHM]\n"
+                "       ./runall --contexts [PATH] [THREADS]...\n"
+                "       ./runall --dynamic [PATH] [UPDATES] [BATCH]\n"
+                "       ./runall --flow-bench [PATH] [ALGORITHM]\n"
+                "       ./runall --checkpoint [PATH] [FILE] [SECONDS]\n"
+                "       ./runall --checkpoint-bench [PATH] [SECONDS]\n"
+                "       ./runall --mincost [PATH] [FLOW FILE]\n"
+                "       ./runall --mincost-bench [PATH]...\n"
+                "       ./runall --bench [RESULTS] [PATH]...\n"
+                "       ./runall --bench-compare [BASELINE] [RESULTS]\n"
+                "       ./runall --memory [POLICY] ...\n"
                 "[PATH] is the DIMACS file to be run\n");
         return 1;
     }
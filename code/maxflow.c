@@ -3,13 +3,17 @@
 #include "queue.h"
 #include "list.h"
 #include "edge.h"
+#include "linkcut.h"
+#include "trace.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <assert.h>
 
 // Augment path with residual path capacity, cfp
 void augment(struct list* path, int cfp) {
+    TRACE_BEGIN("augment");
     struct element* cur = path->head;
     struct edge* cur_edge;
 
@@ -24,6 +28,7 @@ void augment(struct list* path, int cfp) {
 
         cur = cur->next;
     }
+    TRACE_END("augment");
 }
 
 // Get the residual capacity of edge
@@ -61,25 +66,56 @@ int get_cfp(struct list* augpath) {
     return min;
 }
 
+// Get the vertex the path ends in
+int get_path_sink(struct list* augpath) {
+    struct element* cur = augpath->head;
+
+    while (cur->next) {
+        cur = cur->next;
+    }
+    return ((struct edge*)cur->this)->to;
+}
+
 // Build augmenting path using list.
-// Uses the 'parents' array to find path.
-struct list* build_augmenting_path(struct edge* parent[], int index) {
+// Uses the 'parents' array to find path. It is followed back from the sink
+// until a source, which has no parent, is reached.
+struct list* build_augmenting_path(struct edge* parent[], int sink) {
+    TRACE_BEGIN("build_augmenting_path");
     struct list* augpath = list_init();
+    struct edge* e = parent[sink];
 
-    while (index > 0) {
+    while (e) {
+        list_insert_first(augpath, e);
+        e = parent[e->from];
+    }
+    TRACE_END("build_augmenting_path");
+    return augpath;
+}
 
-        struct edge* e = parent[index - 1];
+// What stops the searches of this thread, and the vertices they visited
+static _Thread_local struct {
+    int (*stop)(void*);
+    void* arg;
+    long visits;
+    int stopped;
+} search_stop;
+
+void search_set_stop(int (*stop)(void*), void* arg) {
+    search_stop.stop = stop;
+    search_stop.arg = arg;
+    search_stop.visits = 0;
+}
 
-        if (e) {
-            list_insert_first(augpath, e);
-        } else {
-            // if edge on augmenting path is NULL there is no augmenting path
-            container_free(augpath, augpath->head, 0, 0);
-            return NULL;
-        }
-        index = e->from;
+// Whether the search that visits a vertex now must give up
+static int search_stopped(void) {
+    if (!search_stop.stop) {
+        return 0;
     }
-    return augpath;
+    if (!search_stop.stopped &&
+        ++search_stop.visits % SEARCH_STOP_VERTICES == 0) {
+        search_stop.stopped = search_stop.stop(search_stop.arg);
+    }
+    return search_stop.stopped;
 }
 
 // Used for printing elements on the queue during bfs
@@ -90,34 +126,52 @@ void print_int_elm(void* x) {
 
 // Depth first search
 struct list* dfs(struct graph* g) {
+    TRACE_BEGIN("search");
     int* visited = malloc(g->size * sizeof(int));
-
-    struct edge* parent[g->size - 1];
+    struct edge** parent = malloc(g->size * sizeof(struct edge*));
+    int sink = -1;
 
     for (int i = 0; i < g->size; ++i) {
         visited[i] = -1;
         parent[i] = NULL;
     }
+    search_stop.stopped = 0;
 
-    for (int u = 0; u < g->size; u++) {
-        if (visited[u] == -1) {
-            dfs_visit(g, u, visited, parent);
+    // Search from every source that can still send flow until a sink that
+    // can still receive flow is found
+    for (int u = 0; u < g->size && sink == -1 && !search_stop.stopped; u++) {
+        if (visited[u] == -1 && graph_supply_left(g, u) > 0) {
+            sink = dfs_visit(g, u, visited, parent);
         }
     }
     free(visited);
+    TRACE_END("search");
 
-    // All vertices are visited and an augmenting path can be build
-    // travelling  back from the sink to the source
-    struct list* augmenting_path = build_augmenting_path(parent, g->size - 1);
+    // An augmenting path can be build travelling back from the sink to the
+    // source
+    struct list* augmenting_path = NULL;
+    if (sink != -1 && !search_stop.stopped) {
+        augmenting_path = build_augmenting_path(parent, sink);
+    }
+    free(parent);
     return augmenting_path;
 }
 
-void dfs_visit(struct graph* g, int u, int visited[], struct edge* parent[]) {
+int dfs_visit(struct graph* g, int u, int visited[], struct edge* parent[]) {
     visited[u] = 1;
+    if (search_stopped()) {
+        return -1;
+    }
+
+    // A sink is found. Its parent edges are already set, hence the rest of the
+    // search cannot change the path to it.
+    if (graph_demand_left(g, u) > 0) {
+        return u;
+    }
 
     struct element* adj = g->adj_array[u]->head;
     struct edge* adj_e;
-    int v, cfe;
+    int v, cfe, sink;
 
     // Iterate u's adjacency list
     for (int i = 0; i < g->adj_array[u]->size; i++) {
@@ -129,31 +183,38 @@ void dfs_visit(struct graph* g, int u, int visited[], struct edge* parent[]) {
         // If v is not visited and there is residual capacity
         // on the edge (u,v) then set v's parent to u and visit v
         if (visited[v] == -1 && cfe) {
-            parent[v - 1] = adj_e;
-            dfs_visit(g, v, visited, parent);
+            parent[v] = adj_e;
+            sink = dfs_visit(g, v, visited, parent);
+            if (sink != -1 || search_stop.stopped) {
+                return sink;
+            }
         }
         adj = adj->next;
     }
+    return -1;
 }
 
 struct list* bfs(struct graph* g) {
-
+    TRACE_BEGIN("search");
     int visited[g->size];
-    struct edge* parents[g->size - 1];
+    struct edge* parents[g->size];
+    int sink = -1;
 
-    for (int i = 1; i < g->size; ++i) {
+    struct queue* q = queue_init();
+
+    // Every source that can still send flow is a start of the search
+    for (int i = 0; i < g->size; ++i) {
         //g->parents[i] = NULL;
         parents[i] = NULL;
         visited[i] = -1;
+        if (graph_supply_left(g, i) > 0) {
+            visited[i] = 0;
+            enqueue(q, &g->vertices[i]);
+        }
     }
-    //g->parents[0] = NULL;
-    parents[0] = NULL;
-    visited[0] = 0;
 
-    struct queue* q = queue_init();
-    enqueue(q, &g->vertices[0]); // enqueue the source s
-
-    while (!queue_is_empty(q)) {
+    search_stop.stopped = 0;
+    while (sink == -1 && !queue_is_empty(q) && !search_stopped()) {
         int u = *(int *)(dequeue(q));
 
         struct element* adj = g->adj_array[u]->head;
@@ -171,38 +232,395 @@ struct list* bfs(struct graph* g) {
             if ((visited[v] == -1) && (cfe > 0)) {
                 visited[v] = 1;
                 enqueue(q, &g->vertices[v]);
-                parents[v - 1] = v_edg;
+                parents[v] = v_edg;
                 //g->parents[v - 1] = v_edg;
+
+                // The first sink reached ends a shortest augmenting path
+                if (graph_demand_left(g, v) > 0) {
+                    sink = v;
+                    break;
+                }
             }
             adj = adj->next;
         }
     }
-    container_free(q, q->head, 1, 0);
+    container_free(q, q->head, 0, 0);
+    TRACE_END("search");
 
-    struct list* augmenting_path = build_augmenting_path(parents, g->size - 1);
+    if (sink == -1 || search_stop.stopped) {
+        return NULL;
+    }
+    struct list* augmenting_path = build_augmenting_path(parents, sink);
     //struct list* augmenting_path = build_augmenting_path(g->parents, g->size - 1);
     return augmenting_path;
 }
 
+long get_min_cut(struct graph* g, int* source_side) {
+    int* side = source_side ? source_side : malloc(g->size * sizeof(int));
+    int* stack = malloc(g->size * sizeof(int));
+    int top = 0;
+    long capacity = 0;
+
+    for (int i = 0; i < g->size; i++) {
+        side[i] = graph_supply_left(g, i) > 0;
+        if (side[i]) {
+            stack[top++] = i;
+        }
+    }
+
+    // Search the residual graph from the sources
+    while (top) {
+        int u = stack[--top];
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            if (!side[e->to] && get_cfe(e) > 0) {
+                side[e->to] = 1;
+                stack[top++] = e->to;
+            }
+        }
+    }
+
+    // Sum the capacities of the edges leaving the source side. A virtual arc
+    // is cut if a source is on the sink side or a sink on the source side.
+    for (int u = 0; u < g->size; u++) {
+        if (!side[u] && g->supply[u]) {
+            capacity += g->supply[u];
+        }
+        if (side[u] && g->demand[u]) {
+            capacity += g->demand[u];
+        }
+        if (!side[u]) {
+            continue;
+        }
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            if (e->original && !side[e->to]) {
+                capacity += e->capacity;
+            }
+        }
+    }
+
+    free(stack);
+    if (!source_side) {
+        free(side);
+    }
+    return capacity;
+}
+
 int get_maximum_flow(struct graph* g,
                      struct list* search_algorithm(struct graph*)) {
+    return augment_paths(g, search_algorithm, LONG_MAX);
+}
+
+int augment_paths(struct graph* g,
+                  struct list* search_algorithm(struct graph*), long paths) {
     int cfp, maxflow;
     struct list* augpath;
-    //int cnt;
-    //cnt = 0;
     maxflow = 0;
 
     // Get an augmenting path using the file pointer
     // to a search algorithm (bfs or dfs)
-    while ((augpath = (*search_algorithm)(g))) {
+    while (paths-- > 0 && (augpath = (*search_algorithm)(g))) {
         cfp = get_cfp(augpath); // get residual path capacity
+
+        // The virtual arcs from the super source to the path's source and from
+        // its sink to the super sink are part of the path too
+        int s = ((struct edge*)augpath->head->this)->from;
+        int t = get_path_sink(augpath);
+        int s_left = graph_supply_left(g, s);
+        int t_left = graph_demand_left(g, t);
+        cfp = cfp < s_left ? cfp : s_left;
+        cfp = cfp < t_left ? cfp : t_left;
+        g->supplied[s] += cfp;
+        g->absorbed[t] += cfp;
+
         augment(augpath, cfp);
         maxflow += cfp;
         container_free(augpath, augpath->head, 0, 0);
-        //++cnt;
+        TRACE_COUNT("augmentations", 1);
     }
-//    printf("\nThe number of iterations to find maxflow is: %d\n\n", cnt);
 
     return maxflow;
 }
 
+
+// Breadth first search from the sources with supply left in the residual
+// graph, for Dinic's algorithm. Sets the level of every vertex, -1 if it is
+// not reached. Vertices at the nearest sink's level are not searched from.
+// Return: The level of the nearest sink with demand left, -1 if there is none
+static int dinic_levels(struct graph* g, int* level, int* queue) {
+    int head = 0, tail = 0, sink_level = -1;
+
+    for (int v = 0; v < g->size; v++) {
+        level[v] = -1;
+        if (graph_supply_left(g, v) > 0) {
+            level[v] = 0;
+            queue[tail++] = v;
+        }
+    }
+    while (head < tail) {
+        int u = queue[head++];
+        if (sink_level != -1 && level[u] >= sink_level) {
+            break;
+        }
+        if (graph_demand_left(g, u) > 0) {
+            sink_level = level[u];
+            continue;
+        }
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            if (level[e->to] == -1 && get_cfe(e) > 0) {
+                level[e->to] = level[u] + 1;
+                queue[tail++] = e->to;
+            }
+        }
+    }
+    return sink_level;
+}
+
+// Pushes flow on an edge, or takes it back from its reverse edge
+static void dinic_push(struct edge* e, int amount) {
+    if (e->original) {
+        e->flow += amount;
+    }
+    else {
+        e->reverse_edge->flow -= amount;
+    }
+}
+
+int dinic(struct graph* g) {
+    int n = g->size, maxflow = 0, sink_level;
+    int* level = malloc(n * sizeof(int));
+    int* queue = malloc(n * sizeof(int));
+    struct element** current = malloc(n * sizeof(struct element*));
+    struct edge** path = malloc(n * sizeof(struct edge*));
+    assert(level && queue && current && path);
+
+    while ((sink_level = dinic_levels(g, level, queue)) != -1) {
+        for (int v = 0; v < n; v++) {
+            current[v] = g->adj_array[v]->head;
+        }
+
+        // Blocking flow by depth first search from each source. The current
+        // arc of a vertex is the first one that can still be admissible.
+        for (int s = 0; s < n; s++) {
+            int length = 0, v = s;
+
+            while (level[s] == 0 && graph_supply_left(g, s) > 0) {
+                if (level[v] == sink_level && graph_demand_left(g, v) > 0) {
+                    int cfp = graph_supply_left(g, s);
+                    cfp = graph_demand_left(g, v) < cfp ?
+                          graph_demand_left(g, v) : cfp;
+                    for (int i = 0; i < length; i++) {
+                        cfp = get_cfe(path[i]) < cfp ? get_cfe(path[i]) : cfp;
+                    }
+                    for (int i = 0; i < length; i++) {
+                        dinic_push(path[i], cfp);
+                    }
+                    g->supplied[s] += cfp;
+                    g->absorbed[v] += cfp;
+                    maxflow += cfp;
+
+                    // Go back to the tail of the first saturated edge
+                    for (int i = 0; i < length; i++) {
+                        if (get_cfe(path[i]) == 0) {
+                            length = i;
+                            break;
+                        }
+                    }
+                    v = length ? path[length - 1]->to : s;
+                    continue;
+                }
+
+                while (current[v]) {
+                    struct edge* e = current[v]->this;
+                    if (get_cfe(e) > 0 && level[e->to] == level[v] + 1) {
+                        break;
+                    }
+                    current[v] = current[v]->next;
+                }
+
+                // Advance, or retreat from a dead end
+                if (current[v]) {
+                    path[length++] = current[v]->this;
+                    v = path[length - 1]->to;
+                }
+                else {
+                    level[v] = -1;
+                    if (!length) {
+                        break;
+                    }
+                    v = path[--length]->from;
+                    current[v] = current[v]->next;
+                }
+            }
+        }
+    }
+
+    free(level);
+    free(queue);
+    free(current);
+    free(path);
+    return maxflow;
+}
+
+/* The state of Dinic's algorithm with dynamic trees. The trees are over the
+ * vertices and a super source S = |V| and super sink T = |V| + 1. A tree arc
+ * from v is an edge, or a virtual arc from S to a source or from a sink to T.
+ * 'linked' is the arc's residual capacity when it was linked. The cost of v
+ * in the trees is its residual capacity now. */
+struct dinic_trees {
+    struct graph* g;
+    struct linkcut* t;
+    int* parent;            // Tree parent of each node, -1 for roots
+    struct edge** edge;     // The edge to the parent, NULL if virtual
+    long* linked;
+};
+
+// Cuts the arc from v to its parent and stores the flow pushed on it
+static void dinic_cut(struct dinic_trees* d, int v) {
+    struct graph* g = d->g;
+    int w = d->parent[v];
+    int amount = d->linked[v] - linkcut_cut(d->t, v);
+
+    if (v == g->size) {
+        g->supplied[w] += amount;
+    }
+    else if (w == g->size + 1) {
+        g->absorbed[v] += amount;
+    }
+    else {
+        dinic_push(d->edge[v], amount);
+    }
+    d->parent[v] = -1;
+}
+
+static void dinic_link(struct dinic_trees* d, int v, int w, struct edge* e,
+                       long capacity) {
+    linkcut_link(d->t, v, w, capacity);
+    d->parent[v] = w;
+    d->edge[v] = e;
+    d->linked[v] = capacity;
+}
+
+int dinic_dynamic_trees(struct graph* g) {
+    int n = g->size, S = n, T = n + 1, sink_level;
+    long maxflow = 0;
+    struct dinic_trees d;
+    d.g = g;
+    d.t = linkcut_init(n + 2);
+    d.parent = malloc((n + 2) * sizeof(int));
+    d.edge   = malloc((n + 2) * sizeof(struct edge*));
+    d.linked = malloc((n + 2) * sizeof(long));
+    int* level   = malloc((n + 2) * sizeof(int));
+    int* queue   = malloc(n * sizeof(int));
+    int* sources = malloc(n * sizeof(int));
+    char* sink_tried = malloc(n);
+    struct element** current = malloc(n * sizeof(struct element*));
+    assert(d.parent && d.edge && d.linked && level && queue && sources &&
+           sink_tried && current);
+
+    for (int v = 0; v < n + 2; v++) {
+        d.parent[v] = -1;
+    }
+
+    while ((sink_level = dinic_levels(g, level, queue)) != -1) {
+        int n_sources = 0, next_source = 0;
+        for (int v = 0; v < n; v++) {
+            current[v] = g->adj_array[v]->head;
+            sink_tried[v] = 0;
+            if (level[v] == 0) {
+                sources[n_sources++] = v;
+            }
+        }
+
+        while (1) {
+            int v = linkcut_root(d.t, S);
+
+            // A path from S to T. Push the least residual capacity on it and
+            // cut the arcs it saturates.
+            if (v == T) {
+                long amount = linkcut_cost(d.t, linkcut_path_min(d.t, S));
+                linkcut_path_add(d.t, S, -amount);
+                maxflow += amount;
+
+                int u;
+                while ((u = linkcut_path_min(d.t, S)) != T &&
+                       linkcut_cost(d.t, u) == 0) {
+                    if (u == S) {
+                        ++next_source;
+                    }
+                    dinic_cut(&d, u);
+                }
+                continue;
+            }
+
+            // Advance from the root, S to the next source left
+            if (v == S) {
+                while (next_source < n_sources &&
+                       (level[sources[next_source]] != 0 ||
+                        graph_supply_left(g, sources[next_source]) <= 0)) {
+                    ++next_source;
+                }
+                if (next_source == n_sources) {
+                    break;
+                }
+                dinic_link(&d, S, sources[next_source], NULL,
+                           graph_supply_left(g, sources[next_source]));
+                continue;
+            }
+
+            while (current[v]) {
+                struct edge* e = current[v]->this;
+                if (get_cfe(e) > 0 && level[e->to] == level[v] + 1) {
+                    break;
+                }
+                current[v] = current[v]->next;
+            }
+            if (current[v]) {
+                struct edge* e = current[v]->this;
+                dinic_link(&d, v, e->to, e, get_cfe(e));
+                continue;
+            }
+            // The virtual arc to T is after the edges
+            if (!sink_tried[v] && level[v] == sink_level &&
+                graph_demand_left(g, v) > 0) {
+                sink_tried[v] = 1;
+                dinic_link(&d, v, T, NULL, graph_demand_left(g, v));
+                continue;
+            }
+
+            // v is a dead end. Cut the tree arcs into it.
+            level[v] = -1;
+            for (struct element* cur = g->adj_array[v]->head; cur;
+                 cur = cur->next) {
+                int u = ((struct edge*)cur->this)->to;
+                if (d.parent[u] == v) {
+                    dinic_cut(&d, u);
+                }
+            }
+            if (d.parent[S] == v) {
+                dinic_cut(&d, S);
+                ++next_source;
+            }
+        }
+
+        // Store the flow on the arcs still in the trees
+        for (int v = 0; v < n + 2; v++) {
+            if (d.parent[v] != -1) {
+                dinic_cut(&d, v);
+            }
+        }
+    }
+
+    linkcut_free(d.t);
+    free(d.parent);
+    free(d.edge);
+    free(d.linked);
+    free(level);
+    free(queue);
+    free(sources);
+    free(sink_tried);
+    free(current);
+    return maxflow;
+}
@@ -6,30 +6,49 @@
 #include "edge.h"
 
 /* Do breadth first on a graph and return pointer to list containing the
- * augmenting path
+ * augmenting path. The search starts in all sources with supply left and stops
+ * at the first sink with demand left.
  * Args:    - Pointer to the graph
- * Return:  A pointer to list containing the augmenting path*/
+ * Return:  A pointer to list containing the augmenting path. NULL if there is
+ *          no augmenting path */
 struct list* bfs(struct graph*);
 
-/* Do depth first search on a graph and return pointer
+/* Do depth first search on a graph and return pointer. The search starts in
+ * the sources with supply left and stops at the first sink with demand left.
  * Args:    - Pointer to the graph
- * Return:  A pointer to list containing the augmenting path*/
+ * Return:  A pointer to list containing the augmenting path. NULL if there is
+ *          no augmenting path */
 struct list* dfs(struct graph* g);
 
+/* Vertices bfs and dfs visit between calls of the stop function */
+#define SEARCH_STOP_VERTICES 64
+
+/* Makes bfs and dfs in this thread give up and find no path once a function
+ * returns 1. It is called every SEARCH_STOP_VERTICES vertices they visit.
+ * Args:    - The function, NULL for none
+ *          - What it is called with
+ * Return:  Nothing */
+void search_set_stop(int (*stop)(void*), void* arg);
+
 /* Subrutine of depth first search that visits vertex u's adjacent vertices if
  * they have not been visited before and there is residual capacity on (u,v)
  * Args:    - Pointer to the graph
  *          - Vertex u
  *          - Array that tells which vertices have been visited
  *          - Array with edges that goes from vertices parents to vertex.
- * Return:  Nothing */
-void dfs_visit(struct graph* g, int u, int visited[], struct edge* parents[]);
+ * Return:  The sink found with demand left. -1 if no sink was found */
+int dfs_visit(struct graph* g, int u, int visited[], struct edge* parents[]);
 
 /* Find the minimum capacity of the augmenting path
  * Args:    - Pointer to augmenting path in list
  * Return:  The path capacity */
 int get_cfp(struct list* augpath);
 
+/* Find the vertex an augmenting path ends in
+ * Args:    - Pointer to augmenting path in list
+ * Return:  The sink of the path */
+int get_path_sink(struct list* augpath);
+
 /* Get the residual capacity of edge
  * Args:    - Pointer to edge
  * Return:  Residual capacity of edge */
@@ -41,13 +60,50 @@ int get_cfe(struct edge*);
  * Return:  Nothing */
 void augment(struct list* path, int cfp);
 
-/* Get maximum flow on graph using search_algorithm to traverse graph
+/* Get maximum flow on graph using search_algorithm to traverse graph. The
+ * supply of the sources and demand of the sinks bound the flow.
  * Args:    - Pointer to the graph
  *          - Function pointer to a graph search algorithm that takes a graph
  *          and returns a list pointer holding the path to augment
  * Return:  The maximum flow of graph g */
 int get_maximum_flow(struct graph* g, struct list*(search_algo)(struct graph*));
 
+/* Augments at most a number of paths found by search_algorithm, starting from
+ * the flow the graph has. get_maximum_flow is this without a limit.
+ * Args:    - Pointer to the graph
+ *          - Function pointer to a graph search algorithm like for
+ *            get_maximum_flow
+ *          - The most paths to augment
+ * Return:  The flow added. A path adds at least 1, so with a limit of 1
+ *          the flow is maximum when this is 0. */
+int augment_paths(struct graph* g, struct list*(search_algo)(struct graph*),
+                  long paths);
+
+/* Dinic's algorithm. The level graph is found by breadth first search from
+ * the sources, and a blocking flow in it by depth first searches that keep a
+ * current arc for each vertex and go back to the first saturated edge after
+ * each augmentation.
+ * Args:    - Pointer to the graph
+ * Return:  The maximum flow */
+int dinic(struct graph* g);
+
+/* Dinic's algorithm with the blocking flow found using Sleator-Tarjan dynamic
+ * trees, see linkcut.h. The partial paths found are kept in the trees, so an
+ * augmentation and the search for the next path do not walk them again. This
+ * takes O(|V||E| log |V|) time in total instead of O(|V|^2 |E|).
+ * Args:    - Pointer to the graph
+ * Return:  The maximum flow */
+int dinic_dynamic_trees(struct graph* g);
+
+/* Find the minimum cut given by a maximum flow in the graph. The source side
+ * is the vertices reachable from a source with supply left in the residual
+ * graph.
+ * Args:    - Pointer to the graph holding a maximum flow
+ *          - Array that is set to 1 for vertices on the source side and 0 for
+ *            the rest. Can be NULL.
+ * Return:  The capacity of the cut, including the virtual terminal arcs */
+long get_min_cut(struct graph* g, int* source_side);
+
 /* Cast void* to int*, dereference and print it
  * Args:    - Void pointer to element
  * Return:  Nothing */
@@ -0,0 +1,780 @@
+#define _GNU_SOURCE
+#include "mincost.h"
+#include "csr.h"
+#include "list.h"
+#include "loaddimacs.h"
+#include "placement.h"
+#include "pushrelabel.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+
+// Adds arc i of the file, u -> v, to the problem
+static void add_arc(struct mincost_problem* p, int i, int u, int v, int lower,
+                    int capacity, int cost) {
+    assert(0 <= u && u < p->g->size && 0 <= v && v < p->g->size);
+    assert(0 <= lower && lower <= capacity);
+    p->tail[i] = u;
+    p->head[i] = v;
+    p->lower[i] = lower;
+    p->capacity[i] = capacity;
+    p->cost[i] = cost;
+    p->base += (long)lower * cost;
+    if (u == v) {
+        p->edge[i] = NULL;
+        return;
+    }
+    graph_add_edges(p->g, u, v, capacity - lower);
+    // The forward edge is first in u's list
+    p->edge[i] = p->g->adj_array[u]->head->this;
+    p->supply[u] -= lower;
+    p->supply[v] += lower;
+}
+
+struct mincost_problem* mincost_read(char* path) {
+    FILE* fp = fopen(path, "r");
+    assert(fp != NULL);
+    struct mincost_problem* p = calloc(1, sizeof(struct mincost_problem));
+    assert(p != NULL);
+    int n = 0, m = 0;
+    char* line = NULL;
+    size_t len = 0;
+
+    while (getline(&line, &len, fp) != EOF) {
+        char* s = line + 1;
+        int id, u, v, lower, capacity, cost, supply, read;
+        switch (line[0]) {
+            case 'p': // p min |V| |E|
+                assert(p->g == NULL);
+                read = sscanf(line, "p min %d %d", &n, &m);
+                assert(read == 2);
+                p->g = graph_init(n);
+                graph_clear_terminals(p->g);
+                p->tail      = malloc(m * sizeof(int));
+                p->head      = malloc(m * sizeof(int));
+                p->lower     = malloc(m * sizeof(int));
+                p->capacity  = malloc(m * sizeof(int));
+                p->cost      = malloc(m * sizeof(int));
+                p->edge      = malloc(m * sizeof(struct edge*));
+                p->loop_flow = calloc(m, sizeof(int));
+                p->supply    = calloc(n, sizeof(long));
+                assert(p->tail && p->head && p->lower && p->capacity &&
+                       p->cost && p->edge && p->loop_flow && p->supply);
+                break;
+            case 'n': // n id supply
+                assert(p->g != NULL);
+                read = read_int(&s, &id) && read_int(&s, &supply);
+                assert(read);
+                assert(1 <= id && id <= n);
+                p->supply[id - 1] += supply;
+                break;
+            case 'a': // a from to lower capacity cost
+                assert(p->g != NULL && p->arcs < m);
+                read = read_int(&s, &u) && read_int(&s, &v) &&
+                       read_int(&s, &lower) && read_int(&s, &capacity) &&
+                       read_int(&s, &cost);
+                assert(read);
+                add_arc(p, p->arcs++, u - 1, v - 1, lower, capacity, cost);
+                break;
+        }
+    }
+    free(line);
+    fclose(fp);
+    assert(p->g != NULL);
+
+    // The vertices with supply are the sources of the graph and those with
+    // demand its sinks
+    for (int w = 0; w < n; w++) {
+        p->balance += p->supply[w];
+        assert(-INT_MAX < p->supply[w] && p->supply[w] < INT_MAX);
+        if (0 < p->supply[w]) {
+            graph_add_source(p->g, w, p->supply[w]);
+        }
+        else if (p->supply[w] < 0) {
+            graph_add_sink(p->g, w, -p->supply[w]);
+        }
+    }
+    return p;
+}
+
+void mincost_free(struct mincost_problem* p) {
+    graph_free(p->g);
+    free(p->tail);
+    free(p->head);
+    free(p->lower);
+    free(p->capacity);
+    free(p->cost);
+    free(p->edge);
+    free(p->loop_flow);
+    free(p->supply);
+    free(p->price);
+    free(p);
+}
+
+// The state of cost scaling on the arcs of csr.h
+struct scaling {
+    struct csr* c;
+    long* cost;             // Times n + 1, the negated cost on reverse arcs
+    long* price;
+    long* excess;
+    int* current;
+    int* queue;             // n + 1 entries
+    long epsilon;
+    long since_update;      // Relabels since the last global price update
+
+    // Price refinement
+    long* distance;
+    char* queued;
+
+    // Global price updates, buckets of vertices by rank
+    long* rank;
+    int* bucket;
+    int* next;
+    int* prev;
+    char* scanned;
+
+    struct mincost_stats* stats;
+};
+
+static inline long reduced_cost(struct scaling* s, int u, int a) {
+    return s->cost[a] + s->price[u] - s->price[s->c->head[a]];
+}
+
+static void bucket_insert(struct scaling* s, int v, int k) {
+    s->next[v] = s->bucket[k];
+    s->prev[v] = -1;
+    if (s->bucket[k] != -1) {
+        s->prev[s->bucket[k]] = v;
+    }
+    s->bucket[k] = v;
+}
+
+static void bucket_remove(struct scaling* s, int v, int k) {
+    if (s->prev[v] != -1) {
+        s->next[s->prev[v]] = s->next[v];
+    }
+    else {
+        s->bucket[k] = s->next[v];
+    }
+    if (s->next[v] != -1) {
+        s->prev[s->next[v]] = s->prev[v];
+    }
+}
+
+// Goldberg's global price update. The rank of a vertex is the least sum
+// over a path to a vertex with a deficit of floor(c_p / epsilon) + 1 for the
+// arcs of non-negative reduced cost, the arcs of negative reduced cost being
+// free. The search goes out from the deficits over the arcs backwards, rank
+// by rank, until it has reached all the vertices with excess or rank n.
+// Lowering each price by rank times epsilon keeps the flow epsilon-optimal,
+// and the vertices the search did not get to are lowered by the rank it
+// stopped at.
+static void global_update(struct scaling* s) {
+    struct csr* c = s->c;
+    int n = c->n, active = 0, k;
+    for (int v = 0; v < n; v++) {
+        s->rank[v] = n;
+        s->scanned[v] = 0;
+        s->bucket[v] = -1;
+    }
+    for (int v = 0; v < n; v++) {
+        active += 0 < s->excess[v];
+        if (s->excess[v] < 0) {
+            s->rank[v] = 0;
+            bucket_insert(s, v, 0);
+        }
+    }
+    for (k = 0; k < n && 0 < active; k++) {
+        while (s->bucket[k] != -1 && 0 < active) {
+            int y = s->bucket[k];
+            bucket_remove(s, y, k);
+            s->scanned[y] = 1;
+            active -= 0 < s->excess[y];
+            for (int b = c->first[y]; b < c->first[y + 1]; b++) {
+                int x = c->head[b], a = c->rev[b];
+                if (s->scanned[x] || c->residual[a] <= 0) {
+                    continue;
+                }
+                long cp = reduced_cost(s, x, a);
+                long r = k + (cp < 0 ? 0 : cp / s->epsilon + 1);
+                if (r < s->rank[x]) {
+                    if (s->rank[x] < n) {
+                        bucket_remove(s, x, s->rank[x]);
+                    }
+                    s->rank[x] = r;
+                    bucket_insert(s, x, r);
+                }
+            }
+        }
+        if (active == 0) {
+            break;
+        }
+    }
+    for (int v = 0; v < n; v++) {
+        s->price[v] -= (s->scanned[v] ? s->rank[v] : k) * s->epsilon;
+        s->current[v] = c->first[v];
+    }
+    ++s->stats->global_updates;
+}
+
+// Looks for prices that make the flow epsilon-optimal, with Bellman-Ford
+// from all vertices at once over arcs of length c_p + epsilon
+// Return: 1 if it found them and moved the prices, 0 if it gave up
+static int price_refine(struct scaling* s) {
+    struct csr* c = s->c;
+    int n = c->n, head = 0, tail = 0;
+    long work = 0, budget = MINCOST_REFINE_PASSES * (long)c->m;
+    for (int u = 0; u < n; u++) {
+        s->distance[u] = 0;
+        s->queued[u] = 0;
+    }
+    // Only the tails of the arcs that are too negative need to be looked at
+    for (int u = 0; u < n; u++) {
+        for (int a = c->first[u]; a < c->first[u + 1]; a++) {
+            if (0 < c->residual[a] && reduced_cost(s, u, a) < -s->epsilon) {
+                s->queue[tail++] = u;
+                s->queued[u] = 1;
+                break;
+            }
+        }
+    }
+    while (head != tail) {
+        int u = s->queue[head];
+        head = head == n ? 0 : head + 1;
+        s->queued[u] = 0;
+        work += c->first[u + 1] - c->first[u];
+        if (budget < work) {
+            return 0;
+        }
+        for (int a = c->first[u]; a < c->first[u + 1]; a++) {
+            int v = c->head[a];
+            long d = s->distance[u] + reduced_cost(s, u, a) + s->epsilon;
+            if (0 < c->residual[a] && d < s->distance[v]) {
+                s->distance[v] = d;
+                if (!s->queued[v]) {
+                    s->queue[tail] = v;
+                    tail = tail == n ? 0 : tail + 1;
+                    s->queued[v] = 1;
+                }
+            }
+        }
+    }
+    for (int u = 0; u < n; u++) {
+        s->price[u] += s->distance[u];
+    }
+    return 1;
+}
+
+static void relabel_price(struct scaling* s, int u) {
+    struct csr* c = s->c;
+    long highest = LONG_MIN;
+    for (int a = c->first[u]; a < c->first[u + 1]; a++) {
+        long p = s->price[c->head[a]] - s->cost[a];
+        if (0 < c->residual[a] && highest < p) {
+            highest = p;
+        }
+    }
+    // Excess can always go back the way it came
+    assert(highest != LONG_MIN);
+    s->price[u] = highest - s->epsilon;
+    s->current[u] = c->first[u];
+    ++s->stats->relabels;
+}
+
+// Pushes u's excess on arcs of negative reduced cost, relabeling u when
+// they run out
+static void discharge(struct scaling* s, int u, int* tail) {
+    struct csr* c = s->c;
+    int n = c->n;
+    while (0 < s->excess[u]) {
+        if (s->current[u] == c->first[u + 1]) {
+            relabel_price(s, u);
+            if (n <= ++s->since_update) {
+                global_update(s);
+                s->since_update = 0;
+            }
+            continue;
+        }
+        int a = s->current[u], v = c->head[a];
+        if (0 < c->residual[a] && reduced_cost(s, u, a) < 0) {
+            long amount = s->excess[u] < c->residual[a] ? s->excess[u]
+                                                        : c->residual[a];
+            c->residual[a] -= amount;
+            c->residual[c->rev[a]] += amount;
+            s->excess[u] -= amount;
+            // A vertex is queued when it gets excess, so it is in the
+            // queue at most once
+            if (s->excess[v] <= 0 && 0 < s->excess[v] + amount) {
+                s->queue[*tail] = v;
+                *tail = *tail == n ? 0 : *tail + 1;
+            }
+            s->excess[v] += amount;
+            ++s->stats->pushes;
+        }
+        else {
+            ++s->current[u];
+        }
+    }
+}
+
+// Makes the flow epsilon-optimal from 2 epsilon or so optimal
+static void refine(struct scaling* s) {
+    struct csr* c = s->c;
+    int n = c->n, head = 0, tail = 0;
+    for (int u = 0; u < n; u++) {
+        for (int a = c->first[u]; a < c->first[u + 1]; a++) {
+            int r = c->residual[a];
+            if (0 < r && reduced_cost(s, u, a) < 0) {
+                c->residual[a] = 0;
+                c->residual[c->rev[a]] += r;
+                s->excess[u] -= r;
+                s->excess[c->head[a]] += r;
+            }
+        }
+    }
+    global_update(s);
+    s->since_update = 0;
+    for (int v = 0; v < n; v++) {
+        if (0 < s->excess[v]) {
+            s->queue[tail++] = v;
+        }
+    }
+    while (head != tail) {
+        int u = s->queue[head];
+        head = head == n ? 0 : head + 1;
+        discharge(s, u, &tail);
+    }
+}
+
+int mincost_solve(struct mincost_problem* p) {
+    struct graph* g = p->g;
+    int n = g->size;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    memset(&p->stats, 0, sizeof(p->stats));
+    p->solved = 0;
+
+    // A flow that meets the supplies, from pr-fifo
+    long needed = 0;
+    for (int v = 0; v < n; v++) {
+        needed += 0 < p->supply[v] ? p->supply[v] : 0;
+    }
+    graph_reset_flow(g);
+    p->value = push_relabel_fifo(g);
+    if (p->balance != 0 || p->value != needed) {
+        return 1;
+    }
+
+    struct scaling s;
+    struct csr* c = s.c = csr_build(g);
+    int m = c->m;
+    long scale = n + 1, largest = 1;
+    s.cost     = array_alloc((m + 1) * sizeof(long));
+    s.price    = calloc(n, sizeof(long));
+    s.excess   = array_calloc(n, sizeof(long));
+    s.current  = array_alloc(n * sizeof(int));
+    s.queue    = array_alloc((n + 1) * sizeof(int));
+    s.distance = array_alloc(n * sizeof(long));
+    s.queued   = array_alloc(n);
+    s.rank     = array_alloc(n * sizeof(long));
+    s.bucket   = array_alloc((n + 1) * sizeof(int));
+    s.next     = array_alloc(n * sizeof(int));
+    s.prev     = array_alloc(n * sizeof(int));
+    s.scanned  = array_alloc(n);
+    assert(s.price);
+    s.stats = &p->stats;
+
+    // The arc of each edge is found by setting the forward edges' 'from' to
+    // their arc of the file for a moment, like csr_build does
+    for (int i = 0; i < p->arcs; i++) {
+        if (p->edge[i]) {
+            p->edge[i]->from = i;
+        }
+    }
+    for (int a = 0; a < m; a++) {
+        struct edge* e = c->edges[a];
+        s.cost[a] = e->original ? scale * p->cost[e->from]
+                                : -scale * p->cost[e->reverse_edge->from];
+        largest = largest < labs(s.cost[a]) ? labs(s.cost[a]) : largest;
+    }
+    for (int u = 0; u < n; u++) {
+        for (int a = c->first[u]; a < c->first[u + 1]; a++) {
+            c->edges[a]->from = u;
+        }
+    }
+
+    // With all prices 0 the flow is 'largest'-optimal
+    s.epsilon = largest;
+    while (1 < s.epsilon) {
+        s.epsilon = s.epsilon / MINCOST_ALPHA < 1 ? 1
+                                                  : s.epsilon / MINCOST_ALPHA;
+        ++p->stats.phases;
+        if (price_refine(&s)) {
+            ++p->stats.refined;
+            continue;
+        }
+        refine(&s);
+    }
+    csr_store_flow(c);
+
+    // A loop of negative cost is a cycle to fill
+    p->total = p->base;
+    for (int i = 0; i < p->arcs; i++) {
+        if (p->edge[i]) {
+            p->total += (long)p->edge[i]->flow * p->cost[i];
+            continue;
+        }
+        p->loop_flow[i] = p->cost[i] < 0 ? p->capacity[i] : p->lower[i];
+        p->total += (long)(p->loop_flow[i] - p->lower[i]) * p->cost[i];
+    }
+    free(p->price);
+    p->price = s.price;
+    p->solved = 1;
+
+    csr_free(c);
+    array_free(s.cost);
+    array_free(s.excess);
+    array_free(s.current);
+    array_free(s.queue);
+    array_free(s.distance);
+    array_free(s.queued);
+    array_free(s.rank);
+    array_free(s.bucket);
+    array_free(s.next);
+    array_free(s.prev);
+    array_free(s.scanned);
+    p->stats.seconds = seconds_since(&start);
+    return 0;
+}
+
+int mincost_arc_flow(struct mincost_problem* p, int i) {
+    return p->edge[i] ? p->edge[i]->flow + p->lower[i] : p->loop_flow[i];
+}
+
+int mincost_check(struct mincost_problem* p) {
+    int n = p->g->size, right = p->solved;
+    long scale = n + 1;
+    long* out = calloc(n, sizeof(long));
+    assert(out != NULL);
+    for (int i = 0; right && i < p->arcs; i++) {
+        int u = p->tail[i], v = p->head[i], x = mincost_arc_flow(p, i);
+        right = p->lower[i] <= x && x <= p->capacity[i];
+        if (u == v) {
+            right &= p->cost[i] < 0 ? x == p->capacity[i] : x == p->lower[i];
+            continue;
+        }
+        out[u] += x - p->lower[i];
+        out[v] -= x - p->lower[i];
+        long cp = scale * p->cost[i] + p->price[u] - p->price[v];
+        if (x < p->capacity[i]) {
+            right &= -1 <= cp;
+        }
+        if (p->lower[i] < x) {
+            right &= cp <= 1;
+        }
+    }
+    for (int v = 0; right && v < n; v++) {
+        right = out[v] == p->supply[v];
+    }
+    free(out);
+    return right;
+}
+
+int mincost_write_flow(struct mincost_problem* p, char* path) {
+    FILE* fp = fopen(path, "w");
+    if (fp == NULL) {
+        return 1;
+    }
+    fprintf(fp, "s %ld\n", p->total);
+    for (int i = 0; i < p->arcs; i++) {
+        fprintf(fp, "f %d %d %d\n", p->tail[i] + 1, p->head[i] + 1,
+                mincost_arc_flow(p, i));
+    }
+    return fclose(fp) != 0;
+}
+
+void mincost_print_stats(struct mincost_problem* p, FILE* fp) {
+    fprintf(fp, "mincost: %ld phases, %ld by price refinement, pushes %ld, "
+            "relabels %ld, global price updates %ld\n", p->stats.phases,
+            p->stats.refined, p->stats.pushes, p->stats.relabels,
+            p->stats.global_updates);
+}
+
+int mincost_run(char* path, char* flow, FILE* fp) {
+    struct mincost_problem* p = mincost_read(path);
+    if (mincost_solve(p)) {
+        fprintf(fp, "mincost: no flow meets the supplies\n");
+        mincost_free(p);
+        return 1;
+    }
+    int right = mincost_check(p);
+    fprintf(fp, "mincost: flow %ld, minimum cost %ld, %.3f ms%s\n", p->value,
+            p->total, 1e3 * p->stats.seconds, right ? "" : ", WRONG FLOW");
+    mincost_print_stats(p, fp);
+    int failed = !right;
+    if (flow && mincost_write_flow(p, flow)) {
+        fprintf(stderr, "The flow could not be written\n");
+        failed = 1;
+    }
+    mincost_free(p);
+    return failed;
+}
+
+// A binary heap of vertices by distance, entries pushed again instead of
+// moved up
+struct heap {
+    long* key;
+    int* vertex;
+    int size;
+};
+
+static void heap_push(struct heap* h, long key, int v) {
+    int i = h->size++;
+    while (0 < i && key < h->key[(i - 1) / 2]) {
+        h->key[i] = h->key[(i - 1) / 2];
+        h->vertex[i] = h->vertex[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    h->key[i] = key;
+    h->vertex[i] = v;
+}
+
+static int heap_pop(struct heap* h, long* key) {
+    int top = h->vertex[0];
+    *key = h->key[0];
+    long k = h->key[--h->size];
+    int v = h->vertex[h->size], i = 0;
+    while (2 * i + 1 < h->size) {
+        int child = 2 * i + 1;
+        if (child + 1 < h->size && h->key[child + 1] < h->key[child]) {
+            ++child;
+        }
+        if (k <= h->key[child]) {
+            break;
+        }
+        h->key[i] = h->key[child];
+        h->vertex[i] = h->vertex[child];
+        i = child;
+    }
+    h->key[i] = k;
+    h->vertex[i] = v;
+    return top;
+}
+
+// Successive shortest paths with Dijkstra's algorithm on reduced costs, what
+// mincost_benchmark checks cost scaling with. It works on the arcs of the
+// file alone and not on the graph. The costs must not be negative.
+// Return: The least cost, -1 if no flow meets the supplies
+static long shortest_paths_cost(struct mincost_problem* p) {
+    int n = p->g->size, m = 2 * p->arcs;
+    // Arc 2i is arc i of the file and 2i + 1 its reverse
+    int* first    = malloc(n * sizeof(int));
+    int* next     = malloc(m * sizeof(int));
+    int* head     = malloc(m * sizeof(int));
+    int* residual = malloc(m * sizeof(int));
+    long* left    = malloc(n * sizeof(long));
+    long* dist    = malloc(n * sizeof(long));
+    long* pot     = calloc(n, sizeof(long));
+    int* parent   = malloc(n * sizeof(int));
+    struct heap h;
+    h.key = malloc((m + n) * sizeof(long));
+    h.vertex = malloc((m + n) * sizeof(int));
+    assert(first && next && head && residual && left && dist && pot &&
+           parent && h.key && h.vertex);
+    for (int v = 0; v < n; v++) {
+        first[v] = -1;
+        left[v] = p->supply[v];
+    }
+    long total = p->base;
+    for (int i = 0; i < p->arcs; i++) {
+        assert(0 <= p->cost[i]);
+        int u = p->tail[i], v = p->head[i];
+        head[2 * i] = v;
+        head[2 * i + 1] = u;
+        // A loop can only add cost
+        residual[2 * i] = u == v ? 0 : p->capacity[i] - p->lower[i];
+        residual[2 * i + 1] = 0;
+        next[2 * i] = first[u];
+        first[u] = 2 * i;
+        next[2 * i + 1] = first[v];
+        first[v] = 2 * i + 1;
+    }
+
+    for (;;) {
+        h.size = 0;
+        int sources = 0;
+        for (int v = 0; v < n; v++) {
+            dist[v] = LONG_MAX;
+            parent[v] = -1;
+            if (0 < left[v]) {
+                dist[v] = 0;
+                heap_push(&h, 0, v);
+                ++sources;
+            }
+        }
+        if (sources == 0) {
+            break;
+        }
+        int t = -1;
+        while (0 < h.size) {
+            long d;
+            int u = heap_pop(&h, &d);
+            if (d != dist[u]) {
+                continue;
+            }
+            if (left[u] < 0) {
+                t = u;
+                break;
+            }
+            for (int a = first[u]; a != -1; a = next[a]) {
+                int v = head[a];
+                long cost = a % 2 ? -p->cost[a / 2] : p->cost[a / 2];
+                long dv = d + cost + pot[u] - pot[v];
+                if (0 < residual[a] && dv < dist[v]) {
+                    dist[v] = dv;
+                    parent[v] = a;
+                    heap_push(&h, dv, v);
+                }
+            }
+        }
+        if (t == -1) {
+            total = -1;
+            break;
+        }
+        // The reduced costs stay non-negative on the arcs with residual
+        // capacity
+        for (int v = 0; v < n; v++) {
+            pot[v] += dist[v] < dist[t] ? dist[v] : dist[t];
+        }
+        long amount = -left[t];
+        int s = t;
+        while (parent[s] != -1) {
+            int a = parent[s];
+            amount = residual[a] < amount ? residual[a] : amount;
+            s = head[a ^ 1];
+        }
+        amount = left[s] < amount ? left[s] : amount;
+        for (int v = t; v != s; v = head[parent[v] ^ 1]) {
+            int a = parent[v];
+            residual[a] -= amount;
+            residual[a ^ 1] += amount;
+            total += amount * (a % 2 ? -p->cost[a / 2] : p->cost[a / 2]);
+        }
+        left[s] -= amount;
+        left[t] += amount;
+    }
+
+    free(first);
+    free(next);
+    free(head);
+    free(residual);
+    free(left);
+    free(dist);
+    free(pot);
+    free(parent);
+    free(h.key);
+    free(h.vertex);
+    return total;
+}
+
+// xorshift64*, so the costs are the same on every machine
+static unsigned long next_random(unsigned long* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717UL;
+}
+
+// Writes a 'min' problem of a maximum flow graph whose terminals supply and
+// absorb what they do in its flow, with random costs
+// Return: 0 on success, 1 if the file could not be written
+static int write_costs(struct graph* g, char* path) {
+    FILE* fp = fopen(path, "w");
+    if (fp == NULL) {
+        return 1;
+    }
+    long arcs = 0;
+    for (int u = 0; u < g->size; u++) {
+        arcs += g->adj_array[u]->size;
+    }
+    unsigned long state = 0x9e3779b97f4a7c15UL;
+    fprintf(fp, "c The maximum flow with costs from 0 to %d\n",
+            MINCOST_BENCH_COST);
+    fprintf(fp, "p min %d %ld\n", g->size, arcs / 2);
+    for (int v = 0; v < g->size; v++) {
+        if (g->supplied[v] != g->absorbed[v]) {
+            fprintf(fp, "n %d %d\n", v + 1, g->supplied[v] - g->absorbed[v]);
+        }
+    }
+    for (int u = 0; u < g->size; u++) {
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            if (e->original) {
+                fprintf(fp, "a %d %d 0 %d %lu\n", u + 1, e->to + 1,
+                        e->capacity,
+                        next_random(&state) % (MINCOST_BENCH_COST + 1));
+            }
+        }
+    }
+    return fclose(fp) != 0;
+}
+
+int mincost_benchmark(char** paths, int n_paths, FILE* fp) {
+    int failed = 0;
+    for (int k = 0; k < n_paths; k++) {
+        char* name = strrchr(paths[k], '/') ? strrchr(paths[k], '/') + 1
+                                            : paths[k];
+        char* problem = malloc(strlen(paths[k]) + strlen("_min") + 1);
+        assert(problem != NULL);
+        strcpy(problem, paths[k]);
+        strcat(problem, "_min");
+
+        struct graph* g = read_dimacs_file(paths[k]);
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        long flow = push_relabel_fifo(g);
+        double maximum = seconds_since(&start);
+        int unwritten = write_costs(g, problem);
+        graph_free(g);
+        if (unwritten) {
+            fprintf(fp, "mincost: %s could not be written\n", problem);
+            failed = 1;
+            free(problem);
+            continue;
+        }
+
+        struct mincost_problem* p = mincost_read(problem);
+        int right = mincost_solve(p) == 0 && p->value == flow &&
+                    mincost_check(p);
+        fprintf(fp, "mincost: %-48s %6d vertices %8d arcs, flow %ld, cost "
+                "%ld%s\n", name, p->g->size, p->arcs, flow, p->total,
+                right ? "" : ", WRONG FLOW");
+        fprintf(fp, "mincost:   cost scaling   %10.3f ms, %.1f times the "
+                "maximum flow, %ld phases, %ld by price refinement, %ld "
+                "relabels, %ld global price updates\n",
+                1e3 * p->stats.seconds, p->stats.seconds / maximum,
+                p->stats.phases, p->stats.refined, p->stats.relabels,
+                p->stats.global_updates);
+        if (p->arcs <= MINCOST_BENCH_REFERENCE_ARCS) {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            long cost = shortest_paths_cost(p);
+            double seconds = seconds_since(&start);
+            fprintf(fp, "mincost:   shortest paths %10.3f ms, %.1f times cost "
+                    "scaling, cost %ld%s\n", 1e3 * seconds,
+                    seconds / p->stats.seconds, cost,
+                    cost == p->total ? "" : ", DIFFERENT COST");
+            right &= cost == p->total;
+        }
+        failed |= !right;
+        mincost_free(p);
+        unlink(problem);
+        free(problem);
+    }
+    return failed;
+}
@@ -0,0 +1,157 @@
+#ifndef MINCOST_H
+#define MINCOST_H
+
+#include "graph.h"
+#include "edge.h"
+
+#include <stdio.h>
+
+/* Minimum cost flow on problems in the DIMACS 'min' format:
+ *
+ *     p min <vertices> <arcs>
+ *     n <id> <supply>                  demand if negative
+ *     a <from> <to> <lower> <capacity> <cost>
+ *
+ * The arcs become a graph of graph.h with their capacity minus their lower
+ * bound, the lower bounds being moved into the supplies, and the vertices
+ * with supply or demand become its sources and sinks. pr-fifo then finds a
+ * flow that meets the supplies, or there is none.
+ *
+ * mincost_solve turns that flow into one of minimum cost with Goldberg's
+ * cost scaling, on the arcs of csr.h. The costs are multiplied by n + 1, and
+ * a flow is epsilon-optimal with prices p if no arc with residual capacity
+ * has a reduced cost c(u, v) + p(u) - p(v) below -epsilon. Epsilon starts at
+ * the largest cost and is divided by MINCOST_ALPHA each phase until it is 1,
+ * where the flow is optimal as the costs are integers. A phase, a refine,
+ * saturates the arcs of negative reduced cost and discharges the vertices
+ * with excess first in, first out: excess is pushed on arcs of negative
+ * reduced cost from u.current on, and when they run out u's price is lowered
+ * until its cheapest arc costs -epsilon. Two heuristics cut the work:
+ *
+ *  - Price refinement. Before a refine, prices that make the flow
+ *    epsilon-optimal are searched for with Bellman-Ford over the residual
+ *    arcs, their lengths being their reduced costs plus epsilon. If the
+ *    search is done within MINCOST_REFINE_PASSES times |E| arc scans, the
+ *    prices are moved by what it found and the refine is skipped.
+ *  - Global price updates. At the start of a refine and after every |V|
+ *    relabels, each vertex gets as rank the number of epsilons its price
+ *    must drop so that a path of arcs of negative reduced cost leads to a
+ *    vertex with a deficit, found with Dial's buckets from the deficits, and
+ *    the prices are lowered by that much at once.
+ *
+ * The prices stay above about -3 |V|^2 times the largest cost, which must
+ * fit in a long. */
+
+/* Epsilon is divided by this each phase */
+#define MINCOST_ALPHA 16
+
+/* Arc scans price refinement may take, in passes over the arcs */
+#define MINCOST_REFINE_PASSES 4
+
+/* Costs of the arcs of the graphs mincost_benchmark adds costs to are drawn
+ * from 0 .. MINCOST_BENCH_COST */
+#define MINCOST_BENCH_COST 100
+
+/* mincost_benchmark checks with successive shortest paths on graphs with at
+ * most this many arcs */
+#define MINCOST_BENCH_REFERENCE_ARCS 20000
+
+/* What the last solve did */
+struct mincost_stats {
+    long phases;            // Values of epsilon
+    long refined;           // Phases done by price refinement alone
+    long pushes;
+    long relabels;
+    long global_updates;
+    double seconds;
+};
+
+/* A problem and, once solved, its flow. The flow on arc i is
+ * edge[i]->flow + lower[i], or for a loop, which is not in the graph,
+ * loop_flow[i]. */
+struct mincost_problem {
+    struct graph* g;
+    int arcs;               // Arcs in the file
+    int* tail;
+    int* head;
+    int* lower;
+    int* capacity;
+    int* cost;
+    struct edge** edge;     // The forward edge of each arc, NULL for loops
+    int* loop_flow;
+    long* supply;           // Of each vertex, after the lower bounds
+    long balance;           // Sum of the supplies, 0 if the problem can have
+                            // a flow
+    long base;              // Cost of the lower bounds
+    long value;             // Flow from the sources
+    long total;             // Cost of the flow
+    long* price;            // Prices the flow is optimal with, in units of
+                            // 1 / (n + 1)
+    int solved;
+    struct mincost_stats stats;
+};
+
+/* Reads a problem in the DIMACS 'min' format
+ * Args:    - The path to the file
+ * Return:  Pointer to the problem */
+struct mincost_problem* mincost_read(char* path);
+
+/* Frees a problem and its graph
+ * Args:    - Pointer to the problem
+ * Return:  Nothing */
+void mincost_free(struct mincost_problem* p);
+
+/* Finds a flow of minimum cost that meets the supplies
+ * Args:    - Pointer to the problem
+ * Return:  0 if there is such a flow, 1 if no flow meets the supplies */
+int mincost_solve(struct mincost_problem* p);
+
+/* The flow on an arc of the file after mincost_solve
+ * Args:    - Pointer to the problem
+ *          - The arc, counted from 0 in the order of the file
+ * Return:  The flow */
+int mincost_arc_flow(struct mincost_problem* p, int i);
+
+/* Checks the flow of a solved problem without the solver: every arc within
+ * its bounds, every vertex sending out its supply, and no arc with residual
+ * capacity of reduced cost below -1 / (n + 1) with the prices, so no cycle
+ * of negative cost is left
+ * Args:    - Pointer to the problem
+ * Return:  1 if the flow is a minimum cost flow, 0 if not */
+int mincost_check(struct mincost_problem* p);
+
+/* Writes the flow as DIMACS does, an "s COST" line and an "f u v x" line
+ * for each arc in the order of the file
+ * Args:    - Pointer to the solved problem
+ *          - Path of the file to write
+ * Return:  0 on success, 1 if the file could not be written */
+int mincost_write_flow(struct mincost_problem* p, char* path);
+
+/* Prints the counters of a solve
+ * Args:    - Pointer to the problem
+ *          - The file to print to
+ * Return:  Nothing */
+void mincost_print_stats(struct mincost_problem* p, FILE* fp);
+
+/* Reads, solves and checks a problem and writes its flow if a file is given
+ * Args:    - Path to the problem
+ *          - Path of the flow file to write, NULL for none
+ *          - The file to print to
+ * Return:  0 on success, 1 if there is no flow, the check failed or the
+ *          flow could not be written */
+int mincost_run(char* path, char* flow, FILE* fp);
+
+/* Adds costs to maximum flow graphs and finds the cheapest maximum flow.
+ * Each graph's maximum flow is found with pr-fifo, and a 'min' problem is
+ * written next to it with the sources supplying and the sinks absorbing
+ * what they did in that flow, and costs from 0 to MINCOST_BENCH_COST drawn
+ * with a fixed seed. The problem is read back, solved by cost scaling and
+ * checked, and on small graphs solved again with successive shortest paths
+ * to compare the costs. The problem files are removed after.
+ * Args:    - Paths to the maximum flow graphs
+ *          - Number of graphs
+ *          - The file to print to
+ * Return:  0 on success, 1 if a flow was wrong */
+int mincost_benchmark(char** paths, int n_paths, FILE* fp);
+
+#endif
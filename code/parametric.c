@@ -0,0 +1,446 @@
+#define _GNU_SOURCE
+#include "parametric.h"
+#include "pushrelabel.h"
+#include "maxflow.h"
+#include "loaddimacs.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <assert.h>
+
+// What the search for the points where the vertices join the source side
+// shares. state[v] is 1 on the source side at the low end of the interval,
+// 2 if v joins it in the interval and 0 if not.
+struct refinement {
+    struct parametric* p;
+    int* state;
+    int* local;         // Index of a joining vertex in the contracted graph
+    int* side;          // Source side of the contracted graph
+    double* joins;
+};
+
+// The supply or demand at lambda, rounded down. It is kept below
+// TERMINAL_UNBOUNDED so that it never becomes unbounded.
+static int amount_at(int amount, int slope, double lambda) {
+    if (amount == TERMINAL_UNBOUNDED) {
+        return amount;
+    }
+    double at = floor(amount + slope * lambda);
+    if (at < 0) {
+        return 0;
+    }
+    return at < INT_MAX - 1 ? (int)at : INT_MAX - 1;
+}
+
+static int clamp_amount(long amount) {
+    return amount < INT_MAX - 1 ? (int)amount : INT_MAX - 1;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+struct parametric* parametric_read(char* path) {
+    struct parametric* p = malloc(sizeof(struct parametric));
+    assert(p);
+    p->g = read_parametric_dimacs_file(path, &p->supply_slope,
+                                       &p->demand_slope);
+    int size = p->g->size;
+    p->supply = malloc(size * sizeof(int));
+    p->demand = malloc(size * sizeof(int));
+    assert(p->supply && p->demand);
+
+    for (int i = 0; i < size; i++) {
+        p->supply[i] = p->g->supply[i];
+        p->demand[i] = p->g->demand[i];
+    }
+    return p;
+}
+
+void parametric_set(struct parametric* p, struct graph* g, double lambda) {
+    for (int i = 0; i < g->size; i++) {
+        g->supply[i] = amount_at(p->supply[i], p->supply_slope[i], lambda);
+        g->demand[i] = amount_at(p->demand[i], -p->demand_slope[i], lambda);
+    }
+}
+
+// Changes the terminals of a preflow from the last lambda to a greater one.
+// The heights stay valid: an arc from the super source, at height |V|, may be
+// left with residual capacity only into vertices at least that high, and the
+// flow into a sink is only made less.
+static void parametric_raise(struct parametric* p, struct push_relabel* pr,
+                             double lambda) {
+    struct graph* g = p->g;
+
+    for (int v = 0; v < g->size; v++) {
+        if (is_unbounded_terminal(g, v)) {
+            continue;
+        }
+        int supply = amount_at(p->supply[v], p->supply_slope[v], lambda);
+        int demand = amount_at(p->demand[v], -p->demand_slope[v], lambda);
+
+        if (pr->height[v] < g->size && g->supplied[v] < supply) {
+            pr->excess[v] += supply - g->supplied[v];
+            g->supplied[v] = supply;
+        }
+        g->supply[v] = supply;
+
+        if (g->absorbed[v] > demand) {
+            pr->excess[v] += g->absorbed[v] - demand;
+            g->absorbed[v] = demand;
+        }
+        g->demand[v] = demand;
+    }
+}
+
+// Finds the minimal source side at lambda among the vertices in 'join', with
+// the source side contracted into the super source and the vertices that do
+// not join into the super sink. The arcs from them become supply and demand.
+// rf->side[i] is set for join[i].
+static void solve_contracted(struct refinement* rf, int* join, int k,
+                             double lambda) {
+    struct parametric* p = rf->p;
+    struct graph* h = graph_init(k);
+    graph_clear_terminals(h);
+
+    for (int i = 0; i < k; i++) {
+        rf->local[join[i]] = i;
+    }
+
+    for (int i = 0; i < k; i++) {
+        int v = join[i];
+        long supply = amount_at(p->supply[v], p->supply_slope[v], lambda);
+        long demand = amount_at(p->demand[v], -p->demand_slope[v], lambda);
+
+        for (struct element* cur = p->g->adj_array[v]->head; cur;
+             cur = cur->next) {
+            struct edge* e = cur->this;
+            int state = rf->state[e->to];
+            if (e->original && state == 0) {
+                demand += e->capacity;
+            }
+            else if (e->original && state == 2) {
+                graph_add_edges(h, i, rf->local[e->to], e->capacity);
+            }
+            else if (!e->original && state == 1) {
+                supply += e->reverse_edge->capacity;
+            }
+        }
+
+        // A vertex can not be both a source and a sink, and only the
+        // difference changes which cuts are minimal
+        if (supply > demand) {
+            graph_add_source(h, i, clamp_amount(supply - demand));
+        }
+        else if (demand > supply) {
+            graph_add_sink(h, i, clamp_amount(demand - supply));
+        }
+    }
+
+    push_relabel_fifo(h);
+    get_min_cut(h, rf->side);
+    graph_free(h);
+}
+
+// How much more the cut with the source side in state 1 costs than the one
+// with the vertices in 'join' added too, at lambda. The arcs into and out of
+// them that change sides cost 'arcs'. It never gets less as lambda grows.
+static long cut_difference(struct refinement* rf, int* join, int k,
+                           long arcs, double lambda) {
+    struct parametric* p = rf->p;
+    long difference = arcs;
+
+    for (int i = 0; i < k; i++) {
+        int v = join[i];
+        difference += amount_at(p->supply[v], p->supply_slope[v], lambda);
+        difference -= amount_at(p->demand[v], -p->demand_slope[v], lambda);
+    }
+    return difference;
+}
+
+// Moves the vertices of 'join' on the source side of the contracted graph
+// to the front and returns how many there are
+static int partition_joined(struct refinement* rf, int* join, int k) {
+    int z = 0;
+    for (int i = 0; i < k; i++) {
+        if (rf->side[i]) {
+            int v = join[i];
+            join[i] = join[z];
+            join[z++] = v;
+        }
+    }
+    return z;
+}
+
+// Finds where the vertices in 'join', which are on the source side at 'hi'
+// but not at 'lo', join it. As Eisner and Severance do, the vertices are
+// solved just below and at the least lambda where the cut at 'hi' costs less
+// than the one at 'lo'. Those that join at that point are done, and the
+// search goes on in the intervals on each side of it with fewer vertices.
+// When all the vertices join at one point it takes two solves. They are all
+// moved to the source side.
+static void refine(struct refinement* rf, int* join, int k, double lo,
+                   double hi) {
+    if (k == 0) {
+        return;
+    }
+
+    long arcs = 0;
+    for (int i = 0; i < k; i++) {
+        for (struct element* cur = rf->p->g->adj_array[join[i]]->head; cur;
+             cur = cur->next) {
+            struct edge* e = cur->this;
+            int state = rf->state[e->to];
+            if (e->original && state == 0) {
+                arcs -= e->capacity;
+            }
+            else if (!e->original && state == 1) {
+                arcs += e->reverse_edge->capacity;
+            }
+        }
+    }
+
+    // The cut at 'hi' is the least there, so it costs less than the one at
+    // 'lo'. Halve down to where it starts to.
+    double below = lo, at = hi;
+    while (at - below > PARAMETRIC_TOLERANCE / 2) {
+        double mid = below + (at - below) / 2;
+        if (cut_difference(rf, join, k, arcs, mid) > 0) {
+            at = mid;
+        } else {
+            below = mid;
+        }
+    }
+    below = at - PARAMETRIC_TOLERANCE;
+
+    // Those on the source side just below the point, none if that is 'lo'
+    int z = 0;
+    if (lo < below) {
+        solve_contracted(rf, join, k, below);
+        z = partition_joined(rf, join, k);
+    }
+    for (int i = z; i < k; i++) {
+        rf->state[join[i]] = 0;
+    }
+    refine(rf, join, z, lo, below);
+
+    // Those that join at the point. There are none if those that joined
+    // below it are all that join there, but then some did.
+    for (int i = z; i < k; i++) {
+        rf->state[join[i]] = 2;
+    }
+    solve_contracted(rf, join + z, k - z, at);
+    int joined = z + partition_joined(rf, join + z, k - z);
+    for (int i = z; i < joined; i++) {
+        rf->joins[join[i]] = at;
+        rf->state[join[i]] = 1;
+    }
+    refine(rf, join + joined, k - joined, at, hi);
+}
+
+// Finds the minimal source side at this lambda, the vertices reachable from
+// a source with supply left. It contains the one at the last lambda, those
+// with last[v] == 1, so when they are the most, the search starts from the
+// other vertices that have supply left or a residual arc from it instead of
+// going through all of it again.
+static void find_source_side(struct graph* g, int* last, int last_size,
+                             int* side, int* stack) {
+    int incremental = 2 * last_size > g->size;
+    int top = 0;
+
+    for (int v = 0; v < g->size; v++) {
+        side[v] = incremental && last[v] == 1;
+    }
+    for (int v = 0; v < g->size; v++) {
+        if (side[v]) {
+            continue;
+        }
+        int seed = graph_supply_left(g, v) > 0;
+        for (struct element* cur = g->adj_array[v]->head;
+             incremental && cur && !seed; cur = cur->next) {
+            struct edge* e = cur->this;
+            seed = side[e->to] && get_cfe(e->reverse_edge) > 0;
+        }
+        if (seed) {
+            stack[top++] = v;
+        }
+    }
+    for (int i = 0; i < top; i++) {
+        side[stack[i]] = 1;
+    }
+
+    // Search the residual graph from them
+    while (top) {
+        int u = stack[--top];
+        for (struct element* cur = g->adj_array[u]->head; cur;
+             cur = cur->next) {
+            struct edge* e = cur->this;
+            if (!side[e->to] && get_cfe(e) > 0) {
+                side[e->to] = 1;
+                stack[top++] = e->to;
+            }
+        }
+    }
+}
+
+struct parametric_result* parametric_solve(struct parametric* p,
+                                           double* lambdas, int n) {
+    assert(0 < n);
+    struct graph* g = p->g;
+    int size = g->size;
+
+    struct parametric_result* r = malloc(sizeof(struct parametric_result));
+    assert(r);
+    r->n = n;
+    r->size = size;
+    r->lambdas = malloc(n * sizeof(double));
+    r->flows = malloc(n * sizeof(int));
+    r->source_sizes = malloc(n * sizeof(int));
+    r->joins = malloc(size * sizeof(double));
+    assert(r->lambdas && r->flows && r->source_sizes && r->joins);
+    for (int i = 0; i < n; i++) {
+        r->lambdas[i] = lambdas[i];
+    }
+    qsort(r->lambdas, n, sizeof(double), compare_doubles);
+
+    struct refinement rf;
+    rf.p = p;
+    rf.state = calloc(size, sizeof(int));
+    rf.local = malloc(size * sizeof(int));
+    rf.side = malloc(size * sizeof(int));
+    rf.joins = r->joins;
+    int* side = malloc(size * sizeof(int));
+    int* join = malloc(size * sizeof(int));
+    assert(rf.state && rf.local && rf.side && side && join);
+
+    graph_reset_flow(g);
+    parametric_set(p, g, r->lambdas[0]);
+    struct push_relabel pr;
+    push_relabel_init(&pr, g);
+
+    for (int i = 0; i < n; i++) {
+        if (i) {
+            parametric_raise(p, &pr, r->lambdas[i]);
+        }
+        push_relabel_run_fifo(&pr);
+        r->flows[i] = push_relabel_flow(&pr);
+        find_source_side(g, rf.state, i ? r->source_sizes[i - 1] : 0, side,
+                         join);
+
+        int k = 0;
+        r->source_sizes[i] = 0;
+        for (int v = 0; v < size; v++) {
+            r->source_sizes[i] += side[v];
+            if (!i) {
+                rf.state[v] = side[v];
+                r->joins[v] = side[v] ? -INFINITY : INFINITY;
+            }
+            else if (side[v] && !rf.state[v]) {
+                rf.state[v] = 2;
+                join[k++] = v;
+            }
+            // The minimal source sides are nested
+            assert(side[v] || rf.state[v] != 1);
+        }
+        if (i) {
+            refine(&rf, join, k, r->lambdas[i - 1], r->lambdas[i]);
+        }
+    }
+
+    push_relabel_free(&pr);
+    free(rf.state);
+    free(rf.local);
+    free(rf.side);
+    free(side);
+    free(join);
+    return r;
+}
+
+void parametric_print(struct parametric_result* r, FILE* fp) {
+    for (int i = 0; i < r->n; i++) {
+        fprintf(fp, "lambda %g: maximum flow %d, source side %d\n",
+                r->lambdas[i], r->flows[i], r->source_sizes[i]);
+    }
+
+    // The breakpoints are the distinct finite join points
+    double* points = malloc(r->size * sizeof(double));
+    assert(points);
+    int k = 0;
+    for (int v = 0; v < r->size; v++) {
+        if (isfinite(r->joins[v])) {
+            points[k++] = r->joins[v];
+        }
+    }
+    qsort(points, k, sizeof(double), compare_doubles);
+
+    for (int i = 0; i < k; ) {
+        int j = i;
+        while (j < k && points[j] == points[i]) {
+            ++j;
+        }
+        fprintf(fp, "breakpoint %.9g: source side grows by %d\n",
+                points[i], j - i);
+        i = j;
+    }
+    free(points);
+}
+
+void parametric_result_free(struct parametric_result* r) {
+    free(r->lambdas);
+    free(r->flows);
+    free(r->source_sizes);
+    free(r->joins);
+    free(r);
+}
+
+void parametric_free(struct parametric* p) {
+    graph_free(p->g);
+    free(p->supply);
+    free(p->demand);
+    free(p->supply_slope);
+    free(p->demand_slope);
+    free(p);
+}
+
+int parametric_run(char* path, char** lambdas, int n, FILE* fp) {
+    double* values = malloc(n * sizeof(double));
+    assert(values);
+    for (int i = 0; i < n; i++) {
+        char* end;
+        values[i] = strtod(lambdas[i], &end);
+        if (end == lambdas[i] || *end || !isfinite(values[i])) {
+            fprintf(stderr, "Not a value of lambda: %s\n", lambdas[i]);
+            free(values);
+            return 1;
+        }
+    }
+
+    struct parametric* p = parametric_read(path);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct parametric_result* r = parametric_solve(p, values, n);
+    double all = seconds_since(&start);
+    parametric_print(r, fp);
+
+    // One solve from scratch at the greatest lambda, to compare with
+    struct graph* g = graph_copy(p->g);
+    graph_reset_flow(g);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int mf = push_relabel_fifo(g);
+    double one = seconds_since(&start);
+    assert(mf == r->flows[n - 1]);
+    fprintf(fp, "parametric: %d values of lambda in %.3f ms, one solve at "
+            "lambda %g in %.3f ms\n", n, all * 1000, r->lambdas[n - 1],
+            one * 1000);
+
+    graph_free(g);
+    parametric_result_free(r);
+    parametric_free(p);
+    free(values);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#ifndef PARAMETRIC_H
+#define PARAMETRIC_H
+
+#include "graph.h"
+
+#include <stdio.h>
+
+/* Parametric maximum flow, where the supply of the sources grows and the
+ * demand of the sinks shrinks with a parameter lambda. The supply of v is
+ * supply[v] + supply_slope[v] * lambda and its demand demand[v] -
+ * demand_slope[v] * lambda, rounded down and kept between 0 and INT_MAX - 1.
+ * Unbounded terminals stay unbounded.
+ *
+ * The values of lambda are solved in increasing order as Gallo, Grigoriadis
+ * and Tarjan do: the preflow and the heights of one are the start of the
+ * next. The arcs from the super source that grow are saturated, except into
+ * vertices already on the source side, and the flow into the sinks is cut
+ * back to their new demand. The heights stay valid, so a push-relabel run
+ * from there only does the work the change needs, and no height ever goes
+ * down. All values together take about as long as one solve.
+ *
+ * The minimal source side of a minimum cut only grows with lambda. Between
+ * two values where it grows, the points where the vertices join it are found
+ * by halving the interval, solving only the vertices that join with the
+ * source side contracted into the super source and the vertices that never
+ * join into the super sink. */
+struct parametric {
+    struct graph* g;
+    int* supply;            // At lambda = 0
+    int* demand;
+    int* supply_slope;
+    int* demand_slope;
+};
+
+/* The points where a vertex joins the source side are found this closely */
+#define PARAMETRIC_TOLERANCE 1e-6
+
+/* What parametric_solve found. 'joins' is the least lambda where the vertex
+ * is on the minimal source side, to within PARAMETRIC_TOLERANCE above it.
+ * -INFINITY if it is there already at the first lambda and INFINITY if it is
+ * not there at the last. */
+struct parametric_result {
+    int n;                  // Number of values of lambda
+    double* lambdas;        // In increasing order
+    int* flows;             // The maximum flow at each lambda
+    int* source_sizes;      // The size of the minimal source side
+    int size;               // |V|
+    double* joins;
+};
+
+/* Loads a graph with parametric terminals, see read_parametric_dimacs_file
+ * Args:    - The path to the file to load
+ * Return:  Pointer to the parametric graph */
+struct parametric* parametric_read(char* path);
+
+/* Sets the supply and demand of the terminals to those at a lambda
+ * Args:    - Pointer to the parametric graph
+ *          - The graph to set them in, with the same vertices. The
+ *            parametric graph's own or a copy of it.
+ *          - The lambda
+ * Return:  Nothing */
+void parametric_set(struct parametric* p, struct graph* g, double lambda);
+
+/* Finds the maximum flows and minimum cuts at some values of lambda. The
+ * flow at the greatest lambda is left in the graph.
+ * Args:    - Pointer to the parametric graph
+ *          - The values of lambda, in any order
+ *          - Number of values
+ * Return:  Pointer to the result */
+struct parametric_result* parametric_solve(struct parametric* p,
+                                           double* lambdas, int n);
+
+/* Prints the flow and the size of the source side at each lambda on a line
+ * each, and then the breakpoints: where vertices join the source side, with
+ * how many join.
+ * Args:    - Pointer to the result
+ *          - The file to print to
+ * Return:  Nothing */
+void parametric_print(struct parametric_result* r, FILE* fp);
+
+/* Frees the result
+ * Args:    - Pointer to the result
+ * Return:  Nothing */
+void parametric_result_free(struct parametric_result* r);
+
+/* Frees the parametric graph and its graph
+ * Args:    - Pointer to the parametric graph
+ * Return:  Nothing */
+void parametric_free(struct parametric* p);
+
+/* Loads a parametric graph, solves it at the values of lambda and prints the
+ * result and the time it took
+ * Args:    - Path to the graph
+ *          - The values of lambda as strings
+ *          - Number of values
+ *          - The file to print to
+ * Return:  0 on success, 1 if a value is not a number */
+int parametric_run(char* path, char** lambdas, int n, FILE* fp);
+
+#endif
@@ -0,0 +1,347 @@
+#define _GNU_SOURCE
+#include "placement.h"
+#include "dobfs.h"
+#include "solver.h"
+#include "loaddimacs.h"
+#include "graph.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// From numaif.h, so libnuma is not needed
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+
+// Bits in the node mask given to mbind
+#define PLACEMENT_MAX_NODES 1024
+
+// Before each array, keeping it aligned to a cache line
+#define ARRAY_HEADER 64
+
+enum array_kind {ARRAY_MALLOC, ARRAY_MAPPED};
+
+struct array_header {
+    size_t bytes;
+    size_t mapped;          // The size of the mapping, 0 from malloc
+    int kind;
+    int huge;               // 1 if it was mapped for huge pages
+};
+
+static char* page_names[] = {"malloc", "thp", "hugetlb"};
+static char* numa_names[] = {"default", "first-touch", "interleave"};
+
+static enum page_policy pages = PAGES_MALLOC;
+static enum numa_policy numa = NUMA_DEFAULT;
+static pthread_once_t policy_once = PTHREAD_ONCE_INIT;
+static struct placement_stats stats;
+
+// The nodes with memory, read once
+static unsigned long node_mask[PLACEMENT_MAX_NODES / (8 * sizeof(long))];
+static int n_nodes = 0;
+static pthread_once_t nodes_once = PTHREAD_ONCE_INIT;
+
+// Sets the policy from a string, for placement_parse and read_environment
+// Return: 0 on success, 1 if it is not a policy
+static int set_policy(char* policy) {
+    char copy[64];
+    snprintf(copy, sizeof(copy), "%s", policy);
+    char* comma = strchr(copy, ',');
+    char* numa_name = comma ? comma + 1 : "default";
+    if (comma) {
+        *comma = '\0';
+    }
+    int p = -1, n = -1;
+    for (int i = 0; i < PAGE_POLICIES; i++) {
+        p = strcmp(copy, page_names[i]) == 0 ? i : p;
+    }
+    for (int i = 0; i < NUMA_POLICIES; i++) {
+        n = strcmp(numa_name, numa_names[i]) == 0 ? i : n;
+    }
+    if (p == -1 || n == -1) {
+        return 1;
+    }
+    pages = p;
+    numa = n;
+    return 0;
+}
+
+static void read_environment(void) {
+    char* policy = getenv("MAXFLOW_MEMORY");
+    if (policy && set_policy(policy)) {
+        fprintf(stderr, "MAXFLOW_MEMORY: no such policy %s\n", policy);
+    }
+}
+
+void placement_set(enum page_policy p, enum numa_policy n) {
+    pthread_once(&policy_once, &read_environment);
+    pages = p;
+    numa = n;
+}
+
+// The environment is read first, so the policy given here replaces it
+int placement_parse(char* policy) {
+    pthread_once(&policy_once, &read_environment);
+    return set_policy(policy);
+}
+
+char* placement_name(char* buffer) {
+    pthread_once(&policy_once, &read_environment);
+    sprintf(buffer, "%s,%s", page_names[pages], numa_names[numa]);
+    return buffer;
+}
+
+// The nodes with memory, from sysfs, like "0-1", into node_mask and n_nodes
+static void read_nodes(void) {
+    unsigned long* mask = node_mask;
+    FILE* fp = fopen("/sys/devices/system/node/has_memory", "r");
+    if (!fp) {
+        return;
+    }
+    int nodes = 0, from, to;
+    char separator;
+    while (fscanf(fp, "%d", &from) == 1) {
+        to = from;
+        if (fscanf(fp, "%c", &separator) == 1 && separator == '-') {
+            if (fscanf(fp, "%d%c", &to, &separator) < 1) {
+                break;
+            }
+        }
+        for (int node = from; node <= to && node < PLACEMENT_MAX_NODES;
+             node++) {
+            mask[node / (8 * sizeof(long))] |= 1UL << node % (8 * sizeof(long));
+            ++nodes;
+        }
+    }
+    fclose(fp);
+    n_nodes = nodes;
+}
+
+// Touches a range of pages from a CPU of its own
+struct toucher {
+    char* from;
+    char* to;
+    int cpu;
+};
+
+static void* touch(void* arg) {
+    struct toucher* t = arg;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(t->cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    long page = sysconf(_SC_PAGESIZE);
+    for (char* p = t->from; p < t->to; p += page) {
+        *(volatile char*)p = 0;
+    }
+    return NULL;
+}
+
+// The threads' ranges are equal, like those of the solvers that split the
+// vertices
+static void touch_first(char* base, size_t size) {
+    int threads = bfs_default_threads();
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    cpus = cpus < 1 ? 1 : cpus;
+    struct toucher* t = malloc(threads * sizeof(struct toucher));
+    pthread_t* workers = malloc(threads * sizeof(pthread_t));
+    assert(t && workers);
+    for (int i = 0; i < threads; i++) {
+        t[i].from = base + size * i / threads;
+        t[i].to = base + size * (i + 1) / threads;
+        t[i].cpu = i % cpus;
+        int created = pthread_create(&workers[i], NULL, &touch, &t[i]);
+        assert(created == 0);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(t);
+    free(workers);
+}
+
+// Maps an array with the policy
+static void* map_array(size_t size) {
+    void* base = MAP_FAILED;
+    if (pages == PAGES_HUGETLB) {
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        __atomic_fetch_add(base == MAP_FAILED ? &stats.fallbacks
+                                              : &stats.hugetlb,
+                           base == MAP_FAILED ? 1 : (long)size,
+                           __ATOMIC_RELAXED);
+    }
+    if (base == MAP_FAILED) {
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        assert(base != MAP_FAILED);
+        if (pages != PAGES_MALLOC && madvise(base, size, MADV_HUGEPAGE) == 0) {
+            __atomic_fetch_add(&stats.advised, size, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (numa != NUMA_DEFAULT) {
+        pthread_once(&nodes_once, &read_nodes);
+    }
+    if (numa == NUMA_INTERLEAVE) {
+        if (n_nodes && syscall(SYS_mbind, base, size, MPOL_INTERLEAVE,
+                               node_mask, PLACEMENT_MAX_NODES, 0) == 0) {
+            __atomic_fetch_add(&stats.interleaved, size, __ATOMIC_RELAXED);
+        }
+        else {
+            __atomic_fetch_add(&stats.mbind_failed, 1, __ATOMIC_RELAXED);
+        }
+    }
+    // With one node every page is on it, wherever it is touched first, so no
+    // threads are started for it
+    else if (numa == NUMA_FIRST_TOUCH && 1 < n_nodes) {
+        touch_first(base, size);
+        __atomic_fetch_add(&stats.touched, size, __ATOMIC_RELAXED);
+    }
+    return base;
+}
+
+void* array_alloc(size_t bytes) {
+    pthread_once(&policy_once, &read_environment);
+    struct array_header* h;
+
+    if (bytes < PLACEMENT_MIN_BYTES ||
+        (pages == PAGES_MALLOC && numa == NUMA_DEFAULT)) {
+        h = malloc(bytes + ARRAY_HEADER);
+        assert(h != NULL);
+        h->kind = ARRAY_MALLOC;
+        h->mapped = 0;
+        h->huge = 0;
+    }
+    else {
+        size_t size = (bytes + ARRAY_HEADER + PLACEMENT_HUGE_PAGE - 1) /
+                      PLACEMENT_HUGE_PAGE * PLACEMENT_HUGE_PAGE;
+        h = map_array(size);
+        h->kind = ARRAY_MAPPED;
+        h->mapped = size;
+        h->huge = pages != PAGES_MALLOC;
+    }
+    h->bytes = bytes;
+    if (PLACEMENT_MIN_BYTES <= bytes) {
+        __atomic_fetch_add(&stats.arrays, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats.bytes, bytes, __ATOMIC_RELAXED);
+    }
+    return (char*)h + ARRAY_HEADER;
+}
+
+void* array_calloc(size_t count, size_t size) {
+    void* p = array_alloc(count * size);
+    struct array_header* h = (void*)((char*)p - ARRAY_HEADER);
+    // Mapped memory is zero already
+    if (h->kind == ARRAY_MALLOC) {
+        memset(p, 0, count * size);
+    }
+    return p;
+}
+
+// The transparent huge pages of the process, in bytes
+static long anon_huge_pages(void) {
+    FILE* fp = fopen("/proc/self/smaps_rollup", "r");
+    if (!fp) {
+        return 0;
+    }
+    char line[256];
+    long kb = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1) {
+            break;
+        }
+    }
+    fclose(fp);
+    return kb * 1024;
+}
+
+void array_free(void* p) {
+    if (!p) {
+        return;
+    }
+    struct array_header* h = (void*)((char*)p - ARRAY_HEADER);
+    // The pages are in use until now, so this is when to count them. Only
+    // arrays mapped for huge pages are counted, as it reads procfs.
+    if (h->huge) {
+        long huge = anon_huge_pages();
+        long peak = __atomic_load_n(&stats.peak_huge, __ATOMIC_RELAXED);
+        while (huge > peak &&
+               !__atomic_compare_exchange_n(&stats.peak_huge, &peak, huge, 0,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+        }
+    }
+    if (h->kind == ARRAY_MALLOC) {
+        free(h);
+        return;
+    }
+    int unmapped = munmap(h, h->mapped);
+    assert(unmapped == 0);
+}
+
+void placement_reset(void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+void placement_get_stats(struct placement_stats* s) {
+    *s = stats;
+}
+
+int placement_benchmark(char* path, char* algorithm, FILE* fp) {
+    struct solver* solver = solver_find(algorithm);
+    if (!solver) {
+        fprintf(stderr, "No such algorithm: %s\n", algorithm);
+        return 1;
+    }
+    pthread_once(&policy_once, &read_environment);
+    enum page_policy old_pages = pages;
+    enum numa_policy old_numa = numa;
+    double base = 0;
+    int expected = 0, same = 1;
+
+    for (int p = 0; p < PAGE_POLICIES; p++) {
+        for (int n = 0; n < NUMA_POLICIES; n++) {
+            struct graph* g = read_dimacs_file(path);
+            placement_set(p, n);
+            placement_reset();
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            int mf = solver->solve(g);
+            double seconds = seconds_since(&start);
+            graph_free(g);
+
+            struct placement_stats s;
+            placement_get_stats(&s);
+            if (p == 0 && n == 0) {
+                base = seconds;
+                expected = mf;
+            }
+            same &= mf == expected;
+            char name[32];
+            fprintf(fp, "memory: %-19s maximum flow %d%s, %.3f ms, %.2f times "
+                    "malloc, %ld arrays of %.1f MB, %.1f MB huge pages",
+                    placement_name(name), mf, mf == expected ? "" : " (WRONG)",
+                    seconds * 1000, seconds / base, s.arrays, s.bytes / 1e6,
+                    (s.hugetlb + s.peak_huge) / 1e6);
+            if (s.fallbacks) {
+                fprintf(fp, ", %ld without hugetlb pages", s.fallbacks);
+            }
+            if (s.mbind_failed) {
+                fprintf(fp, ", %ld not interleaved", s.mbind_failed);
+            }
+            fprintf(fp, "\n");
+        }
+    }
+    placement_set(old_pages, old_numa);
+    return !same;
+}
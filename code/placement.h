@@ -0,0 +1,105 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* Where the large arrays of the graph and the solvers go: the compressed
+ * graphs of csr.h and compact.h, the search engine of dobfs.h and the
+ * heights, excess and other arrays of the push-relabel solvers.
+ *
+ * The pages are those of malloc, transparent huge pages asked for with
+ * madvise, or explicit 2 MB huge pages mapped with MAP_HUGETLB, which the
+ * system must have reserved (vm.nr_hugepages). Without them the transparent
+ * ones are used. Huge pages need fewer TLB entries for arrays that are read
+ * at random.
+ *
+ * On a machine with several NUMA nodes the pages can be interleaved across
+ * the nodes with mbind, or touched first by one thread on each CPU, each
+ * writing an equal range of the array, so each range is on the node of its
+ * thread. The solvers that split the vertices into equal ranges, --verify
+ * and pr-region, then find their part on their own node when they run on
+ * the same CPUs.
+ *
+ * The policy is set with --memory or the environment variable
+ * MAXFLOW_MEMORY, as PAGES[,NUMA] with PAGES malloc, thp or hugetlb and NUMA
+ * default, first-touch or interleave. --memory replaces MAXFLOW_MEMORY.
+ * Arrays below PLACEMENT_MIN_BYTES always come from malloc. */
+enum page_policy {PAGES_MALLOC, PAGES_THP, PAGES_HUGETLB, PAGE_POLICIES};
+enum numa_policy {NUMA_DEFAULT, NUMA_FIRST_TOUCH, NUMA_INTERLEAVE,
+                  NUMA_POLICIES};
+
+#define PLACEMENT_MIN_BYTES (1L << 20)
+
+/* The size of a huge page */
+#define PLACEMENT_HUGE_PAGE (2L << 20)
+
+/* What the arrays got since the last placement_reset */
+struct placement_stats {
+    long arrays;            // Arrays of PLACEMENT_MIN_BYTES or more
+    long bytes;             // Their size
+    long advised;           // Bytes madvise took for transparent huge pages
+    long hugetlb;           // Bytes on explicit huge pages
+    long fallbacks;         // Arrays that got no explicit huge pages
+    long interleaved;       // Bytes mbind interleaved
+    long mbind_failed;      // Arrays mbind did not take
+    long touched;           // Bytes touched first by the threads, only
+                            // with more than one node with memory
+    long peak_huge;         // The most bytes of transparent huge pages seen
+                            // in the process, from /proc/self/smaps_rollup
+                            // when an array mapped for them is freed
+};
+
+/* Sets the policy for the arrays allocated from now on
+ * Args:    - The pages
+ *          - The NUMA placement
+ * Return:  Nothing */
+void placement_set(enum page_policy pages, enum numa_policy numa);
+
+/* Sets the policy from a string like "thp,interleave", in place of the one
+ * in MAXFLOW_MEMORY
+ * Args:    - The string
+ * Return:  0 on success, 1 if it is not a policy */
+int placement_parse(char* policy);
+
+/* The name of the current policy, like "thp,interleave"
+ * Args:    - Buffer of at least 32 chars to write it to
+ * Return:  The buffer */
+char* placement_name(char* buffer);
+
+/* Allocates an array with the current policy. It must be freed with
+ * array_free.
+ * Args:    - The size in bytes
+ * Return:  Pointer to the array */
+void* array_alloc(size_t bytes);
+
+/* Allocates an array of zeros with the current policy
+ * Args:    - Number of elements
+ *          - The size of one
+ * Return:  Pointer to the array */
+void* array_calloc(size_t count, size_t size);
+
+/* Frees an array from array_alloc or array_calloc. NULL is ignored.
+ * Args:    - Pointer to the array
+ * Return:  Nothing */
+void array_free(void* p);
+
+/* Sets all the counters to 0
+ * Args:    None
+ * Return:  Nothing */
+void placement_reset(void);
+
+/* The counters since the last reset
+ * Args:    - The stats to fill in
+ * Return:  Nothing */
+void placement_get_stats(struct placement_stats* s);
+
+/* Solves a graph with an algorithm under each policy and prints the times
+ * and what the arrays got
+ * Args:    - Path to the graph
+ *          - The name of the algorithm, see solver.h
+ *          - The file to print to
+ * Return:  0 on success, 1 if there is no such algorithm or a flow differed */
+int placement_benchmark(char* path, char* algorithm, FILE* fp);
+
+#endif
@@ -0,0 +1,193 @@
+#include "preflow.h"
+#include "graph.h"
+
+#include <stdlib.h>
+#include <assert.h>
+#include <limits.h>
+
+static inline int residual(const struct preflow* p, int a) {
+    return p->stamp && p->stamp[a] != p->epoch ? p->capacity[a]
+                                               : p->residual[a];
+}
+
+// Moves 'amount' of flow over arc a
+static inline void push_arc(struct preflow* p, int a, int amount) {
+    int b = p->rev[a];
+    if (p->stamp) {
+        if (p->stamp[a] != p->epoch) {
+            p->residual[a] = p->capacity[a];
+            p->stamp[a] = p->epoch;
+        }
+        if (p->stamp[b] != p->epoch) {
+            p->residual[b] = p->capacity[b];
+            p->stamp[b] = p->epoch;
+        }
+    }
+    p->residual[a] -= amount;
+    p->residual[b] += amount;
+}
+
+// An unbounded source can send at most what its arcs can carry
+static int supply_of(const struct preflow* p, int v) {
+    if (p->supply[v] != TERMINAL_UNBOUNDED) {
+        return p->supply[v];
+    }
+    long sum = 0;
+    for (int a = p->begin[v]; a < p->end[v]; a++) {
+        sum += p->capacity[a];
+    }
+    return sum < INT_MAX ? sum : INT_MAX;
+}
+
+static inline long demand_left(const struct preflow* p, int v) {
+    return p->demand[v] == TERMINAL_UNBOUNDED ? LONG_MAX
+                                              : p->demand[v] - p->absorbed[v];
+}
+
+// Sets the heights to the distances to the super sink, or above those of
+// the super source plus the distance to it
+static void global_relabel(struct preflow* p) {
+    int n = p->n, unreached = 2 * (n + 2);
+    // The queue may hold the active vertices, so the search has its own
+    int* queue = p->search;
+    int head = 0, tail = 0;
+    for (int v = 0; v < n; v++) {
+        p->height[v] = unreached;
+        p->current[v] = p->begin[v];
+    }
+    for (int pass = 0; pass < 2; pass++) {
+        for (int v = 0; v < n; v++) {
+            int root = pass == 0 ? 0 < demand_left(p, v)
+                                 : 0 < p->supplied[v];
+            if (root && p->height[v] == unreached) {
+                p->height[v] = pass == 0 ? 1 : n + 3;
+                queue[tail++] = v;
+            }
+        }
+        while (head < tail) {
+            int v = queue[head++];
+            for (int a = p->begin[v]; a < p->end[v]; a++) {
+                int w = p->head[a];
+                if (p->height[w] == unreached && 0 < residual(p, p->rev[a])) {
+                    p->height[w] = p->height[v] + 1;
+                    queue[tail++] = w;
+                }
+            }
+        }
+    }
+    ++p->global_relabels;
+}
+
+static void relabel_vertex(struct preflow* p, int u) {
+    int least = INT_MAX;
+    if (0 < demand_left(p, u)) {
+        least = 0;
+    }
+    if (0 < p->supplied[u] && p->n + 2 < least) {
+        least = p->n + 2;
+    }
+    for (int a = p->begin[u]; a < p->end[u]; a++) {
+        if (0 < residual(p, a) && p->height[p->head[a]] < least) {
+            least = p->height[p->head[a]];
+        }
+    }
+    assert(least != INT_MAX);
+    p->height[u] = least + 1;
+    ++p->relabels;
+}
+
+// The FIFO queue holds n + 1 entries, so it never fills up
+static inline void enqueue(struct preflow* p, int v) {
+    p->queue[p->back] = v;
+    p->back = p->back == p->n ? 0 : p->back + 1;
+}
+
+void preflow_start(struct preflow* p) {
+    int n = p->n;
+    for (int v = 0; v < n; v++) {
+        p->excess[v] = 0;
+    }
+    for (int v = 0; v < n; v++) {
+        int left = supply_of(p, v) - p->supplied[v];
+        if (0 < left) {
+            p->excess[v] += left;
+            p->supplied[v] += left;
+        }
+    }
+    global_relabel(p);
+    p->front = p->back = 0;
+    for (int v = 0; v < n; v++) {
+        if (0 < p->excess[v]) {
+            enqueue(p, v);
+        }
+    }
+    p->since_global = 0;
+}
+
+// Pushes u's excess away, relabeling it when its arcs run out
+static inline void discharge(struct preflow* p, int u) {
+    int n = p->n;
+    while (0 < p->excess[u]) {
+        int h = p->height[u];
+        long left = demand_left(p, u);
+        if (h == 1 && 0 < left) {
+            int amount = p->excess[u] < left ? p->excess[u] : left;
+            p->absorbed[u] += amount;
+            p->excess[u] -= amount;
+            continue;
+        }
+        if (h == n + 3 && 0 < p->supplied[u]) {
+            int amount = p->excess[u] < p->supplied[u] ? p->excess[u]
+                                                       : p->supplied[u];
+            p->supplied[u] -= amount;
+            p->excess[u] -= amount;
+            continue;
+        }
+        if (p->current[u] == p->end[u]) {
+            relabel_vertex(p, u);
+            p->current[u] = p->begin[u];
+            // Exact heights every n relabels, as in rtf-simd
+            if (n <= ++p->since_global) {
+                global_relabel(p);
+                p->since_global = 0;
+            }
+            continue;
+        }
+        int a = p->current[u], w = p->head[a];
+        int r = residual(p, a);
+        if (0 < r && h == p->height[w] + 1) {
+            int amount = p->excess[u] < r ? p->excess[u] : r;
+            push_arc(p, a, amount);
+            if (p->excess[w] == 0) {
+                enqueue(p, w);
+            }
+            p->excess[w] += amount;
+            p->excess[u] -= amount;
+            ++p->pushes;
+        }
+        else {
+            ++p->current[u];
+        }
+    }
+}
+
+int preflow_run(struct preflow* p, long discharges) {
+    for (long i = 0; i < discharges; i++) {
+        if (p->front == p->back) {
+            return 1;
+        }
+        int u = p->queue[p->front];
+        p->front = p->front == p->n ? 0 : p->front + 1;
+        ++p->discharges;
+        discharge(p, u);
+    }
+    return p->front == p->back;
+}
+
+long preflow_value(struct preflow* p) {
+    long value = 0;
+    for (int v = 0; v < p->n; v++) {
+        value += p->absorbed[v];
+    }
+    return value;
+}
@@ -0,0 +1,75 @@
+#ifndef PREFLOW_H
+#define PREFLOW_H
+
+/* FIFO push-relabel with global relabels on a graph in compressed sparse row
+ * form, the one solve of context.c, dynamic.c and checkpoint.c. Each fills in
+ * a struct preflow with its own arrays and runs it.
+ *
+ * The arcs of u are begin[u] .. end[u] - 1. Arc a goes to head[a], rev[a] is
+ * its reverse arc, residual[a] its residual capacity and capacity[a] its
+ * residual capacity without flow, 0 for the reverse arcs. With a stamp array
+ * the residual capacities are lazy like those of context.h: an arc with
+ * stamp[a] != epoch has capacity[a], and residual[a] is written when the arc
+ * is first pushed on.
+ *
+ * The super sink has height 0 and the super source n + 2. The sinks with
+ * demand left start at 1, and the vertices that can send their excess back to
+ * a source at n + 3, above the super source. The heights are set to these
+ * distances at the start and every n relabels by a search, a global relabel.
+ *
+ * Between two preflow_run the state of the solve is the arrays, the queue and
+ * since_global, so a caller can copy it away and put it back later. */
+struct preflow {
+    int n;
+    const int* begin;
+    const int* end;
+    const int* head;
+    const int* rev;
+    const int* capacity;
+    int* residual;
+    unsigned* stamp;        // NULL if all of residual is valid
+    unsigned epoch;
+    const int* supply;      // The terminals, like in graph.h
+    const int* demand;
+    int* supplied;
+    int* absorbed;
+
+    // Workspaces
+    int* height;
+    long* excess;
+    int* current;
+    int* queue;             // n + 1 entries, front .. back - 1 are active
+    int* search;            // n entries, the queue of the global relabels
+    int front;
+    int back;
+    long since_global;      // Relabels since the last global relabel
+
+    // Counters, added to by the runs
+    long discharges;
+    long pushes;
+    long relabels;
+    long global_relabels;
+};
+
+/* Starts a solve from the flow in the arrays. What the sources have left to
+ * send becomes their excess, the heights are set by a global relabel and the
+ * vertices with excess are queued.
+ * Args:    - Pointer to the preflow
+ * Return:  Nothing */
+void preflow_start(struct preflow* p);
+
+/* Discharges the queued vertices in FIFO order, pushing their excess to
+ * lower neighbours and relabeling them when no arc is left, until the queue
+ * is empty or 'discharges' vertices were discharged
+ * Args:    - Pointer to a started preflow
+ *          - Most vertices to discharge. LONG_MAX for no limit
+ * Return:  1 if the queue is empty and the flow is a maximum flow, 0 if the
+ *          run stopped before */
+int preflow_run(struct preflow* p, long discharges);
+
+/* The flow from the sources to the sinks
+ * Args:    - Pointer to the preflow
+ * Return:  The flow into the super sink */
+long preflow_value(struct preflow* p);
+
+#endif
@@ -0,0 +1,616 @@
+#include "pseudoflow.h"
+#include "maxflow.h"
+#include "list.h"
+#include "edge.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+// The vertices of the forest. A tree arc is the original edge between a
+// vertex and its parent, whichever way it goes. The unbounded sources and
+// sinks are part of the super source and super sink and are never in a tree.
+// Their excess is the flow on their virtual arcs.
+struct pseudoflow_state {
+    struct graph* g;
+    enum pseudoflow_order order;
+    struct pseudoflow_stats* stats;
+    int n;
+    long* excess;
+    int* label;             // |V| for the source side
+    int* label_count;       // Vertices with each label, terminals left out
+    char* terminal;
+    int* parent;            // -1 for roots
+    struct edge** arc;      // Tree arc to the parent
+    int* first_child;
+    int* next_sibling;
+    int* prev_sibling;
+    int* next_scan;         // Child to go down to next when processing
+    struct element** current;
+
+    // Strong roots waiting to be processed, a queue per label. The FIFO
+    // order keeps them all in the queue of label 0.
+    int* bucket_first;
+    int* bucket_last;
+    int* next_root;
+    int highest;
+};
+
+static _Thread_local struct pseudoflow_stats last_stats;
+
+// Residual capacity of an original edge from its end v to the other end
+static int residual_from(struct edge* e, int v) {
+    return e->from == v ? e->capacity - e->flow : e->flow;
+}
+
+// Sends flow on an original edge from its end v to the other end
+static void send_from(struct edge* e, int v, int amount) {
+    if (e->from == v) {
+        e->flow += amount;
+    }
+    else {
+        e->flow -= amount;
+    }
+}
+
+static void add_root(struct pseudoflow_state* p, int v) {
+    if (p->label[v] >= p->n) {
+        return;
+    }
+    int b = p->order == PSEUDOFLOW_FIFO ? 0 : p->label[v];
+    p->next_root[v] = -1;
+    if (p->bucket_first[b] == -1) {
+        p->bucket_first[b] = v;
+    }
+    else {
+        p->next_root[p->bucket_last[b]] = v;
+    }
+    p->bucket_last[b] = v;
+    if (p->label[v] > p->highest) {
+        p->highest = p->label[v];
+    }
+}
+
+static int pop_root(struct pseudoflow_state* p, int b) {
+    int v = p->bucket_first[b];
+    if (v != -1) {
+        p->bucket_first[b] = p->next_root[v];
+    }
+    return v;
+}
+
+static void set_label(struct pseudoflow_state* p, int v, int label) {
+    --p->label_count[p->label[v]];
+    p->label[v] = label;
+    ++p->label_count[label];
+}
+
+static void attach(struct pseudoflow_state* p, int parent, int child,
+                   struct edge* arc) {
+    p->parent[child] = parent;
+    p->arc[child] = arc;
+    p->prev_sibling[child] = -1;
+    p->next_sibling[child] = p->first_child[parent];
+    if (p->first_child[parent] != -1) {
+        p->prev_sibling[p->first_child[parent]] = child;
+    }
+    p->first_child[parent] = child;
+}
+
+static void detach(struct pseudoflow_state* p, int child) {
+    int prev = p->prev_sibling[child], next = p->next_sibling[child];
+    if (prev == -1) {
+        p->first_child[p->parent[child]] = next;
+    }
+    else {
+        p->next_sibling[prev] = next;
+    }
+    if (next != -1) {
+        p->prev_sibling[next] = prev;
+    }
+    p->parent[child] = -1;
+}
+
+// Looks for a residual arc from v, which has the root's label, to a vertex
+// with one less. That vertex is in another tree, since the labels never
+// decrease away from a root. The arcs before the current one stay useless
+// until v is relabeled.
+// Return: The arc as it is in v's adjacency list, NULL if there is none
+static struct edge* find_merger(struct pseudoflow_state* p, int v) {
+    for (; p->current[v]; p->current[v] = p->current[v]->next) {
+        struct edge* e = p->current[v]->this;
+        ++p->stats->arc_scans;
+        if (p->label[e->to] == p->label[v] - 1 && !p->terminal[e->to] &&
+            e->to != p->parent[v] && get_cfe(e) > 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+// Moves v's next_scan to the first child with v's label. If there is none
+// all of v's subtree with its label has been relabeled and so is v.
+static void check_children(struct pseudoflow_state* p, int v) {
+    for (; p->next_scan[v] != -1;
+         p->next_scan[v] = p->next_sibling[p->next_scan[v]]) {
+        if (p->label[p->next_scan[v]] == p->label[v]) {
+            return;
+        }
+    }
+    set_label(p, v, p->label[v] + 1);
+    p->current[v] = p->g->adj_array[v]->head;
+    ++p->stats->relabels;
+}
+
+// Hangs the tree of the strong vertex under the vertex in the other tree.
+// The path from the strong vertex to its root is turned around.
+static void merge(struct pseudoflow_state* p, int weak, int strong,
+                  struct edge* arc) {
+    int v = strong, new_parent = weak;
+    ++p->stats->merges;
+
+    while (p->parent[v] != -1) {
+        int old_parent = p->parent[v];
+        struct edge* old_arc = p->arc[v];
+        detach(p, v);
+        attach(p, new_parent, v, arc);
+        new_parent = v;
+        v = old_parent;
+        arc = old_arc;
+        ++p->stats->rerooted;
+    }
+    attach(p, new_parent, v, arc);
+}
+
+// Pushes the excess of the old root up to the new root. Where an arc cannot
+// take all of it the tree is split and the child becomes a strong root.
+static void push_excess(struct pseudoflow_state* p, int v) {
+    long before = 1;
+
+    while (p->excess[v] > 0 && p->parent[v] != -1) {
+        int parent = p->parent[v];
+        struct edge* e = p->arc[v];
+        int residual = residual_from(e, v);
+        before = p->excess[parent];
+        ++p->stats->pushes;
+
+        if (residual >= p->excess[v]) {
+            send_from(e, v, p->excess[v]);
+            p->excess[parent] += p->excess[v];
+            p->excess[v] = 0;
+        }
+        else {
+            send_from(e, v, residual);
+            p->excess[parent] += residual;
+            p->excess[v] -= residual;
+            detach(p, v);
+            add_root(p, v);
+            ++p->stats->splits;
+        }
+        v = parent;
+    }
+    // A root that had no excess is a new strong root
+    if (p->excess[v] > 0 && before <= 0) {
+        add_root(p, v);
+    }
+}
+
+// Moves the whole tree to the source side when no vertex has the label below
+// its root's, so that no vertex in it can reach a sink
+static void lift_tree(struct pseudoflow_state* p, int root) {
+    int v = root;
+    p->next_scan[v] = p->first_child[v];
+    set_label(p, v, p->n);
+    ++p->stats->lifted;
+
+    while (v != -1) {
+        while (p->next_scan[v] != -1) {
+            int child = p->next_scan[v];
+            p->next_scan[v] = p->next_sibling[child];
+            v = child;
+            p->next_scan[v] = p->first_child[v];
+            set_label(p, v, p->n);
+            ++p->stats->lifted;
+        }
+        v = p->parent[v];
+    }
+}
+
+// Looks for a merge from the vertices with the root's label, depth first.
+// Those that have none are relabeled on the way back up.
+static void process_root(struct pseudoflow_state* p, int root) {
+    int v = root;
+    struct edge* e;
+
+    p->next_scan[v] = p->first_child[v];
+    if ((e = find_merger(p, v))) {
+        merge(p, e->to, v, e->original ? e : e->reverse_edge);
+        push_excess(p, root);
+        return;
+    }
+    check_children(p, v);
+
+    while (v != -1) {
+        while (p->next_scan[v] != -1) {
+            int child = p->next_scan[v];
+            p->next_scan[v] = p->next_sibling[child];
+            v = child;
+            p->next_scan[v] = p->first_child[v];
+            if ((e = find_merger(p, v))) {
+                merge(p, e->to, v, e->original ? e : e->reverse_edge);
+                push_excess(p, root);
+                return;
+            }
+            check_children(p, v);
+        }
+        if ((v = p->parent[v]) != -1) {
+            check_children(p, v);
+        }
+    }
+    add_root(p, root);
+}
+
+// Strong roots that were weak roots have label 0 and are relabeled to 1
+static void relabel_from_zero(struct pseudoflow_state* p, int v) {
+    if (p->label[v] == 0) {
+        set_label(p, v, 1);
+        ++p->stats->relabels;
+    }
+}
+
+// The next strong root to process, -1 when all strong trees are on the
+// source side
+static int next_root(struct pseudoflow_state* p) {
+    int v;
+
+    if (p->order == PSEUDOFLOW_FIFO) {
+        while ((v = pop_root(p, 0)) != -1) {
+            relabel_from_zero(p, v);
+            if (p->label_count[p->label[v] - 1]) {
+                return v;
+            }
+            lift_tree(p, v);
+        }
+        return -1;
+    }
+
+    for (int h = p->highest; h > 0; h--) {
+        p->highest = h;
+        while ((v = pop_root(p, h)) != -1) {
+            if (p->label_count[h - 1]) {
+                return v;
+            }
+            lift_tree(p, v);
+        }
+    }
+    if (p->bucket_first[0] == -1) {
+        return -1;
+    }
+    while ((v = pop_root(p, 0)) != -1) {
+        relabel_from_zero(p, v);
+        add_root(p, v);
+    }
+    p->highest = 1;
+    return pop_root(p, 1);
+}
+
+static void initialize(struct pseudoflow_state* p) {
+    struct graph* g = p->g;
+    int n = p->n;
+
+    for (int v = 0; v < n; v++) {
+        g->supplied[v] = 0;
+        g->absorbed[v] = 0;
+        p->excess[v] = 0;
+        p->parent[v] = -1;
+        p->first_child[v] = -1;
+        p->current[v] = g->adj_array[v]->head;
+        p->terminal[v] = g->supply[v] == TERMINAL_UNBOUNDED ||
+                         g->demand[v] == TERMINAL_UNBOUNDED;
+        // The virtual arcs of the bounded terminals are saturated
+        if (!p->terminal[v]) {
+            g->supplied[v] = g->supply[v];
+            g->absorbed[v] = g->demand[v];
+            p->excess[v] = (long)g->supply[v] - g->demand[v];
+        }
+    }
+    for (int i = 0; i <= n; i++) {
+        p->label_count[i] = 0;
+        p->bucket_first[i] = -1;
+    }
+
+    // So are the arcs out of the unbounded sources and into the unbounded
+    // sinks. They are found from the terminals' lists, an arc between two
+    // of them twice.
+    for (int u = 0; u < n; u++) {
+        if (!p->terminal[u]) {
+            continue;
+        }
+        for (struct element* cur = g->adj_array[u]->head; cur;
+             cur = cur->next) {
+            struct edge* e = cur->this;
+            e = e->original ? e : e->reverse_edge;
+            int from_source = g->supply[e->from] == TERMINAL_UNBOUNDED;
+            int to_sink = g->demand[e->to] == TERMINAL_UNBOUNDED;
+            if (e->flow || e->from == e->to ||
+                !((from_source && g->supply[e->to] != TERMINAL_UNBOUNDED) ||
+                  (to_sink && g->demand[e->from] != TERMINAL_UNBOUNDED))) {
+                continue;
+            }
+            e->flow = e->capacity;
+            p->excess[e->from] -= e->capacity;
+            p->excess[e->to] += e->capacity;
+        }
+    }
+
+    p->highest = 0;
+    for (int v = 0; v < n; v++) {
+        if (p->terminal[v]) {
+            p->label[v] = g->supply[v] == TERMINAL_UNBOUNDED ? n : 0;
+            continue;
+        }
+        p->label[v] = p->excess[v] > 0;
+        ++p->label_count[p->label[v]];
+        if (p->excess[v] > 0) {
+            add_root(p, v);
+        }
+    }
+}
+
+// The original edge of an adjacency list entry of v if it has flow the given
+// way, into v when going backwards and out of v when going forwards, and goes
+// to a vertex that is not an unbounded terminal
+static struct edge* flow_arc(struct pseudoflow_state* p, struct edge* e,
+                             int backwards) {
+    if (e->original == backwards) {
+        return NULL;
+    }
+    e = e->original ? e : e->reverse_edge;
+    int w = backwards ? e->from : e->to;
+    return e->flow > 0 && !p->terminal[w] && e->from != e->to ? e : NULL;
+}
+
+// Depth first search from the roots on the arcs with flow, backwards or
+// forwards. The cycles of flow found are cancelled. The vertices reached are
+// put in the reverse of the order they are finished, so an arc with flow the
+// way of the search goes to a vertex later in the order.
+// Return: The number of vertices in the order
+static int order_flow(struct pseudoflow_state* p, int* roots, int n_roots,
+                      int backwards, int* order) {
+    struct graph* g = p->g;
+    int n = p->n, n_order = n;
+    char* color = calloc(n, 1); // 0 new, 1 on the stack, 2 finished
+    int* stack = malloc(n * sizeof(int));
+    int* position = malloc(n * sizeof(int));
+    assert(color && stack && position);
+
+    for (int v = 0; v < n; v++) {
+        p->current[v] = g->adj_array[v]->head;
+    }
+
+    for (int r = 0; r < n_roots; r++) {
+        int root = roots[r];
+        if (color[root]) {
+            continue;
+        }
+        int top = 0;
+        stack[0] = root;
+        position[root] = 0;
+        color[root] = 1;
+
+        while (top >= 0) {
+            int v = stack[top];
+            struct element* cur = p->current[v];
+            struct edge* e = NULL;
+            for (; cur; cur = p->current[v] = cur->next) {
+                e = flow_arc(p, cur->this, backwards);
+                if (e && color[backwards ? e->from : e->to] != 2) {
+                    break;
+                }
+            }
+            if (!cur) {
+                color[v] = 2;
+                order[--n_order] = v;
+                --top;
+                continue;
+            }
+
+            int w = backwards ? e->from : e->to;
+            if (!color[w]) {
+                color[w] = 1;
+                position[w] = ++top;
+                stack[top] = w;
+                p->arc[w] = e;
+                continue;
+            }
+
+            // A cycle from w on the stack up to v and back to w. Take the
+            // least flow on it off all its arcs, and go back to the first
+            // vertex whose arc from the one below it got no flow.
+            int least = e->flow;
+            for (int i = position[w] + 1; i <= top; i++) {
+                if (p->arc[stack[i]]->flow < least) {
+                    least = p->arc[stack[i]]->flow;
+                }
+            }
+            e->flow -= least;
+            int back = top + 1;
+            for (int i = position[w] + 1; i <= top; i++) {
+                p->arc[stack[i]]->flow -= least;
+                if (p->arc[stack[i]]->flow == 0 && back == top + 1) {
+                    back = i;
+                }
+            }
+            for (; top >= back; top--) {
+                color[stack[top]] = 0;
+            }
+        }
+    }
+
+    // Move the order to the front of the array
+    memmove(order, order + n_order, (n - n_order) * sizeof(int));
+
+    free(color);
+    free(stack);
+    free(position);
+    return n - n_order;
+}
+
+// Returns the excess to the sources, backwards on the arcs with flow, and
+// then the deficits to the sinks, forwards. No arc with flow crosses the
+// minimum cut backwards, so neither crosses it and the flow over the cut
+// stays the same.
+static void recover_flow(struct pseudoflow_state* p) {
+    struct graph* g = p->g;
+    int n = p->n, n_roots = 0, n_order;
+    int* roots = malloc(n * sizeof(int));
+    int* order = malloc(n * sizeof(int));
+    assert(roots && order);
+
+    for (int v = 0; v < n; v++) {
+        if (!p->terminal[v] && p->excess[v] > 0) {
+            roots[n_roots++] = v;
+        }
+    }
+    n_order = order_flow(p, roots, n_roots, 1, order);
+    for (int i = 0; i < n_order; i++) {
+        int v = order[i];
+        if (p->excess[v] <= 0) {
+            continue;
+        }
+        int amount = p->excess[v] < g->supplied[v] ? p->excess[v]
+                                                   : g->supplied[v];
+        g->supplied[v] -= amount;
+        p->excess[v] -= amount;
+
+        for (struct element* cur = g->adj_array[v]->head;
+             cur && p->excess[v] > 0; cur = cur->next) {
+            struct edge* e = ((struct edge*)cur->this)->reverse_edge;
+            if (((struct edge*)cur->this)->original || e->flow == 0) {
+                continue;
+            }
+            amount = p->excess[v] < e->flow ? p->excess[v] : e->flow;
+            e->flow -= amount;
+            p->excess[v] -= amount;
+            p->excess[e->from] += amount;
+        }
+    }
+
+    n_roots = 0;
+    for (int v = 0; v < n; v++) {
+        if (!p->terminal[v] && p->excess[v] < 0) {
+            roots[n_roots++] = v;
+        }
+    }
+    n_order = order_flow(p, roots, n_roots, 0, order);
+    for (int i = 0; i < n_order; i++) {
+        int v = order[i];
+        if (p->excess[v] >= 0) {
+            continue;
+        }
+        int amount = -p->excess[v] < g->absorbed[v] ? -p->excess[v]
+                                                    : g->absorbed[v];
+        g->absorbed[v] -= amount;
+        p->excess[v] += amount;
+
+        for (struct element* cur = g->adj_array[v]->head;
+             cur && p->excess[v] < 0; cur = cur->next) {
+            struct edge* e = cur->this;
+            if (!e->original || e->flow == 0) {
+                continue;
+            }
+            amount = -p->excess[v] < e->flow ? -p->excess[v] : e->flow;
+            e->flow -= amount;
+            p->excess[v] += amount;
+            p->excess[e->to] -= amount;
+        }
+    }
+
+    free(roots);
+    free(order);
+}
+
+int pseudoflow(struct graph* g, enum pseudoflow_order order,
+               struct pseudoflow_stats* stats) {
+    int n = g->size;
+    struct pseudoflow_stats unused;
+    struct pseudoflow_state p;
+    p.g = g;
+    p.order = order;
+    p.stats = stats ? stats : &unused;
+    p.n = n;
+    p.excess       = malloc(n * sizeof(long));
+    p.label        = malloc(n * sizeof(int));
+    p.label_count  = malloc((n + 1) * sizeof(int));
+    p.terminal     = malloc(n);
+    p.parent       = malloc(n * sizeof(int));
+    p.arc          = malloc(n * sizeof(struct edge*));
+    p.first_child  = malloc(n * sizeof(int));
+    p.next_sibling = malloc(n * sizeof(int));
+    p.prev_sibling = malloc(n * sizeof(int));
+    p.next_scan    = malloc(n * sizeof(int));
+    p.current      = malloc(n * sizeof(struct element*));
+    p.bucket_first = malloc((n + 1) * sizeof(int));
+    p.bucket_last  = malloc((n + 1) * sizeof(int));
+    p.next_root    = malloc(n * sizeof(int));
+    assert(p.excess && p.label && p.label_count && p.terminal && p.parent &&
+           p.arc && p.first_child && p.next_sibling && p.prev_sibling &&
+           p.next_scan && p.current && p.bucket_first && p.bucket_last &&
+           p.next_root);
+    memset(p.stats, 0, sizeof(struct pseudoflow_stats));
+    p.stats->vertices = n;
+
+    initialize(&p);
+    int root;
+    while ((root = next_root(&p)) != -1) {
+        process_root(&p, root);
+    }
+    recover_flow(&p);
+
+    // The flow on the virtual arcs of the unbounded terminals is their excess
+    int maximum_flow = 0;
+    for (int v = 0; v < n; v++) {
+        if (g->supply[v] == TERMINAL_UNBOUNDED) {
+            g->supplied[v] = -p.excess[v];
+        }
+        if (g->demand[v] == TERMINAL_UNBOUNDED) {
+            g->absorbed[v] = p.excess[v];
+        }
+        maximum_flow += g->absorbed[v];
+    }
+
+    free(p.excess);
+    free(p.label);
+    free(p.label_count);
+    free(p.terminal);
+    free(p.parent);
+    free(p.arc);
+    free(p.first_child);
+    free(p.next_sibling);
+    free(p.prev_sibling);
+    free(p.next_scan);
+    free(p.current);
+    free(p.bucket_first);
+    free(p.bucket_last);
+    free(p.next_root);
+    return maximum_flow;
+}
+
+int pseudoflow_highest_label(struct graph* g) {
+    return pseudoflow(g, PSEUDOFLOW_HIGHEST_LABEL, &last_stats);
+}
+
+int pseudoflow_fifo(struct graph* g) {
+    return pseudoflow(g, PSEUDOFLOW_FIFO, &last_stats);
+}
+
+void pseudoflow_print_stats(FILE* fp) {
+    struct pseudoflow_stats* s = &last_stats;
+    long tree_ops = s->merges + s->splits + s->pushes + s->rerooted;
+    fprintf(fp, "pseudoflow: merges %ld, splits %ld, pushes %ld, rerooted %ld, "
+            "relabels %ld, lifted %ld, arc scans %ld, tree operations per "
+            "vertex %.2f\n", s->merges, s->splits, s->pushes, s->rerooted,
+            s->relabels, s->lifted, s->arc_scans,
+            s->vertices ? (double)tree_ops / s->vertices : 0.0);
+}
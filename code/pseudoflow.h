@@ -0,0 +1,65 @@
+#ifndef PSEUDOFLOW_H
+#define PSEUDOFLOW_H
+
+#include "graph.h"
+
+#include <stdio.h>
+
+/* Hochbaum's pseudoflow algorithm (HPF). The arcs out of the sources and into
+ * the sinks are saturated, which leaves vertices with excess or deficit. The
+ * vertices are kept in a forest where every tree has a root with all of the
+ * tree's excess or deficit. A tree is strong if its root has excess. The
+ * algorithm merges a strong tree into another tree by a residual arc and
+ * pushes the excess along the path to the new root, splitting the tree at the
+ * arcs the push saturates. When no strong tree can be merged the vertices in
+ * the strong trees are the source side of a minimum cut. A second phase
+ * returns the excess to the sources and the deficits to the sinks, which
+ * gives a maximum flow.
+ *
+ * The strong root to process next is the one with the highest label or the
+ * one that has waited the longest. */
+enum pseudoflow_order {
+    PSEUDOFLOW_HIGHEST_LABEL,
+    PSEUDOFLOW_FIFO
+};
+
+/* What one run of the pseudoflow algorithm did */
+struct pseudoflow_stats {
+    int vertices;
+    long merges;            // Strong trees merged into another tree
+    long splits;            // Trees split at an arc a push saturated
+    long pushes;            // Pushes on tree arcs
+    long rerooted;          // Tree arcs turned around by merges
+    long relabels;
+    long lifted;            // Vertices moved to the source side by a gap
+    long arc_scans;         // Arcs looked at for a merge
+};
+
+/* The pseudoflow algorithm
+ * Args:    - Pointer to graph
+ *          - Which strong root to process next
+ *          - Pointer to the counters to fill in. Can be NULL.
+ * Return:  The maximum flow */
+int pseudoflow(struct graph* g, enum pseudoflow_order order,
+               struct pseudoflow_stats* stats);
+
+/* The pseudoflow algorithm processing the strong root with the highest label
+ * first. The counters are kept for pseudoflow_print_stats.
+ * Args:    - Pointer to graph
+ * Return:  The maximum flow */
+int pseudoflow_highest_label(struct graph* g);
+
+/* The pseudoflow algorithm processing the strong roots first in, first out.
+ * The counters are kept for pseudoflow_print_stats.
+ * Args:    - Pointer to graph
+ * Return:  The maximum flow */
+int pseudoflow_fifo(struct graph* g);
+
+/* Prints the counters of the last run of pseudoflow_highest_label or
+ * pseudoflow_fifo in this thread on one line. The tree operations, merges,
+ * splits, pushes and arcs turned around, are also given per vertex.
+ * Args:    - The file to print to
+ * Return:  Nothing */
+void pseudoflow_print_stats(FILE* fp);
+
+#endif
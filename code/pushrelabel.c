@@ -1,10 +1,13 @@
 #include "pushrelabel.h"
+#include "placement.h"
 #include "maxflow.h"
 #include "edge.h"
+#include "trace.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <assert.h>
 
 // Only checks residual capacity of edge and the heights since excess is
 // checked earlier in push relabel algorithm.
@@ -53,7 +56,9 @@ int relabel_applies(int u, int* excess, struct list* neighbors, int* heights) {
     return ans;
 }
 
-void relabel(int u, struct list* neighbors, int* heights) {
+void relabel(struct graph* g, int u, int* heights) {
+    TRACE_BEGIN("relabel");
+    struct list* neighbors = g->adj_array[u];
     int min = INT_MAX;
     int cfe, v_height;
 
@@ -68,106 +73,487 @@ void relabel(int u, struct list* neighbors, int* heights) {
         }
         cur = cur->next;
     }
+
+    // The virtual arcs to the super sink, at height 0, and back to the super
+    // source, at height |V|, are part of the residual graph too
+    if (0 < graph_demand_left(g, u)) {
+        min = 0;
+    }
+    if (0 < g->supplied[u] && min > g->size) {
+        min = g->size;
+    }
     // u.height = 1 + min{v.h : (u,v) in E_f}
     heights[u] = 1 + min;
+    TRACE_END("relabel");
 }
 
-void initialize_preflow(struct graph* g, int* excess, int* height) {
-    int s = 0;
+int push_terminal(struct graph* g, int u, int* excess, int* heights) {
+    int amount;
+
+    // Push to the super sink
+    if (heights[u] == 1 && 0 < graph_demand_left(g, u)) {
+        amount = graph_demand_left(g, u);
+        amount = excess[u] < amount ? excess[u] : amount;
+        g->absorbed[u] += amount;
+    }
+    // Push back to the super source
+    else if (heights[u] == g->size + 1 && 0 < g->supplied[u]) {
+        amount = excess[u] < g->supplied[u] ? excess[u] : g->supplied[u];
+        g->supplied[u] -= amount;
+    }
+    else {
+        return 0;
+    }
+    excess[u] -= amount;
+    return 1;
+}
+
+int is_unbounded_terminal(struct graph* g, int u) {
+    return g->supply[u] == TERMINAL_UNBOUNDED ||
+           g->demand[u] == TERMINAL_UNBOUNDED;
+}
 
+void initialize_preflow(struct graph* g, int* excess, int* height) {
     for (int i = 0; i < g->size; i++) {
         excess[i] = 0;
         height[i] = 0;
+        g->supplied[i] = 0;
+        g->absorbed[i] = 0;
     }
-    height[s] = g->size;
 
-    struct list* s_adj = g->adj_array[s];
-    struct element* cur = s_adj->head;
-    struct edge* cur_e;
+    for (int s = 0; s < g->size; s++) {
+        // A source with limited supply gets it all as excess. The virtual arc
+        // from the super source is saturated.
+        if (g->supply[s] != TERMINAL_UNBOUNDED) {
+            excess[s] += g->supply[s];
+            g->supplied[s] = g->supply[s];
+            continue;
+        }
 
-    // Iterate the source's adjacency list and push flow to all its neighbors
-    // so the edges get saturated
-    for (int i = 0; i < s_adj->size; i++) {
+        // An unbounded source is a part of the super source
+        height[s] = g->size;
 
-        cur_e = ((struct edge*)cur->this);
+        struct list* s_adj = g->adj_array[s];
+        struct element* cur = s_adj->head;
+        struct edge* cur_e;
 
-        cur_e->flow = cur_e->capacity;
-        excess[cur_e->to] = cur_e->capacity;
-        excess[s] -= cur_e->capacity;
+        // Iterate the source's adjacency list and push flow to all its
+        // neighbors so the edges get saturated. Edges between unbounded sources
+        // are inside the super source and are left empty.
+        for (int i = 0; i < s_adj->size; i++) {
 
-        cur = cur->next;
+            cur_e = ((struct edge*)cur->this);
+
+            if (cur_e->original && g->supply[cur_e->to] != TERMINAL_UNBOUNDED) {
+                cur_e->flow = cur_e->capacity;
+                excess[cur_e->to] += cur_e->capacity;
+                excess[s] -= cur_e->capacity;
+            }
+
+            cur = cur->next;
+        }
     }
 }
 
-// Implementaion of Relabel-to-front algorithm from p. 755 of CLRS
-int relabel_to_front(struct graph* g) {
-    int* height = malloc(g->size * sizeof(int));
-    int* excess = malloc(g->size * sizeof(int));
-    int v_except_s_t = g->size - 2;
-    struct element** cur_pointers = malloc(v_except_s_t * sizeof(struct element));
-    struct list* L = list_init();
-
-    for (int i = 0; i < v_except_s_t; i++) {
-        // L = G.V - {s,t}
-        list_insert_last(L, &g->vertices[i+1]);
+static _Thread_local struct push_relabel_stats last_stats;
+
+void push_relabel_init(struct push_relabel* pr, struct graph* g) {
+    pr->g = g;
+    pr->height  = array_alloc(g->size * sizeof(int));
+    pr->excess  = array_alloc(g->size * sizeof(int));
+    pr->current = array_alloc(g->size * sizeof(struct element*));
+    assert(pr->height && pr->excess && pr->current);
+    pr->delta = LONG_MAX;
+    pr->budget = LONG_MAX;
+    pr->gained = NULL;
+    pr->strategy = NULL;
+    pr->count = NULL;
+    pr->stats = &last_stats;
+    pr->stats->pushes = 0;
+    pr->stats->relabels = 0;
+    pr->stats->discharges = 0;
+    pr->stats->phases = 0;
+    pr->stats->lifted = 0;
+
+    for (int i = 0; i < g->size; i++) {
         // The neighbor list of an vertex, u.N, is the same as its adjacency
         // list in this implementation
-        //for each vertex - s,t do u.current = u.N.head
-        cur_pointers[i] = g->adj_array[i+1]->head;
+        pr->current[i] = g->adj_array[i]->head;
+    }
+    initialize_preflow(g, pr->excess, pr->height);
+}
+
+// The flow into the sinks is the maximum flow. The flow on the virtual arcs
+// of the unbounded terminals is their excess.
+int push_relabel_flow(struct push_relabel* pr) {
+    struct graph* g = pr->g;
+    int maximum_flow = 0;
+
+    for (int i = 0; i < g->size; i++) {
+        if (g->supply[i] == TERMINAL_UNBOUNDED) {
+            g->supplied[i] = -pr->excess[i];
+        }
+        if (g->demand[i] == TERMINAL_UNBOUNDED) {
+            g->absorbed[i] = pr->excess[i];
+        }
+        maximum_flow += g->absorbed[i];
+    }
+    return maximum_flow;
+}
+
+void push_relabel_free(struct push_relabel* pr) {
+    array_free(pr->height);
+    array_free(pr->excess);
+    array_free(pr->current);
+}
+
+static int push_relabel_finish(struct push_relabel* pr) {
+    int maximum_flow = push_relabel_flow(pr);
+    graph_cancel_surplus(pr->g);
+    push_relabel_free(pr);
+    return maximum_flow;
+}
+
+// The gap heuristic. If no vertex is left at 'height', which is above the
+// super sink and below the super source, the vertices above it can not
+// reach a sink. They are lifted to |V|, the height of the super source.
+static void lift_gap(struct push_relabel* pr, int height) {
+    struct graph* g = pr->g;
+    int* count = pr->count;
+
+    for (int v = 0; v < g->size; v++) {
+        int h = pr->height[v];
+        if (height < h && h < g->size && !is_unbounded_terminal(g, v)) {
+            --count[h];
+            pr->height[v] = g->size;
+            pr->current[v] = g->adj_array[v]->head;
+            ++pr->stats->lifted;
+        }
     }
+}
+
+// Counts the vertices at each height below |V| for the gap heuristic
+static void count_heights(struct push_relabel* pr) {
+    struct graph* g = pr->g;
+    pr->count = calloc(g->size, sizeof(int));
+    assert(pr->count != NULL);
+    for (int i = 0; i < g->size; i++) {
+        if (!is_unbounded_terminal(g, i) && pr->height[i] < g->size) {
+            ++pr->count[pr->height[i]];
+        }
+    }
+}
+
+// Moves u from height 'before' in the counts and lifts the vertices above a
+// gap it left
+static void relabeled(struct push_relabel* pr, int u, int before) {
+    int n = pr->g->size;
+    if (before >= n) {
+        return;
+    }
+    --pr->count[before];
+    if (pr->height[u] < n) {
+        ++pr->count[pr->height[u]];
+    }
+    // Height 0 is never a gap, the super sink is there
+    if (pr->count[before] == 0 && 0 < before) {
+        lift_gap(pr, before);
+    }
+}
+
+// The discharge kernel of all the variants. Pushes u's excess on the
+// admissible arcs from u.current on, and to the terminals, until at most
+// 'until' is left. Stops after a relabel, or when a push would overfill a
+// vertex with delta excess. With the height counts a relabel that leaves a
+// gap lifts the vertices above it.
+// Return: 1 if u was relabeled, 0 if not
+static int discharge(struct push_relabel* pr, int u, int until) {
+    struct graph* g = pr->g;
+    int* excess = pr->excess;
+    ++pr->stats->discharges;
+
+    while (excess[u] > until) {
+        // v = u.current
+        struct element* v = pr->current[u];
+
+        // Relabel
+        // u's neighbors list's end is reached and none of u's outgoing
+        // edges are admissible. The virtual arcs to the terminals are
+        // last in the neighbor list.
+        if (v == NULL) {
+            if (!push_terminal(g, u, excess, pr->height)) {
+                int before = pr->height[u];
+                relabel(g, u, pr->height);
+                pr->current[u] = g->adj_array[u]->head;
+                ++pr->stats->relabels;
+                if (pr->count) {
+                    relabeled(pr, u, before);
+                }
+                return 1;
+            }
+            continue;
+        }
+
+        struct edge* uv = v->this;
+        // Neither push or relabel applies.
+        // Move u.current to its next neighbor
+        if (!push_applies(uv, pr->height)) {
+            pr->current[u] = v->next;
+            continue;
+        }
 
-    initialize_preflow(g, excess, height);
+        // Push
+        TRACE_BEGIN("push");
+        int w = uv->to, before = excess[w];
+        long amount = excess[u] < get_cfe(uv) ? excess[u] : get_cfe(uv);
+        if (!is_unbounded_terminal(g, w) && pr->delta - before < amount) {
+            amount = pr->delta - before;
+        }
+        if (amount <= 0) {
+            TRACE_END("push");
+            return 0;
+        }
+        if (uv->original) {
+            uv->flow += amount;
+        }
+        else {
+            uv->reverse_edge->flow -= amount;
+        }
+        excess[u] -= amount;
+        excess[w] += amount;
+        ++pr->stats->pushes;
+        TRACE_END("push");
 
-    struct element* u = L->head;
+        if (pr->gained && !is_unbounded_terminal(g, w)) {
+            pr->gained(pr, w, before);
+        }
+    }
+    return 0;
+}
 
-    int old_height, u_data, index = 0;
+// Implementaion of Relabel-to-front algorithm from p. 755 of CLRS. L is kept
+// in index arrays so that moving a vertex to the front is O(1).
+int relabel_to_front(struct graph* g) {
+    struct push_relabel pr;
+    push_relabel_init(&pr, g);
+    int* next = malloc(g->size * sizeof(int));
+    int* prev = malloc(g->size * sizeof(int));
+    assert(next && prev);
+
+    // L = G.V - {s,t}. Terminals without a limit are parts of the super
+    // source and super sink.
+    int head = -1, last = -1;
+    for (int i = 0; i < g->size; i++) {
+        if (is_unbounded_terminal(g, i)) {
+            continue;
+        }
+        prev[i] = last;
+        next[i] = -1;
+        if (last == -1) {
+            head = i;
+        }
+        else {
+            next[last] = i;
+        }
+        last = i;
+    }
 
     // Traverse L
-    while (u) {
-        // get the integer representing vertex u
-        u_data = *((int*)u->this);
-        old_height = height[u_data];
+    int u = head;
+    while (u != -1) {
+        int old_height = pr.height[u];
 
         // Discharge u
-        while (excess[u_data] > 0) {
-            // v = u.current
-            struct element* v = cur_pointers[u_data - 1];
-
-            // Relabel
-            // u's neighbors list's end is reached and none of u's outgoing
-            // edges are admissible
-            if (v == NULL) {
-                relabel(u_data, g->adj_array[u_data], height);
-                cur_pointers[u_data - 1] = g->adj_array[u_data]->head;
-            }
-            // Push
-            else if (push_applies(((struct edge*)v->this), height)) {
-                push((struct edge*)v->this, excess);
-            }
-            // Neither push or relabel applies.
-            // Move u.current to its next neighbor
-            else {
-                cur_pointers[u_data - 1] = v->next;
+        while (pr.excess[u] > 0) {
+            discharge(&pr, u, 0);
+        }
+
+        // Move u to front of L
+        if (pr.height[u] > old_height && u != head) {
+            next[prev[u]] = next[u];
+            if (next[u] != -1) {
+                prev[next[u]] = prev[u];
             }
+            prev[u] = -1;
+            next[u] = head;
+            prev[head] = u;
+            head = u;
+        }
+        u = next[u];
+    }
+
+    free(next);
+    free(prev);
+    return push_relabel_finish(&pr);
+}
+
+// The active vertices in a ring. A vertex is added when it gets excess and
+// is discharged until it has none, so it is in the ring at most once.
+struct fifo_queue {
+    int* ring;
+    int first;
+    int size;
+};
+
+static void fifo_gained(struct push_relabel* pr, int v, int before) {
+    struct fifo_queue* q = pr->strategy;
+    if (before == 0) {
+        q->ring[(q->first + q->size++) % pr->g->size] = v;
+    }
+}
+
+void push_relabel_run_fifo(struct push_relabel* pr) {
+    struct graph* g = pr->g;
+    struct fifo_queue q;
+    q.ring = malloc(g->size * sizeof(int));
+    q.first = 0;
+    q.size = 0;
+    assert(q.ring != NULL);
+    pr->gained = &fifo_gained;
+    pr->strategy = &q;
+    count_heights(pr);
+
+    for (int i = 0; i < g->size; i++) {
+        if (!is_unbounded_terminal(g, i) && pr->excess[i] > 0) {
+            fifo_gained(pr, i, 0);
         }
+    }
 
-        if (height[u_data] > old_height) {
-            // Move u to front of L and reset index
-            list_move_to_front(L, index);
-            index = 0;
+    // The budget is only counted per vertex, the discharge kernel never sees it
+    while (q.size && pr->budget > 0) {
+        --pr->budget;
+        int u = q.ring[q.first];
+        q.first = (q.first + 1) % g->size;
+        --q.size;
+        while (pr->excess[u] > 0) {
+            discharge(pr, u, 0);
         }
+    }
+
+    free(q.ring);
+    free(pr->count);
+    pr->count = NULL;
+    pr->gained = NULL;
+    pr->strategy = NULL;
+}
 
-        ++index;
-        u = u->next;
+int push_relabel_fifo(struct graph* g) {
+    struct push_relabel pr;
+    push_relabel_init(&pr, g);
+    push_relabel_run_fifo(&pr);
+    return push_relabel_finish(&pr);
+}
+
+// The vertices with more than delta / 2 excess in a stack for each height.
+// The one to discharge is one of the lowest.
+struct scaling_buckets {
+    int* first;
+    int* next;
+    char* in;
+    int lowest;
+    int size;
+};
+
+static void scaling_add(struct push_relabel* pr, int v) {
+    struct scaling_buckets* b = pr->strategy;
+    int h = pr->height[v];
+    assert(h < b->size);
+    if (b->in[v]) {
+        return;
+    }
+    b->in[v] = 1;
+    b->next[v] = b->first[h];
+    b->first[h] = v;
+    if (h < b->lowest) {
+        b->lowest = h;
     }
+}
 
-    int maximum_flow = excess[g->size-1];
+static void scaling_gained(struct push_relabel* pr, int v, int before) {
+    if (2 * (long)before <= pr->delta && 2 * (long)pr->excess[v] > pr->delta) {
+        scaling_add(pr, v);
+    }
+}
 
-    container_free(L, L->head, 0, 0);
-    free(cur_pointers);
-    free(height);
-    free(excess);
+// Ahuja and Orlin's excess scaling. In the phase for delta only vertices
+// with more than delta / 2 excess are discharged, the lowest first, and no
+// push gives a vertex more than delta excess. Delta starts at the least
+// power of 2 that is at least the largest capacity and excess, and is halved
+// every phase until it is 1.
+int push_relabel_excess_scaling(struct graph* g) {
+    struct push_relabel pr;
+    struct scaling_buckets b;
+    push_relabel_init(&pr, g);
+    int n = g->size;
+    long largest = 1;
+
+    b.size = 2 * n + 2;
+    b.first = malloc(b.size * sizeof(int));
+    b.next = malloc(n * sizeof(int));
+    b.in = calloc(n, 1);
+    assert(b.first && b.next && b.in);
+    pr.gained = &scaling_gained;
+    pr.strategy = &b;
+    count_heights(&pr);
+
+    for (int u = 0; u < n; u++) {
+        if (!is_unbounded_terminal(g, u) && pr.excess[u] > largest) {
+            largest = pr.excess[u];
+        }
+        for (struct element* cur = g->adj_array[u]->head; cur;
+             cur = cur->next) {
+            struct edge* e = cur->this;
+            if (e->original && e->capacity > largest) {
+                largest = e->capacity;
+            }
+        }
+    }
+    pr.delta = 1;
+    while (pr.delta < largest) {
+        pr.delta *= 2;
+    }
 
-    return maximum_flow;
+    for (; pr.delta >= 1; pr.delta /= 2) {
+        ++pr.stats->phases;
+        for (int h = 0; h < b.size; h++) {
+            b.first[h] = -1;
+        }
+        b.lowest = b.size;
+        for (int u = 0; u < n; u++) {
+            if (!is_unbounded_terminal(g, u) &&
+                2 * (long)pr.excess[u] > pr.delta) {
+                scaling_add(&pr, u);
+            }
+        }
+
+        while (b.lowest < b.size) {
+            int u = b.first[b.lowest];
+            if (u == -1) {
+                ++b.lowest;
+                continue;
+            }
+            b.first[b.lowest] = b.next[u];
+            b.in[u] = 0;
+
+            discharge(&pr, u, pr.delta / 2);
+            // Relabeled or stopped by a full vertex, which is lower
+            if (2 * (long)pr.excess[u] > pr.delta) {
+                scaling_add(&pr, u);
+            }
+        }
+    }
+
+    free(b.first);
+    free(b.next);
+    free(b.in);
+    free(pr.count);
+    pr.count = NULL;
+    return push_relabel_finish(&pr);
 }
 
+void push_relabel_print_stats(FILE* fp) {
+    fprintf(fp, "push-relabel: pushes %ld, relabels %ld, discharges %ld, "
+            "phases %ld, lifted %ld\n", last_stats.pushes,
+            last_stats.relabels, last_stats.discharges, last_stats.phases,
+            last_stats.lifted);
+}
@@ -4,6 +4,8 @@
 #include "list.h"
 #include "graph.h"
 
+#include <stdio.h>
+
 /* Checks if push applies:
  * e(u) > 0, c_f(u,v) > 0, u.h = v.h + 1
  * Args:    - A pointer to an edge
@@ -26,20 +28,92 @@ void push(struct edge*, int* excess);
 int relabel_applies(int u, int* excess, struct list* neighbors, int* heights);
 
 /* Relabels u : u.h = 1 + min{v.h : (u,v) in E_f}
- * Args:    - The vertex, u
- *          - u's neighbor list
+ * The virtual arcs to the super sink and super source are included.
+ * Args:    - Pointer to graph
+ *          - The vertex, u
  *          - Array with all vertices' heights
  * Return:  Nothing */
-void relabel(int u, struct list* neighbors, int* heights);
+void relabel(struct graph* g, int u, int* heights);
 
-/* Initialize preflow in G by pushing flow
- * on all edges going out from the source
+/* Push flow on the virtual arc from u to the super sink, at height 0, or back
+ * on the virtual arc to the super source, at height |V|, if it applies
+ * Args:    - Pointer to graph
+ *          - The vertex, u
+ *          - Array containing vertices' excess flow
+ *          - Array with all vertices' heights
+ * Return:  1 if flow was pushed and 0 if not */
+int push_terminal(struct graph* g, int u, int* excess, int* heights);
+
+/* Checks if u is a source or sink without limit on its supply or demand.
+ * These are parts of the super source or super sink and are never discharged.
+ * Args:    - Pointer to graph
+ *          - The vertex, u
+ * Return:  1 for true and 0 for false */
+int is_unbounded_terminal(struct graph* g, int u);
+
+/* Initialize preflow in G by pushing flow on all edges going out from the
+ * unbounded sources and giving the other sources their supply as excess
  * Args:    - Pointer to graph
  *          - Array with all vertices' excess
  *          - Array with all vertices' heights
  * Return: Nothing */
 void initialize_preflow(struct graph*, int* excess, int* height);
 
+/* What the last run of a push-relabel variant in a thread did */
+struct push_relabel_stats {
+    long pushes;
+    long relabels;
+    long discharges;    // Calls of the discharge kernel shared by the variants
+    long phases;        // Scaling phases, 0 for the other variants
+    long lifted;        // Vertices lifted to |V| by a gap, in pr-fifo and
+                        // pr-scaling
+};
+
+/* The state of a push-relabel run. The variants share it and the discharge
+ * kernel in pushrelabel.c, and differ only in which vertex they discharge
+ * next. They learn of the vertices that get excess through 'gained'. */
+struct push_relabel {
+    struct graph* g;
+    int* height;
+    int* excess;
+    struct element** current;   // u.current, NULL after the last neighbor
+    long delta;                 // A push leaves at most this much excess
+    long budget;                // Vertices push_relabel_run_fifo may still
+                                // discharge, LONG_MAX for no limit
+    void (*gained)(struct push_relabel*, int v, int before);
+    void* strategy;
+    int* count;                 // Vertices at each height below |V| for the
+                                // gap heuristic, NULL without it
+    struct push_relabel_stats* stats;
+};
+
+/* Starts a push-relabel run with a preflow in the graph
+ * Args:    - Pointer to the state to fill in
+ *          - Pointer to graph
+ * Return:  Nothing */
+void push_relabel_init(struct push_relabel* pr, struct graph* g);
+
+/* Discharges the vertices with excess first in, first out until none has
+ * any. When a relabel leaves no vertex at a height below |V|, the vertices
+ * above it are lifted to |V|, the gap heuristic. It starts from the heights
+ * and flow the run has, so the capacities of the terminals' virtual arcs can
+ * be changed between calls as long as the heights stay valid. It stops
+ * early when the run's budget is used up, and the next call goes on from
+ * there.
+ * Args:    - Pointer to the state
+ * Return:  Nothing */
+void push_relabel_run_fifo(struct push_relabel* pr);
+
+/* Sets the flow on the unbounded terminals' virtual arcs from their excess
+ * Args:    - Pointer to the state
+ * Return:  The flow into the sinks */
+int push_relabel_flow(struct push_relabel* pr);
+
+/* Frees the arrays of a run, but not the graph
+ * Args:    - Pointer to the state
+ * Return:  Nothing */
+void push_relabel_free(struct push_relabel* pr);
+
 /* The Relabel-to-Front algorithm to use
  * on a graph to find the maximum flow
  * Args:    - Pointer to graph
@@ -47,5 +121,24 @@ void initialize_preflow(struct graph*, int* excess, int* height);
  * */
 int relabel_to_front(struct graph*);
 
+/* Push-relabel discharging the active vertices first in, first out
+ * Args:    - Pointer to graph
+ * Return:  The maximum flow */
+int push_relabel_fifo(struct graph* g);
+
+/* Push-relabel with Ahuja and Orlin's excess scaling. Only vertices with
+ * large excess are discharged, the lowest first, and pushes never give a
+ * vertex more excess than the current scale. It uses the gap heuristic of
+ * push_relabel_run_fifo too.
+ * Args:    - Pointer to graph
+ * Return:  The maximum flow */
+int push_relabel_excess_scaling(struct graph* g);
+
+/* Prints the counters of the last run of relabel_to_front, push_relabel_fifo
+ * or push_relabel_excess_scaling in this thread on one line
+ * Args:    - The file to print to
+ * Return:  Nothing */
+void push_relabel_print_stats(FILE* fp);
+
 #endif
 
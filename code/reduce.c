@@ -0,0 +1,383 @@
+#include "reduce.h"
+#include "graph.h"
+#include "container.h"
+#include "list.h"
+#include "edge.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <assert.h>
+#include <time.h>
+
+/* The arcs while the graph is being reduced. Arc a goes from 'from[a]' to
+ * 'to[a]' and is the series-parallel tree with root 'node[a]'. */
+struct work_arcs {
+    int* from;
+    int* to;
+    int* node;
+    int* alive;
+    int size;
+};
+
+static int add_node(struct reduction* r, int series, int left, int right) {
+    struct sp_node* nd = &r->nodes[r->n_nodes];
+    long capacity;
+
+    if (series) {
+        capacity = r->nodes[left].capacity < r->nodes[right].capacity ?
+                   r->nodes[left].capacity : r->nodes[right].capacity;
+    } else {
+        // The capacities of merged arcs are capped, as no flow can be larger
+        capacity = (long)r->nodes[left].capacity + r->nodes[right].capacity;
+        capacity = capacity < INT_MAX ? capacity : INT_MAX;
+    }
+    nd->capacity = capacity;
+    nd->series   = series;
+    nd->left     = left;
+    nd->right    = right;
+    nd->edge     = NULL;
+    return r->n_nodes++;
+}
+
+// Marks the vertices reachable from the sources when 'forward' is 1, or the
+// vertices that can reach a sink when 'forward' is 0. Only edges with
+// capacity are used.
+static void mark_reachable(struct graph* g, int forward, int* mark) {
+    int* stack = malloc(g->size * sizeof(int));
+    assert(stack != NULL);
+    int top = 0;
+
+    for (int i = 0; i < g->size; i++) {
+        mark[i] = forward ? g->supply[i] > 0 : g->demand[i] > 0;
+        if (mark[i]) {
+            stack[top++] = i;
+        }
+    }
+
+    while (top) {
+        int u = stack[--top];
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            // Searching backward uses the reverse edges of the edges into u
+            int capacity = forward ? e->capacity : e->reverse_edge->capacity;
+            if (e->original == forward && capacity > 0 && !mark[e->to]) {
+                mark[e->to] = 1;
+                stack[top++] = e->to;
+            }
+        }
+    }
+    free(stack);
+}
+
+// Merges arcs with the same tail and head into one arc. The arcs are put in a
+// list per tail, and the arc from the current tail to each head is stamped
+// with the tail, so every group of parallel arcs is found wherever its arcs
+// are, also the ones added by contract_series.
+// Return: The number of arcs merged
+static int merge_parallel(struct reduction* r, struct work_arcs* w, int n,
+                          int* first, int* next, int* stamp, int* at_head) {
+    int merged = 0;
+
+    for (int i = 0; i < n; i++) {
+        first[i] = -1;
+        stamp[i] = -1;
+    }
+    // Backwards, so the lists keep the order of the arcs
+    for (int a = w->size - 1; a >= 0; a--) {
+        if (w->alive[a]) {
+            next[a] = first[w->from[a]];
+            first[w->from[a]] = a;
+        }
+    }
+    for (int u = 0; u < n; u++) {
+        for (int a = first[u]; a != -1; a = next[a]) {
+            int v = w->to[a];
+            if (stamp[v] == u) {
+                int b = at_head[v];
+                w->node[b] = add_node(r, 0, w->node[b], w->node[a]);
+                w->alive[a] = 0;
+                ++merged;
+            } else {
+                stamp[v]   = u;
+                at_head[v] = a;
+            }
+        }
+    }
+    return merged;
+}
+
+// Contracts vertices with one arc in and one arc out, which are not
+// terminals. A vertex where the arcs go back to where they came from is on no
+// path between the terminals and is removed.
+// Return: The number of vertices contracted or removed
+static int contract_series(struct reduction* r, struct work_arcs* w,
+                           int* keep, int* in_deg, int* out_deg,
+                           int* in_arc, int* out_arc) {
+    struct graph* g = r->original;
+    int contracted = 0;
+
+    for (int i = 0; i < g->size; i++) {
+        in_deg[i]  = 0;
+        out_deg[i] = 0;
+    }
+    for (int a = 0; a < w->size; a++) {
+        if (w->alive[a]) {
+            ++out_deg[w->from[a]];
+            ++in_deg[w->to[a]];
+            out_arc[w->from[a]] = a;
+            in_arc[w->to[a]]    = a;
+        }
+    }
+
+    for (int v = 0; v < g->size; v++) {
+        if (!keep[v] || in_deg[v] != 1 || out_deg[v] != 1 ||
+            g->supply[v] || g->demand[v]) {
+            continue;
+        }
+        int a = in_arc[v], b = out_arc[v];
+        int u = w->from[a], x = w->to[b];
+
+        w->alive[a] = 0;
+        w->alive[b] = 0;
+        keep[v] = 0;
+        ++contracted;
+
+        if (u == x) {
+            // u loses an arc in and out, and its single arcs are not known
+            // anymore, so it waits for the next round
+            in_deg[u] = out_deg[u] = -1;
+            continue;
+        }
+
+        int c = w->size++;
+        w->from[c]  = u;
+        w->to[c]    = x;
+        w->node[c]  = add_node(r, 1, w->node[a], w->node[b]);
+        w->alive[c] = 1;
+
+        // The arc replaces u's arc out and x's arc in, so the degrees are kept
+        if (out_arc[u] == a) {
+            out_arc[u] = c;
+        }
+        if (in_arc[x] == b) {
+            in_arc[x] = c;
+        }
+    }
+    return contracted;
+}
+
+struct reduction* reduce_graph(struct graph* g) {
+    clock_t start = clock();
+    int n = g->size, m = 0;
+
+    struct reduction* r = malloc(sizeof(struct reduction));
+    assert(r != NULL);
+    r->original = g;
+    r->zero_arcs = r->pruned_vertices = r->merged_arcs = r->contracted = 0;
+
+    for (int u = 0; u < n; u++) {
+        m += g->adj_array[u]->size;
+    }
+    m /= 2;
+    r->original_arcs = m;
+
+    // Each contraction adds a node and an arc, each merge adds a node
+    r->nodes = malloc((2 * m + 1) * sizeof(struct sp_node));
+    r->n_nodes = 0;
+
+    struct work_arcs w;
+    w.from  = malloc((2 * m + 1) * sizeof(int));
+    w.to    = malloc((2 * m + 1) * sizeof(int));
+    w.node  = malloc((2 * m + 1) * sizeof(int));
+    w.alive = malloc((2 * m + 1) * sizeof(int));
+    w.size  = 0;
+    int* next_arc = malloc((2 * m + 1) * sizeof(int));
+
+    int* keep     = malloc(n * sizeof(int));
+    int* backward = malloc(n * sizeof(int));
+    int* in_deg   = malloc(n * sizeof(int));
+    int* out_deg  = malloc(n * sizeof(int));
+    int* in_arc   = malloc(n * sizeof(int));
+    int* out_arc  = malloc(n * sizeof(int));
+    assert(r->nodes && w.from && w.to && w.node && w.alive && next_arc &&
+           keep && backward && in_deg && out_deg && in_arc && out_arc);
+
+    // Prune the vertices that are not on a path from a source to a sink
+    mark_reachable(g, 1, keep);
+    mark_reachable(g, 0, backward);
+    for (int v = 0; v < n; v++) {
+        keep[v] = keep[v] && backward[v];
+        r->pruned_vertices += !keep[v];
+    }
+
+    // Every original edge with capacity between kept vertices is a leaf
+    for (int u = 0; u < n; u++) {
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            if (!e->original) {
+                continue;
+            }
+            if (e->capacity == 0) {
+                ++r->zero_arcs;
+                continue;
+            }
+            if (keep[e->from] && keep[e->to]) {
+                struct sp_node* leaf = &r->nodes[r->n_nodes];
+                leaf->capacity = e->capacity;
+                leaf->series   = 0;
+                leaf->left     = -1;
+                leaf->right    = -1;
+                leaf->edge     = e;
+
+                w.from[w.size]  = e->from;
+                w.to[w.size]    = e->to;
+                w.node[w.size]  = r->n_nodes++;
+                w.alive[w.size] = 1;
+                ++w.size;
+            }
+        }
+    }
+
+    // Merging can give vertices one arc in and out, and contracting can make
+    // parallel arcs, so it is repeated until nothing changes
+    int changed;
+    do {
+        int merged = merge_parallel(r, &w, n, in_deg, next_arc, in_arc,
+                                    out_arc);
+        int contracted = contract_series(r, &w, keep, in_deg, out_deg,
+                                         in_arc, out_arc);
+        r->merged_arcs += merged;
+        r->contracted  += contracted;
+        changed = merged || contracted;
+    } while (changed);
+
+    // Build the reduced graph from the vertices and arcs left, keeping their
+    // order
+    int reduced_size = 0;
+    r->vertex_map = malloc(n * sizeof(int));
+    assert(r->vertex_map != NULL);
+    for (int v = 0; v < n; v++) {
+        r->vertex_map[v] = keep[v] ? reduced_size++ : -1;
+    }
+
+    // The graph must have a vertex, even if nothing is left
+    r->reduced = graph_init(reduced_size ? reduced_size : 1);
+    graph_clear_terminals(r->reduced);
+    for (int v = 0; v < n; v++) {
+        int rv = r->vertex_map[v];
+        if (rv != -1 && g->supply[v]) {
+            graph_add_source(r->reduced, rv, g->supply[v]);
+        }
+        if (rv != -1 && g->demand[v]) {
+            graph_add_sink(r->reduced, rv, g->demand[v]);
+        }
+    }
+
+    r->n_arcs = 0;
+    r->arcs = malloc((w.size + 1) * sizeof(struct edge*));
+    r->arc_node = malloc((w.size + 1) * sizeof(int));
+    assert(r->arcs != NULL && r->arc_node != NULL);
+    for (int a = 0; a < w.size; a++) {
+        if (w.alive[a]) {
+            int from = r->vertex_map[w.from[a]];
+            graph_add_edges(r->reduced, from, r->vertex_map[w.to[a]],
+                            r->nodes[w.node[a]].capacity);
+            // The new edge is the head of the tail's adjacency list
+            r->arcs[r->n_arcs] = r->reduced->adj_array[from]->head->this;
+            r->arc_node[r->n_arcs] = w.node[a];
+            ++r->n_arcs;
+        }
+    }
+
+    free(w.from);
+    free(w.to);
+    free(w.node);
+    free(w.alive);
+    free(next_arc);
+    free(keep);
+    free(backward);
+    free(in_deg);
+    free(out_deg);
+    free(in_arc);
+    free(out_arc);
+
+    r->seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    return r;
+}
+
+void reduction_expand_flow(struct reduction* r) {
+    struct graph* g = r->original;
+
+    graph_reset_flow(g);
+    for (int v = 0; v < g->size; v++) {
+        int rv = r->vertex_map[v];
+        if (rv != -1) {
+            g->supplied[v] = r->reduced->supplied[rv];
+            g->absorbed[v] = r->reduced->absorbed[rv];
+        }
+    }
+
+    // The trees can be as deep as the longest chain, so they are walked with
+    // a stack of nodes and their flow
+    int* stack_node = malloc((r->n_nodes + 1) * sizeof(int));
+    int* stack_flow = malloc((r->n_nodes + 1) * sizeof(int));
+    assert(stack_node != NULL && stack_flow != NULL);
+
+    for (int k = 0; k < r->n_arcs; k++) {
+        int top = 0;
+        stack_node[top] = r->arc_node[k];
+        stack_flow[top] = r->arcs[k]->flow;
+        ++top;
+
+        while (top) {
+            --top;
+            struct sp_node* nd = &r->nodes[stack_node[top]];
+            int flow = stack_flow[top];
+
+            if (nd->edge) {
+                nd->edge->flow = flow;
+            } else if (nd->series) {
+                // All arcs on a chain carry the same flow
+                stack_node[top] = nd->left;
+                stack_flow[top] = flow;
+                stack_node[top + 1] = nd->right;
+                stack_flow[top + 1] = flow;
+                top += 2;
+            } else {
+                // Fill the left arc first and put the rest on the right
+                int left = r->nodes[nd->left].capacity;
+                left = flow < left ? flow : left;
+                stack_node[top] = nd->left;
+                stack_flow[top] = left;
+                stack_node[top + 1] = nd->right;
+                stack_flow[top + 1] = flow - left;
+                top += 2;
+            }
+        }
+    }
+    free(stack_node);
+    free(stack_flow);
+}
+
+void reduction_print(struct reduction* r, FILE* fp) {
+    int n = r->original->size;
+    int reduced_n = n - r->pruned_vertices - r->contracted;
+
+    fprintf(fp, "reduce: |V| %d -> %d, |E| %d -> %d (%.1f%% of arcs left)\n",
+            n, reduced_n, r->original_arcs, r->n_arcs,
+            r->original_arcs ? 100.0 * r->n_arcs / r->original_arcs : 100.0);
+    fprintf(fp, "reduce: %d arcs without capacity, %d vertices pruned, "
+            "%d parallel arcs merged, %d chain vertices contracted\n",
+            r->zero_arcs, r->pruned_vertices, r->merged_arcs, r->contracted);
+    fprintf(fp, "reduce: %.3f ms\n", r->seconds * 1000);
+}
+
+void reduction_free(struct reduction* r) {
+    graph_free(r->reduced);
+    free(r->vertex_map);
+    free(r->nodes);
+    free(r->arcs);
+    free(r->arc_node);
+    free(r);
+}
@@ -0,0 +1,70 @@
+#ifndef REDUCE_H
+#define REDUCE_H
+
+#include "graph.h"
+#include "edge.h"
+
+#include <stdio.h>
+
+/* A node in the series-parallel tree of a reduced arc. A leaf is an edge of
+ * the original graph. A series node is a chain of its children where the
+ * capacity is the smallest of theirs, and a parallel node is its children
+ * side by side where the capacities are added. */
+struct sp_node {
+    int capacity;
+    int series;           // 1 for series and 0 for parallel
+    int left, right;      // Indices of the children. -1 for a leaf.
+    struct edge* edge;    // The original edge of a leaf
+};
+
+/* A graph reduced before solving, and what is needed to map its flow back to
+ * the original graph.
+ * 'vertex_map' maps the original vertices to the reduced ones, -1 if removed.
+ * 'arc_node' is the series-parallel tree of each of the reduced graph's edges
+ * in 'arcs'. */
+struct reduction {
+    struct graph* original;
+    struct graph* reduced;
+    int* vertex_map;
+    struct sp_node* nodes;
+    int n_nodes;
+    struct edge** arcs;
+    int* arc_node;
+    int n_arcs;
+
+    // What was done
+    int original_arcs;
+    int zero_arcs;        // Arcs without capacity
+    int pruned_vertices;  // Not reachable from a source or cannot reach a sink
+    int merged_arcs;      // Parallel arcs merged into another
+    int contracted;       // Vertices on chains that were contracted
+    double seconds;
+};
+
+/* Reduces a graph by removing arcs with no capacity, pruning vertices that
+ * are not on any path from a source to a sink, merging parallel arcs and
+ * contracting chains of vertices with one arc in and one out. The original
+ * graph is not changed.
+ * Args:    - Pointer to the graph with no flow
+ * Return:  Pointer to the reduction holding the reduced graph */
+struct reduction* reduce_graph(struct graph* g);
+
+/* Sets the flow in the original graph from the flow in the reduced graph.
+ * Flow on merged arcs is split between them and flow on a contracted chain is
+ * put on all of its arcs.
+ * Args:    - Pointer to the reduction
+ * Return:  Nothing */
+void reduction_expand_flow(struct reduction* r);
+
+/* Prints how much the graph was reduced
+ * Args:    - Pointer to the reduction
+ *          - The file to print to
+ * Return:  Nothing */
+void reduction_print(struct reduction* r, FILE* fp);
+
+/* Frees the reduction and the reduced graph, but not the original graph
+ * Args:    - Pointer to the reduction
+ * Return:  Nothing */
+void reduction_free(struct reduction* r);
+
+#endif
@@ -0,0 +1,371 @@
+#define _GNU_SOURCE
+#include "region.h"
+#include "csr.h"
+#include "csrflow.h"
+#include "dobfs.h"
+#include "pushrelabel.h"
+#include "loaddimacs.h"
+#include "trace.h"
+#include "placement.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+// What a worker counted, in the shared segment
+struct region_counts {
+    long pushes;
+    long relabels;
+};
+
+// The part of the shared segment that is not arrays
+struct region_header {
+    pthread_barrier_t barrier;
+    int done;
+};
+
+// A run. The arrays from 'height' on are in the shared segment, and the rest
+// is copied to the workers when they are forked.
+struct region_run {
+    struct csr* c;
+    struct graph* g;
+    int regions;
+    int* bound;             // Region r is bound[r] .. bound[r + 1] - 1
+    void* segment;
+    size_t segment_size;
+    struct region_header* sh;
+    int* height;            // Of the vertices of the worker's region
+    int* label;             // Of all the vertices at the start of the sweep
+    int* excess;
+    int* incoming;          // Flow pushed from other regions in the sweep
+    int* current;
+    int* ring;              // The active vertices of each region, in its range
+    struct region_counts* counts;
+};
+
+// Carves an array out of the segment, on a cache line of its own
+static void* carve(char** at, size_t size) {
+    void* p = *at;
+    *at += (size + 63) / 64 * 64;
+    return p;
+}
+
+// Maps the shared segment and puts the residual capacities and the flow of
+// the terminals in it
+static void region_map(struct region_run* r) {
+    int n = r->c->n, m = r->c->m;
+    size_t ints = (size_t)6 * (n + 1) + 2 * (size_t)(n + 1) + (m + 1);
+    r->segment_size = sizeof(struct region_header) + ints * sizeof(int) +
+                      r->regions * sizeof(struct region_counts) + 16 * 64;
+    r->segment = mmap(NULL, r->segment_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    assert(r->segment != MAP_FAILED);
+
+    char* at = r->segment;
+    r->sh       = carve(&at, sizeof(struct region_header));
+    r->height   = carve(&at, (n + 1) * sizeof(int));
+    r->label    = carve(&at, (n + 1) * sizeof(int));
+    r->excess   = carve(&at, (n + 1) * sizeof(int));
+    r->incoming = carve(&at, (n + 1) * sizeof(int));
+    r->current  = carve(&at, (n + 1) * sizeof(int));
+    r->ring     = carve(&at, (n + 1) * sizeof(int));
+    r->counts   = carve(&at, r->regions * sizeof(struct region_counts));
+    int* supplied = carve(&at, (n + 1) * sizeof(int));
+    int* absorbed = carve(&at, (n + 1) * sizeof(int));
+    int* residual = carve(&at, (m + 1) * sizeof(int));
+    assert(at <= (char*)r->segment + r->segment_size);
+
+    // The segment is zeroed by mmap
+    memcpy(residual, r->c->residual, m * sizeof(int));
+    array_free(r->c->residual);
+    r->c->residual = residual;
+    r->g->supplied = supplied;
+    r->g->absorbed = absorbed;
+
+    pthread_barrierattr_t attr;
+    pthread_barrierattr_init(&attr);
+    pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    // The workers and the parent
+    int made = pthread_barrier_init(&r->sh->barrier, &attr, r->regions + 1);
+    assert(made == 0);
+    pthread_barrierattr_destroy(&attr);
+}
+
+// Splits the vertices into ranges with about the same number of arcs
+static void region_split(struct region_run* r, struct region_stats* s) {
+    struct csr* c = r->c;
+    int v = 0;
+    r->bound[0] = 0;
+    for (int i = 1; i < r->regions; i++) {
+        long goal = (long)c->m * i / r->regions;
+        while (v < c->n && c->first[v] < goal) {
+            ++v;
+        }
+        r->bound[i] = v;
+    }
+    r->bound[r->regions] = c->n;
+
+    s->regions = r->regions;
+    s->arcs = c->m;
+    s->boundary_arcs = 0;
+    s->max_region_arcs = 0;
+    for (int i = 0; i < r->regions; i++) {
+        int first = r->bound[i], last = r->bound[i + 1];
+        long arcs = c->first[last] - c->first[first];
+        s->max_region_arcs = arcs > s->max_region_arcs ? arcs
+                                                       : s->max_region_arcs;
+        for (int a = c->first[first]; a < c->first[last]; a++) {
+            s->boundary_arcs += c->head[a] < first || last <= c->head[a];
+        }
+    }
+}
+
+// Like relabel in pushrelabel.c, with the vertices of the other regions at
+// their labels
+static void region_relabel(struct region_run* r, int u, int first, int last) {
+    struct csr* c = r->c;
+    int min = INT_MAX;
+
+    for (int a = c->first[u]; a < c->first[u + 1]; a++) {
+        int v = c->head[a];
+        int own = first <= v && v < last;
+        int residual = own ? c->residual[a]
+                           : __atomic_load_n(&c->residual[a], __ATOMIC_RELAXED);
+        int h = own ? r->height[v] : r->label[v];
+        if (0 < residual && h < min) {
+            min = h;
+        }
+    }
+    if (0 < graph_demand_left(r->g, u)) {
+        min = 0;
+    }
+    if (0 < r->g->supplied[u] && min > c->n) {
+        min = c->n;
+    }
+    assert(min != INT_MAX);
+    r->height[u] = 1 + min;
+}
+
+// Pushes u's excess on the admissible arcs, to the terminals, and across the
+// boundary, relabeling u when none is left, until it has none. The arcs
+// across the boundary and their reverse arcs can be changed by both their
+// workers at once. Only the worker of an arc's tail takes from its residual
+// capacity.
+static void region_discharge(struct region_run* r, struct region_counts* k,
+                             int u, int first, int last, int* ring,
+                             int* ring_first, int* ring_size) {
+    struct csr* c = r->c;
+    int* excess = r->excess;
+    int size = last - first;
+
+    while (excess[u] > 0) {
+        int a = r->current[u];
+        if (a == c->first[u + 1]) {
+            if (!push_terminal(r->g, u, excess, r->height)) {
+                region_relabel(r, u, first, last);
+                r->current[u] = c->first[u];
+                ++k->relabels;
+            }
+            continue;
+        }
+
+        int v = c->head[a];
+        int own = first <= v && v < last;
+        int residual = own ? c->residual[a]
+                           : __atomic_load_n(&c->residual[a], __ATOMIC_RELAXED);
+        int h = own ? r->height[v] : r->label[v];
+        if (residual <= 0 || r->height[u] != h + 1) {
+            ++r->current[u];
+            continue;
+        }
+
+        int amount = excess[u] < residual ? excess[u] : residual;
+        excess[u] -= amount;
+        ++k->pushes;
+        if (own) {
+            c->residual[a] -= amount;
+            c->residual[c->rev[a]] += amount;
+            int before = excess[v];
+            excess[v] += amount;
+            if (before == 0 && !is_unbounded_terminal(r->g, v)) {
+                ring[(*ring_first + (*ring_size)++) % size] = v;
+            }
+        }
+        else {
+            __atomic_fetch_sub(&c->residual[a], amount, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&c->residual[c->rev[a]], amount,
+                               __ATOMIC_RELAXED);
+            __atomic_fetch_add(&r->incoming[v], amount, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// A worker process. It discharges its region in each sweep, between the
+// parent's barriers. A sweep ends early after as many relabels as the region
+// has vertices, so the heights are set exactly again, like in rtf-simd.
+static void region_worker(struct region_run* r, int id) {
+    int first = r->bound[id], last = r->bound[id + 1];
+    int* ring = r->ring + first;
+    struct region_counts* k = &r->counts[id];
+
+    while (1) {
+        pthread_barrier_wait(&r->sh->barrier);
+        if (r->sh->done) {
+            break;
+        }
+        int ring_first = 0, ring_size = 0;
+        for (int v = first; v < last; v++) {
+            r->current[v] = r->c->first[v];
+            if (r->excess[v] > 0 && !is_unbounded_terminal(r->g, v)) {
+                ring[ring_size++] = v;
+            }
+        }
+        long relabels = k->relabels + (last - first);
+        while (ring_size && k->relabels < relabels) {
+            int u = ring[ring_first];
+            ring_first = (ring_first + 1) % (last - first);
+            --ring_size;
+            region_discharge(r, k, u, first, last, ring, &ring_first,
+                             &ring_size);
+        }
+        pthread_barrier_wait(&r->sh->barrier);
+    }
+}
+
+int region_push_relabel(struct graph* g, int regions, struct region_stats* s) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct region_stats own_stats;
+    s = s ? s : &own_stats;
+    memset(s, 0, sizeof(struct region_stats));
+    regions = regions < 1 ? 1 : regions;
+
+    struct region_run r;
+    r.c = csr_build(g);
+    r.g = g;
+    r.regions = regions;
+    r.bound = malloc((regions + 1) * sizeof(int));
+    pid_t* workers = malloc(regions * sizeof(pid_t));
+    assert(r.bound && workers);
+    int* supplied = g->supplied;
+    int* absorbed = g->absorbed;
+    region_split(&r, s);
+    region_map(&r);
+    csr_initialize_preflow(r.c, r.excess, r.height);
+
+    // Before any thread is started, so the workers are forked from a single
+    // thread
+    fflush(NULL);
+    for (int i = 0; i < regions; i++) {
+        workers[i] = fork();
+        assert(workers[i] != -1);
+        if (workers[i] == 0) {
+            region_worker(&r, i);
+            _exit(0);
+        }
+    }
+
+    struct bfs_engine* e = bfs_engine_init(r.c, bfs_default_threads());
+    int n = g->size;
+    while (1) {
+        for (int v = 0; v < n; v++) {
+            r.excess[v] += r.incoming[v];
+            r.incoming[v] = 0;
+        }
+        csr_global_relabel(r.c, e, r.height);
+        memcpy(r.label, r.height, n * sizeof(int));
+
+        int active = 0;
+        for (int v = 0; v < n && !active; v++) {
+            active = r.excess[v] > 0 && !is_unbounded_terminal(g, v);
+        }
+        r.sh->done = !active;
+        pthread_barrier_wait(&r.sh->barrier);
+        if (!active) {
+            break;
+        }
+        ++s->sweeps;
+        pthread_barrier_wait(&r.sh->barrier);
+    }
+    for (int i = 0; i < regions; i++) {
+        int status;
+        pid_t done = waitpid(workers[i], &status, 0);
+        assert(done == workers[i] && WIFEXITED(status) &&
+               WEXITSTATUS(status) == 0);
+        s->pushes += r.counts[i].pushes;
+        s->relabels += r.counts[i].relabels;
+    }
+
+    // The flow on the virtual arcs of the unbounded terminals is their excess
+    int maximum_flow = 0;
+    for (int i = 0; i < n; i++) {
+        if (g->supply[i] == TERMINAL_UNBOUNDED) {
+            g->supplied[i] = -r.excess[i];
+        }
+        if (g->demand[i] == TERMINAL_UNBOUNDED) {
+            g->absorbed[i] = r.excess[i];
+        }
+        maximum_flow += g->absorbed[i];
+    }
+    csr_store_flow(r.c);
+    graph_cancel_surplus(g);
+    memcpy(supplied, g->supplied, n * sizeof(int));
+    memcpy(absorbed, g->absorbed, n * sizeof(int));
+    g->supplied = supplied;
+    g->absorbed = absorbed;
+
+    bfs_engine_free(e);
+    pthread_barrier_destroy(&r.sh->barrier);
+    // The residual capacities were in the segment
+    r.c->residual = NULL;
+    csr_free(r.c);
+    munmap(r.segment, r.segment_size);
+    free(r.bound);
+    free(workers);
+    s->seconds = seconds_since(&start);
+    return maximum_flow;
+}
+
+int region_solve(struct graph* g) {
+    return region_push_relabel(g, bfs_default_threads(), NULL);
+}
+
+int region_benchmark(char* path, int* regions, int n, FILE* fp) {
+    struct graph* g = read_dimacs_file(path);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int expected = push_relabel_fifo(g);
+    double fifo = seconds_since(&start);
+    graph_free(g);
+    fprintf(fp, "region: pr-fifo maximum flow %d in %.3f ms\n", expected,
+            fifo * 1000);
+
+    int same = 1;
+    double first = 0;
+    for (int i = 0; i < n; i++) {
+        struct region_stats s;
+        g = read_dimacs_file(path);
+        int mf = region_push_relabel(g, regions[i], &s);
+        graph_free(g);
+        first = i == 0 ? s.seconds : first;
+        same &= mf == expected;
+        fprintf(fp, "region: %d regions, %.1f%% of the arcs between them, "
+                "the largest with %.2f times the mean\n", s.regions,
+                100.0 * s.boundary_arcs / (s.arcs ? s.arcs : 1),
+                (double)s.max_region_arcs * s.regions / (s.arcs ? s.arcs : 1));
+        fprintf(fp, "region: %d regions maximum flow %d%s, %ld sweeps, %ld "
+                "pushes, %ld relabels, %.3f ms, speedup %.2f over %d "
+                "regions and %.2f over pr-fifo\n", s.regions, mf,
+                mf == expected ? "" : " (WRONG)", s.sweeps, s.pushes,
+                s.relabels, s.seconds * 1000, first / s.seconds, regions[0],
+                fifo / s.seconds);
+    }
+    return !same;
+}
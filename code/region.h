@@ -0,0 +1,55 @@
+#ifndef REGION_H
+#define REGION_H
+
+#include "graph.h"
+
+#include <stdio.h>
+
+/* Push-relabel split into regions, after Delong and Boykov's region
+ * discharge. The vertices are split into ranges with about the same number
+ * of arcs, and each range is discharged by a worker process of its own. The
+ * residual capacities, heights and excess are in a segment of memory the
+ * processes share.
+ *
+ * The work goes in sweeps. Before each sweep the parent process sets all
+ * heights to the exact distances with a global relabel, as in rtf-simd, and
+ * copies them to the labels the workers see of the other regions. In a
+ * sweep each worker discharges the active vertices of its region first in,
+ * first out until none is left, with the vertices of the other regions at
+ * their labels. Flow pushed to another region is added to that vertex' excess
+ * by the parent at the end of the sweep. It stops when no vertex has excess. */
+
+/* What a run did */
+struct region_stats {
+    int regions;
+    long boundary_arcs;     // Arcs between regions, the reverse arcs included
+    long arcs;
+    long max_region_arcs;   // The most arcs in one region
+    long sweeps;
+    long pushes;
+    long relabels;
+    double seconds;
+};
+
+/* Finds a maximum flow with push-relabel split into regions
+ * Args:    - Pointer to graph
+ *          - Number of regions, each with a worker process
+ *          - The stats to fill in, or NULL
+ * Return:  The maximum flow */
+int region_push_relabel(struct graph* g, int regions, struct region_stats* s);
+
+/* region_push_relabel with bfs_default_threads regions, for solver.h
+ * Args:    - Pointer to graph
+ * Return:  The maximum flow */
+int region_solve(struct graph* g);
+
+/* Solves a graph with pr-fifo and then with each number of regions, and
+ * prints how the vertices were split, the sweeps and the speedups
+ * Args:    - Path to the graph
+ *          - The numbers of regions
+ *          - Number of them
+ *          - The file to print to
+ * Return:  0 on success, 1 if a flow differed */
+int region_benchmark(char* path, int* regions, int n, FILE* fp);
+
+#endif
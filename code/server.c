@@ -0,0 +1,501 @@
+#define _GNU_SOURCE
+#include "server.h"
+#include "graph.h"
+#include "solver.h"
+#include "loaddimacs.h"
+#include "container.h"
+#include "queue.h"
+#include "list.h"
+#include "edge.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+
+/* A graph file in the cache. 'template' is the graph as loaded and is never
+ * solved on, so copies can be made from it while other copies are in use.
+ * 'idle' holds copies with no flow that no request is using. A stale entry is
+ * out of the cache, because its file changed or it was evicted, and is freed
+ * when its last copy is given back. */
+struct cache_entry {
+    char* path;
+    struct timespec mtime;
+    struct graph* template;
+    struct list* idle;
+    int in_use;
+    int stale;
+    long last_used;
+};
+
+/* A solve request waiting in the queue */
+struct request {
+    char* line;
+    struct timespec received;
+};
+
+/* A capacity changed by a request, so it can be set back afterwards */
+struct capacity_change {
+    struct edge* e;
+    int capacity;
+};
+
+struct server {
+    pthread_mutex_t lock;
+    pthread_cond_t work;     // A request is queued or the server stops
+    pthread_cond_t answered; // A request is answered
+    struct queue* requests;
+    int pending;             // Requests queued or being solved
+    int stopping;
+
+    struct cache_entry** cache;
+    int cache_size;
+    long clock;              // Counts cache lookups. Used for LRU.
+
+    long n_requests, hits, misses, evictions;
+    long* latencies;         // Latency of each answered request in us
+    long n_latencies, max_latencies;
+};
+
+static long elapsed_us(struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000L +
+           (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+static void entry_free(struct cache_entry* entry) {
+    while (entry->idle->size) {
+        graph_free(list_remove_element(entry->idle, 0));
+    }
+    free(entry->idle);
+    graph_free(entry->template);
+    free(entry->path);
+    free(entry);
+}
+
+// Takes an entry out of the cache. Must hold the lock.
+static void entry_retire(struct server* sv, int index) {
+    struct cache_entry* entry = sv->cache[index];
+    sv->cache[index] = NULL;
+    entry->stale = 1;
+    if (entry->in_use == 0) {
+        entry_free(entry);
+    }
+}
+
+// Puts a new entry in the cache and evicts the least recently used entry if
+// the cache is full. Entries with copies in use are evicted last. Must hold
+// the lock.
+static void cache_insert(struct server* sv, struct cache_entry* entry) {
+    int victim = -1;
+
+    for (int i = 0; i < sv->cache_size; i++) {
+        if (!sv->cache[i]) {
+            sv->cache[i] = entry;
+            return;
+        }
+        if (victim == -1 ||
+            (sv->cache[i]->in_use == 0 && sv->cache[victim]->in_use != 0) ||
+            ((sv->cache[i]->in_use == 0) == (sv->cache[victim]->in_use == 0) &&
+             sv->cache[i]->last_used < sv->cache[victim]->last_used)) {
+            victim = i;
+        }
+    }
+    entry_retire(sv, victim);
+    ++sv->evictions;
+    sv->cache[victim] = entry;
+}
+
+// Finds the cached entry for a file. An entry for an older version of the
+// file is retired. Must hold the lock.
+static struct cache_entry* cache_find(struct server* sv, char* path,
+                                      struct timespec* mtime) {
+    for (int i = 0; i < sv->cache_size; i++) {
+        struct cache_entry* entry = sv->cache[i];
+        if (entry && strcmp(entry->path, path) == 0) {
+            if (entry->mtime.tv_sec == mtime->tv_sec &&
+                entry->mtime.tv_nsec == mtime->tv_nsec) {
+                return entry;
+            }
+            entry_retire(sv, i);
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+// Get a graph with no flow for the file. It is loaded if it is not cached.
+static struct graph* cache_checkout(struct server* sv, char* path,
+                                    struct cache_entry** out, int* hit) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&sv->lock);
+    struct cache_entry* entry = cache_find(sv, path, &st.st_mtim);
+    *hit = entry != NULL;
+
+    if (entry) {
+        ++sv->hits;
+    } else {
+        ++sv->misses;
+        pthread_mutex_unlock(&sv->lock);
+
+        // Load without holding the lock. Another worker might load the same
+        // file meanwhile, then the first one to finish is kept.
+        struct graph* template = read_dimacs_file_checked(path);
+        if (!template) {
+            return NULL;
+        }
+
+        pthread_mutex_lock(&sv->lock);
+        entry = cache_find(sv, path, &st.st_mtim);
+        if (entry) {
+            graph_free(template);
+        } else {
+            entry = malloc(sizeof(struct cache_entry));
+            assert(entry != NULL);
+            entry->path     = strdup(path);
+            entry->mtime    = st.st_mtim;
+            entry->template = template;
+            entry->idle     = list_init();
+            entry->in_use   = 0;
+            entry->stale    = 0;
+            cache_insert(sv, entry);
+        }
+    }
+    entry->last_used = ++sv->clock;
+    ++entry->in_use;
+
+    struct graph* g = NULL;
+    if (entry->idle->size) {
+        g = list_remove_element(entry->idle, 0);
+    }
+    pthread_mutex_unlock(&sv->lock);
+
+    // The template is never changed, so it can be copied without the lock
+    if (!g) {
+        g = graph_copy(entry->template);
+    }
+    *out = entry;
+    return g;
+}
+
+// Give a graph back to the cache. Its capacities must be set back already.
+static void cache_release(struct server* sv, struct cache_entry* entry,
+                          struct graph* g) {
+    int n = g->size;
+    graph_reset_flow(g);
+    memcpy(g->supply, entry->template->supply, n * sizeof(int));
+    memcpy(g->demand, entry->template->demand, n * sizeof(int));
+
+    pthread_mutex_lock(&sv->lock);
+    --entry->in_use;
+    if (entry->stale) {
+        graph_free(g);
+        if (entry->in_use == 0) {
+            entry_free(entry);
+        }
+    } else {
+        list_insert_first(entry->idle, g);
+    }
+    pthread_mutex_unlock(&sv->lock);
+}
+
+// Reads a vertex, numbered from 1, and checks that it is in the graph
+static int read_vertex(struct graph* g, char* token, int* v) {
+    if (!token || sscanf(token, "%d", v) != 1 || *v < 1 || g->size < *v) {
+        return 1;
+    }
+    --*v;
+    return 0;
+}
+
+// Applies the 's', 't' and 'c' options of a request to the graph. The changed
+// capacities are saved in 'changes'.
+// Returns an error message or NULL on success
+static char* apply_options(struct graph* g, char** save,
+                           struct capacity_change* changes, int* n_changes) {
+    int sources_cleared = 0, sinks_cleared = 0;
+    char* token;
+
+    while ((token = strtok_r(NULL, " \t\n", save))) {
+        int u, v, capacity;
+
+        if (strcmp(token, "s") == 0 || strcmp(token, "t") == 0) {
+            int is_source = *token == 's';
+            if (read_vertex(g, strtok_r(NULL, " \t\n", save), &v)) {
+                return "bad vertex";
+            }
+            if (is_source && !sources_cleared++) {
+                memset(g->supply, 0, g->size * sizeof(int));
+            }
+            if (!is_source && !sinks_cleared++) {
+                memset(g->demand, 0, g->size * sizeof(int));
+            }
+            if ((is_source && g->demand[v]) || (!is_source && g->supply[v])) {
+                return "vertex is both source and sink";
+            }
+            if (is_source) {
+                graph_add_source(g, v, TERMINAL_UNBOUNDED);
+            } else {
+                graph_add_sink(g, v, TERMINAL_UNBOUNDED);
+            }
+        }
+        else if (strcmp(token, "c") == 0) {
+            if (read_vertex(g, strtok_r(NULL, " \t\n", save), &u) ||
+                read_vertex(g, strtok_r(NULL, " \t\n", save), &v)) {
+                return "bad vertex";
+            }
+            token = strtok_r(NULL, " \t\n", save);
+            if (!token || sscanf(token, "%d", &capacity) != 1 || capacity < 0) {
+                return "bad capacity";
+            }
+
+            struct element* cur = g->adj_array[u]->head;
+            while (cur && !(((struct edge*)cur->this)->original &&
+                            ((struct edge*)cur->this)->to == v)) {
+                cur = cur->next;
+            }
+            if (!cur) {
+                return "no such arc";
+            }
+            changes[*n_changes].e = cur->this;
+            changes[*n_changes].capacity = changes[*n_changes].e->capacity;
+            changes[*n_changes].e->capacity = capacity;
+            ++*n_changes;
+        }
+        else {
+            return "unknown option";
+        }
+    }
+    return NULL;
+}
+
+static void record_latency(struct server* sv, long latency) {
+    if (sv->n_latencies == sv->max_latencies) {
+        sv->max_latencies = sv->max_latencies ? 2 * sv->max_latencies : 1024;
+        sv->latencies = realloc(sv->latencies, sv->max_latencies * sizeof(long));
+        assert(sv->latencies != NULL);
+    }
+    sv->latencies[sv->n_latencies++] = latency;
+}
+
+// Solves one request and writes the answer
+static void handle_request(struct server* sv, struct request* req) {
+    char* save;
+    char* id;
+    char* path;
+    char* algorithm;
+    char* error = NULL;
+    int maxflow = 0, hit = 0, n_changes = 0;
+
+    strtok_r(req->line, " \t\n", &save); // "solve"
+    id        = strtok_r(NULL, " \t\n", &save);
+    path      = strtok_r(NULL, " \t\n", &save);
+    algorithm = strtok_r(NULL, " \t\n", &save);
+
+    struct solver* solver = algorithm ? solver_find(algorithm) : NULL;
+    struct cache_entry* entry = NULL;
+    struct graph* g = NULL;
+
+    if (!id || !path || !algorithm) {
+        error = "usage: solve <id> <path> <algorithm> [options]";
+    } else if (!solver) {
+        error = "unknown algorithm";
+    } else if (!solver->in_process) {
+        error = "algorithm not served";
+    } else if (!(g = cache_checkout(sv, path, &entry, &hit))) {
+        error = "cannot open graph";
+    }
+
+    if (g) {
+        // There can at most be one capacity change per remaining token
+        struct capacity_change* changes =
+            malloc((strlen(save) / 2 + 1) * sizeof(struct capacity_change));
+        assert(changes != NULL);
+
+        error = apply_options(g, &save, changes, &n_changes);
+        if (!error) {
+            TRACE_BEGIN("solve");
+            maxflow = solver->solve(g);
+            TRACE_END("solve");
+        }
+        while (n_changes) {
+            --n_changes;
+            changes[n_changes].e->capacity = changes[n_changes].capacity;
+        }
+        free(changes);
+        cache_release(sv, entry, g);
+    }
+
+    long latency = elapsed_us(&req->received);
+
+    pthread_mutex_lock(&sv->lock);
+    ++sv->n_requests;
+    if (error) {
+        fprintf(stdout, "err %s %s\n", id ? id : "-", error);
+    } else {
+        record_latency(sv, latency);
+        fprintf(stdout, "ok %s %d %ld %s\n", id, maxflow, latency,
+                hit ? "hit" : "miss");
+    }
+    fflush(stdout);
+    pthread_mutex_unlock(&sv->lock);
+}
+
+static void* worker(void* arg) {
+    struct server* sv = arg;
+
+    pthread_mutex_lock(&sv->lock);
+    while (1) {
+        while (queue_is_empty(sv->requests) && !sv->stopping) {
+            pthread_cond_wait(&sv->work, &sv->lock);
+        }
+        if (queue_is_empty(sv->requests)) {
+            break;
+        }
+        struct request* req = dequeue(sv->requests);
+        pthread_mutex_unlock(&sv->lock);
+
+        handle_request(sv, req);
+        free(req->line);
+        free(req);
+
+        pthread_mutex_lock(&sv->lock);
+        --sv->pending;
+        pthread_cond_broadcast(&sv->answered);
+    }
+    pthread_mutex_unlock(&sv->lock);
+    return NULL;
+}
+
+static int compare_longs(const void* a, const void* b) {
+    long x = *(const long*)a, y = *(const long*)b;
+    return (x > y) - (x < y);
+}
+
+// Writes the metrics. Must hold the lock.
+static void print_stats(struct server* sv, FILE* fp) {
+    long n = sv->n_latencies, sum = 0, p50 = 0, p99 = 0, max = 0;
+
+    if (n) {
+        long* sorted = malloc(n * sizeof(long));
+        assert(sorted != NULL);
+        memcpy(sorted, sv->latencies, n * sizeof(long));
+        qsort(sorted, n, sizeof(long), compare_longs);
+        for (long i = 0; i < n; i++) {
+            sum += sorted[i];
+        }
+        p50 = sorted[n / 2];
+        p99 = sorted[(n * 99) / 100];
+        max = sorted[n - 1];
+        free(sorted);
+    }
+    fprintf(fp, "stats requests %ld hits %ld misses %ld evictions %ld "
+            "mean_us %ld p50_us %ld p99_us %ld max_us %ld\n",
+            sv->n_requests, sv->hits, sv->misses, sv->evictions,
+            n ? sum / n : 0, p50, p99, max);
+    fflush(fp);
+}
+
+static void wait_for_pending(struct server* sv) {
+    while (sv->pending) {
+        pthread_cond_wait(&sv->answered, &sv->lock);
+    }
+}
+
+int server_run(int workers, int cache_size) {
+    assert(0 < workers);
+    assert(0 < cache_size);
+
+    struct server sv;
+    memset(&sv, 0, sizeof(struct server));
+    pthread_mutex_init(&sv.lock, NULL);
+    pthread_cond_init(&sv.work, NULL);
+    pthread_cond_init(&sv.answered, NULL);
+    sv.requests   = queue_init();
+    sv.cache_size = cache_size;
+    sv.cache      = calloc(cache_size, sizeof(struct cache_entry*));
+    assert(sv.cache != NULL);
+
+    pthread_t* threads = malloc(workers * sizeof(pthread_t));
+    assert(threads != NULL);
+    for (int i = 0; i < workers; i++) {
+        int created = pthread_create(&threads[i], NULL, &worker, &sv);
+        assert(created == 0);
+    }
+
+    char* line = NULL;
+    size_t len = 0;
+
+    // Read one request at a time
+    while (getline(&line, &len, stdin) != EOF) {
+        if (strncmp(line, "solve", 5) == 0) {
+            struct request* req = malloc(sizeof(struct request));
+            assert(req != NULL);
+            req->line = strdup(line);
+            clock_gettime(CLOCK_MONOTONIC, &req->received);
+
+            pthread_mutex_lock(&sv.lock);
+            enqueue(sv.requests, req);
+            ++sv.pending;
+            pthread_cond_signal(&sv.work);
+            pthread_mutex_unlock(&sv.lock);
+        }
+        else if (strncmp(line, "sync", 4) == 0) {
+            pthread_mutex_lock(&sv.lock);
+            wait_for_pending(&sv);
+            fprintf(stdout, "synced\n");
+            fflush(stdout);
+            pthread_mutex_unlock(&sv.lock);
+        }
+        else if (strncmp(line, "stats", 5) == 0) {
+            pthread_mutex_lock(&sv.lock);
+            print_stats(&sv, stdout);
+            pthread_mutex_unlock(&sv.lock);
+        }
+        else if (strncmp(line, "quit", 4) == 0) {
+            break;
+        }
+        else if (line[0] != '\n') {
+            pthread_mutex_lock(&sv.lock);
+            fprintf(stdout, "err - unknown request\n");
+            fflush(stdout);
+            pthread_mutex_unlock(&sv.lock);
+        }
+    }
+    free(line);
+
+    // Answer what is left and stop the workers
+    pthread_mutex_lock(&sv.lock);
+    wait_for_pending(&sv);
+    sv.stopping = 1;
+    pthread_cond_broadcast(&sv.work);
+    print_stats(&sv, stderr);
+    pthread_mutex_unlock(&sv.lock);
+
+    for (int i = 0; i < workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (int i = 0; i < cache_size; i++) {
+        if (sv.cache[i]) {
+            entry_free(sv.cache[i]);
+        }
+    }
+    free(threads);
+    free(sv.cache);
+    free(sv.latencies);
+    container_free(sv.requests, sv.requests->head, 0, 0);
+    pthread_mutex_destroy(&sv.lock);
+    pthread_cond_destroy(&sv.work);
+    pthread_cond_destroy(&sv.answered);
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+/* A long running solver that reads requests from stdin and writes the
+ * answers to stdout, one line each. Graphs are loaded once and kept in an LRU
+ * cache keyed by their path and modification time. The requests are solved
+ * concurrently by a pool of worker threads, so answers can come in another
+ * order than the requests.
+ *
+ * Requests:
+ *   solve <id> <path> <algorithm> [s <v>]... [t <v>]... [c <u> <v> <cap>]...
+ *       Solve the graph in the DIMACS file <path>. 's' and 't' replace the
+ *       file's sources and sinks, and 'c' sets the capacity of the arc (u,v)
+ *       for this request only. Vertices are numbered from 1 like in DIMACS.
+ *       Answer: ok <id> <maximum flow> <latency in us> <hit|miss>
+ *           or: err <id> <message>
+ *       A path that is not a DIMACS file the loader can read is answered
+ *       with 'err <id> cannot open graph' and is not cached. The
+ *       algorithms that fork processes or write files, pr-region and
+ *       pr-checkpoint, are answered with 'err <id> algorithm not served'.
+ *   sync    Wait until all requests sent so far are answered.
+ *           Answer: synced
+ *   stats   Answer: stats requests <n> hits <n> misses <n> evictions <n>
+ *                   mean_us <n> p50_us <n> p99_us <n> max_us <n>
+ *   quit    Wait for all requests, then stop. End of input does the same.
+ */
+
+/* Default number of worker threads and of graphs in the cache */
+#define SERVER_WORKERS 4
+#define SERVER_CACHE_SIZE 8
+
+/* Runs the server until 'quit' or end of input
+ * Args:    - Number of worker threads
+ *          - Number of graphs the cache can hold
+ * Return:  0 on success */
+int server_run(int workers, int cache_size);
+
+#endif
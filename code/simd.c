@@ -0,0 +1,238 @@
+#include "simd.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <immintrin.h>
+
+// Scalar versions, also used for the arcs left after the last full vector
+
+static int min_height_scalar(const int* residual, const int* head,
+                             const int* heights, int n) {
+    int min = INT_MAX;
+    for (int i = 0; i < n; i++) {
+        if (0 < residual[i] && heights[head[i]] < min) {
+            min = heights[head[i]];
+        }
+    }
+    return min;
+}
+
+static int find_admissible_scalar(const int* residual, const int* head,
+                                  const int* heights, int n, int height) {
+    for (int i = 0; i < n; i++) {
+        if (0 < residual[i] && heights[head[i]] == height) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int scan_unvisited_scalar(const int* residual, const int* head,
+                                 const int* mark, int n, int* out) {
+    int found = 0;
+    for (int i = 0; i < n; i++) {
+        if (0 < residual[i] && mark[head[i]] < 0) {
+            out[found++] = i;
+        }
+    }
+    return found;
+}
+
+// AVX2: 8 arcs at the time. Only the heads of arcs with residual capacity are
+// gathered, the other lanes get a value that never matches.
+
+__attribute__((target("avx2")))
+static int min_height_avx2(const int* residual, const int* head,
+                           const int* heights, int n) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i none = _mm256_set1_epi32(INT_MAX);
+    __m256i min  = none;
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i r   = _mm256_loadu_si256((const __m256i*)(residual + i));
+        __m256i idx = _mm256_loadu_si256((const __m256i*)(head + i));
+        __m256i has = _mm256_cmpgt_epi32(r, zero);
+        __m256i h   = _mm256_mask_i32gather_epi32(none, heights, idx, has, 4);
+        min = _mm256_min_epi32(min, h);
+    }
+
+    // Horizontal minimum of the 8 lanes
+    __m128i m = _mm_min_epi32(_mm256_castsi256_si128(min),
+                              _mm256_extracti128_si256(min, 1));
+    m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    int result = _mm_cvtsi128_si32(m);
+
+    int rest = min_height_scalar(residual + i, head + i, heights, n - i);
+    return rest < result ? rest : result;
+}
+
+__attribute__((target("avx2")))
+static int find_admissible_avx2(const int* residual, const int* head,
+                                const int* heights, int n, int height) {
+    __m256i zero   = _mm256_setzero_si256();
+    __m256i none   = _mm256_set1_epi32(INT_MIN);
+    __m256i target = _mm256_set1_epi32(height);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i r   = _mm256_loadu_si256((const __m256i*)(residual + i));
+        __m256i idx = _mm256_loadu_si256((const __m256i*)(head + i));
+        __m256i has = _mm256_cmpgt_epi32(r, zero);
+        __m256i h   = _mm256_mask_i32gather_epi32(none, heights, idx, has, 4);
+        __m256i hit = _mm256_and_si256(has, _mm256_cmpeq_epi32(h, target));
+        int bits = _mm256_movemask_ps(_mm256_castsi256_ps(hit));
+        if (bits) {
+            return i + __builtin_ctz(bits);
+        }
+    }
+
+    int rest = find_admissible_scalar(residual + i, head + i, heights, n - i,
+                                      height);
+    return rest < 0 ? -1 : i + rest;
+}
+
+__attribute__((target("avx2")))
+static int scan_unvisited_avx2(const int* residual, const int* head,
+                               const int* mark, int n, int* out) {
+    __m256i zero = _mm256_setzero_si256();
+    int found = 0, i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i r   = _mm256_loadu_si256((const __m256i*)(residual + i));
+        __m256i idx = _mm256_loadu_si256((const __m256i*)(head + i));
+        __m256i has = _mm256_cmpgt_epi32(r, zero);
+        __m256i v   = _mm256_mask_i32gather_epi32(zero, mark, idx, has, 4);
+        __m256i hit = _mm256_cmpgt_epi32(zero, v);
+        int bits = _mm256_movemask_ps(_mm256_castsi256_ps(hit));
+        while (bits) {
+            out[found++] = i + __builtin_ctz(bits);
+            bits &= bits - 1;
+        }
+    }
+
+    int rest = scan_unvisited_scalar(residual + i, head + i, mark, n - i,
+                                     out + found);
+    for (int k = found; k < found + rest; k++) {
+        out[k] += i;
+    }
+    return found + rest;
+}
+
+// AVX-512: 16 arcs at the time, the last ones with a mask instead of the
+// scalar version
+
+__attribute__((target("avx512f")))
+static int min_height_avx512(const int* residual, const int* head,
+                             const int* heights, int n) {
+    __m512i zero = _mm512_setzero_si512();
+    __m512i min  = _mm512_set1_epi32(INT_MAX);
+
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 in = n - i < 16 ? (__mmask16)((1u << (n - i)) - 1) : 0xFFFF;
+        __m512i r    = _mm512_maskz_loadu_epi32(in, residual + i);
+        __m512i idx  = _mm512_maskz_loadu_epi32(in, head + i);
+        __mmask16 has = _mm512_mask_cmpgt_epi32_mask(in, r, zero);
+        __m512i h    = _mm512_mask_i32gather_epi32(min, has, idx, heights, 4);
+        min = _mm512_mask_min_epi32(min, has, min, h);
+    }
+    return _mm512_reduce_min_epi32(min);
+}
+
+__attribute__((target("avx512f")))
+static int find_admissible_avx512(const int* residual, const int* head,
+                                  const int* heights, int n, int height) {
+    __m512i zero   = _mm512_setzero_si512();
+    __m512i target = _mm512_set1_epi32(height);
+
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 in = n - i < 16 ? (__mmask16)((1u << (n - i)) - 1) : 0xFFFF;
+        __m512i r    = _mm512_maskz_loadu_epi32(in, residual + i);
+        __m512i idx  = _mm512_maskz_loadu_epi32(in, head + i);
+        __mmask16 has = _mm512_mask_cmpgt_epi32_mask(in, r, zero);
+        __m512i h    = _mm512_mask_i32gather_epi32(zero, has, idx, heights, 4);
+        __mmask16 hit = _mm512_mask_cmpeq_epi32_mask(has, h, target);
+        if (hit) {
+            return i + __builtin_ctz(hit);
+        }
+    }
+    return -1;
+}
+
+__attribute__((target("avx512f")))
+static int scan_unvisited_avx512(const int* residual, const int* head,
+                                 const int* mark, int n, int* out) {
+    __m512i zero  = _mm512_setzero_si512();
+    __m512i lanes = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8,
+                                     7, 6, 5, 4, 3, 2, 1, 0);
+    int found = 0;
+
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 in = n - i < 16 ? (__mmask16)((1u << (n - i)) - 1) : 0xFFFF;
+        __m512i r    = _mm512_maskz_loadu_epi32(in, residual + i);
+        __m512i idx  = _mm512_maskz_loadu_epi32(in, head + i);
+        __mmask16 has = _mm512_mask_cmpgt_epi32_mask(in, r, zero);
+        __m512i v    = _mm512_mask_i32gather_epi32(zero, has, idx, mark, 4);
+        __mmask16 hit = _mm512_mask_cmplt_epi32_mask(has, v, zero);
+        __m512i arcs = _mm512_add_epi32(lanes, _mm512_set1_epi32(i));
+        _mm512_mask_compressstoreu_epi32(out + found, hit, arcs);
+        found += __builtin_popcount(hit);
+    }
+    return found;
+}
+
+static struct simd_kernels kernels[SIMD_LEVELS] = {
+    {"scalar", &min_height_scalar, &find_admissible_scalar,
+     &scan_unvisited_scalar},
+    {"avx2",   &min_height_avx2,   &find_admissible_avx2,
+     &scan_unvisited_avx2},
+    {"avx512", &min_height_avx512, &find_admissible_avx512,
+     &scan_unvisited_avx512},
+};
+
+static struct simd_kernels* chosen = NULL;
+static pthread_once_t chosen_once = PTHREAD_ONCE_INIT;
+
+struct simd_kernels* simd_kernels_at(enum simd_level level) {
+    __builtin_cpu_init();
+    switch (level) {
+        case SIMD_SCALAR:
+            return &kernels[SIMD_SCALAR];
+        case SIMD_AVX2:
+            return __builtin_cpu_supports("avx2") ? &kernels[SIMD_AVX2] : NULL;
+        case SIMD_AVX512:
+            return __builtin_cpu_supports("avx512f") ? &kernels[SIMD_AVX512]
+                                                     : NULL;
+        default:
+            return NULL;
+    }
+}
+
+char* simd_level_name(enum simd_level level) {
+    return kernels[level].name;
+}
+
+static void choose_kernels(void) {
+    char* wanted = getenv("MAXFLOW_SIMD");
+    int level = SIMD_LEVELS - 1;
+
+    if (wanted) {
+        for (int i = 0; i < SIMD_LEVELS; i++) {
+            if (strcmp(wanted, kernels[i].name) == 0) {
+                level = i;
+            }
+        }
+    }
+    while (!simd_kernels_at(level)) {
+        --level;
+    }
+    chosen = simd_kernels_at(level);
+}
+
+struct simd_kernels* simd_kernels(void) {
+    pthread_once(&chosen_once, &choose_kernels);
+    return chosen;
+}
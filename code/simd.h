@@ -0,0 +1,44 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+/* Kernels that scan the arcs of one vertex in a compressed graph, see csr.h.
+ * Each takes the vertex's slices of the residual and head arrays and the
+ * number of arcs in them. There is a scalar version and AVX2 and AVX-512
+ * versions that gather the heads' values 8 or 16 arcs at the time.
+ *
+ * min_height:      The least heights[head[i]] over the arcs with residual
+ *                  capacity, INT_MAX if there are none
+ * find_admissible: The first arc with residual capacity into a vertex of the
+ *                  given height, -1 if there is none
+ * scan_unvisited:  Writes the arcs with residual capacity into vertices with
+ *                  a negative mark to 'out', in order, and returns how many */
+struct simd_kernels {
+    char* name;
+    int (*min_height)(const int* residual, const int* head, const int* heights,
+                      int n);
+    int (*find_admissible)(const int* residual, const int* head,
+                           const int* heights, int n, int height);
+    int (*scan_unvisited)(const int* residual, const int* head,
+                          const int* mark, int n, int* out);
+};
+
+enum simd_level {SIMD_SCALAR, SIMD_AVX2, SIMD_AVX512, SIMD_LEVELS};
+
+/* The kernels to use, the best the CPU supports. They are chosen once, the
+ * first time this is called. The environment variable MAXFLOW_SIMD set to
+ * scalar, avx2 or avx512 chooses a lower level.
+ * Args:    None
+ * Return:  Pointer to the kernels */
+struct simd_kernels* simd_kernels(void);
+
+/* The kernels of a given level
+ * Args:    - The level
+ * Return:  Pointer to the kernels, NULL if the CPU does not support them */
+struct simd_kernels* simd_kernels_at(enum simd_level level);
+
+/* The name of a level, as for MAXFLOW_SIMD
+ * Args:    - The level
+ * Return:  The name */
+char* simd_level_name(enum simd_level level);
+
+#endif
@@ -0,0 +1,142 @@
+#define _GNU_SOURCE
+#include "solver.h"
+#include "maxflow.h"
+#include "pushrelabel.h"
+#include "unitcap.h"
+#include "autoselect.h"
+#include "csrflow.h"
+#include "compact.h"
+#include "region.h"
+#include "context.h"
+#include "dynamic.h"
+#include "checkpoint.h"
+#include "pseudoflow.h"
+#include "loaddimacs.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+int ford_fulkerson(struct graph* g) {
+    return get_maximum_flow(g, &dfs);
+}
+
+int edmonds_karp(struct graph* g) {
+    return get_maximum_flow(g, &bfs);
+}
+
+// All solvers that can be chosen by name. The list ends with a NULL name.
+static struct solver solvers[] = {
+    {"dfs",        "Ford-Fulkerson, depth first search",
+     &ford_fulkerson, NULL, 1},
+    {"bfs",        "Edmonds-Karp, breadth first search",
+     &edmonds_karp, NULL, 1},
+    {"rtf",        "Relabel-to-Front push-relabel",
+     &relabel_to_front, &push_relabel_print_stats, 1},
+    {"pr-fifo",    "Push-relabel, first in first out",
+     &push_relabel_fifo, &push_relabel_print_stats, 1},
+    {"pr-scaling", "Push-relabel, Ahuja-Orlin excess scaling",
+     &push_relabel_excess_scaling, &push_relabel_print_stats, 1},
+    {"dinic",      "Dinic, depth first blocking flow",
+     &dinic, NULL, 1},
+    {"dinic-lct",  "Dinic, link-cut tree blocking flow",
+     &dinic_dynamic_trees, NULL, 1},
+    {"hpf",        "Pseudoflow, highest label first",
+     &pseudoflow_highest_label, &pseudoflow_print_stats, 1},
+    {"hpf-fifo",   "Pseudoflow, first in first out",
+     &pseudoflow_fifo, &pseudoflow_print_stats, 1},
+    {"bfs-simd",   "Edmonds-Karp, SIMD arc scans",
+     &csr_edmonds_karp, NULL, 1},
+    {"bfs-do",     "Edmonds-Karp, direction-optimizing",
+     &csr_edmonds_karp_do, NULL, 1},
+    {"rtf-simd",   "Relabel-to-Front, SIMD arc scans",
+     &csr_relabel_to_front, NULL, 1},
+    {"bfs-compact", "Edmonds-Karp, compressed arcs",
+     &compact_bfs_solve, NULL, 1},
+    {"pr-compact", "Push-relabel FIFO, compressed arcs",
+     &compact_pr_solve, NULL, 1},
+    {"pr-region",  "Push-relabel, regions in worker processes",
+     &region_solve, NULL, 0},
+    {"pr-context", "Push-relabel FIFO, reentrant context",
+     &context_solve_graph, &context_print_stats, 1},
+    {"pr-dynamic", "Push-relabel FIFO, mutable graph",
+     &dynamic_solve_graph, &dynamic_print_stats, 1},
+    {"pr-checkpoint", "Push-relabel FIFO, snapshots on disk",
+     &checkpoint_solve_graph, &checkpoint_print_stats, 0},
+    {"unit",       "Hopcroft-Karp or unit Dinic",
+     &unit_solve, NULL, 1},
+    {"auto",       "Chosen from the graph's statistics",
+     &auto_solve, NULL, 1},
+    {NULL,          NULL,
+     NULL, NULL, 0}
+};
+
+struct solver* solver_find(char* name) {
+    for (int i = 0; solvers[i].name; i++) {
+        if (strcmp(solvers[i].name, name) == 0) {
+            return &solvers[i];
+        }
+    }
+    return NULL;
+}
+
+struct solver* solver_at(int i) {
+    int count = sizeof(solvers) / sizeof(struct solver) - 1;
+    return 0 <= i && i < count ? &solvers[i] : NULL;
+}
+
+void solver_print_names(FILE* fp) {
+    for (int i = 0; solvers[i].name; i++) {
+        fprintf(fp, "%s%s", i ? ", " : "", solvers[i].name);
+    }
+}
+
+static int compare_times(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+int solver_compare(char* path, char** names, int n_names, FILE* fp) {
+    int expected = -1;
+
+    for (int i = 0; i < n_names; i++) {
+        struct solver* solver = solver_find(names[i]);
+        if (!solver) {
+            fprintf(stderr, "Unknown solver: %s\n", names[i]);
+            return 1;
+        }
+
+        double times[SOLVER_COMPARE_RUNS];
+        int mf = 0;
+        for (int run = 0; run < SOLVER_COMPARE_RUNS; run++) {
+            struct timespec start, end;
+            struct graph* g = read_dimacs_file(path);
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            TRACE_BEGIN("solve");
+            mf = solver->solve(g);
+            TRACE_END("solve");
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            times[run] = (end.tv_sec - start.tv_sec) +
+                         (end.tv_nsec - start.tv_nsec) / 1e9;
+            graph_free(g);
+        }
+        qsort(times, SOLVER_COMPARE_RUNS, sizeof(double), compare_times);
+
+        fprintf(fp, "compare: %-10s maximum flow %d, median %.3f ms, "
+                "min %.3f ms, max %.3f ms\n", solver->name, mf,
+                times[SOLVER_COMPARE_RUNS / 2] * 1000, times[0] * 1000,
+                times[SOLVER_COMPARE_RUNS - 1] * 1000);
+        if (solver->print_stats) {
+            solver->print_stats(fp);
+        }
+        if (i && mf != expected) {
+            fprintf(stderr, "compare: %s found %d, %s found %d\n",
+                    solver->name, mf, names[0], expected);
+            return 1;
+        }
+        expected = mf;
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "graph.h"
+
+#include <stdio.h>
+
+/* A maximum flow algorithm that can be chosen by name, e.g. from the command
+ * line. 'solve' runs it on a graph with no flow and returns the maximum flow.
+ * The flow is left in the graph's edges. 'print_stats' prints what the last
+ * run in the calling thread counted, NULL if the algorithm counts nothing.
+ * 'in_process' is 0 for the solvers that fork processes or write files,
+ * which auto does not choose and the server does not run. */
+struct solver {
+    char* name;
+    char* description;
+    int (*solve)(struct graph*);
+    void (*print_stats)(FILE*);
+    int in_process;
+};
+
+/* Find a maximum flow algorithm by its name
+ * Args:    - The name, e.g. "bfs"
+ * Return:  Pointer to the solver. NULL if there is no solver with that name */
+struct solver* solver_find(char* name);
+
+/* Get a solver by its place in the list of solvers, to go through them all
+ * Args:    - The index
+ * Return:  Pointer to the solver. NULL if the index is past the last solver */
+struct solver* solver_at(int i);
+
+/* Prints the names of all the solvers, separated by ", "
+ * Args:    - The file to print to
+ * Return:  Nothing */
+void solver_print_names(FILE* fp);
+
+/* Times each run of a solver in solver_compare */
+#define SOLVER_COMPARE_RUNS 3
+
+/* Times solvers on a graph, each on a new copy of it SOLVER_COMPARE_RUNS
+ * times, and prints the median, least and greatest time and the counters
+ * of the solvers that have them. All must find the same maximum flow.
+ * Args:    - Path to the graph
+ *          - Names of the solvers
+ *          - Number of solvers
+ *          - The file to print to
+ * Return:  0 on success, 1 for an unknown solver or a different flow */
+int solver_compare(char* path, char** names, int n_names, FILE* fp);
+
+/* Ford-Fulkerson using depth first search to find augmenting paths
+ * Args:    - Pointer to graph
+ * Return:  The maximum flow */
+int ford_fulkerson(struct graph* g);
+
+/* Edmonds-Karp using breadth first search to find augmenting paths
+ * Args:    - Pointer to graph
+ * Return:  The maximum flow */
+int edmonds_karp(struct graph* g);
+
+#endif
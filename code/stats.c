@@ -0,0 +1,105 @@
+#define _GNU_SOURCE
+#include "stats.h"
+#include "graph.h"
+#include "unitcap.h"
+#include "list.h"
+#include "edge.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+
+// Number of arcs from the sources to the nearest sink, using arcs with
+// capacity
+static int st_distance(struct graph* g) {
+    int* dist  = malloc(g->size * sizeof(int));
+    int* queue = malloc(g->size * sizeof(int));
+    assert(dist != NULL && queue != NULL);
+    int head = 0, tail = 0, found = -1;
+
+    for (int u = 0; u < g->size; u++) {
+        dist[u] = g->supply[u] ? 0 : -1;
+        if (g->supply[u]) {
+            queue[tail++] = u;
+        }
+    }
+    while (head < tail && found == -1) {
+        int u = queue[head++];
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            if (e->original && e->capacity > 0 && dist[e->to] == -1) {
+                dist[e->to] = dist[u] + 1;
+                queue[tail++] = e->to;
+                if (g->demand[e->to]) {
+                    found = dist[e->to];
+                    break;
+                }
+            }
+        }
+    }
+    free(dist);
+    free(queue);
+    return found;
+}
+
+void graph_stats_compute(struct graph* g, struct graph_stats* st) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    double sum_squares = 0;
+    st->n = g->size;
+    st->m = 0;
+    st->max_degree = 0;
+    st->min_capacity = INT_MAX;
+    st->max_capacity = 0;
+    st->sources = st->sinks = 0;
+
+    for (int u = 0; u < g->size; u++) {
+        int degree = 0;
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            if (!e->original) {
+                continue;
+            }
+            ++degree;
+            st->min_capacity = e->capacity < st->min_capacity ?
+                               e->capacity : st->min_capacity;
+            st->max_capacity = e->capacity > st->max_capacity ?
+                               e->capacity : st->max_capacity;
+        }
+        st->m += degree;
+        sum_squares += (double)degree * degree;
+        st->max_degree = degree > st->max_degree ? degree : st->max_degree;
+        st->sources += g->supply[u] > 0;
+        st->sinks   += g->demand[u] > 0;
+    }
+    if (st->m == 0) {
+        st->min_capacity = 0;
+    }
+
+    double n = st->n;
+    st->density = 1 < n ? st->m / (n * (n - 1)) : 0;
+    st->mean_degree = st->m / n;
+    st->degree_stddev = sqrt(fabs(sum_squares / n -
+                                  st->mean_degree * st->mean_degree));
+    st->unit = unit_classify(g, NULL);
+    st->st_distance = st_distance(g);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    st->seconds = (end.tv_sec - start.tv_sec) +
+                  (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+void graph_stats_print(struct graph_stats* st, FILE* fp) {
+    static char* unit_names[] = {"no", "yes", "bipartite"};
+    fprintf(fp, "stats: |V| %d, |E| %ld, density %.4f, degree mean %.2f "
+            "stddev %.2f max %d, capacity %d..%d, %d sources, %d sinks, "
+            "unit capacity %s, s-t distance %d, %.3f ms\n",
+            st->n, st->m, st->density, st->mean_degree, st->degree_stddev,
+            st->max_degree, st->min_capacity, st->max_capacity, st->sources,
+            st->sinks, unit_names[st->unit], st->st_distance,
+            st->seconds * 1000);
+}
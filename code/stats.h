@@ -0,0 +1,40 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "graph.h"
+#include "unitcap.h"
+
+#include <stdio.h>
+
+/* Cheap statistics of a graph, used to choose which algorithm to solve it
+ * with. The degrees are the number of arcs out of the vertices and the
+ * distance is the least number of arcs from a source to a sink. */
+struct graph_stats {
+    int n;
+    long m;
+    double density;         // m / (n (n - 1))
+    double mean_degree;
+    double degree_stddev;
+    int max_degree;
+    int min_capacity;
+    int max_capacity;
+    int sources;
+    int sinks;
+    enum unit_kind unit;
+    int st_distance;        // -1 if no sink can be reached
+    double seconds;         // Time used computing the statistics
+};
+
+/* Computes the statistics of a graph in O(|V| + |E|)
+ * Args:    - Pointer to the graph
+ *          - Pointer to the statistics to fill in
+ * Return:  Nothing */
+void graph_stats_compute(struct graph* g, struct graph_stats* st);
+
+/* Prints the statistics on one line
+ * Args:    - Pointer to the statistics
+ *          - The file to print to
+ * Return:  Nothing */
+void graph_stats_print(struct graph_stats* st, FILE* fp);
+
+#endif
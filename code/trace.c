@@ -0,0 +1,265 @@
+#define _GNU_SOURCE
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+
+// Span and counter names a thread can have
+#define TRACE_NAMES 64
+
+// A closed span, in nanoseconds from the first event of the process
+struct trace_event {
+    const char* name;
+    long begin;
+    long end;
+};
+
+// An open span. 'children' is the time of the spans closed inside it.
+struct trace_frame {
+    const char* name;
+    long begin;
+    long children;
+};
+
+// The sums for one name, for the table
+struct trace_total {
+    const char* name;
+    int counter;            // 1 for a counter, 0 for a span
+    long calls;             // The value of a counter
+    long total;
+    long self;              // The total without the spans inside
+};
+
+// What a thread has recorded. The buffers of all threads are kept in a list
+// until the process exits.
+struct trace_buffer {
+    int thread;
+    struct trace_event* events;
+    int n_events;
+    int events_size;
+    long dropped;
+    struct trace_frame stack[TRACE_DEPTH];
+    int depth;
+    struct trace_total totals[TRACE_NAMES];
+    int n_totals;
+    struct trace_buffer* next;
+};
+
+static _Thread_local struct trace_buffer* buffer;
+static struct trace_buffer* buffers;
+static int threads;
+static pthread_mutex_t buffers_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t started = PTHREAD_ONCE_INIT;
+static struct timespec epoch;
+
+static void trace_start(void) {
+    clock_gettime(CLOCK_MONOTONIC, &epoch);
+    atexit(&trace_flush);
+}
+
+static long now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (t.tv_sec - epoch.tv_sec) * 1000000000L + (t.tv_nsec - epoch.tv_nsec);
+}
+
+double seconds_since(struct timespec* start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// The buffer of this thread, made on its first event
+static struct trace_buffer* thread_buffer(void) {
+    if (buffer) {
+        return buffer;
+    }
+    pthread_once(&started, &trace_start);
+    buffer = calloc(1, sizeof(struct trace_buffer));
+    assert(buffer);
+
+    pthread_mutex_lock(&buffers_lock);
+    buffer->thread = threads++;
+    buffer->next = buffers;
+    buffers = buffer;
+    pthread_mutex_unlock(&buffers_lock);
+    return buffer;
+}
+
+// The names are literals, so the same pointer is the same name within a file
+static struct trace_total* find_total(struct trace_buffer* b, const char* name,
+                                      int counter) {
+    for (int i = 0; i < b->n_totals; i++) {
+        if (b->totals[i].name == name) {
+            return &b->totals[i];
+        }
+    }
+    assert(b->n_totals < TRACE_NAMES);
+    struct trace_total* t = &b->totals[b->n_totals++];
+    t->name = name;
+    t->counter = counter;
+    return t;
+}
+
+void trace_begin(const char* name) {
+    struct trace_buffer* b = thread_buffer();
+    assert(b->depth < TRACE_DEPTH);
+    struct trace_frame* f = &b->stack[b->depth++];
+    f->name = name;
+    f->children = 0;
+    f->begin = now();
+}
+
+void trace_end(const char* name) {
+    long end = now();
+    struct trace_buffer* b = thread_buffer();
+    assert(b->depth > 0 && strcmp(b->stack[b->depth - 1].name, name) == 0);
+    struct trace_frame* f = &b->stack[--b->depth];
+    long time = end - f->begin;
+    if (b->depth) {
+        b->stack[b->depth - 1].children += time;
+    }
+
+    struct trace_total* t = find_total(b, f->name, 0);
+    ++t->calls;
+    t->total += time;
+    t->self += time - f->children;
+
+    if (b->n_events == TRACE_EVENTS) {
+        ++b->dropped;
+        return;
+    }
+    if (b->n_events == b->events_size) {
+        b->events_size = b->events_size ? 2 * b->events_size : 1024;
+        b->events = realloc(b->events,
+                            b->events_size * sizeof(struct trace_event));
+        assert(b->events);
+    }
+    struct trace_event* e = &b->events[b->n_events++];
+    e->name = f->name;
+    e->begin = f->begin;
+    e->end = end;
+}
+
+void trace_count(const char* name, long n) {
+    find_total(thread_buffer(), name, 1)->calls += n;
+}
+
+static void write_events(FILE* fp) {
+    int first = 1;
+    long end = now();
+    fprintf(fp, "{\"traceEvents\":[\n");
+    for (struct trace_buffer* b = buffers; b; b = b->next) {
+        fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                first ? "" : ",\n", b->thread, b->thread);
+        first = 0;
+        for (int i = 0; i < b->n_events; i++) {
+            struct trace_event* e = &b->events[i];
+            fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+                    "\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", e->name,
+                    b->thread, e->begin / 1e3, (e->end - e->begin) / 1e3);
+        }
+        // The counters as their values at the end
+        for (int i = 0; i < b->n_totals; i++) {
+            struct trace_total* t = &b->totals[i];
+            if (t->counter) {
+                fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,"
+                        "\"tid\":%d,\"ts\":%.3f,\"args\":{\"%s\":%ld}}",
+                        t->name, b->thread, end / 1e3, t->name, t->calls);
+            }
+        }
+    }
+    fprintf(fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+}
+
+// Adds up the totals of all threads by name
+static int merge_totals(struct trace_total* merged, int size) {
+    int n = 0;
+    for (struct trace_buffer* b = buffers; b; b = b->next) {
+        for (int i = 0; i < b->n_totals; i++) {
+            struct trace_total* t = &b->totals[i];
+            int j = 0;
+            while (j < n && (merged[j].counter != t->counter ||
+                             strcmp(merged[j].name, t->name) != 0)) {
+                ++j;
+            }
+            if (j == n) {
+                assert(n < size);
+                merged[n] = *t;
+                merged[n].calls = merged[n].total = merged[n].self = 0;
+                ++n;
+            }
+            merged[j].calls += t->calls;
+            merged[j].total += t->total;
+            merged[j].self  += t->self;
+        }
+    }
+    return n;
+}
+
+static int by_self_time(const void* a, const void* b) {
+    const struct trace_total* x = a;
+    const struct trace_total* y = b;
+    if (x->counter != y->counter) {
+        return x->counter - y->counter;
+    }
+    return (y->self > x->self) - (y->self < x->self);
+}
+
+static void write_table(FILE* fp, char* path) {
+    struct trace_total* merged = malloc(threads * TRACE_NAMES *
+                                        sizeof(struct trace_total));
+    assert(merged);
+    int n = merge_totals(merged, threads * TRACE_NAMES);
+    qsort(merged, n, sizeof(struct trace_total), &by_self_time);
+
+    long self = 0, events = 0, dropped = 0;
+    for (int i = 0; i < n; i++) {
+        self += merged[i].self;
+    }
+    for (struct trace_buffer* b = buffers; b; b = b->next) {
+        events += b->n_events;
+        dropped += b->dropped;
+    }
+
+    fprintf(fp, "trace: %-24s %10s %12s %12s %7s\n", "span", "calls",
+            "total ms", "self ms", "self %");
+    for (int i = 0; i < n && !merged[i].counter; i++) {
+        struct trace_total* t = &merged[i];
+        fprintf(fp, "trace: %-24s %10ld %12.3f %12.3f %7.2f\n", t->name,
+                t->calls, t->total / 1e6, t->self / 1e6,
+                self ? 100.0 * t->self / self : 0);
+    }
+    for (int i = 0; i < n; i++) {
+        if (merged[i].counter) {
+            fprintf(fp, "trace: %-24s %10ld\n", merged[i].name,
+                    merged[i].calls);
+        }
+    }
+    fprintf(fp, "trace: %d threads, %ld events written to %s, %ld only in "
+            "the table\n", threads, events, path, dropped);
+    free(merged);
+}
+
+void trace_flush(void) {
+    if (!buffers) {
+        return;
+    }
+    char* path = getenv("MAXFLOW_TRACE_FILE");
+    path = path ? path : "trace.json";
+
+    FILE* fp = fopen(path, "w");
+    if (fp) {
+        write_events(fp);
+        fclose(fp);
+    }
+    else {
+        fprintf(stderr, "trace: can not write %s\n", path);
+    }
+    write_table(stderr, path);
+}
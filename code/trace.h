@@ -0,0 +1,67 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <time.h>
+
+/* Tracing of where the time goes. A span is the time between TRACE_BEGIN and
+ * TRACE_END with the same name in one thread, and spans nest. A counter is a
+ * number added to with TRACE_COUNT. Each thread records into a buffer of its
+ * own, without locks. At exit the spans are written as Chrome trace events
+ * (chrome://tracing or ui.perfetto.dev) to the file MAXFLOW_TRACE_FILE, or
+ * trace.json, and a table with the calls, total and self time of each span
+ * and the value of each counter is printed to stderr.
+ *
+ * The macros are only compiled in with MAXFLOW_TRACE defined, 'make trace',
+ * and do nothing otherwise. The names must be string literals. */
+
+/* Events a thread keeps for the trace file. The spans after these are only
+ * in the table. */
+#define TRACE_EVENTS (1 << 16)
+
+/* Spans a thread can have open at once */
+#define TRACE_DEPTH 64
+
+/* Opens a span in this thread
+ * Args:    - The name of the span
+ * Return:  Nothing */
+void trace_begin(const char* name);
+
+/* Closes the innermost open span of this thread, which must have the name
+ * Args:    - The name of the span
+ * Return:  Nothing */
+void trace_end(const char* name);
+
+/* Adds to a counter of this thread
+ * Args:    - The name of the counter
+ *          - What to add
+ * Return:  Nothing */
+void trace_count(const char* name, long n);
+
+/* Writes the trace file and the table. Called at exit, when the other
+ * threads must be done. It can be called before, and then writes what was
+ * recorded until then.
+ * Args:    None
+ * Return:  Nothing */
+void trace_flush(void);
+
+/* The seconds from a time taken with clock_gettime(CLOCK_MONOTONIC) until now,
+ * for the timings printed with or without tracing
+ * Args:    - The start time
+ * Return:  The seconds since then */
+double seconds_since(struct timespec* start);
+
+#ifdef MAXFLOW_TRACE
+
+#define TRACE_BEGIN(name)       trace_begin(name)
+#define TRACE_END(name)         trace_end(name)
+#define TRACE_COUNT(name, n)    trace_count(name, n)
+
+#else
+
+#define TRACE_BEGIN(name)       ((void)0)
+#define TRACE_END(name)         ((void)0)
+#define TRACE_COUNT(name, n)    ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,428 @@
+#include "unitcap.h"
+#include "pushrelabel.h"
+#include "graph.h"
+#include "list.h"
+#include "edge.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+
+// Collects the original edges with capacity 1.
+// Return: The number of edges
+static int collect_unit_arcs(struct graph* g, struct edge*** out) {
+    int m = 0;
+    for (int u = 0; u < g->size; u++) {
+        m += g->adj_array[u]->size;
+    }
+    struct edge** arcs = malloc((m / 2 + 1) * sizeof(struct edge*));
+    assert(arcs != NULL);
+
+    m = 0;
+    for (int u = 0; u < g->size; u++) {
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            if (e->original && e->capacity == 1) {
+                arcs[m++] = e;
+            }
+        }
+    }
+    *out = arcs;
+    return m;
+}
+
+// Sets the flow on the terminals' virtual arcs from the flow on the edges
+static void set_terminal_flows(struct graph* g) {
+    for (int u = 0; u < g->size; u++) {
+        int net = 0; // Flow into u minus flow out of u
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            net += e->original ? -e->flow : e->reverse_edge->flow;
+        }
+        g->supplied[u] = g->supply[u] ? -net : 0;
+        g->absorbed[u] = g->demand[u] ?  net : 0;
+    }
+}
+
+enum unit_kind unit_classify(struct graph* g, int* side) {
+    int n = g->size, bipartite = 1;
+    int* s     = side ? side : malloc(n * sizeof(int));
+    int* count = calloc(n, sizeof(int)); // Arcs in to L or out of R
+    assert(s != NULL && count != NULL);
+
+    for (int v = 0; v < n; v++) {
+        s[v] = 0;
+        if ((g->supply[v] && g->supply[v] != TERMINAL_UNBOUNDED) ||
+            (g->demand[v] && g->demand[v] != TERMINAL_UNBOUNDED)) {
+            bipartite = -1;
+        }
+    }
+
+    // Find L as the heads of arcs from the sources and R as the tails of arcs
+    // to the sinks
+    for (int u = 0; u < n && bipartite != -1; u++) {
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            int v = e->to;
+            if (!e->original || e->capacity == 0) {
+                continue;
+            }
+            if (e->capacity > 1) {
+                bipartite = -1;
+                break;
+            }
+
+            if (g->supply[v] || g->demand[u]) {
+                bipartite = 0; // Into a source or out of a sink
+            } else if (g->supply[u] && g->demand[v]) {
+                continue;      // Directly from a source to a sink
+            } else if (g->supply[u]) {
+                bipartite = s[v] == 2 ? 0 : bipartite;
+                s[v] = 1;
+                ++count[v];
+            } else if (g->demand[v]) {
+                bipartite = s[u] == 1 ? 0 : bipartite;
+                s[u] = 2;
+                ++count[u];
+            }
+        }
+    }
+
+    // All other arcs must go from L to R
+    for (int u = 0; u < n && bipartite == 1; u++) {
+        if (s[u] && count[u] != 1) {
+            bipartite = 0;
+        }
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            int v = e->to;
+            if (e->original && e->capacity == 1 && !g->supply[u] &&
+                !g->demand[v] && (s[u] != 1 || s[v] != 2)) {
+                bipartite = 0;
+            }
+        }
+    }
+
+    free(count);
+    if (!side) {
+        free(s);
+    }
+    if (bipartite == -1) {
+        return UNIT_NONE;
+    }
+    return bipartite ? UNIT_BIPARTITE : UNIT_CAPACITY;
+}
+
+int hopcroft_karp(struct graph* g, int* side) {
+    int n = g->size, m, nl = 0, nr = 0, matching = 0;
+    struct edge** arcs;
+    m = collect_unit_arcs(g, &arcs);
+
+    // Number the vertices of L and R from 0
+    int* index = malloc(n * sizeof(int));
+    struct edge** in_edge  = malloc(n * sizeof(struct edge*)); // Source to l
+    struct edge** out_edge = malloc(n * sizeof(struct edge*)); // r to sink
+    assert(index != NULL && in_edge != NULL && out_edge != NULL);
+    for (int v = 0; v < n; v++) {
+        index[v] = side[v] == 1 ? nl++ : side[v] == 2 ? nr++ : -1;
+    }
+
+    // L's arcs to R, grouped by l
+    int* first = calloc(nl + 1, sizeof(int));
+    int* adj   = malloc((m + 1) * sizeof(int));
+    struct edge** adj_edge = malloc((m + 1) * sizeof(struct edge*));
+    assert(first != NULL && adj != NULL && adj_edge != NULL);
+
+    for (int k = 0; k < m; k++) {
+        struct edge* e = arcs[k];
+        e->flow = 0;
+        if (side[e->from] == 1 && side[e->to] == 2) {
+            ++first[index[e->from] + 1];
+        } else if (side[e->to] == 1) {
+            in_edge[index[e->to]] = e;
+        } else if (side[e->from] == 2) {
+            out_edge[index[e->from]] = e;
+        } else {
+            // Directly from a source to a sink
+            e->flow = 1;
+            ++matching;
+        }
+    }
+    for (int l = 0; l < nl; l++) {
+        first[l + 1] += first[l];
+    }
+    int* fill = malloc((nl + 1) * sizeof(int));
+    assert(fill != NULL);
+    memcpy(fill, first, (nl + 1) * sizeof(int));
+    for (int k = 0; k < m; k++) {
+        struct edge* e = arcs[k];
+        if (side[e->from] == 1 && side[e->to] == 2) {
+            int at = fill[index[e->from]]++;
+            adj[at] = index[e->to];
+            adj_edge[at] = e;
+        }
+    }
+
+    int* mate_l = malloc((nl + 1) * sizeof(int)); // Index in adj of l's match
+    int* mate_r = malloc((nr + 1) * sizeof(int)); // The l matched with r
+    int* dist   = malloc((nl + 1) * sizeof(int));
+    int* queue  = malloc((nl + 1) * sizeof(int));
+    int* it     = malloc((nl + 1) * sizeof(int));
+    int* stack  = malloc((nl + 1) * sizeof(int));
+    assert(mate_l && mate_r && dist && queue && it && stack);
+    for (int l = 0; l < nl; l++) {
+        mate_l[l] = -1;
+    }
+    for (int r = 0; r < nr; r++) {
+        mate_r[r] = -1;
+    }
+
+    while (1) {
+        // Layer L by alternating paths from the free vertices in L. 'found' is
+        // the length of the shortest augmenting paths.
+        int head = 0, tail = 0, found = INT_MAX;
+        for (int l = 0; l < nl; l++) {
+            dist[l] = mate_l[l] == -1 ? 0 : INT_MAX;
+            if (mate_l[l] == -1) {
+                queue[tail++] = l;
+            }
+        }
+        while (head < tail) {
+            int l = queue[head++];
+            if (dist[l] >= found) {
+                continue;
+            }
+            for (int i = first[l]; i < first[l + 1]; i++) {
+                int l2 = mate_r[adj[i]];
+                if (l2 == -1) {
+                    found = found == INT_MAX ? dist[l] + 1 : found;
+                } else if (dist[l2] == INT_MAX) {
+                    dist[l2] = dist[l] + 1;
+                    queue[tail++] = l2;
+                }
+            }
+        }
+        if (found == INT_MAX) {
+            break;
+        }
+
+        // Find vertex disjoint shortest augmenting paths by depth first
+        // search, where 'it' is each l's current arc
+        memcpy(it, first, nl * sizeof(int));
+        for (int l0 = 0; l0 < nl; l0++) {
+            if (mate_l[l0] != -1) {
+                continue;
+            }
+            int top = 0;
+            stack[top] = l0;
+            while (top >= 0) {
+                int l = stack[top];
+                if (it[l] == first[l + 1]) {
+                    // Dead end
+                    dist[l] = INT_MAX;
+                    if (--top >= 0) {
+                        ++it[stack[top]];
+                    }
+                    continue;
+                }
+                int l2 = mate_r[adj[it[l]]];
+                if (l2 == -1 && dist[l] + 1 == found) {
+                    // Augment: each l on the stack is matched with the r its
+                    // current arc goes to
+                    for (int i = 0; i <= top; i++) {
+                        mate_l[stack[i]] = it[stack[i]];
+                        mate_r[adj[it[stack[i]]]] = stack[i];
+                    }
+                    ++matching;
+                    break;
+                } else if (l2 != -1 && dist[l2] == dist[l] + 1) {
+                    stack[++top] = l2;
+                } else {
+                    ++it[l];
+                }
+            }
+        }
+    }
+
+    // Put the matching in the graph as flow
+    for (int v = 0; v < n; v++) {
+        if (side[v] == 1 && mate_l[index[v]] != -1) {
+            int at = mate_l[index[v]];
+            in_edge[index[v]]->flow = 1;
+            adj_edge[at]->flow = 1;
+            out_edge[adj[at]]->flow = 1;
+        }
+    }
+    set_terminal_flows(g);
+
+    free(arcs);
+    free(index);
+    free(in_edge);
+    free(out_edge);
+    free(first);
+    free(adj);
+    free(adj_edge);
+    free(fill);
+    free(mate_l);
+    free(mate_r);
+    free(dist);
+    free(queue);
+    free(it);
+    free(stack);
+    return matching;
+}
+
+int unit_dinic(struct graph* g) {
+    int n = g->size, m, maxflow = 0;
+    struct edge** arcs;
+    m = collect_unit_arcs(g, &arcs);
+
+    // Each vertex' residual arcs are entries (k << 1 | backward) in adj. The
+    // flow on arc k is a bit, so it is residual forward when the bit is 0 and
+    // backward when it is 1.
+    int* first = calloc(n + 1, sizeof(int));
+    int* adj   = malloc((2 * m + 1) * sizeof(int));
+    unsigned long* flow = calloc(BITSET_WORDS(m) + 1, sizeof(unsigned long));
+    assert(first != NULL && adj != NULL && flow != NULL);
+
+    for (int k = 0; k < m; k++) {
+        ++first[arcs[k]->from + 1];
+        ++first[arcs[k]->to + 1];
+    }
+    for (int u = 0; u < n; u++) {
+        first[u + 1] += first[u];
+    }
+    int* fill = malloc((n + 1) * sizeof(int));
+    assert(fill != NULL);
+    memcpy(fill, first, (n + 1) * sizeof(int));
+    for (int k = 0; k < m; k++) {
+        adj[fill[arcs[k]->from]++] = k << 1;
+        adj[fill[arcs[k]->to]++]   = k << 1 | 1;
+    }
+
+    int* level   = malloc(n * sizeof(int));
+    int* queue   = malloc(n * sizeof(int));
+    int* cur     = malloc(n * sizeof(int));
+    int* stack_v = malloc((n + 1) * sizeof(int));
+    int* stack_a = malloc((n + 1) * sizeof(int));
+    assert(level && queue && cur && stack_v && stack_a);
+
+    while (1) {
+        // Level the residual graph from the sources. Vertices at the level of
+        // the nearest sink or further are not expanded.
+        int head = 0, tail = 0, sink_level = INT_MAX;
+        for (int u = 0; u < n; u++) {
+            level[u] = g->supply[u] ? 0 : -1;
+            if (g->supply[u]) {
+                queue[tail++] = u;
+            }
+        }
+        while (head < tail) {
+            int u = queue[head++];
+            if (level[u] >= sink_level) {
+                continue;
+            }
+            if (g->demand[u]) {
+                sink_level = level[u];
+                continue;
+            }
+            for (int i = first[u]; i < first[u + 1]; i++) {
+                int k = adj[i] >> 1, backward = adj[i] & 1;
+                int v = backward ? arcs[k]->from : arcs[k]->to;
+                if (level[v] == -1 && (int)BIT_GET(flow, k) == backward) {
+                    level[v] = level[u] + 1;
+                    queue[tail++] = v;
+                }
+            }
+        }
+        if (sink_level == INT_MAX) {
+            break;
+        }
+
+        // Blocking flow by depth first search from each source. A path to a
+        // sink has room for 1 unit, and flipping the bits of its arcs
+        // augments it.
+        memcpy(cur, first, n * sizeof(int));
+        for (int s = 0; s < n; s++) {
+            if (!g->supply[s]) {
+                continue;
+            }
+            int top = 0;
+            stack_v[0] = s;
+            while (top >= 0) {
+                int u = stack_v[top];
+                if (top > 0 && g->demand[u]) {
+                    for (int i = 1; i <= top; i++) {
+                        BIT_FLIP(flow, stack_a[i] >> 1);
+                    }
+                    ++maxflow;
+                    top = 0;
+                    continue;
+                }
+
+                while (cur[u] < first[u + 1]) {
+                    int k = adj[cur[u]] >> 1, backward = adj[cur[u]] & 1;
+                    int v = backward ? arcs[k]->from : arcs[k]->to;
+                    if (level[v] == level[u] + 1 &&
+                        (int)BIT_GET(flow, k) == backward) {
+                        break;
+                    }
+                    ++cur[u];
+                }
+
+                if (cur[u] < first[u + 1]) {
+                    int entry = adj[cur[u]];
+                    stack_a[top + 1] = entry;
+                    stack_v[top + 1] = entry & 1 ? arcs[entry >> 1]->from
+                                                 : arcs[entry >> 1]->to;
+                    ++top;
+                } else {
+                    // Dead end. Retreat and skip the arc that led here.
+                    level[u] = -1;
+                    if (--top >= 0) {
+                        ++cur[stack_v[top]];
+                    }
+                }
+            }
+        }
+    }
+
+    for (int k = 0; k < m; k++) {
+        arcs[k]->flow = BIT_GET(flow, k);
+    }
+    set_terminal_flows(g);
+
+    free(arcs);
+    free(first);
+    free(adj);
+    free(flow);
+    free(fill);
+    free(level);
+    free(queue);
+    free(cur);
+    free(stack_v);
+    free(stack_a);
+    return maxflow;
+}
+
+int unit_solve(struct graph* g) {
+    int* side = malloc(g->size * sizeof(int));
+    assert(side != NULL);
+    int maxflow;
+
+    switch (unit_classify(g, side)) {
+        case UNIT_BIPARTITE:
+            maxflow = hopcroft_karp(g, side);
+            break;
+        case UNIT_CAPACITY:
+            maxflow = unit_dinic(g);
+            break;
+        default:
+            maxflow = relabel_to_front(g);
+            break;
+    }
+    free(side);
+    return maxflow;
+}
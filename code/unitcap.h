@@ -0,0 +1,54 @@
+#ifndef UNITCAP_H
+#define UNITCAP_H
+
+#include "graph.h"
+
+/* What kind of unit capacity network a graph is.
+ * UNIT_NONE:      Some capacity is larger than 1 or a terminal is bounded.
+ * UNIT_CAPACITY:  All capacities are 0 or 1.
+ * UNIT_BIPARTITE: Unit capacities and a bipartite matching: the sources have
+ *                 arcs to a set L, L has arcs to a set R and R has arcs to the
+ *                 sinks. Every vertex in L has one arc in and every vertex in
+ *                 R one arc out. Arcs directly from a source to a sink are
+ *                 allowed. */
+enum unit_kind {
+    UNIT_NONE,
+    UNIT_CAPACITY,
+    UNIT_BIPARTITE
+};
+
+/* A set of bits, one per arc or vertex */
+#define BITS_PER_WORD (8 * sizeof(unsigned long))
+#define BITSET_WORDS(n) (((n) + BITS_PER_WORD - 1) / BITS_PER_WORD)
+#define BIT_GET(set, i) (((set)[(i) / BITS_PER_WORD] >> ((i) % BITS_PER_WORD)) & 1UL)
+#define BIT_SET(set, i) ((set)[(i) / BITS_PER_WORD] |= 1UL << ((i) % BITS_PER_WORD))
+#define BIT_CLEAR(set, i) ((set)[(i) / BITS_PER_WORD] &= ~(1UL << ((i) % BITS_PER_WORD)))
+#define BIT_FLIP(set, i) ((set)[(i) / BITS_PER_WORD] ^= 1UL << ((i) % BITS_PER_WORD))
+
+/* Finds out if the graph is a unit capacity network, and if it is a bipartite
+ * matching
+ * Args:    - Pointer to the graph
+ *          - Array that is set to 1 for vertices in L and 2 for vertices in R
+ *            when the graph is bipartite. Can be NULL.
+ * Return:  The kind of network */
+enum unit_kind unit_classify(struct graph* g, int* side);
+
+/* Hopcroft-Karp maximum matching on a graph that is UNIT_BIPARTITE
+ * Args:    - Pointer to the graph
+ *          - The sides of the vertices from unit_classify
+ * Return:  The maximum flow, being the size of the matching */
+int hopcroft_karp(struct graph* g, int* side);
+
+/* Dinic's algorithm for graphs with capacities 0 or 1. The flow on each arc is
+ * a single bit.
+ * Args:    - Pointer to the graph
+ * Return:  The maximum flow */
+int unit_dinic(struct graph* g);
+
+/* Solves the graph with Hopcroft-Karp if it is a bipartite matching, with
+ * unit_dinic if it has unit capacities and else with relabel_to_front
+ * Args:    - Pointer to the graph
+ * Return:  The maximum flow */
+int unit_solve(struct graph* g);
+
+#endif
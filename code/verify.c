@@ -0,0 +1,352 @@
+#define _GNU_SOURCE
+#include "verify.h"
+#include "maxflow.h"
+#include "loaddimacs.h"
+#include "solver.h"
+#include "dobfs.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+
+// What a thread found in its range of vertices
+struct verify_part {
+    long value;
+    long supplied;
+    long cut;
+    int source_side;
+    long capacity_errors;
+    long conservation_errors;
+    int reached_sink;
+    int first_error;
+};
+
+// What the threads share. 'side' is 1 for the vertices found reachable.
+// The frontier of a level is taken in chunks from 'taken' on, and the
+// vertices found are added to 'next' at 'next_size'.
+struct verify_shared {
+    struct graph* g;
+    int threads;
+    long* net;              // Flow into the vertex less the flow out
+    char* side;
+    int* frontier;
+    int* next;
+    int size;
+    int next_size;
+    int taken;
+    pthread_barrier_t barrier;
+    struct verify_part* parts;
+};
+
+struct verify_thread {
+    struct verify_shared* sh;
+    int id;
+};
+
+static void wait_all(struct verify_shared* sh) {
+    if (sh->threads > 1) {
+        pthread_barrier_wait(&sh->barrier);
+    }
+}
+
+static void add_error(struct verify_part* p, int v) {
+    if (p->first_error == -1 || v < p->first_error) {
+        p->first_error = v;
+    }
+}
+
+// The capacities of the edges out of v. The flow on them is added to the
+// net flow into the vertices they go to and taken from v's.
+static void check_edges(struct verify_shared* sh, int v,
+                        struct verify_part* p) {
+    long out = 0;
+    for (struct element* cur = sh->g->adj_array[v]->head; cur;
+         cur = cur->next) {
+        struct edge* e = cur->this;
+        if (!e->original) {
+            continue;
+        }
+        if (e->flow < 0 || e->capacity < e->flow) {
+            ++p->capacity_errors;
+            add_error(p, v);
+        }
+        out += e->flow;
+        __atomic_fetch_add(&sh->net[e->to], e->flow, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_sub(&sh->net[v], out, __ATOMIC_RELAXED);
+}
+
+// The flow in, with the supply, is the flow out, with the absorbed flow
+static void check_vertex(struct verify_shared* sh, int v,
+                         struct verify_part* p) {
+    struct graph* g = sh->g;
+    int supply_ok = 0 <= g->supplied[v] &&
+                    (g->supply[v] == TERMINAL_UNBOUNDED ||
+                     g->supplied[v] <= g->supply[v]);
+    int demand_ok = 0 <= g->absorbed[v] &&
+                    (g->demand[v] == TERMINAL_UNBOUNDED ||
+                     g->absorbed[v] <= g->demand[v]);
+    if (sh->net[v] + g->supplied[v] - g->absorbed[v] != 0 || !supply_ok ||
+        !demand_ok) {
+        ++p->conservation_errors;
+        add_error(p, v);
+    }
+    p->value += g->absorbed[v];
+    p->supplied += g->supplied[v];
+}
+
+// Searches from the vertices of a level with residual capacity to ones not
+// yet found, and adds those to the next level
+static void expand_level(struct verify_shared* sh) {
+    struct graph* g = sh->g;
+    int found[VERIFY_CHUNK * 4];
+    int n_found = 0;
+
+    while (1) {
+        int from = __atomic_fetch_add(&sh->taken, VERIFY_CHUNK,
+                                      __ATOMIC_RELAXED);
+        if (from >= sh->size) {
+            break;
+        }
+        int to = from + VERIFY_CHUNK < sh->size ? from + VERIFY_CHUNK : sh->size;
+        for (int i = from; i < to; i++) {
+            int u = sh->frontier[i];
+            for (struct element* cur = g->adj_array[u]->head; cur;
+                 cur = cur->next) {
+                struct edge* e = cur->this;
+                if (get_cfe(e) <= 0 ||
+                    __atomic_load_n(&sh->side[e->to], __ATOMIC_RELAXED) ||
+                    __atomic_exchange_n(&sh->side[e->to], 1,
+                                        __ATOMIC_RELAXED)) {
+                    continue;
+                }
+                found[n_found++] = e->to;
+                // Added to the next level a few at a time
+                if (n_found == VERIFY_CHUNK * 4) {
+                    int at = __atomic_fetch_add(&sh->next_size, n_found,
+                                                __ATOMIC_RELAXED);
+                    memcpy(sh->next + at, found, n_found * sizeof(int));
+                    n_found = 0;
+                }
+            }
+        }
+    }
+    int at = __atomic_fetch_add(&sh->next_size, n_found, __ATOMIC_RELAXED);
+    memcpy(sh->next + at, found, n_found * sizeof(int));
+}
+
+static void* verify_worker(void* arg) {
+    struct verify_thread* t = arg;
+    struct verify_shared* sh = t->sh;
+    struct graph* g = sh->g;
+    struct verify_part* p = &sh->parts[t->id];
+    int first = (long)g->size * t->id / sh->threads;
+    int last  = (long)g->size * (t->id + 1) / sh->threads;
+
+    for (int v = first; v < last; v++) {
+        check_edges(sh, v, p);
+    }
+    wait_all(sh);
+
+    // Conservation, and the sources with supply left
+    for (int v = first; v < last; v++) {
+        check_vertex(sh, v, p);
+        sh->side[v] = graph_supply_left(g, v) > 0;
+        if (sh->side[v]) {
+            int at = __atomic_fetch_add(&sh->size, 1, __ATOMIC_RELAXED);
+            sh->frontier[at] = v;
+        }
+    }
+    wait_all(sh);
+
+    // The residual graph from the sources, a level at a time
+    while (sh->size) {
+        expand_level(sh);
+        wait_all(sh);
+        if (t->id == 0) {
+            int* level = sh->frontier;
+            sh->frontier = sh->next;
+            sh->next = level;
+            sh->size = sh->next_size;
+            sh->next_size = 0;
+            sh->taken = 0;
+        }
+        wait_all(sh);
+    }
+
+    // The capacity of the cut like get_min_cut
+    for (int u = first; u < last; u++) {
+        if (!sh->side[u]) {
+            if (g->supply[u]) {
+                p->cut += g->supply[u];
+            }
+            continue;
+        }
+        ++p->source_side;
+        if (g->demand[u]) {
+            p->cut += g->demand[u];
+        }
+        if (graph_demand_left(g, u) > 0 && p->reached_sink == -1) {
+            p->reached_sink = u;
+        }
+        for (struct element* cur = g->adj_array[u]->head; cur; cur = cur->next) {
+            struct edge* e = cur->this;
+            if (e->original && !sh->side[e->to]) {
+                p->cut += e->capacity;
+            }
+        }
+    }
+    return NULL;
+}
+
+int verify_flow(struct graph* g, int threads, struct flow_verdict* v) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    threads = threads < 1 ? 1 : threads;
+
+    struct verify_shared sh;
+    sh.g = g;
+    sh.threads = threads;
+    sh.net = calloc(g->size + 1, sizeof(long));
+    sh.side = malloc(g->size + 1);
+    sh.frontier = malloc((g->size + 1) * sizeof(int));
+    sh.next = malloc((g->size + 1) * sizeof(int));
+    sh.parts = calloc(threads, sizeof(struct verify_part));
+    struct verify_thread* t = malloc(threads * sizeof(struct verify_thread));
+    pthread_t* workers = malloc(threads * sizeof(pthread_t));
+    assert(sh.net && sh.side && sh.frontier && sh.next && sh.parts && t && workers);
+    sh.size = 0;
+    sh.next_size = 0;
+    sh.taken = 0;
+    if (threads > 1) {
+        pthread_barrier_init(&sh.barrier, NULL, threads);
+    }
+
+    // The calling thread is the first one
+    for (int i = 0; i < threads; i++) {
+        t[i].sh = &sh;
+        t[i].id = i;
+        sh.parts[i].reached_sink = -1;
+        sh.parts[i].first_error = -1;
+    }
+    for (int i = 1; i < threads; i++) {
+        int created = pthread_create(&workers[i], NULL, &verify_worker, &t[i]);
+        assert(created == 0);
+    }
+    verify_worker(&t[0]);
+    for (int i = 1; i < threads; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    memset(v, 0, sizeof(struct flow_verdict));
+    v->reached_sink = -1;
+    v->first_error = -1;
+    for (int i = 0; i < threads; i++) {
+        struct verify_part* p = &sh.parts[i];
+        v->value += p->value;
+        v->supplied += p->supplied;
+        v->cut += p->cut;
+        v->source_side += p->source_side;
+        v->capacity_errors += p->capacity_errors;
+        v->conservation_errors += p->conservation_errors;
+        if (v->reached_sink == -1) {
+            v->reached_sink = p->reached_sink;
+        }
+        if (v->first_error == -1) {
+            v->first_error = p->first_error;
+        }
+    }
+    v->feasible = !v->capacity_errors && !v->conservation_errors &&
+                  v->value == v->supplied;
+    v->maximum = v->feasible && v->reached_sink == -1 && v->cut == v->value;
+    v->seconds = seconds_since(&start);
+
+    if (threads > 1) {
+        pthread_barrier_destroy(&sh.barrier);
+    }
+    free(sh.net);
+    free(sh.side);
+    free(sh.frontier);
+    free(sh.next);
+    free(sh.parts);
+    free(t);
+    free(workers);
+    return v->maximum;
+}
+
+void verify_print(struct flow_verdict* v, long reported, FILE* fp) {
+    if (v->maximum && v->value == reported) {
+        fprintf(fp, "verify: maximum flow %ld, equal to the cut with %d "
+                "vertices on the source side, checked in %.3f ms\n", v->value,
+                v->source_side, v->seconds * 1000);
+        return;
+    }
+    fprintf(fp, "verify: FAILED, reported %ld, flow into the sinks %ld, out "
+            "of the sources %ld", reported, v->value, v->supplied);
+    if (!v->feasible) {
+        fprintf(fp, ", %ld capacity and %ld conservation errors, the first "
+                "at vertex %d", v->capacity_errors, v->conservation_errors,
+                v->first_error + 1);
+    }
+    if (v->reached_sink != -1) {
+        fprintf(fp, ", sink %d with demand left is reachable\n",
+                v->reached_sink + 1);
+    }
+    else {
+        fprintf(fp, ", cut %ld\n", v->cut);
+    }
+}
+
+// Solves and checks each graph with one solver
+// Return: 1 if a flow was not a maximum flow, 0 if not
+static int verify_solver(struct solver* solver, char** paths, int n_paths,
+                         int threads, FILE* fp) {
+    int maximum = 0;
+    double solving = 0, checking = 0;
+    for (int i = 0; i < n_paths; i++) {
+        struct graph* g = read_dimacs_file(paths[i]);
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int mf = solver->solve(g);
+        solving += seconds_since(&start);
+
+        struct flow_verdict v;
+        verify_flow(g, threads, &v);
+        checking += v.seconds;
+        maximum += v.maximum && v.value == mf;
+        fprintf(fp, "%s: ", paths[i]);
+        verify_print(&v, mf, fp);
+        graph_free(g);
+    }
+    fprintf(fp, "verify: %s gave a maximum flow on %d of %d graphs, solved "
+            "in %.3f ms and checked in %.3f ms by %d threads\n", solver->name,
+            maximum, n_paths, solving * 1000, checking * 1000, threads);
+    return maximum != n_paths;
+}
+
+int verify_run(char* algorithm, char** paths, int n_paths, int threads,
+               FILE* fp) {
+    if (threads == 0) {
+        threads = bfs_default_threads();
+    }
+    if (strcmp(algorithm, "all") != 0) {
+        struct solver* solver = solver_find(algorithm);
+        if (!solver) {
+            fprintf(stderr, "No such algorithm: %s\n", algorithm);
+            return 1;
+        }
+        return verify_solver(solver, paths, n_paths, threads, fp);
+    }
+
+    int failed = 0;
+    for (int i = 0; solver_at(i); i++) {
+        failed += verify_solver(solver_at(i), paths, n_paths, threads, fp);
+    }
+    fprintf(fp, "verify: %d solvers gave a flow that was not a maximum flow\n",
+            failed);
+    return failed != 0;
+}
@@ -0,0 +1,67 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "graph.h"
+
+#include <stdio.h>
+
+/* Checks a flow left in a graph by a solver, without solving the graph
+ * again. The flow must keep within the capacities, the flow into each vertex
+ * must equal the flow out of it, with what a source supplied and a sink
+ * absorbed counted in, and no terminal may pass on more than its supply or
+ * demand. The flow is maximum if its value equals the capacity of a cut:
+ * the vertices reachable from the sources with supply left in the residual
+ * graph, which must hold no sink with demand left.
+ *
+ * It takes O(|V| + |E|) time split between threads. The vertices are split
+ * in equal ranges for the checks and the cut, and the search from the
+ * sources goes level by level, with the threads taking chunks of a level. */
+
+/* Vertices of a level a thread takes at a time */
+#define VERIFY_CHUNK 64
+
+/* What the check found */
+struct flow_verdict {
+    long value;             // The flow into the sinks
+    long supplied;          // The flow out of the sources
+    long cut;               // The capacity of the cut, if it is one
+    int source_side;        // Vertices reachable from the sources
+    long capacity_errors;   // Edges with flow below 0 or above capacity
+    long conservation_errors; // Vertices where the flow is not conserved or
+                              // that supply or absorb more than they may
+    int reached_sink;       // A sink with demand left that is reachable, -1
+                            // if there is none
+    int first_error;        // The least vertex with an error, -1 if none
+    int feasible;           // 1 if there are no errors
+    int maximum;            // 1 if feasible and the value is the cut's
+    double seconds;
+};
+
+/* Checks the flow in a graph
+ * Args:    - Pointer to the graph holding the flow
+ *          - Number of threads, 1 to check in the calling thread only
+ *          - The verdict to fill in
+ * Return:  1 if the flow is a maximum flow, 0 if not */
+int verify_flow(struct graph* g, int threads, struct flow_verdict* v);
+
+/* Prints the verdict on one line. Vertices are numbered from 1 as in the
+ * DIMACS file.
+ * Args:    - Pointer to the verdict
+ *          - The flow the solver reported
+ *          - The file to print to
+ * Return:  Nothing */
+void verify_print(struct flow_verdict* v, long reported, FILE* fp);
+
+/* Solves each graph with an algorithm, checks the flow and prints the
+ * verdicts and how many were maximum flows
+ * Args:    - The name of the algorithm, see solver.h, or "all" for each one
+ *          - The paths to the graphs
+ *          - Number of paths
+ *          - Number of threads, 0 for bfs_default_threads
+ *          - The file to print to
+ * Return:  0 if all the flows were maximum flows, 1 if not or if there is no
+ *          such algorithm */
+int verify_run(char* algorithm, char** paths, int n_paths, int threads,
+               FILE* fp);
+
+#endif